@@ -1,5 +1,6 @@
 #include <ESP8266WiFi.h>
 #include <espnow.h>
+#include <espnow_packet.h>
 #include "config.h"
 
 // Advanced sensor data structure with additional fields
@@ -26,6 +27,8 @@ struct SystemState {
 
 // Global variables
 AdvancedSensorData sensorData;
+uint8_t packet[PACKET_MAX_SIZE];
+uint16_t packetSequence = 0;
 SystemState systemState;
 bool sendSuccess = false;
 uint32_t lastHeartbeat = 0;
@@ -305,9 +308,29 @@ void transmitAdvancedData() {
         return;
     }
     
-    esp_err_t result = esp_now_send(RECEIVER_MAC_ADDRESS, 
-                                 (uint8_t *)&sensorData, 
-                                 sizeof(sensorData));
+    // The distance in the format the receiver reads, then the rest as a
+    // status packet; each is built in place in the send buffer
+    uint8_t receiver[] = RECEIVER_MAC_ADDRESS;
+    DistancePayload* distance = (DistancePayload*)beginPacket(packet, PACKET_DISTANCE, NODE_ID,
+                                                              packetSequence++, micros());
+    distance->rate = 0;
+    distance->count = 1;
+    distance->readings[0].distance = sensorData.distance == INVALID_READING ?
+                                     PACKET_NO_READING : (uint16_t)sensorData.distance;
+    distance->readings[0].confidence = sensorData.distance == INVALID_READING ? 0 : 100;
+    esp_err_t result = esp_now_send(receiver, packet, sealPacket(packet, distancePayloadSize(1)));
+
+    StatusPayload* status = (StatusPayload*)beginPacket(packet, PACKET_STATUS, NODE_ID,
+                                                        packetSequence++, micros());
+    status->battery = sensorData.batteryLevel;
+    status->temperature = (int16_t)(sensorData.temperature * 10);
+    status->humidity = (uint8_t)sensorData.humidity;
+    status->light = sensorData.lightLevel;
+    status->rssi = (int8_t)sensorData.signalStrength;
+    status->errorFlags = sensorData.errorFlags;
+    if (result == ESP_OK) {
+        result = esp_now_send(receiver, packet, sealPacket(packet, sizeof(StatusPayload)));
+    }
     
     if (result == ESP_OK) {
         systemState.lastTransmission = millis();
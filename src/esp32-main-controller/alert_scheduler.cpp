@@ -0,0 +1,249 @@
+#include "alert_scheduler.h"
+#include <string.h>
+
+#define RING_MASK (ALERT_QUEUE_SIZE - 1)
+#define NO_ENTRY 0xFF
+
+AlertScheduler::AlertScheduler()
+    : tail(0), postCount(0), rejectCount(0), head(0),
+      freeList(0), delayedCount(0), wheelTick(0), wheelStarted(false),
+      clockTick(0), clockPhaseMs(0), lastMs(0) {
+    for (uint32_t i = 0; i < ALERT_QUEUE_SIZE; i++) {
+        ring[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    memset(ready, 0, sizeof(ready));
+    for (uint8_t i = 0; i < ALERT_WHEEL_CAPACITY; i++) {
+        pool[i].next = i + 1 < ALERT_WHEEL_CAPACITY ? i + 1 : NO_ENTRY;
+    }
+    memset(slots, NO_ENTRY, sizeof(slots));
+    memset(&stats, 0, sizeof(stats));
+}
+
+// ================= Producer side =================
+
+bool AlertScheduler::post(const AlertRequest& request) {
+    uint32_t pos = tail.load(std::memory_order_relaxed);
+    for (;;) {
+        Cell& cell = ring[pos & RING_MASK];
+        int32_t diff = (int32_t)(cell.sequence.load(std::memory_order_acquire) - pos);
+        if (diff == 0) {
+            if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                cell.request = request;
+                cell.sequence.store(pos + 1, std::memory_order_release);
+                postCount.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        } else if (diff < 0) {
+            // Full: the consumer has not caught up with this cell yet
+            rejectCount.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        } else {
+            pos = tail.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+// ================= Consumer side =================
+
+void AlertScheduler::collect(uint32_t nowMs) {
+    if (!wheelStarted) {
+        clockTick = nowMs / ALERT_WHEEL_TICK_MS;
+        clockPhaseMs = nowMs % ALERT_WHEEL_TICK_MS;
+        wheelTick = clockTick;
+        wheelStarted = true;
+    } else {
+        // Elapsed time is wrap-safe; nowMs / ALERT_WHEEL_TICK_MS is not
+        uint64_t phase = (uint64_t)clockPhaseMs + (uint32_t)(nowMs - lastMs);
+        clockTick += (uint32_t)(phase / ALERT_WHEEL_TICK_MS);
+        clockPhaseMs = (uint32_t)(phase % ALERT_WHEEL_TICK_MS);
+    }
+    lastMs = nowMs;
+    uint32_t nowTick = clockTick;
+
+    for (;;) {
+        Cell& cell = ring[head & RING_MASK];
+        if ((int32_t)(cell.sequence.load(std::memory_order_acquire) - (head + 1)) < 0) break;
+
+        AlertRequest request = cell.request;
+        cell.sequence.store(head + ALERT_QUEUE_SIZE, std::memory_order_release);
+        head++;
+
+        if (request.flags & (ALERT_FLAG_CLEAR_READY | ALERT_FLAG_CLEAR_DELAYED)) {
+            if (request.flags & ALERT_FLAG_CLEAR_READY) clearReady();
+            if (request.flags & ALERT_FLAG_CLEAR_DELAYED) clearDelayed();
+            continue;
+        }
+
+        if (request.delayMs > 0) {
+            // Round up so an alert never fires early
+            uint32_t dueTick = nowTick + (uint32_t)(((uint64_t)clockPhaseMs + request.delayMs +
+                                                     ALERT_WHEEL_TICK_MS - 1) / ALERT_WHEEL_TICK_MS);
+            request.postedUs += request.delayMs * 1000;
+            request.delayMs = 0;
+            schedule(request, dueTick);
+        } else {
+            pushReady(request, false);
+        }
+    }
+
+    advanceWheel(nowTick);
+}
+
+bool AlertScheduler::pushReady(const AlertRequest& request, bool front) {
+    uint8_t priority = request.priority < ALERT_PRIORITY_COUNT ? request.priority : ALERT_PRIORITY_COUNT - 1;
+    ReadyQueue& q = ready[priority];
+
+    if (q.count == ALERT_READY_DEPTH) {
+        stats.dropped++;
+        if (!front) return false;
+        q.count--;      // A resumed alert displaces the newest arrival
+    }
+
+    if (front) {
+        q.head = (q.head + ALERT_READY_DEPTH - 1) % ALERT_READY_DEPTH;
+        q.items[q.head] = request;
+    } else {
+        q.items[(q.head + q.count) % ALERT_READY_DEPTH] = request;
+    }
+    q.count++;
+    return true;
+}
+
+void AlertScheduler::schedule(const AlertRequest& request, uint32_t dueTick) {
+    if ((int32_t)(dueTick - wheelTick) <= 0) {
+        pushReady(request, false);
+        return;
+    }
+    if (freeList == NO_ENTRY) {
+        stats.dropped++;
+        return;
+    }
+
+    uint8_t index = freeList;
+    WheelEntry& entry = pool[index];
+    freeList = entry.next;
+
+    entry.request = request;
+    entry.dueTick = dueTick;
+    entry.next = slots[dueTick % ALERT_WHEEL_SLOTS];
+    slots[dueTick % ALERT_WHEEL_SLOTS] = index;
+
+    delayedCount++;
+    stats.delayed++;
+}
+
+void AlertScheduler::advanceWheel(uint32_t nowTick) {
+    uint32_t ticks = nowTick - wheelTick;
+    if (ticks == 0) return;
+    if (ticks > ALERT_WHEEL_SLOTS) ticks = ALERT_WHEEL_SLOTS;
+
+    // Oldest slot first, so alerts become ready in due order
+    for (uint32_t i = ticks; i > 0; i--) {
+        uint8_t* link = &slots[(nowTick - i + 1) % ALERT_WHEEL_SLOTS];
+        while (*link != NO_ENTRY) {
+            uint8_t index = *link;
+            WheelEntry& entry = pool[index];
+            if ((int32_t)(entry.dueTick - nowTick) > 0) {
+                link = &entry.next;
+                continue;
+            }
+            *link = entry.next;
+            pushReady(entry.request, false);
+            entry.next = freeList;
+            freeList = index;
+            delayedCount--;
+        }
+    }
+    wheelTick = nowTick;
+}
+
+void AlertScheduler::clearReady() {
+    for (uint8_t p = 0; p < ALERT_PRIORITY_COUNT; p++) {
+        ready[p].head = 0;
+        ready[p].count = 0;
+    }
+}
+
+void AlertScheduler::clearDelayed() {
+    for (uint8_t s = 0; s < ALERT_WHEEL_SLOTS; s++) {
+        while (slots[s] != NO_ENTRY) {
+            uint8_t index = slots[s];
+            slots[s] = pool[index].next;
+            pool[index].next = freeList;
+            freeList = index;
+        }
+    }
+    delayedCount = 0;
+}
+
+bool AlertScheduler::pop(AlertRequest& out) {
+    for (int p = ALERT_PRIORITY_COUNT - 1; p >= 0; p--) {
+        ReadyQueue& q = ready[p];
+        if (q.count == 0) continue;
+
+        out = q.items[q.head];
+        q.head = (q.head + 1) % ALERT_READY_DEPTH;
+        q.count--;
+        return true;
+    }
+    return false;
+}
+
+void AlertScheduler::requeue(const AlertRequest& request) {
+    pushReady(request, true);
+}
+
+int AlertScheduler::topPriority() {
+    for (int p = ALERT_PRIORITY_COUNT - 1; p >= 0; p--) {
+        if (ready[p].count > 0) return p;
+    }
+    return -1;
+}
+
+uint8_t AlertScheduler::readyCount() {
+    uint8_t count = 0;
+    for (uint8_t p = 0; p < ALERT_PRIORITY_COUNT; p++) count += ready[p].count;
+    return count;
+}
+
+uint8_t AlertScheduler::delayedPending() {
+    return delayedCount;
+}
+
+bool AlertScheduler::nextDue(uint32_t& dueMs) {
+    bool found = false;
+    uint32_t earliest = 0;
+    for (uint8_t s = 0; s < ALERT_WHEEL_SLOTS; s++) {
+        for (uint8_t index = slots[s]; index != NO_ENTRY; index = pool[index].next) {
+            if (!found || (int32_t)(pool[index].dueTick - earliest) < 0) {
+                earliest = pool[index].dueTick;
+                found = true;
+            }
+        }
+    }
+    if (found) dueMs = earliest * ALERT_WHEEL_TICK_MS;
+    return found;
+}
+
+void AlertScheduler::noteDispatch(const AlertRequest& request, uint32_t nowUs) {
+    stats.dispatched++;
+    if (request.resumeRepeats > 0) {
+        stats.resumed++;
+        return;
+    }
+
+    uint32_t latency = nowUs - request.postedUs;
+    stats.lastLatencyUs = latency;
+    if (latency > stats.maxLatencyUs) stats.maxLatencyUs = latency;
+}
+
+void AlertScheduler::notePreemption() {
+    stats.preempted++;
+}
+
+AlertStats AlertScheduler::getStats() {
+    AlertStats snapshot = stats;
+    snapshot.posted = postCount.load(std::memory_order_relaxed);
+    snapshot.dropped += rejectCount.load(std::memory_order_relaxed);
+    return snapshot;
+}
@@ -0,0 +1,122 @@
+#ifndef ALERT_SCHEDULER_H
+#define ALERT_SCHEDULER_H
+
+#include <stdint.h>
+#include <atomic>
+#include "config.h"
+
+#if (ALERT_QUEUE_SIZE & (ALERT_QUEUE_SIZE - 1)) != 0
+#error "ALERT_QUEUE_SIZE must be a power of two"
+#endif
+
+// Alert priorities, lowest first. A ready alert of higher priority
+// preempts the one playing.
+typedef enum {
+    ALERT_PRIORITY_LOW,
+    ALERT_PRIORITY_NORMAL,
+    ALERT_PRIORITY_WARNING,
+    ALERT_PRIORITY_EMERGENCY,
+    ALERT_PRIORITY_COUNT
+} AlertPriority;
+
+// Request flags. The clear requests travel through the post ring like
+// alerts, so only the consumer ever touches the queues.
+#define ALERT_FLAG_RESUME 0x01          // Continue where it stopped after preemption
+#define ALERT_FLAG_CLEAR_READY 0x02     // Drop waiting alerts
+#define ALERT_FLAG_CLEAR_DELAYED 0x04   // Drop delayed alerts
+
+typedef struct {
+    uint8_t pattern;
+    uint8_t priority;
+    uint8_t flags;
+    uint8_t resumeStep;
+    uint8_t resumeRepeats;          // Non-zero when resuming a preempted alert
+    uint32_t delayMs;
+    uint32_t postedUs;
+} AlertRequest;
+
+// Scheduler statistics
+typedef struct {
+    uint32_t posted;
+    uint32_t dropped;               // Post ring, ready queue or wheel full
+    uint32_t delayed;
+    uint32_t preempted;
+    uint32_t resumed;
+    uint32_t dispatched;
+    uint32_t lastLatencyUs;         // Post to start of playback
+    uint32_t maxLatencyUs;
+} AlertStats;
+
+class AlertScheduler {
+private:
+    // Bounded multi-producer ring. A producer claims a cell with a CAS on
+    // tail and publishes it through the cell's sequence number; nothing
+    // blocks, so an ISR can post while a task is halfway through a post.
+    struct Cell {
+        std::atomic<uint32_t> sequence;
+        AlertRequest request;
+    };
+    Cell ring[ALERT_QUEUE_SIZE];
+    std::atomic<uint32_t> tail;
+    std::atomic<uint32_t> postCount;
+    std::atomic<uint32_t> rejectCount;
+    uint32_t head;
+
+    // Waiting alerts, FIFO per priority
+    struct ReadyQueue {
+        AlertRequest items[ALERT_READY_DEPTH];
+        uint8_t head;
+        uint8_t count;
+    };
+    ReadyQueue ready[ALERT_PRIORITY_COUNT];
+
+    // Timer wheel for delayed alerts. Each entry hangs off the slot of its
+    // due tick; delays beyond one revolution wait in place until due.
+    struct WheelEntry {
+        AlertRequest request;
+        uint32_t dueTick;
+        uint8_t next;
+    };
+    WheelEntry pool[ALERT_WHEEL_CAPACITY];
+    uint8_t slots[ALERT_WHEEL_SLOTS];
+    uint8_t freeList;
+    uint8_t delayedCount;
+    uint32_t wheelTick;
+    bool wheelStarted;
+    // Ticks keep counting through the millis() wrap at 49.7 days, so
+    // dueTick * ALERT_WHEEL_TICK_MS is always the millis() time it is due
+    uint32_t clockTick;
+    uint32_t clockPhaseMs;          // Into the current tick
+    uint32_t lastMs;
+
+    AlertStats stats;
+
+    bool pushReady(const AlertRequest& request, bool front);
+    void schedule(const AlertRequest& request, uint32_t dueTick);
+    void advanceWheel(uint32_t nowTick);
+    void clearReady();
+    void clearDelayed();
+
+public:
+    AlertScheduler();
+
+    // Producer side: lock-free, safe from ISRs and any task
+    bool post(const AlertRequest& request);
+
+    // Consumer side: one context only. collect() must run at least once
+    // per millis() wrap to keep the tick count continuous.
+    void collect(uint32_t nowMs);
+    bool pop(AlertRequest& out);
+    void requeue(const AlertRequest& request);
+    int topPriority();
+    uint8_t readyCount();
+    uint8_t delayedPending();
+    bool nextDue(uint32_t& dueMs);
+    void noteDispatch(const AlertRequest& request, uint32_t nowUs);
+    void notePreemption();
+
+    // Diagnostics
+    AlertStats getStats();
+};
+
+#endif // ALERT_SCHEDULER_H
@@ -0,0 +1,758 @@
+#include "buzzer_control.h"
+#include <esp_timer.h>
+#include <esp_arduino_version.h>
+#include <freertos/FreeRTOS.h>
+
+#define TONE BUZZ_TONE_DEFAULT
+#define BEEP BUZZER_BEEP_DURATION_MS
+
+BuzzerController buzzer(BUZZER_PIN);
+
+// Shared between the API (loop or any task) and the esp_timer task
+static portMUX_TYPE buzzerLock = portMUX_INITIALIZER_UNLOCKED;
+
+// ================= Pattern tables =================
+
+static constexpr BuzzerStep SINGLE_STEPS[] = { {TONE, 100} };
+static constexpr BuzzerStep BEEP_STEPS[] = { {TONE, BEEP}, {0, BEEP} };
+static constexpr BuzzerStep SHORT_STEPS[] = { {TONE, 100}, {0, 100} };
+static constexpr BuzzerStep LONG_STEPS[] = { {TONE, 1000} };
+static constexpr BuzzerStep SOS_STEPS[] = {
+    {TONE, 100}, {0, 100}, {TONE, 100}, {0, 100}, {TONE, 100}, {0, 300},
+    {TONE, 300}, {0, 100}, {TONE, 300}, {0, 100}, {TONE, 300}, {0, 300},
+    {TONE, 100}, {0, 100}, {TONE, 100}, {0, 100}, {TONE, 100}, {0, 700}
+};
+static constexpr BuzzerStep WARNING_STEPS[] = { {TONE, 500}, {0, 500} };
+static constexpr BuzzerStep SUCCESS_STEPS[] = { {1000, 80}, {0, 40}, {1500, 120} };
+static constexpr BuzzerStep ERROR_STEPS[] = { {400, 300}, {0, 100}, {300, 500} };
+
+typedef struct {
+    const BuzzerStep* steps;
+    uint8_t count;
+    uint8_t repeats;
+} BuzzerPatternDef;
+
+#define PATTERN(table, repeats) { table, sizeof(table) / sizeof(table[0]), repeats }
+
+static constexpr BuzzerPatternDef patternTable[BUZZ_PATTERN_CUSTOM] = {
+    PATTERN(SINGLE_STEPS, 1),                       // BUZZ_PATTERN_SINGLE
+    PATTERN(BEEP_STEPS, NORMAL_BEEP_COUNT),         // BUZZ_PATTERN_DOUBLE
+    PATTERN(SHORT_STEPS, 3),                        // BUZZ_PATTERN_TRIPLE
+    PATTERN(LONG_STEPS, 1),                         // BUZZ_PATTERN_LONG
+    PATTERN(SOS_STEPS, 1),                          // BUZZ_PATTERN_SOS
+    PATTERN(BEEP_STEPS, EMERGENCY_BEEP_COUNT),      // BUZZ_PATTERN_EMERGENCY
+    PATTERN(WARNING_STEPS, 3),                      // BUZZ_PATTERN_WARNING
+    PATTERN(SUCCESS_STEPS, 1),                      // BUZZ_PATTERN_SUCCESS
+    PATTERN(ERROR_STEPS, 1)                         // BUZZ_PATTERN_ERROR
+};
+
+// ================= LEDC output =================
+
+static void ledcBegin(uint8_t pin, uint16_t frequency) {
+#if ESP_ARDUINO_VERSION_MAJOR >= 3
+    ledcAttach(pin, frequency, BUZZER_LEDC_RESOLUTION);
+#else
+    ledcSetup(BUZZER_LEDC_CHANNEL, frequency, BUZZER_LEDC_RESOLUTION);
+    ledcAttachPin(pin, BUZZER_LEDC_CHANNEL);
+#endif
+}
+
+static void ledcEnd(uint8_t pin) {
+#if ESP_ARDUINO_VERSION_MAJOR >= 3
+    ledcDetach(pin);
+#else
+    ledcDetachPin(pin);
+#endif
+}
+
+static void ledcDuty(uint8_t pin, uint32_t duty) {
+#if ESP_ARDUINO_VERSION_MAJOR >= 3
+    ledcWrite(pin, duty);
+#else
+    (void)pin;
+    ledcWrite(BUZZER_LEDC_CHANNEL, duty);
+#endif
+}
+
+static void ledcFrequency(uint8_t pin, uint16_t frequency) {
+#if ESP_ARDUINO_VERSION_MAJOR >= 3
+    ledcChangeFrequency(pin, frequency, BUZZER_LEDC_RESOLUTION);
+#else
+    (void)pin;
+    ledcChangeFrequency(BUZZER_LEDC_CHANNEL, frequency, BUZZER_LEDC_RESOLUTION);
+#endif
+}
+
+// ================= BuzzerController =================
+
+BuzzerController::BuzzerController(uint8_t pin)
+    : buzzerPin(pin), currentState(BUZZ_STATE_IDLE), frequency(BUZZER_FREQUENCY), volume(100),
+      stepTimer(NULL), steps(NULL), stepCount(0), stepIndex(0), repeatsLeft(0),
+      pauseAfter(0), inPause(false), stepDeadline(0), pausedRemaining(0),
+      pendingTone(0), pendingArmed(false), pendingDeadline(0), outputPending(false),
+      currentPattern(BUZZ_PATTERN_SINGLE), emergencyActive(false),
+      kickTimer(NULL), scheduleTimer(NULL), nextDueMs(0),
+      currentPriority(ALERT_PRIORITY_LOW), currentResumable(false),
+      patternCompleteCallback(NULL), emergencyCallback(NULL) {
+    memset(&timingStats, 0, sizeof(timingStats));
+    customPattern.onDuration = BEEP;
+    customPattern.offDuration = BEEP;
+    customPattern.repeatCount = 1;
+    customPattern.pauseDuration = 0;
+    for (uint8_t i = 0; i < BUZZ_PATTERN_CUSTOM; i++) hasSavedPattern[i] = false;
+}
+
+void BuzzerController::begin() {
+    ledcBegin(buzzerPin, frequency);
+    ledcDuty(buzzerPin, 0);
+
+    esp_timer_create_args_t args;
+    memset(&args, 0, sizeof(args));
+    args.callback = onStepTimer;
+    args.arg = this;
+    args.dispatch_method = ESP_TIMER_TASK;
+    args.name = "buzzer_step";
+    esp_timer_create(&args, (esp_timer_handle_t*)&stepTimer);
+
+    args.callback = onDispatchTimer;
+    args.name = "buzzer_kick";
+    esp_timer_create(&args, (esp_timer_handle_t*)&kickTimer);
+    args.name = "buzzer_sched";
+    esp_timer_create(&args, (esp_timer_handle_t*)&scheduleTimer);
+
+    // Alerts posted before begin() are waiting in the ring
+    kick();
+}
+
+void BuzzerController::test() {
+    beepPattern(BUZZ_PATTERN_SUCCESS);
+}
+
+void BuzzerController::stop() {
+    AlertRequest request;
+    memset(&request, 0, sizeof(request));
+    request.flags = ALERT_FLAG_CLEAR_READY | ALERT_FLAG_CLEAR_DELAYED;
+    post(request);
+
+    portENTER_CRITICAL(&buzzerLock);
+    steps = NULL;
+    emergencyActive = false;
+    currentState = BUZZ_STATE_IDLE;
+    toggleBuzzer(false);
+    disarmTimer();
+    portEXIT_CRITICAL(&buzzerLock);
+    kick();
+}
+
+// ================= Output (lock not held) =================
+
+// esp_timer and LEDC calls take their own locks and may block, so they
+// never run inside buzzerLock. Only the esp_timer task calls this, which
+// keeps the hardware updates in the order they were decided.
+void BuzzerController::applyOutput() {
+    portENTER_CRITICAL(&buzzerLock);
+    bool pending = outputPending;
+    uint16_t toneFrequency = pendingTone;
+    bool armed = pendingArmed;
+    int64_t deadline = pendingDeadline;
+    uint8_t level = volume;
+    uint16_t baseFrequency = frequency;
+    outputPending = false;
+    portEXIT_CRITICAL(&buzzerLock);
+    if (!pending) return;
+
+    if (stepTimer) esp_timer_stop((esp_timer_handle_t)stepTimer);
+
+    uint32_t maxDuty = (1UL << BUZZER_LEDC_RESOLUTION) - 1;
+    if (toneFrequency == 0 || level == 0) {
+        ledcDuty(buzzerPin, 0);
+    } else if (BUZZER_PASSIVE) {
+        // A piezo needs a square wave; volume scales the duty up to 50%
+        ledcFrequency(buzzerPin, toneFrequency == BUZZ_TONE_DEFAULT ? baseFrequency : toneFrequency);
+        ledcDuty(buzzerPin, maxDuty / 2 * level / 100);
+    } else {
+        // An active buzzer makes its own tone; full volume is a steady high
+        ledcDuty(buzzerPin, (maxDuty + 1) * level / 100);
+    }
+
+    if (armed && stepTimer) {
+        int64_t delay = deadline - esp_timer_get_time();
+        if (delay < 1) delay = 1;
+        esp_timer_start_once((esp_timer_handle_t)stepTimer, (uint64_t)delay);
+    }
+}
+
+// ================= Sequencer (lock held) =================
+
+// These only record the output; applyOutput() drives the hardware
+void BuzzerController::toggleBuzzer(bool state) {
+    outputTone(state ? BUZZ_TONE_DEFAULT : 0);
+}
+
+void BuzzerController::outputTone(uint16_t toneFrequency) {
+    pendingTone = toneFrequency;
+    outputPending = true;
+}
+
+void BuzzerController::armTimer(int64_t deadline) {
+    pendingArmed = true;
+    pendingDeadline = deadline;
+    outputPending = true;
+}
+
+void BuzzerController::disarmTimer() {
+    pendingArmed = false;
+    outputPending = true;
+}
+
+void BuzzerController::applyStep() {
+    if (inPause) {
+        toggleBuzzer(false);
+    } else {
+        outputTone(steps[stepIndex].frequency);
+    }
+}
+
+void BuzzerController::playSteps(const BuzzerStep* sequence, uint8_t count,
+                                 uint8_t repeats, uint16_t pause, uint8_t startStep) {
+    steps = sequence;
+    stepCount = count;
+    stepIndex = startStep < count ? startStep : 0;
+    repeatsLeft = repeats > 0 ? repeats : 1;
+    pauseAfter = pause;
+    inPause = false;
+    currentState = emergencyActive ? BUZZ_STATE_EMERGENCY : BUZZ_STATE_PLAYING;
+
+    stepDeadline = esp_timer_get_time() + (int64_t)steps[stepIndex].durationMs * 1000;
+    applyStep();
+    armTimer(stepDeadline);
+}
+
+uint8_t BuzzerController::buildCustomSteps(const BuzzerPatternData& data) {
+    customSteps[0].frequency = BUZZ_TONE_DEFAULT;
+    customSteps[0].durationMs = data.onDuration;
+    if (data.offDuration == 0) return 1;
+
+    customSteps[1].frequency = 0;
+    customSteps[1].durationMs = data.offDuration;
+    return 2;
+}
+
+void BuzzerController::startAlert(const AlertRequest& request, int64_t nowUs) {
+    BuzzerPattern pattern = (BuzzerPattern)request.pattern;
+    currentPattern = pattern;
+    currentPriority = request.priority;
+    currentResumable = request.flags & ALERT_FLAG_RESUME;
+    emergencyActive = request.priority >= ALERT_PRIORITY_EMERGENCY;
+    alerts.noteDispatch(request, (uint32_t)nowUs);
+
+    const BuzzerStep* sequence;
+    uint8_t count;
+    uint8_t repeats;
+    uint16_t pause = 0;
+    if (pattern >= BUZZ_PATTERN_CUSTOM || hasSavedPattern[pattern]) {
+        const BuzzerPatternData& data =
+            pattern >= BUZZ_PATTERN_CUSTOM ? customPattern : savedPatterns[pattern];
+        sequence = customSteps;
+        count = buildCustomSteps(data);
+        repeats = data.repeatCount;
+        pause = data.pauseDuration;
+    } else {
+        const BuzzerPatternDef& def = patternTable[pattern];
+        sequence = def.steps;
+        count = def.count;
+        repeats = def.repeats;
+    }
+
+    if (request.resumeRepeats > 0) {
+        playSteps(sequence, count, request.resumeRepeats, pause, request.resumeStep);
+    } else {
+        playSteps(sequence, count, repeats, pause);
+    }
+}
+
+bool BuzzerController::isPatternComplete() {
+    return steps == NULL;
+}
+
+void BuzzerController::advance() {
+    bool completed = false;
+    BuzzerPattern finished = currentPattern;
+
+    portENTER_CRITICAL(&buzzerLock);
+    if (steps != NULL && currentState != BUZZ_STATE_PAUSED) {
+        int64_t late = esp_timer_get_time() - stepDeadline;
+        if (late < 0) late = 0;
+        timingStats.steps++;
+        timingStats.totalLateUs += (uint32_t)late;
+        if ((uint32_t)late > timingStats.maxLateUs) timingStats.maxLateUs = (uint32_t)late;
+
+        if (inPause) {
+            inPause = false;
+            stepIndex = 0;
+        } else if (++stepIndex >= stepCount) {
+            if (--repeatsLeft > 0) {
+                stepIndex = 0;
+                inPause = pauseAfter > 0;
+            } else {
+                completed = true;
+            }
+        }
+
+        if (completed) {
+            steps = NULL;
+            emergencyActive = false;
+            currentState = BUZZ_STATE_IDLE;
+            toggleBuzzer(false);
+            disarmTimer();
+        } else {
+            // Deadlines accumulate from the ideal schedule, so a late
+            // callback shortens the next step instead of stretching the pattern
+            stepDeadline += (int64_t)(inPause ? pauseAfter : steps[stepIndex].durationMs) * 1000;
+            applyStep();
+            armTimer(stepDeadline);
+        }
+    }
+    portEXIT_CRITICAL(&buzzerLock);
+    applyOutput();
+
+    if (completed) {
+        if (patternCompleteCallback) patternCompleteCallback(finished);
+        dispatch();
+    }
+}
+
+void BuzzerController::onStepTimer(void* context) {
+    static_cast<BuzzerController*>(context)->advance();
+}
+
+void BuzzerController::onDispatchTimer(void* context) {
+    static_cast<BuzzerController*>(context)->dispatch();
+}
+
+// ================= Alert scheduling =================
+
+AlertPriority BuzzerController::getDefaultPriority(BuzzerPattern pattern) {
+    switch (pattern) {
+        case BUZZ_PATTERN_EMERGENCY:
+        case BUZZ_PATTERN_SOS:
+            return ALERT_PRIORITY_EMERGENCY;
+        case BUZZ_PATTERN_WARNING:
+        case BUZZ_PATTERN_ERROR:
+            return ALERT_PRIORITY_WARNING;
+        default:
+            return ALERT_PRIORITY_NORMAL;
+    }
+}
+
+void BuzzerController::post(const AlertRequest& request) {
+    if (alerts.post(request)) kick();
+}
+
+void BuzzerController::kick() {
+    // Already armed means a dispatch is pending anyway
+    if (kickTimer) esp_timer_start_once((esp_timer_handle_t)kickTimer, 0);
+}
+
+void BuzzerController::alert(BuzzerPattern pattern, AlertPriority priority, bool resume, uint32_t delayMs) {
+    AlertRequest request;
+    memset(&request, 0, sizeof(request));
+    request.pattern = pattern;
+    request.priority = priority;
+    request.flags = resume ? ALERT_FLAG_RESUME : 0;
+    request.delayMs = delayMs;
+    request.postedUs = (uint32_t)esp_timer_get_time();
+    post(request);
+}
+
+void BuzzerController::dispatch() {
+    int64_t now = esp_timer_get_time();
+    alerts.collect((uint32_t)(now / 1000));
+
+    portENTER_CRITICAL(&buzzerLock);
+    if (currentState != BUZZ_STATE_PAUSED) {
+        if (steps != NULL && alerts.topPriority() > (int)currentPriority) {
+            alerts.notePreemption();
+            if (currentResumable) {
+                AlertRequest resumed;
+                memset(&resumed, 0, sizeof(resumed));
+                resumed.pattern = currentPattern;
+                resumed.priority = currentPriority;
+                resumed.flags = ALERT_FLAG_RESUME;
+                resumed.resumeStep = inPause ? 0 : stepIndex;
+                resumed.resumeRepeats = repeatsLeft;
+                alerts.requeue(resumed);
+            }
+            steps = NULL;
+        }
+
+        AlertRequest next;
+        if (steps == NULL && alerts.pop(next)) {
+            startAlert(next, now);
+        } else if (steps == NULL) {
+            currentState = BUZZ_STATE_IDLE;
+            toggleBuzzer(false);
+            disarmTimer();
+        }
+    }
+    portEXIT_CRITICAL(&buzzerLock);
+    applyOutput();
+
+    uint32_t dueMs;
+    if (alerts.nextDue(dueMs)) {
+        nextDueMs = dueMs;
+        // Both sides in the scheduler's 32-bit millisecond clock, which wraps
+        int32_t waitMs = (int32_t)(dueMs - (uint32_t)(now / 1000));
+        int64_t wait = (int64_t)waitMs * 1000 - now % 1000;
+        esp_timer_stop((esp_timer_handle_t)scheduleTimer);
+        esp_timer_start_once((esp_timer_handle_t)scheduleTimer, wait > 0 ? (uint64_t)wait : 1);
+    } else {
+        nextDueMs = 0;
+    }
+}
+
+// ================= Pattern playback =================
+
+void BuzzerController::beep() {
+    beepPattern(BUZZ_PATTERN_SINGLE);
+}
+
+void BuzzerController::beep(uint16_t duration) {
+    beepCustom(duration, 0, 1);
+}
+
+void BuzzerController::beepPattern(BuzzerPattern pattern) {
+    alert(pattern, getDefaultPriority(pattern));
+}
+
+void BuzzerController::beepCustom(uint16_t onTime, uint16_t offTime, uint8_t repeats) {
+    BuzzerPatternData data;
+    data.onDuration = onTime;
+    data.offDuration = offTime;
+    data.repeatCount = repeats;
+    data.pauseDuration = 0;
+    setCustomPattern(data);
+    beepPattern(BUZZ_PATTERN_CUSTOM);
+}
+
+// ================= Emergency alerts =================
+
+void BuzzerController::emergencyAlert() {
+    alert(BUZZ_PATTERN_EMERGENCY, ALERT_PRIORITY_EMERGENCY);
+    if (emergencyCallback) emergencyCallback();
+}
+
+void BuzzerController::warningAlert() {
+    // A warning cut short by an emergency is still worth finishing
+    alert(BUZZ_PATTERN_WARNING, ALERT_PRIORITY_WARNING, true);
+}
+
+void BuzzerController::successAlert() {
+    beepPattern(BUZZ_PATTERN_SUCCESS);
+}
+
+void BuzzerController::errorAlert() {
+    beepPattern(BUZZ_PATTERN_ERROR);
+}
+
+void BuzzerController::sosAlert() {
+    alert(BUZZ_PATTERN_SOS, ALERT_PRIORITY_EMERGENCY);
+}
+
+// ================= Queue management =================
+
+void BuzzerController::addToQueue(BuzzerPattern pattern) {
+    beepPattern(pattern);
+}
+
+void BuzzerController::clearQueue() {
+    AlertRequest request;
+    memset(&request, 0, sizeof(request));
+    request.flags = ALERT_FLAG_CLEAR_READY;
+    post(request);
+}
+
+bool BuzzerController::isQueueEmpty() {
+    return alerts.readyCount() == 0;
+}
+
+uint8_t BuzzerController::getQueueSize() {
+    return alerts.readyCount();
+}
+
+// ================= State management =================
+
+void BuzzerController::update() {
+    // Playback is timer driven; kept so existing loops can still call it
+}
+
+BuzzerState BuzzerController::getState() {
+    return currentState;
+}
+
+bool BuzzerController::isPlaying() {
+    return currentState == BUZZ_STATE_PLAYING || currentState == BUZZ_STATE_EMERGENCY;
+}
+
+bool BuzzerController::isIdle() {
+    return currentState == BUZZ_STATE_IDLE;
+}
+
+void BuzzerController::pause() {
+    portENTER_CRITICAL(&buzzerLock);
+    if (steps != NULL && currentState != BUZZ_STATE_PAUSED) {
+        pausedRemaining = stepDeadline - esp_timer_get_time();
+        if (pausedRemaining < 0) pausedRemaining = 0;
+        toggleBuzzer(false);
+        disarmTimer();
+        currentState = BUZZ_STATE_PAUSED;
+    }
+    portEXIT_CRITICAL(&buzzerLock);
+    kick();
+}
+
+void BuzzerController::resume() {
+    portENTER_CRITICAL(&buzzerLock);
+    if (currentState == BUZZ_STATE_PAUSED) {
+        if (steps != NULL) {
+            currentState = emergencyActive ? BUZZ_STATE_EMERGENCY : BUZZ_STATE_PLAYING;
+            stepDeadline = esp_timer_get_time() + pausedRemaining;
+            applyStep();
+            armTimer(stepDeadline);
+        } else {
+            currentState = BUZZ_STATE_IDLE;
+        }
+    }
+    portEXIT_CRITICAL(&buzzerLock);
+    kick();
+}
+
+void BuzzerController::stopPattern() {
+    portENTER_CRITICAL(&buzzerLock);
+    steps = NULL;
+    emergencyActive = false;
+    currentState = BUZZ_STATE_IDLE;
+    toggleBuzzer(false);
+    disarmTimer();
+    portEXIT_CRITICAL(&buzzerLock);
+    kick();
+}
+
+// ================= Configuration =================
+
+void BuzzerController::setVolume(uint8_t level) {
+    volume = level > 100 ? 100 : level;
+}
+
+void BuzzerController::setFrequency(uint16_t toneFrequency) {
+    portENTER_CRITICAL(&buzzerLock);
+    frequency = toneFrequency;
+    if (steps != NULL && currentState != BUZZ_STATE_PAUSED) applyStep();
+    portEXIT_CRITICAL(&buzzerLock);
+    kick();
+}
+
+void BuzzerController::setEmergencyMode(bool enabled) {
+    portENTER_CRITICAL(&buzzerLock);
+    emergencyActive = enabled;
+    if (steps != NULL && currentState != BUZZ_STATE_PAUSED) {
+        currentState = enabled ? BUZZ_STATE_EMERGENCY : BUZZ_STATE_PLAYING;
+    }
+    portEXIT_CRITICAL(&buzzerLock);
+}
+
+void BuzzerController::setBuzzerPin(uint8_t pin) {
+    stopPattern();
+    ledcEnd(buzzerPin);
+    buzzerPin = pin;
+    ledcBegin(buzzerPin, frequency);
+    ledcDuty(buzzerPin, 0);
+}
+
+// ================= Advanced features =================
+
+void BuzzerController::setCustomPattern(const BuzzerPatternData& pattern) {
+    portENTER_CRITICAL(&buzzerLock);
+    customPattern = pattern;
+    portEXIT_CRITICAL(&buzzerLock);
+}
+
+void BuzzerController::savePattern(BuzzerPattern pattern, const BuzzerPatternData& data) {
+    if (pattern >= BUZZ_PATTERN_CUSTOM) {
+        setCustomPattern(data);
+        return;
+    }
+    portENTER_CRITICAL(&buzzerLock);
+    savedPatterns[pattern] = data;
+    hasSavedPattern[pattern] = true;
+    portEXIT_CRITICAL(&buzzerLock);
+}
+
+BuzzerPatternData BuzzerController::loadPattern(BuzzerPattern pattern) {
+    if (pattern >= BUZZ_PATTERN_CUSTOM) return customPattern;
+    if (hasSavedPattern[pattern]) return savedPatterns[pattern];
+
+    // Built-in tables are summarised by their first on/off pair
+    const BuzzerPatternDef& def = patternTable[pattern];
+    BuzzerPatternData data;
+    data.onDuration = def.steps[0].durationMs;
+    data.offDuration = def.count > 1 ? def.steps[1].durationMs : 0;
+    data.repeatCount = def.repeats;
+    data.pauseDuration = 0;
+    return data;
+}
+
+// ================= Music functionality =================
+
+void BuzzerController::playTone(uint16_t toneFrequency, uint16_t duration) {
+    playMelody(&toneFrequency, &duration, 1);
+}
+
+void BuzzerController::playMelody(const uint16_t* notes, const uint16_t* durations, uint8_t length) {
+    if (length == 0) return;
+    if (length > BUZZER_MELODY_MAX_STEPS) length = BUZZER_MELODY_MAX_STEPS;
+
+    // Music plays at normal priority and never talks over an alert
+    portENTER_CRITICAL(&buzzerLock);
+    if (currentState != BUZZ_STATE_PAUSED &&
+        (steps == NULL || currentPriority <= ALERT_PRIORITY_NORMAL)) {
+        for (uint8_t i = 0; i < length; i++) {
+            customSteps[i].frequency = notes[i];
+            customSteps[i].durationMs = durations[i];
+        }
+        currentPattern = BUZZ_PATTERN_CUSTOM;
+        currentPriority = ALERT_PRIORITY_NORMAL;
+        currentResumable = false;
+        emergencyActive = false;
+        playSteps(customSteps, length, 1, 0);
+    }
+    portEXIT_CRITICAL(&buzzerLock);
+    kick();
+}
+
+void BuzzerController::playNote(char note, uint16_t duration) {
+    uint16_t noteFrequency;
+    switch (note) {
+        case 'c': noteFrequency = 262; break;
+        case 'd': noteFrequency = 294; break;
+        case 'e': noteFrequency = 330; break;
+        case 'f': noteFrequency = 349; break;
+        case 'g': noteFrequency = 392; break;
+        case 'a': noteFrequency = 440; break;
+        case 'b': noteFrequency = 494; break;
+        case 'C': noteFrequency = 523; break;
+        default: noteFrequency = 0; break;      // Rest
+    }
+    playTone(noteFrequency, duration);
+}
+
+// ================= Diagnostics =================
+
+AlertStats BuzzerController::getAlertStats() {
+    return alerts.getStats();
+}
+
+BuzzerTimingStats BuzzerController::getTimingStats() {
+    portENTER_CRITICAL(&buzzerLock);
+    BuzzerTimingStats snapshot = timingStats;
+    portEXIT_CRITICAL(&buzzerLock);
+    return snapshot;
+}
+
+void BuzzerController::printStatus() {
+    BuzzerTimingStats s = getTimingStats();
+    AlertStats a = alerts.getStats();
+    Serial.printf("Buzzer: state %d, pattern %d, queue %u, delayed %u, preempted %lu, latency max %lu us\n",
+                  (int)currentState, (int)currentPattern, alerts.readyCount(), alerts.delayedPending(),
+                  (unsigned long)a.preempted, (unsigned long)a.maxLatencyUs);
+    Serial.printf("Buzzer: steps %lu, late avg %lu us max %lu us\n",
+                  (unsigned long)s.steps,
+                  (unsigned long)(s.steps ? s.totalLateUs / s.steps : 0),
+                  (unsigned long)s.maxLateUs);
+}
+
+bool BuzzerController::testBuzzer() {
+    if (!stepTimer) return false;
+    beep();
+    return true;
+}
+
+void BuzzerController::runSoundTest() {
+    // Equal priority, so the patterns play in order
+    for (uint8_t p = BUZZ_PATTERN_SINGLE; p < BUZZ_PATTERN_CUSTOM; p++) {
+        alert((BuzzerPattern)p, ALERT_PRIORITY_LOW);
+    }
+}
+
+// ================= Callbacks =================
+
+void BuzzerController::setPatternCompleteCallback(void (*callback)(BuzzerPattern)) {
+    patternCompleteCallback = callback;
+}
+
+void BuzzerController::setEmergencyCallback(void (*callback)()) {
+    emergencyCallback = callback;
+}
+
+// ================= Timers and scheduling =================
+
+void BuzzerController::scheduleBeep(uint32_t delayMs, BuzzerPattern pattern) {
+    alert(pattern, getDefaultPriority(pattern), false, delayMs > 0 ? delayMs : 1);
+}
+
+void BuzzerController::cancelScheduledBeep() {
+    AlertRequest request;
+    memset(&request, 0, sizeof(request));
+    request.flags = ALERT_FLAG_CLEAR_DELAYED;
+    post(request);
+}
+
+bool BuzzerController::hasScheduledBeep() {
+    return nextDueMs != 0;
+}
+
+uint32_t BuzzerController::getNextBeepTime() {
+    // millis() time of the earliest delayed alert, 0 if none
+    return nextDueMs;
+}
+
+// ================= Melodies =================
+
+namespace BuzzerMelodies {
+    static const uint16_t STARTUP_NOTES[] = { 523, 659, 784, 1047 };
+    static const uint16_t STARTUP_DURATIONS[] = { 100, 100, 100, 200 };
+    static const uint16_t SHUTDOWN_NOTES[] = { 1047, 784, 659, 523 };
+    static const uint16_t SHUTDOWN_DURATIONS[] = { 100, 100, 100, 200 };
+    static const uint16_t ALERT_NOTES[] = { 1500, 0, 1500, 0, 1500 };
+    static const uint16_t ALERT_DURATIONS[] = { 150, 50, 150, 50, 300 };
+    static const uint16_t CONNECT_NOTES[] = { 880, 1320 };
+    static const uint16_t CONNECT_DURATIONS[] = { 80, 120 };
+    static const uint16_t DISCONNECT_NOTES[] = { 1320, 880 };
+    static const uint16_t DISCONNECT_DURATIONS[] = { 80, 120 };
+    static const uint16_t LOW_BATTERY_NOTES[] = { 440, 0, 330 };
+    static const uint16_t LOW_BATTERY_DURATIONS[] = { 200, 100, 400 };
+
+    void playStartupJingle(BuzzerController& buzzer) {
+        buzzer.playMelody(STARTUP_NOTES, STARTUP_DURATIONS, 4);
+    }
+
+    void playShutdownJingle(BuzzerController& buzzer) {
+        buzzer.playMelody(SHUTDOWN_NOTES, SHUTDOWN_DURATIONS, 4);
+    }
+
+    void playAlertTone(BuzzerController& buzzer) {
+        buzzer.playMelody(ALERT_NOTES, ALERT_DURATIONS, 5);
+    }
+
+    void playConnectSound(BuzzerController& buzzer) {
+        buzzer.playMelody(CONNECT_NOTES, CONNECT_DURATIONS, 2);
+    }
+
+    void playDisconnectSound(BuzzerController& buzzer) {
+        buzzer.playMelody(DISCONNECT_NOTES, DISCONNECT_DURATIONS, 2);
+    }
+
+    void playLowBatteryWarning(BuzzerController& buzzer) {
+        buzzer.playMelody(LOW_BATTERY_NOTES, LOW_BATTERY_DURATIONS, 3);
+    }
+}
@@ -2,6 +2,8 @@
 #define BUZZER_CONTROL_H
 
 #include <Arduino.h>
+#include "config.h"
+#include "alert_scheduler.h"
 
 // Buzzer patterns
 typedef enum {
@@ -33,49 +35,93 @@ typedef struct {
     uint16_t pauseDuration;
 } BuzzerPatternData;
 
+// One sequencer step. A frequency of 0 is silence; BUZZ_TONE_DEFAULT
+// uses the configured frequency (the only one an active buzzer can play).
+typedef struct {
+    uint16_t frequency;
+    uint16_t durationMs;
+} BuzzerStep;
+
+#define BUZZ_TONE_DEFAULT 1
+
+// Step timing error, measured against the ideal schedule
+typedef struct {
+    uint32_t steps;
+    uint32_t totalLateUs;
+    uint32_t maxLateUs;
+} BuzzerTimingStats;
+
 class BuzzerController {
 private:
     uint8_t buzzerPin;
-    BuzzerState currentState;
-    
-    // Timing variables
-    uint32_t startTime;
-    uint32_t lastToggle;
-    uint32_t emergencyStartTime;
+    volatile BuzzerState currentState;
+    uint16_t frequency;
+    uint8_t volume;
+    
+    // Sequencer, advanced from an esp_timer callback so step timing does
+    // not depend on how often loop() runs
+    void* stepTimer;
+    const BuzzerStep* steps;
+    uint8_t stepCount;
+    uint8_t stepIndex;
+    uint8_t repeatsLeft;
+    uint16_t pauseAfter;
+    bool inPause;
+    int64_t stepDeadline;           // Ideal end of the current step (us)
+    int64_t pausedRemaining;
+    BuzzerTimingStats timingStats;
+
+    // Output the sequencer wants, decided under the lock and applied to
+    // LEDC and the step timer after it is released, only from the
+    // esp_timer task
+    uint16_t pendingTone;           // 0 is silence
+    bool pendingArmed;
+    int64_t pendingDeadline;
+    bool outputPending;
     
     // Current pattern
     BuzzerPattern currentPattern;
     BuzzerPatternData customPattern;
-    uint8_t currentRepeat;
-    bool isOn;
+    BuzzerStep customSteps[BUZZER_MELODY_MAX_STEPS];
+    BuzzerPatternData savedPatterns[BUZZ_PATTERN_CUSTOM];
+    bool hasSavedPattern[BUZZ_PATTERN_CUSTOM];
     
     // Emergency handling
     bool emergencyActive;
-    uint8_t emergencyBeepCount;
-    uint32_t lastEmergencyBeep;
     
-    // Queue for multiple patterns
-    BuzzerPattern patternQueue[8];
-    uint8_t queueHead;
-    uint8_t queueTail;
-    uint8_t queueCount;
+    // Alert scheduling. Producers post lock-free and kick the dispatcher;
+    // the kick, step and schedule timers all run in the esp_timer task,
+    // which is the scheduler's only consumer.
+    AlertScheduler alerts;
+    void* kickTimer;
+    void* scheduleTimer;            // Fires at the next delayed alert
+    volatile uint32_t nextDueMs;
+    uint8_t currentPriority;
+    bool currentResumable;
+    
+    // Callbacks
+    void (*patternCompleteCallback)(BuzzerPattern);
+    void (*emergencyCallback)();
     
     // Private methods
-    void playSingleBeep();
-    void playDoubleBeep();
-    void playTripleBeep();
-    void playLongBeep();
-    void playSOS();
-    void playEmergency();
-    void playWarning();
-    void playSuccess();
-    void playError();
-    void playCustomPattern();
+    static void onStepTimer(void* context);
+    static void onDispatchTimer(void* context);
+    void advance();
+    void dispatch();
+    void kick();
+    void post(const AlertRequest& request);
+    void playSteps(const BuzzerStep* sequence, uint8_t count, uint8_t repeats,
+                   uint16_t pause, uint8_t startStep = 0);
+    void applyStep();
+    void armTimer(int64_t deadline);
+    void disarmTimer();
+    uint8_t buildCustomSteps(const BuzzerPatternData& data);
     
     void toggleBuzzer(bool state);
-    void nextInQueue();
+    void outputTone(uint16_t toneFrequency);
+    void applyOutput();
     bool isPatternComplete();
-    void startPattern(BuzzerPattern pattern);
+    void startAlert(const AlertRequest& request, int64_t nowUs);
 
 public:
     BuzzerController(uint8_t pin);
@@ -91,6 +137,11 @@ public:
     void beepPattern(BuzzerPattern pattern);
     void beepCustom(uint16_t onTime, uint16_t offTime, uint8_t repeats = 1);
     
+    // Prioritised playback. Safe from ISRs and any task; a higher priority
+    // preempts the playing alert, which continues afterwards if resume is set.
+    void alert(BuzzerPattern pattern, AlertPriority priority, bool resume = false, uint32_t delayMs = 0);
+    static AlertPriority getDefaultPriority(BuzzerPattern pattern);
+    
     // Emergency alerts
     void emergencyAlert();
     void warningAlert();
@@ -130,6 +181,8 @@ public:
     void playNote(char note, uint16_t duration);
     
     // Diagnostics
+    BuzzerTimingStats getTimingStats();
+    AlertStats getAlertStats();
     void printStatus();
     bool testBuzzer();
     void runSoundTest();
@@ -0,0 +1,165 @@
+#include "client_tracker.h"
+#include <string.h>
+#include <stdio.h>
+
+#ifdef ARDUINO
+#include <freertos/FreeRTOS.h>
+static portMUX_TYPE clientLock = portMUX_INITIALIZER_UNLOCKED;
+#define CLIENT_LOCK() portENTER_CRITICAL(&clientLock)
+#define CLIENT_UNLOCK() portEXIT_CRITICAL(&clientLock)
+#else
+#define CLIENT_LOCK()
+#define CLIENT_UNLOCK()
+#endif
+
+ClientTracker::ClientTracker()
+    : count(0), connectCallback(NULL), disconnectCallback(NULL) {
+    memset(clients, 0, sizeof(clients));
+    memset(&stats, 0, sizeof(stats));
+}
+
+int ClientTracker::find(const uint8_t* mac) const {
+    for (uint8_t i = 0; i < WIFI_MAX_CLIENTS; i++) {
+        if (clients[i].active && memcmp(clients[i].mac, mac, CLIENT_MAC_LEN) == 0) return i;
+    }
+    return -1;
+}
+
+// ================= Event path =================
+
+void ClientTracker::onJoined(const uint8_t* mac, uint8_t aid, uint32_t nowMs) {
+    WiFiClientRecord joined;
+    bool added = false;
+
+    CLIENT_LOCK();
+    // A station that reassociates without a leave event keeps its slot
+    int i = find(mac);
+    if (i < 0) {
+        for (uint8_t k = 0; k < WIFI_MAX_CLIENTS; k++) {
+            if (!clients[k].active) {
+                i = k;
+                break;
+            }
+        }
+    }
+    if (i >= 0) {
+        WiFiClientRecord& c = clients[i];
+        if (!c.active) count.fetch_add(1, std::memory_order_relaxed);
+        memcpy(c.mac, mac, CLIENT_MAC_LEN);
+        c.aid = aid;
+        c.rssi = 0;
+        c.ip = 0;
+        c.connectTimeMs = nowMs;
+        c.active = true;
+        joined = c;
+        added = true;
+        stats.joins++;
+    } else {
+        stats.dropped++;
+    }
+    CLIENT_UNLOCK();
+
+    if (added && connectCallback) connectCallback(joined);
+}
+
+void ClientTracker::onLeft(const uint8_t* mac) {
+    WiFiClientRecord left;
+    bool removed = false;
+
+    CLIENT_LOCK();
+    int i = find(mac);
+    if (i >= 0) {
+        left = clients[i];
+        left.active = false;
+        clients[i].active = false;
+        count.fetch_sub(1, std::memory_order_relaxed);
+        stats.leaves++;
+        removed = true;
+    }
+    CLIENT_UNLOCK();
+
+    if (removed && disconnectCallback) disconnectCallback(left);
+}
+
+void ClientTracker::onIpAssigned(const uint8_t* mac, uint32_t ip) {
+    CLIENT_LOCK();
+    int i = mac ? find(mac) : -1;
+    if (!mac) {
+        // Older IDF events carry no MAC: DHCP answers the station that
+        // joined last and has no address yet
+        for (uint8_t k = 0; k < WIFI_MAX_CLIENTS; k++) {
+            const WiFiClientRecord& c = clients[k];
+            if (!c.active || c.ip != 0) continue;
+            if (i < 0 || (int32_t)(c.connectTimeMs - clients[i].connectTimeMs) > 0) i = k;
+        }
+    }
+    if (i >= 0) clients[i].ip = ip;
+    CLIENT_UNLOCK();
+}
+
+void ClientTracker::setRssi(const uint8_t* mac, int8_t rssi) {
+    CLIENT_LOCK();
+    int i = find(mac);
+    if (i >= 0) clients[i].rssi = rssi;
+    CLIENT_UNLOCK();
+}
+
+// ================= Readers =================
+
+uint8_t ClientTracker::snapshot(WiFiClientRecord* out, uint8_t max) const {
+    uint8_t n = 0;
+    CLIENT_LOCK();
+    for (uint8_t i = 0; i < WIFI_MAX_CLIENTS && n < max; i++) {
+        if (clients[i].active) out[n++] = clients[i];
+    }
+    CLIENT_UNLOCK();
+    return n;
+}
+
+bool ClientTracker::isConnected(const uint8_t* mac) const {
+    CLIENT_LOCK();
+    bool connected = find(mac) >= 0;
+    CLIENT_UNLOCK();
+    return connected;
+}
+
+void ClientTracker::formatMac(const uint8_t* mac, char* out) {
+    snprintf(out, 18, "%02X:%02X:%02X:%02X:%02X:%02X",
+             mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+}
+
+// ================= Device =================
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include <WiFi.h>
+#include <esp_wifi.h>
+#include <esp_idf_version.h>
+
+ClientTracker clientTracker;
+
+void ClientTracker::begin() {
+    WiFi.onEvent([](WiFiEvent_t, WiFiEventInfo_t info) {
+        clientTracker.onJoined(info.wifi_ap_staconnected.mac, info.wifi_ap_staconnected.aid, millis());
+    }, ARDUINO_EVENT_WIFI_AP_STACONNECTED);
+
+    WiFi.onEvent([](WiFiEvent_t, WiFiEventInfo_t info) {
+        clientTracker.onLeft(info.wifi_ap_stadisconnected.mac);
+    }, ARDUINO_EVENT_WIFI_AP_STADISCONNECTED);
+
+    WiFi.onEvent([](WiFiEvent_t, WiFiEventInfo_t info) {
+#if ESP_IDF_VERSION_MAJOR >= 5
+        clientTracker.onIpAssigned(info.wifi_ap_staipassigned.mac, info.wifi_ap_staipassigned.ip.addr);
+#else
+        clientTracker.onIpAssigned(NULL, info.wifi_ap_staipassigned.ip.addr);
+#endif
+    }, ARDUINO_EVENT_WIFI_AP_STAIPASSIGNED);
+}
+
+// On demand only (diagnostics), never from the loop
+void ClientTracker::refreshRssi() {
+    wifi_sta_list_t list;
+    if (esp_wifi_ap_get_sta_list(&list) != ESP_OK) return;
+    for (int i = 0; i < list.num; i++) setRssi(list.sta[i].mac, list.sta[i].rssi);
+}
+#endif
@@ -0,0 +1,70 @@
+#ifndef CLIENT_TRACKER_H
+#define CLIENT_TRACKER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include "config.h"
+
+#define CLIENT_MAC_LEN 6
+
+// One AP station, kept in binary form
+typedef struct {
+    uint8_t mac[CLIENT_MAC_LEN];
+    uint8_t aid;                    // Association ID from the AP
+    int8_t rssi;                    // 0 until refreshed
+    uint32_t ip;                    // IPv4 in network order, 0 until DHCP assigns one
+    uint32_t connectTimeMs;
+    bool active;
+} WiFiClientRecord;
+
+typedef void (*ClientCallback)(const WiFiClientRecord& client);
+
+// Client tracker statistics
+typedef struct {
+    uint32_t joins;
+    uint32_t leaves;
+    uint32_t dropped;               // Joins with the table full
+} ClientStats;
+
+// Station join/leave tracking driven by the WiFi event callbacks. The
+// event task writes, the main loop reads; neither polls the driver.
+class ClientTracker {
+private:
+    WiFiClientRecord clients[WIFI_MAX_CLIENTS];
+    std::atomic<uint8_t> count;
+    ClientStats stats;
+    ClientCallback connectCallback;
+    ClientCallback disconnectCallback;
+
+    int find(const uint8_t* mac) const;
+
+public:
+    ClientTracker();
+
+    // Event path
+    void onJoined(const uint8_t* mac, uint8_t aid, uint32_t nowMs);
+    void onLeft(const uint8_t* mac);
+    void onIpAssigned(const uint8_t* mac, uint32_t ip);     // mac may be NULL
+    void setRssi(const uint8_t* mac, int8_t rssi);
+
+    // Callbacks run on the event path, outside the table lock
+    void setConnectCallback(ClientCallback callback) { connectCallback = callback; }
+    void setDisconnectCallback(ClientCallback callback) { disconnectCallback = callback; }
+
+    // Readers
+    uint8_t getClientCount() const { return count.load(std::memory_order_relaxed); }
+    uint8_t snapshot(WiFiClientRecord* out, uint8_t max) const;
+    bool isConnected(const uint8_t* mac) const;
+    ClientStats getStats() const { return stats; }
+    static void formatMac(const uint8_t* mac, char* out);   // 18 bytes
+
+#ifdef ARDUINO
+    void begin();
+    void refreshRssi();
+#endif
+};
+
+extern ClientTracker clientTracker;
+
+#endif // CLIENT_TRACKER_H
@@ -11,6 +11,7 @@
 // MPU6050 IMU
 #define MPU_SDA_PIN 21
 #define MPU_SCL_PIN 22
+#define MPU_INT_PIN 34          // Motion interrupt (push-pull, active high)
 
 // GPS Module
 #define GPS_RX_PIN 16
@@ -38,27 +39,158 @@
 #define BUZZER_BEEP_DURATION_MS 300
 #define EMERGENCY_BEEP_COUNT 5
 #define NORMAL_BEEP_COUNT 2
+#define BUZZER_PASSIVE false            // true: piezo driven with a tone, false: active buzzer
+#define BUZZER_FREQUENCY 2000           // Tone (passive) or PWM (active) frequency (Hz)
+#define BUZZER_LEDC_CHANNEL 0
+#define BUZZER_LEDC_RESOLUTION 8
+#define BUZZER_MELODY_MAX_STEPS 16      // Custom patterns, tones and melodies
+#define ALERT_QUEUE_SIZE 16             // Lock-free post ring (power of two)
+#define ALERT_READY_DEPTH 8             // Waiting alerts per priority
+#define ALERT_WHEEL_SLOTS 32
+#define ALERT_WHEEL_TICK_MS 50          // Delayed alert resolution
+#define ALERT_WHEEL_CAPACITY 16         // Delayed alerts pending at once
 
 // ================= GPS Configuration =================
 #define GPS_BAUD_RATE 9600
 #define GPS_UPDATE_INTERVAL_MS 1000
 #define GPS_TIMEOUT_MS 5000
 
+// ================= GPS Track Store =================
+#define TRACK_BLOCK_BYTES 496           // Delta-encoded payload per block
+#define TRACK_BLOCK_COUNT 64            // Ring of blocks (~32 KB RAM)
+#define TRACK_WINDOW_POINTS 16          // Opening-window simplifier depth
+#define TRACK_TOLERANCE_M 5.0           // Max cross-track error when storing
+#define TRACK_DEADBAND_M 4.0            // Ignore jitter while standing still
+#define TRACK_MAX_GAP_S 300             // Keep at least one point per gap
+#define TRACK_DEFAULT_MAX_POINTS 500    // Default /track point budget
+
 // ================= Web Server Configuration =================
 #define WEB_SERVER_PORT 80
 #define API_RATE_LIMIT_MS 100
 #define WEB_TIMEOUT_MS 5000
+#define WEB_POLL_INTERVAL_MS 10         // handleClient() period while AP clients are connected
+
+// ================= API Routing =================
+#define ROUTE_TABLE_BITS 6              // 64 hash slots for the perfect hash
+#define ROUTE_MAX_ROUTES 16
+#define ROUTE_SEED_LIMIT 200            // Compile-time seed search bound
+#define ROUTE_LATENCY_BUCKETS 8         // <128 us, then doubling up to >=8 ms
+#define JSON_CHUNK_SIZE 512             // Response stream buffer, one chunk per flush
+#define RESPONSE_CACHE_ENTRIES 4        // Cached endpoint bodies
+#define RESPONSE_CACHE_BODY_BYTES 384   // Largest cached body; bigger ones are streamed
+
+// ================= State Broadcast =================
+#define STATE_BROADCAST_ENABLED true
+#define STATE_BROADCAST_PORT 4210
+#define STATE_BROADCAST_INTERVAL_MS 1000
+#define STATE_URGENT_REPEATS 3          // Extra copies of a fall packet
+#define STATE_URGENT_REPEAT_MS 100
+
+// ================= Emergency Lane =================
+// A fall goes to every sink at once, outside the loop and every batching
+// queue. Sinks that fail are retried with exponential backoff.
+#define EMERGENCY_EVENTS_PORT 81        // SSE stream: http://192.168.4.1:81/events
+#define EMERGENCY_MAX_SUBSCRIBERS WIFI_MAX_CLIENTS
+#define EMERGENCY_WEBHOOK_HOST ""       // HTTP POST per fall; empty for none
+#define EMERGENCY_WEBHOOK_PORT 8080
+#define EMERGENCY_WEBHOOK_PATH "/fall"
+#define EMERGENCY_CONNECT_TIMEOUT_MS 1000
+#define EMERGENCY_RETRY_BASE_MS 250     // First retry; doubles with each attempt
+#define EMERGENCY_RETRY_MAX_MS 8000
+#define EMERGENCY_MAX_ATTEMPTS 8        // Per sink, then that sink gives up
+#define EMERGENCY_MAX_EVENTS 4          // Events in delivery; a new one replaces the oldest
+#define EMERGENCY_DEADLINE_MS 100       // Fall to notification; later counts as late
+#define EMERGENCY_REPLAY_MS 300000      // A new subscriber gets a fall this recent
+#define EMERGENCY_SSE_PING_MS 15000     // Comment line that finds dead subscribers
+#define EMERGENCY_TASK_PRIORITY 5       // Above the loop task (1)
+#define EMERGENCY_IO_TASK_PRIORITY 2    // Takes subscribers and posts the webhook, off the lane task
+#define EMERGENCY_ACK_PORT 4211         // Source port of the UDP packet; receivers acknowledge to it
+
+// ================= Telemetry Uplink =================
+// Station connection to a router next to the AP. In AP+STA mode the AP
+// follows the router's channel.
+#define TELEMETRY_ENABLED false         // Needs the network and broker below
+#define WIFI_STA_SSID ""
+#define WIFI_STA_PASSWORD ""
+#define MQTT_BROKER_HOST "192.168.1.10"
+#define MQTT_BROKER_PORT 1883
+#define MQTT_TOPIC_PREFIX "drishti"     // Publishes to <prefix>/<MAC>/telemetry
+#define MQTT_KEEPALIVE_S 60
+#define MQTT_ACK_TIMEOUT_MS 5000        // PUBACK or PINGRESP wait before reconnecting
+#define MQTT_CONNECT_TIMEOUT_MS 2000
+#define MQTT_RETRY_MS 10000             // Between broker connection attempts
+#define TELEMETRY_PARTITION_LABEL "spiffs"  // Data partition for the queue, unused otherwise
+#define TELEMETRY_QUEUE_SECTORS 64      // 256 KB of flash
+#define TELEMETRY_RECORD_MAX 24         // Largest queued record payload
+#define TELEMETRY_BATCH_RECORDS 64      // Records per publish, at most
+#define TELEMETRY_BATCH_BYTES 512       // Encoded batch, at most
+#define TELEMETRY_FLUSH_MS 300000       // Oldest record waits at most this long
+#define TELEMETRY_SUMMARY_MS 60000      // Sensor summary period
+#define TELEMETRY_TRACK_INTERVAL_S 10   // Minimum spacing of queued track points
+#define TELEMETRY_SERVICE_MS 250        // Exporter task period
+#define TELEMETRY_INBOX_SIZE 16         // Records handed from the loop to the exporter task
+
+// ================= OTA Updates =================
+#define OTA_ENABLED true
+#define OTA_CONFIRM_MS 60000            // Stall-free run before a new image is kept
+#define OTA_MAX_BOOT_ATTEMPTS 3         // Unconfirmed boots before rolling back
+#define OTA_RESTART_DELAY_MS 1000       // Lets the response reach the client
+// HMAC-SHA256 key uploads to /update must be signed with; every upload is
+// refused while it is empty. Use a long random string, not the AP password.
+#define OTA_SECRET ""
+#define PATCH_COPY_CHUNK 256            // Source read buffer while patching
+
+// ================= Rate Limiting =================
+// Per-client token bucket: one token every API_RATE_LIMIT_MS
+#define RATE_LIMIT_SLOTS 32             // Clients tracked (power of two)
+#define RATE_LIMIT_PROBES 8             // Open-addressing probe window
+#define RATE_LIMIT_BURST 10             // Requests a client may send back to back
+#define RATE_LIMIT_IDLE_MS 60000        // Idle clients give up their slot after this
 
 // ================= System Performance =================
 #define MAIN_LOOP_DELAY_MS 10
 #define MPU_SAMPLE_RATE_MS 100
 #define WEB_CLIENT_TIMEOUT 5000
 
+// ================= Timer Service =================
+#define TIMER_WHEEL_BITS 6              // 64 slots per level
+#define TIMER_WHEEL_LEVELS 3            // 1 ms, 64 ms and 4.1 s slots (~4.4 min horizon)
+#define LOOP_MAX_BLOCK_MS 1000          // Longest the loop waits without a deadline or event
+#define IMU_STILL_RETRY_MS 1000         // Still entry retry while the buzzer is playing
+
 // ================= Power Management =================
 #define DEEP_SLEEP_ENABLED false
 #define BATTERY_MONITOR_PIN A0
 #define LOW_BATTERY_THRESHOLD 3.0
 #define BATTERY_CHECK_INTERVAL_MS 30000
+#define BATTERY_DIVIDER_RATIO 2.0       // Cell voltage / ADC pin voltage
+#define BATTERY_FULL_VOLTS 4.2          // 100%; LOW_BATTERY_THRESHOLD is 0%
+
+// Motion-wake low-power mode
+#define LOW_POWER_ENABLED true
+#define LIGHT_SLEEP_ENABLED true        // Only while the AP is not needed; otherwise modem sleep
+#define LIGHT_SLEEP_AP_IDLE_MS 600000   // The AP is needed until no station has been attached this long
+#define IMU_FULL_RATE_HZ 100            // IMU output data rate while moving
+#define IMU_STILL_WAKE_HZ 20            // Accel-only cycle rate while still (1.25/5/20/40)
+#define IMU_STILL_TIMEOUT_MS 30000      // No movement for this long -> still mode
+#define IMU_MOTION_THRESHOLD 20         // Motion interrupt threshold (2 mg/LSB)
+#define IMU_MOTION_DURATION 1           // Motion interrupt duration (ms)
+#define LOW_POWER_IDLE_POLL_MS 50       // Max wait per loop while still with clients
+#define LOW_POWER_MAX_SLEEP_MS 1000     // Light sleep cap so GPS/web get serviced
+#define LOW_POWER_WAKE_BUDGET_MS 10     // Allowed wake-to-first-sample latency
+
+// Dynamic frequency scaling
+#define DFS_ENABLED true
+#define DFS_MAX_FREQ_MHZ 240
+#define DFS_MIN_FREQ_MHZ 80             // Lowest clock that keeps WiFi running
+#define DFS_HTTP_HOLD_MS 500            // Full clock after the last HTTP request
+#define DFS_FALL_HOLD_MS 2000           // Full clock from low-g through the fall event
+#define DFS_GPS_HOLD_MS 100             // Full clock while an NMEA burst is parsed
+
+// Battery life estimate (approximate board current with the AP up)
+#define BATTERY_CAPACITY_MAH 2000
+#define CURRENT_MAX_FREQ_MA 130
+#define CURRENT_MIN_FREQ_MA 100
 
 // ================= Debug and Logging =================
 #define DEBUG_ENABLED true
@@ -67,8 +199,19 @@
 
 // ================= Safety and Reliability =================
 #define WATCHDOG_TIMEOUT_MS 5000
+// The web stage blocks on a slow client for the WebServer's 5 s read
+// timeout and again for its 5 s send timeout, so it may run longer
+#define WATCHDOG_WEB_TIMEOUT_MS 15000
 #define MAX_RESTART_COUNT 3
-#define ERROR_RECOVERY_DELAY_MS 5000
+#define ERROR_RECOVERY_DELAY_MS 5000    // Stall-free run time before restarts stop counting as consecutive
+#define WATCHDOG_CHECK_INTERVAL_MS 250
+
+// Per-stage deadlines for one loop iteration (overruns are counted)
+#define STAGE_WEB_DEADLINE_US 50000
+#define STAGE_GPS_DEADLINE_US 5000
+#define STAGE_IMU_DEADLINE_US 5000
+#define STAGE_FALL_DEADLINE_US 1000
+#define STAGE_BUZZER_DEADLINE_US 500
 
 // ================= Calibration Settings =================
 #define MPU_ACCEL_SCALE 16384.0
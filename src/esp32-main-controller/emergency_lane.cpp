@@ -0,0 +1,631 @@
+#include "emergency_lane.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef ARDUINO
+#include <freertos/FreeRTOS.h>
+static portMUX_TYPE laneLock = portMUX_INITIALIZER_UNLOCKED;
+#define LANE_LOCK() portENTER_CRITICAL(&laneLock)
+#define LANE_UNLOCK() portEXIT_CRITICAL(&laneLock)
+#else
+#define LANE_LOCK()
+#define LANE_UNLOCK()
+#endif
+
+static void putU16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void putU32(uint8_t* p, uint32_t v) {
+    for (uint8_t i = 0; i < 4; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static uint16_t getU16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t getU32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// ================= Formats =================
+
+size_t encodeEmergencyPacket(const EmergencyEvent& e, uint8_t attempt, uint8_t* out) {
+    putU16(out, EMERGENCY_PACKET_MAGIC);
+    out[2] = EMERGENCY_PACKET_VERSION;
+    out[3] = e.flags;
+    putU32(out + 4, e.id);
+    putU32(out + 8, e.uptimeMs);
+    putU32(out + 12, (uint32_t)e.latitudeE6);
+    putU32(out + 16, (uint32_t)e.longitudeE6);
+    putU16(out + 20, e.falls);
+    out[22] = attempt;
+    out[23] = 0;
+    return EMERGENCY_PACKET_SIZE;
+}
+
+bool decodeEmergencyPacket(const uint8_t* data, size_t length, EmergencyEvent& out) {
+    if (length < EMERGENCY_PACKET_SIZE || getU16(data) != EMERGENCY_PACKET_MAGIC ||
+        data[2] < EMERGENCY_PACKET_VERSION) return false;
+    out.flags = data[3];
+    out.id = getU32(data + 4);
+    out.uptimeMs = getU32(data + 8);
+    out.latitudeE6 = (int32_t)getU32(data + 12);
+    out.longitudeE6 = (int32_t)getU32(data + 16);
+    out.falls = getU16(data + 20);
+    out.detectedUs = 0;
+    return true;
+}
+
+size_t encodeEmergencyAck(uint32_t id, uint8_t attempt, uint8_t* out) {
+    putU16(out, EMERGENCY_ACK_MAGIC);
+    out[2] = EMERGENCY_PACKET_VERSION;
+    out[3] = attempt;
+    putU32(out + 4, id);
+    return EMERGENCY_ACK_SIZE;
+}
+
+bool decodeEmergencyAck(const uint8_t* data, size_t length, uint32_t& id, uint8_t& attempt) {
+    if (length < EMERGENCY_ACK_SIZE || getU16(data) != EMERGENCY_ACK_MAGIC ||
+        data[2] < EMERGENCY_PACKET_VERSION) return false;
+    attempt = data[3];
+    id = getU32(data + 4);
+    return true;
+}
+
+// Coordinates as strings, as in /gps
+static size_t formatE6(int32_t value, char* out) {
+    uint32_t magnitude = value < 0 ? 0UL - (uint32_t)value : (uint32_t)value;
+    return sprintf(out, "%s%lu.%06lu", value < 0 ? "-" : "",
+                   (unsigned long)(magnitude / 1000000UL), (unsigned long)(magnitude % 1000000UL));
+}
+
+size_t formatEmergencyJson(const EmergencyEvent& e, uint8_t attempt, char* out, size_t size) {
+    char lat[16], lon[16];
+    formatE6(e.latitudeE6, lat);
+    formatE6(e.longitudeE6, lon);
+    int n = snprintf(out, size,
+                     "{\"event\":\"fall\",\"id\":%lu,\"uptimeMs\":%lu,\"latitude\":\"%s\",\"longitude\":\"%s\","
+                     "\"gpsFix\":%s,\"falls\":%u,\"attempt\":%u}",
+                     (unsigned long)e.id, (unsigned long)e.uptimeMs, lat, lon,
+                     (e.flags & EMERGENCY_FLAG_GPS_FIX) ? "true" : "false", e.falls, attempt);
+    return n < 0 || (size_t)n >= size ? 0 : (size_t)n;
+}
+
+size_t formatWebhookRequest(const EmergencyEvent& e, uint8_t attempt, const char* host,
+                            const char* path, char* out, size_t size) {
+    char body[224];
+    size_t length = formatEmergencyJson(e, attempt, body, sizeof(body));
+    if (length == 0) return 0;
+    int n = snprintf(out, size,
+                     "POST %s HTTP/1.1\r\nHost: %s\r\nContent-Type: application/json\r\n"
+                     "Idempotency-Key: fall-%lu\r\nContent-Length: %u\r\nConnection: close\r\n\r\n%s",
+                     path, host, (unsigned long)e.id, (unsigned)length, body);
+    return n < 0 || (size_t)n >= size ? 0 : (size_t)n;
+}
+
+int parseHttpStatus(const char* line) {
+    if (strncmp(line, "HTTP/1.", 7) != 0 || !line[7] || line[8] != ' ') return 0;
+    const char* code = line + 9;
+    for (uint8_t i = 0; i < 3; i++) {
+        if (code[i] < '0' || code[i] > '9') return 0;
+    }
+    return atoi(code);
+}
+
+// ================= Lane =================
+
+EmergencyLane::EmergencyLane() : sinkCount(0), clock(NULL), idBase(0), idSequence(0), hasLatest(false) {
+    memset(sinks, 0, sizeof(sinks));
+    memset(sinkStats, 0, sizeof(sinkStats));
+    memset(slots, 0, sizeof(slots));
+    memset(&latest, 0, sizeof(latest));
+    memset(&stats, 0, sizeof(stats));
+}
+
+uint8_t EmergencyLane::addSink(const char* name, EmergencySendFn send, void* context, uint32_t confirmMs) {
+    if (sinkCount == EMERGENCY_MAX_SINKS) return sinkCount;
+    sinks[sinkCount].send = send;
+    sinks[sinkCount].context = context;
+    sinks[sinkCount].confirmMs = confirmMs;
+    sinkStats[sinkCount].name = name;
+    return sinkCount++;
+}
+
+uint32_t EmergencyLane::nextId() {
+    return idBase + ++idSequence;
+}
+
+uint32_t EmergencyLane::backoffMs(uint8_t failures) {
+    uint32_t delay = EMERGENCY_RETRY_BASE_MS;
+    for (uint8_t i = 1; i < failures && delay < EMERGENCY_RETRY_MAX_MS; i++) delay <<= 1;
+    return delay < EMERGENCY_RETRY_MAX_MS ? delay : EMERGENCY_RETRY_MAX_MS;
+}
+
+bool EmergencyLane::raise(const EmergencyEvent& e) {
+    LANE_LOCK();
+    Slot* slot = NULL;
+    for (uint8_t i = 0; i < EMERGENCY_MAX_EVENTS; i++) {
+        if (slots[i].active && slots[i].event.id == e.id) {
+            stats.duplicates++;
+            LANE_UNLOCK();
+            return false;
+        }
+        if (!slot && !slots[i].active) slot = &slots[i];
+    }
+    if (!slot) {
+        // Full: the oldest event makes way, its remaining retries dropped
+        slot = &slots[0];
+        for (uint8_t i = 1; i < EMERGENCY_MAX_EVENTS; i++) {
+            if ((int32_t)(slots[i].event.detectedUs - slot->event.detectedUs) < 0) slot = &slots[i];
+        }
+        stats.evicted++;
+    }
+    slot->active = true;
+    slot->event = e;
+    slot->notified = false;
+    for (uint8_t s = 0; s < EMERGENCY_MAX_SINKS; s++) {
+        slot->deliveries[s].attempts = 0;
+        slot->deliveries[s].done = s >= sinkCount;
+        slot->deliveries[s].awaiting = false;
+        slot->deliveries[s].nextUs = e.detectedUs;
+    }
+    latest = e;
+    hasLatest = true;
+    stats.raised++;
+    LANE_UNLOCK();
+    return true;
+}
+
+EmergencyLane::Slot* EmergencyLane::findSlot(uint32_t id) {
+    for (uint8_t i = 0; i < EMERGENCY_MAX_EVENTS; i++) {
+        if (slots[i].active && slots[i].event.id == id) return &slots[i];
+    }
+    return NULL;
+}
+
+// Under the lock. The sink's figures count even if the event was replaced
+// meanwhile (slot NULL); the event's only while it is still in delivery.
+void EmergencyLane::delivered(Slot* slot, uint8_t sink, uint32_t latencyUs) {
+    SinkStats& s = sinkStats[sink];
+    s.delivered++;
+    s.lastLatencyUs = latencyUs;
+    if (latencyUs > s.maxLatencyUs) s.maxLatencyUs = latencyUs;
+    if (latencyUs > (uint32_t)EMERGENCY_DEADLINE_MS * 1000) s.late++;
+    if (!slot) return;
+    if (!slot->notified) {
+        slot->notified = true;
+        stats.lastLatencyUs = latencyUs;
+        if (latencyUs > stats.maxLatencyUs) stats.maxLatencyUs = latencyUs;
+    }
+    slot->deliveries[sink].done = true;
+    slot->deliveries[sink].awaiting = false;
+    finish(*slot);
+}
+
+// Under the lock: the attempt in hand failed
+void EmergencyLane::failed(Slot& slot, uint8_t sink, uint32_t nowUs) {
+    Delivery& d = slot.deliveries[sink];
+    d.awaiting = false;
+    if (d.attempts >= EMERGENCY_MAX_ATTEMPTS) {
+        sinkStats[sink].failed++;
+        d.done = true;
+        finish(slot);
+    } else {
+        d.nextUs = nowUs + backoffMs(d.attempts) * 1000;
+    }
+}
+
+void EmergencyLane::finish(Slot& slot) {
+    bool all = true;
+    for (uint8_t k = 0; k < sinkCount; k++) all = all && slot.deliveries[k].done;
+    if (all) slot.active = false;
+}
+
+// Sends outside the lock: raise() may replace the slot, and confirm() may
+// settle the delivery, meanwhile, so the result is only recorded if the
+// slot still holds the same event and the delivery is still open
+void EmergencyLane::attempt(Slot& slot, uint8_t sink) {
+    LANE_LOCK();
+    EmergencyEvent event = slot.event;
+    uint8_t attemptNumber = ++slot.deliveries[sink].attempts;
+    LANE_UNLOCK();
+
+    uint32_t start = clock();
+    EmergencySendResult result = sinks[sink].send(event, attemptNumber, sinks[sink].context);
+    uint32_t end = clock();
+
+    SinkStats& s = sinkStats[sink];
+    s.lastSendUs = end - start;
+    if (attemptNumber > 1) s.retries++;
+
+    LANE_LOCK();
+    bool current = slot.active && slot.event.id == event.id;
+    bool open = current && !slot.deliveries[sink].done;
+    if (result == EMERGENCY_SEND_DELIVERED) {
+        delivered(open ? &slot : NULL, sink, end - event.detectedUs);
+    } else if (open && result == EMERGENCY_SEND_AWAITING) {
+        Delivery& d = slot.deliveries[sink];
+        uint32_t waitMs = sinks[sink].confirmMs ? sinks[sink].confirmMs : backoffMs(attemptNumber);
+        d.awaiting = true;
+        d.nextUs = end + waitMs * 1000;
+    } else if (open) {
+        failed(slot, sink, end);
+    }
+    LANE_UNLOCK();
+}
+
+// An attempt still awaiting confirmation when it falls due has failed and
+// is tried again at once; its wait was the backoff
+uint32_t EmergencyLane::service() {
+    uint32_t wait = EMERGENCY_IDLE_US;
+    for (uint8_t i = 0; i < EMERGENCY_MAX_EVENTS; i++) {
+        Slot& slot = slots[i];
+        for (uint8_t s = 0; s < sinkCount; s++) {
+            uint32_t nowUs = clock();
+            LANE_LOCK();
+            Delivery& d = slot.deliveries[s];
+            bool waiting = slot.active && !d.done;
+            int32_t until = (int32_t)(d.nextUs - nowUs);
+            if (waiting && until <= 0 && d.awaiting) {
+                sinkStats[s].unconfirmed++;
+                d.awaiting = false;
+                if (d.attempts >= EMERGENCY_MAX_ATTEMPTS) {
+                    failed(slot, s, nowUs);
+                    waiting = false;
+                }
+            }
+            LANE_UNLOCK();
+            if (!waiting) continue;
+            if (until <= 0) {
+                attempt(slot, s);
+                nowUs = clock();
+                LANE_LOCK();
+                waiting = slot.active && !slot.deliveries[s].done;
+                until = (int32_t)(slot.deliveries[s].nextUs - nowUs);
+                LANE_UNLOCK();
+                if (!waiting) continue;
+                if (until < 0) until = 0;
+            }
+            if ((uint32_t)until < wait) wait = until;
+        }
+    }
+    return wait;
+}
+
+bool EmergencyLane::confirm(uint8_t sink, uint32_t id, uint8_t attempt, bool ok) {
+    uint32_t nowUs = clock();
+    LANE_LOCK();
+    Slot* slot = sink < sinkCount ? findSlot(id) : NULL;
+    bool open = slot && !slot->deliveries[sink].done;
+    // A late failure of an earlier attempt leaves the retry under way alone
+    if (open && !ok && (!slot->deliveries[sink].awaiting || attempt != slot->deliveries[sink].attempts)) {
+        open = false;
+    }
+    if (open) {
+        if (ok) delivered(slot, sink, nowUs - slot->event.detectedUs);
+        else failed(*slot, sink, nowUs);
+    }
+    LANE_UNLOCK();
+    return open;
+}
+
+bool EmergencyLane::isAwaiting(uint8_t sink) const {
+    bool awaiting = false;
+    LANE_LOCK();
+    for (uint8_t i = 0; i < EMERGENCY_MAX_EVENTS; i++) {
+        awaiting = awaiting || (slots[i].active && slots[i].deliveries[sink].awaiting);
+    }
+    LANE_UNLOCK();
+    return awaiting;
+}
+
+bool EmergencyLane::isPending() const {
+    bool pending = false;
+    LANE_LOCK();
+    for (uint8_t i = 0; i < EMERGENCY_MAX_EVENTS; i++) pending = pending || slots[i].active;
+    LANE_UNLOCK();
+    return pending;
+}
+
+bool EmergencyLane::getLatest(EmergencyEvent& out) const {
+    LANE_LOCK();
+    bool found = hasLatest;
+    out = latest;
+    LANE_UNLOCK();
+    return found;
+}
+
+// ================= Device =================
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include "client_tracker.h"
+
+#define SUBSCRIBER_POLL_MS 250          // New /events connections, while stations are attached
+#define REQUEST_WAIT_MS 200             // For a subscriber's request headers
+#define ACK_POLL_MS 2                   // Lane task wake-up while a UDP acknowledgement is due
+// Connect and status line, behind whatever the I/O task is doing
+#define WEBHOOK_CONFIRM_MS (3 * EMERGENCY_CONNECT_TIMEOUT_MS)
+
+EmergencyLane emergencyLane;
+
+// The lane task only sends what cannot block for long: the UDP packet and
+// the event stream. Taking subscribers and the webhook request, which wait
+// on the network, run on the I/O task and never hold up a fall.
+static TaskHandle_t laneTask = NULL;
+static TaskHandle_t ioTask = NULL;
+static WiFiUDP laneSocket;
+static WiFiServer eventServer(EMERGENCY_EVENTS_PORT);
+static SemaphoreHandle_t subscriberLock = NULL;
+static WiFiClient subscribers[EMERGENCY_MAX_SUBSCRIBERS];
+static uint8_t subscriberCount = 0;
+static uint32_t lastPingMs = 0;
+static uint8_t udpSink = 0;
+static uint8_t sseSink = 0;
+static uint8_t webhookSink = 0;
+
+typedef struct {
+    EmergencyEvent event;
+    uint8_t attempt;
+} WebhookJob;
+
+static QueueHandle_t webhookQueue = NULL;
+
+static uint32_t laneClock() {
+    return micros();
+}
+
+// ----- Sinks -----
+
+// A broadcast has no delivery report of its own: the packet counts once a
+// receiver acknowledges it (readAcks), and is sent again if none does
+static EmergencySendResult sendUdp(const EmergencyEvent& e, uint8_t attempt, void*) {
+    uint8_t packet[EMERGENCY_PACKET_SIZE];
+    encodeEmergencyPacket(e, attempt, packet);
+    bool sent = laneSocket.beginPacket(WiFi.softAPBroadcastIP(), STATE_BROADCAST_PORT) &&
+                laneSocket.write(packet, sizeof(packet)) == sizeof(packet) &&
+                laneSocket.endPacket();
+    return sent ? EMERGENCY_SEND_AWAITING : EMERGENCY_SEND_FAILED;
+}
+
+static void readAcks() {
+    while (laneSocket.parsePacket() > 0) {
+        uint8_t ack[EMERGENCY_ACK_SIZE];
+        int length = laneSocket.read(ack, sizeof(ack));
+        laneSocket.flush();         // Anything longer is not an acknowledgement
+        uint32_t id;
+        uint8_t attempt;
+        if (length > 0 && decodeEmergencyAck(ack, length, id, attempt)) {
+            emergencyLane.confirm(udpSink, id, attempt, true);
+        }
+    }
+}
+
+static bool writeAll(WiFiClient& client, const char* data, size_t length) {
+    return client.connected() && client.write((const uint8_t*)data, length) == length;
+}
+
+// With subscriberLock held
+static void dropSubscriber(uint8_t i) {
+    subscribers[i].stop();
+    subscribers[i] = subscribers[--subscriberCount];
+    subscribers[subscriberCount] = WiFiClient();
+}
+
+static size_t formatSse(const EmergencyEvent& e, uint8_t attempt, char* out, size_t size) {
+    int n = snprintf(out, size, "id: %lu\nevent: fall\ndata: ", (unsigned long)e.id);
+    size_t body = formatEmergencyJson(e, attempt, out + n, size - n - 2);
+    if (body == 0) return 0;
+    n += body;
+    out[n++] = '\n';
+    out[n++] = '\n';
+    return n;
+}
+
+// Delivered if at least one subscriber's connection took it; with none the
+// sink is retried, and a subscriber that connects meanwhile gets the fall
+// as a replay, which confirms it. A dead connection is dropped.
+static EmergencySendResult sendSse(const EmergencyEvent& e, uint8_t attempt, void*) {
+    char message[256];
+    size_t length = formatSse(e, attempt, message, sizeof(message));
+    uint8_t written = 0;
+    xSemaphoreTake(subscriberLock, portMAX_DELAY);
+    for (uint8_t i = subscriberCount; i > 0; i--) {
+        if (writeAll(subscribers[i - 1], message, length)) written++;
+        else dropSubscriber(i - 1);
+    }
+    xSemaphoreGive(subscriberLock);
+    return written > 0 ? EMERGENCY_SEND_DELIVERED : EMERGENCY_SEND_FAILED;
+}
+
+// Handed to the I/O task, which confirms the outcome
+static EmergencySendResult sendWebhook(const EmergencyEvent& e, uint8_t attempt, void*) {
+    WebhookJob job = { e, attempt };
+    if (xQueueSend(webhookQueue, &job, 0) != pdTRUE) return EMERGENCY_SEND_FAILED;
+    xTaskNotifyGive(ioTask);
+    return EMERGENCY_SEND_AWAITING;
+}
+
+static bool postWebhook(const EmergencyEvent& e, uint8_t attempt) {
+    char request[512];
+    size_t length = formatWebhookRequest(e, attempt, EMERGENCY_WEBHOOK_HOST, EMERGENCY_WEBHOOK_PATH,
+                                         request, sizeof(request));
+    WiFiClient client;
+    if (!length || !client.connect(EMERGENCY_WEBHOOK_HOST, EMERGENCY_WEBHOOK_PORT, EMERGENCY_CONNECT_TIMEOUT_MS)) {
+        return false;
+    }
+    client.setNoDelay(true);
+    bool ok = writeAll(client, request, length);
+
+    // Only the status line matters
+    char line[48];
+    size_t n = 0;
+    uint32_t start = millis();
+    while (ok && millis() - start < EMERGENCY_CONNECT_TIMEOUT_MS) {
+        if (!client.available()) {
+            if (!client.connected()) break;
+            vTaskDelay(1);
+            continue;
+        }
+        uint8_t c;
+        if (client.read(&c, 1) != 1 || c == '\n' || n == sizeof(line) - 1) break;
+        line[n++] = (char)c;
+    }
+    line[n] = '\0';
+    client.stop();
+    int status = parseHttpStatus(line);
+    return ok && status >= 200 && status < 300;
+}
+
+// ----- Subscribers -----
+
+// GET /events, answered with an event stream. Last-Event-ID is what a
+// reconnecting EventSource already has.
+static void acceptSubscriber() {
+    WiFiClient client = eventServer.available();
+    if (!client) return;
+
+    char line[96];
+    size_t n = 0;
+    bool events = false;
+    bool firstLine = true;
+    uint32_t lastEventId = 0;
+    uint32_t start = millis();
+    while (millis() - start < REQUEST_WAIT_MS) {
+        if (!client.available()) {
+            vTaskDelay(1);
+            continue;
+        }
+        uint8_t c;
+        if (client.read(&c, 1) != 1) break;
+        if (c == '\r') continue;
+        if (c != '\n') {
+            if (n < sizeof(line) - 1) line[n++] = (char)c;
+            continue;
+        }
+        line[n] = '\0';
+        if (n == 0) break;          // End of headers
+        if (firstLine) events = strncmp(line, "GET /events", 11) == 0;
+        else if (strncasecmp(line, "Last-Event-ID:", 14) == 0) lastEventId = strtoul(line + 14, NULL, 10);
+        firstLine = false;
+        n = 0;
+    }
+
+    xSemaphoreTake(subscriberLock, portMAX_DELAY);
+    if (!events || subscriberCount == EMERGENCY_MAX_SUBSCRIBERS) {
+        xSemaphoreGive(subscriberLock);
+        const char* reply = events ? "HTTP/1.1 503 Service Unavailable\r\nConnection: close\r\n\r\n"
+                                   : "HTTP/1.1 404 Not Found\r\nConnection: close\r\n\r\n";
+        writeAll(client, reply, strlen(reply));
+        client.stop();
+        return;
+    }
+
+    static const char headers[] =
+        "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\nCache-Control: no-cache\r\n"
+        "Access-Control-Allow-Origin: *\r\nConnection: keep-alive\r\n\r\nretry: 2000\n\n";
+    client.setNoDelay(true);
+    if (!writeAll(client, headers, sizeof(headers) - 1)) {
+        xSemaphoreGive(subscriberLock);
+        client.stop();
+        return;
+    }
+
+    EmergencyEvent latest;
+    if (emergencyLane.getLatest(latest) && latest.id != lastEventId &&
+        millis() - latest.uptimeMs < EMERGENCY_REPLAY_MS) {
+        char message[256];
+        size_t length = formatSse(latest, 0, message, sizeof(message));
+        if (writeAll(client, message, length)) emergencyLane.confirm(sseSink, latest.id, 0, true);
+    }
+    subscribers[subscriberCount++] = client;
+    xSemaphoreGive(subscriberLock);
+}
+
+static void pingSubscribers() {
+    if (millis() - lastPingMs < EMERGENCY_SSE_PING_MS) return;
+    lastPingMs = millis();
+    xSemaphoreTake(subscriberLock, portMAX_DELAY);
+    for (uint8_t i = subscriberCount; i > 0; i--) {
+        if (!writeAll(subscribers[i - 1], ": ping\n\n", 8)) dropSubscriber(i - 1);
+    }
+    xSemaphoreGive(subscriberLock);
+}
+
+// ----- Tasks -----
+
+static void laneLoop(void*) {
+    for (;;) {
+        readAcks();
+        uint32_t waitUs = emergencyLane.service();
+        uint32_t waitMs = waitUs == EMERGENCY_IDLE_US ? portMAX_DELAY : (waitUs + 999) / 1000;
+        // Acknowledgements are read between waits; keep them short while
+        // one is due so its latency is the receiver's, not the task's
+        if (emergencyLane.isAwaiting(udpSink) && waitMs > ACK_POLL_MS) waitMs = ACK_POLL_MS;
+        ulTaskNotifyTake(pdTRUE, waitMs == portMAX_DELAY ? portMAX_DELAY : pdMS_TO_TICKS(waitMs));
+    }
+}
+
+static void ioLoop(void*) {
+    for (;;) {
+        WebhookJob job;
+        while (webhookQueue && xQueueReceive(webhookQueue, &job, 0) == pdTRUE) {
+            bool ok = postWebhook(job.event, job.attempt);
+            if (emergencyLane.confirm(webhookSink, job.event.id, job.attempt, ok) && laneTask) {
+                xTaskNotifyGive(laneTask);
+            }
+        }
+
+        TickType_t wait = portMAX_DELAY;
+        if (clientTracker.getClientCount() > 0) {
+            acceptSubscriber();
+            pingSubscribers();
+            wait = pdMS_TO_TICKS(SUBSCRIBER_POLL_MS);
+        } else {
+            // Nobody can subscribe; wake() brings the task back when a
+            // station joins
+            xSemaphoreTake(subscriberLock, portMAX_DELAY);
+            for (uint8_t i = subscriberCount; i > 0; i--) dropSubscriber(i - 1);
+            xSemaphoreGive(subscriberLock);
+        }
+        ulTaskNotifyTake(pdTRUE, wait);
+    }
+}
+
+void EmergencyLane::begin() {
+    setClock(laneClock);
+    setIdBase(esp_random());
+    subscriberLock = xSemaphoreCreateMutex();
+    laneSocket.begin(EMERGENCY_ACK_PORT);
+    udpSink = addSink("udp", sendUdp, NULL);
+    sseSink = addSink("sse", sendSse, NULL);
+    if (EMERGENCY_WEBHOOK_HOST[0]) {
+        webhookQueue = xQueueCreate(EMERGENCY_MAX_EVENTS, sizeof(WebhookJob));
+        webhookSink = addSink("webhook", sendWebhook, NULL, WEBHOOK_CONFIRM_MS);
+    }
+    eventServer.begin();
+    xTaskCreatePinnedToCore(ioLoop, "emergency-io", 4096, NULL, EMERGENCY_IO_TASK_PRIORITY, &ioTask, 0);
+    xTaskCreatePinnedToCore(laneLoop, "emergency", 4096, NULL, EMERGENCY_TASK_PRIORITY, &laneTask, 0);
+}
+
+// Copies the event and wakes the task; the loop never waits on a sink
+void EmergencyLane::post(const EmergencyEvent& e) {
+    if (raise(e) && laneTask) xTaskNotifyGive(laneTask);
+}
+
+void EmergencyLane::wake() {
+    if (ioTask) xTaskNotifyGive(ioTask);
+}
+
+uint8_t EmergencyLane::getSubscriberCount() const {
+    return subscriberCount;
+}
+#endif
@@ -0,0 +1,175 @@
+#ifndef EMERGENCY_LANE_H
+#define EMERGENCY_LANE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "config.h"
+
+// tools/emergency_receiver/emergency_receiver.py stands in for a webhook
+// and listens for the UDP packet, acknowledging each one.
+
+// ================= Event =================
+
+#define EMERGENCY_FLAG_GPS_FIX 0x01
+
+typedef struct {
+    uint32_t id;                    // Same on every retry and every sink
+    uint32_t detectedUs;            // micros() of the sample that showed the fall
+    uint32_t uptimeMs;
+    int32_t latitudeE6;
+    int32_t longitudeE6;
+    uint16_t falls;
+    uint8_t flags;
+} EmergencyEvent;
+
+// UDP packet, 24 bytes, little endian, on the state broadcast port:
+//   0 magic "DE"  2 version  3 flags  4 event id  8 uptime ms
+//  12 latitude e6  16 longitude e6  20 falls u16  22 attempt  23 reserved
+#define EMERGENCY_PACKET_MAGIC 0x4544   // "DE"
+#define EMERGENCY_PACKET_VERSION 1
+#define EMERGENCY_PACKET_SIZE 24
+
+size_t encodeEmergencyPacket(const EmergencyEvent& e, uint8_t attempt, uint8_t* out);
+bool decodeEmergencyPacket(const uint8_t* data, size_t length, EmergencyEvent& out);
+
+// Acknowledgement, 8 bytes, sent back to the packet's source address and
+// port: 0 magic "DA"  2 version  3 attempt  4 event id
+#define EMERGENCY_ACK_MAGIC 0x4144      // "DA"
+#define EMERGENCY_ACK_SIZE 8
+
+size_t encodeEmergencyAck(uint32_t id, uint8_t attempt, uint8_t* out);
+bool decodeEmergencyAck(const uint8_t* data, size_t length, uint32_t& id, uint8_t& attempt);
+
+// JSON body shared by the SSE stream and the webhook
+size_t formatEmergencyJson(const EmergencyEvent& e, uint8_t attempt, char* out, size_t size);
+
+// HTTP POST with the event ID as Idempotency-Key, so a receiver can drop
+// retries it has already seen
+size_t formatWebhookRequest(const EmergencyEvent& e, uint8_t attempt, const char* host,
+                            const char* path, char* out, size_t size);
+
+// Status code of an HTTP status line, 0 if it is not one
+int parseHttpStatus(const char* line);
+
+// ================= Lane =================
+
+#define EMERGENCY_MAX_SINKS 4
+#define EMERGENCY_IDLE_US 0xFFFFFFFFUL  // Nothing to retry
+
+typedef enum {
+    EMERGENCY_SEND_FAILED,
+    EMERGENCY_SEND_DELIVERED,       // A subscriber or receiver has it
+    EMERGENCY_SEND_AWAITING         // Handed on; confirm() reports the outcome
+} EmergencySendResult;
+
+// attempt counts from 1
+typedef EmergencySendResult (*EmergencySendFn)(const EmergencyEvent& e, uint8_t attempt, void* context);
+
+typedef struct {
+    const char* name;
+    uint32_t delivered;
+    uint32_t retries;
+    uint32_t failed;                // Events given up after EMERGENCY_MAX_ATTEMPTS
+    uint32_t unconfirmed;           // Attempts awaiting confirmation that timed out
+    uint32_t late;                  // Delivered after EMERGENCY_DEADLINE_MS
+    uint32_t lastLatencyUs;         // Fall to delivery (or confirmation)
+    uint32_t maxLatencyUs;
+    uint32_t lastSendUs;            // Time spent in the sink
+} SinkStats;
+
+typedef struct {
+    uint32_t raised;
+    uint32_t duplicates;            // Raised again under an ID still in delivery
+    uint32_t evicted;               // Replaced before every sink had it
+    uint32_t lastLatencyUs;         // Fall to first delivery on any sink
+    uint32_t maxLatencyUs;
+} LaneStats;
+
+// Every sink gets every event straight away, in the order the sinks were
+// added; a sink that fails is tried again after EMERGENCY_RETRY_BASE_MS,
+// doubling up to EMERGENCY_RETRY_MAX_MS. A sink that cannot tell at once
+// (a broadcast, a request on another task) returns AWAITING; the attempt
+// counts as failed unless confirm() arrives within its confirmation time,
+// by default the same backoff. Events are keyed by ID: raising one that is
+// still in delivery does nothing, and receivers use the ID to drop
+// retries they already have.
+class EmergencyLane {
+private:
+    struct Sink {
+        EmergencySendFn send;
+        void* context;
+        uint32_t confirmMs;         // 0: the backoff
+    };
+
+    struct Delivery {
+        uint8_t attempts;
+        bool done;
+        bool awaiting;              // Until nextUs, for confirm()
+        uint32_t nextUs;            // Due time of the next attempt
+    };
+
+    struct Slot {
+        bool active;
+        EmergencyEvent event;
+        Delivery deliveries[EMERGENCY_MAX_SINKS];
+        bool notified;              // At least one sink has it
+    };
+
+    Sink sinks[EMERGENCY_MAX_SINKS];
+    SinkStats sinkStats[EMERGENCY_MAX_SINKS];
+    uint8_t sinkCount;
+    Slot slots[EMERGENCY_MAX_EVENTS];
+    uint32_t (*clock)();            // Microseconds
+    uint32_t idBase;
+    uint16_t idSequence;
+    EmergencyEvent latest;
+    bool hasLatest;
+    LaneStats stats;
+
+    void attempt(Slot& slot, uint8_t sink);
+    Slot* findSlot(uint32_t id);
+    void delivered(Slot* slot, uint8_t sink, uint32_t latencyUs);
+    void failed(Slot& slot, uint8_t sink, uint32_t nowUs);
+    void finish(Slot& slot);
+
+public:
+    EmergencyLane();
+
+    void setClock(uint32_t (*clockUs)()) { clock = clockUs; }
+    uint8_t addSink(const char* name, EmergencySendFn send, void* context, uint32_t confirmMs = 0);
+    void setIdBase(uint32_t base) { idBase = base; }
+    uint32_t nextId();              // Unique within a boot, random across boots
+
+    // False for an ID already in delivery
+    bool raise(const EmergencyEvent& e);
+
+    // Runs every due attempt; returns microseconds until the next retry,
+    // or EMERGENCY_IDLE_US
+    uint32_t service();
+
+    // Outcome of an AWAITING attempt, from any task. A failure only counts
+    // for the attempt in hand; a delivery counts whatever the attempt (0 if
+    // unknown), even while the sink waits to retry. False if the event is
+    // no longer in delivery to that sink.
+    bool confirm(uint8_t sink, uint32_t id, uint8_t attempt, bool ok);
+    bool isAwaiting(uint8_t sink) const;
+
+    bool isPending() const;
+    bool getLatest(EmergencyEvent& out) const;      // The last event raised
+    uint8_t getSinkCount() const { return sinkCount; }
+    const SinkStats& getSinkStats(uint8_t sink) const { return sinkStats[sink]; }
+    const LaneStats& getStats() const { return stats; }
+
+    static uint32_t backoffMs(uint8_t failures);
+
+#ifdef ARDUINO
+    void begin();
+    void post(const EmergencyEvent& e);     // From the loop: raise and wake the task
+    void wake();                    // A station joined: start taking subscribers
+    uint8_t getSubscriberCount() const;
+#endif
+};
+
+extern EmergencyLane emergencyLane;
+
+#endif // EMERGENCY_LANE_H
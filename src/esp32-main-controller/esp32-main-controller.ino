@@ -5,6 +5,22 @@
 #include <WiFi.h>
 #include <WebServer.h>
 #include <math.h>
+#include "config.h"
+#include "track_store.h"
+#include "power_manager.h"
+#include "stage_watchdog.h"
+#include "buzzer_control.h"
+#include "soft_timer.h"
+#include "route_table.h"
+#include "rate_limiter.h"
+#include "client_tracker.h"
+#include "json_stream.h"
+#include "response_cache.h"
+#include "field_versions.h"
+#include "ota_patch.h"
+#include "state_broadcast.h"
+#include "emergency_lane.h"
+#include "telemetry_export.h"
 
 // ================= MPU6050 =================
 MPU6050 mpu;
@@ -13,156 +29,1212 @@ MPU6050 mpu;
 TinyGPSPlus gps;
 HardwareSerial gpsSerial(2);   // UART2
 
-// ================= BUZZER ==================
-#define BUZZER_PIN 27   // SAFE ESP32 PIN
-
 // ================= WIFI ====================
-const char* ssid = "BlindStick_AP";
-const char* password = "12345678";
-WebServer server(80);
-
-// ================= FALL PARAMS =============
-const float FALL_LOW_G  = 0.3;
-const float FALL_HIGH_G = 2.8;
-const unsigned long WINDOW_MS   = 300;
-const unsigned long COOLDOWN_MS = 1000;
+WebServer server(WEB_SERVER_PORT);
 
-// ================= TIMERS ==================
-unsigned long lastLowTime = 0;
-unsigned long lastFallTime = 0;
-unsigned long lastMovementTime = 0;
-unsigned long lastBuzzToggle = 0;
+// ================= EVENTS ==================
+#define EVENT_IMU 0x01        // Full-rate sample due
+#define EVENT_WEB 0x02        // Poll the web server
+#define EVENT_GPS 0x04        // UART data arrived
+#define EVENT_CLIENTS 0x08    // AP station joined or left
 
 // ================= STATES ==================
 bool inLowWindow = false;
 bool fallDetected = false;
 bool inactivityTriggered = false;
+bool gpsFix = false;
+uint16_t fallCount = 0;
+uint8_t batteryPercent = 0;
+bool batteryLow = false;
+uint32_t lastStationMs = 0;     // A station last joined or left
+
+// ================= RUNTIME CONFIG ==========
+// Fall thresholds can be changed over POST /config
+struct FallConfig {
+  float lowG;
+  float highG;
+  uint16_t windowMs;
+};
+FallConfig fallConfig = { FALL_LOW_G, FALL_HIGH_G, FALL_WINDOW_MS };
+
+// ================= TIMERS ==================
+// Deadlines live in the timer service; the loop blocks until one is due
+void onFallWindow(void*) { inLowWindow = false; }
+void onInactivity(void*) { buzzer.emergencyAlert(); }
+void onStillTimeout(void*);
+void onBatteryCheck(void*);
+void onBroadcast(void*);
+void onBroadcastRepeat(void*);
+void onTelemetrySummary(void*);
+void onOtaConfirm(void*) { otaUpdater.confirm(); }
+void onOtaRestart(void*) { ESP.restart(); }
+
+SoftTimer imuTimer(EVENT_IMU);
+SoftTimer webTimer(EVENT_WEB);
+SoftTimer fallWindowTimer(onFallWindow);
+SoftTimer fallCooldownTimer((uint32_t)0);   // Only its expiry matters
+SoftTimer inactivityTimer(onInactivity);
+SoftTimer stillTimer(onStillTimeout);
+SoftTimer batteryTimer(onBatteryCheck);
+SoftTimer broadcastTimer(onBroadcast);
+SoftTimer broadcastRepeatTimer(onBroadcastRepeat);
+SoftTimer telemetrySummaryTimer(onTelemetrySummary);
+SoftTimer otaConfirmTimer(onOtaConfirm);
+SoftTimer otaRestartTimer(onOtaRestart);
 
-// ================= BUZZER FSM ==============
-bool buzzerActive = false;
-int buzzerSteps = 0;
-unsigned long buzzerTimer = 0;
+uint64_t loopBusyUs = 0;
+
+// ================= JSON RESPONSES ==========
+// Responses stream from JsonStream's fixed chunk buffer with chunked
+// transfer encoding; no document or String is built. The heap low-water
+// mark is sampled at every chunk so /metrics can report the peak.
+struct JsonResponse {
+  uint32_t startUs;
+  uint32_t socketUs;
+  uint32_t startFree;
+  uint32_t minFree;
+};
+
+struct JsonResponseStats {
+  uint32_t bytes;
+  uint16_t chunks;
+  uint32_t serializeUs;       // Excluding time spent in the socket
+  uint32_t peakHeapBytes;
+  uint32_t maxPeakHeapBytes;
+};
+JsonResponseStats jsonStats;
+
+void sendJsonChunk(const char* data, size_t length, void* context) {
+  JsonResponse& r = *static_cast<JsonResponse*>(context);
+  uint32_t start = micros();
+  server.sendContent(data, length);
+  r.socketUs += micros() - start;
+
+  uint32_t freeHeap = ESP.getFreeHeap();
+  if (freeHeap < r.minFree) r.minFree = freeHeap;
+}
+
+void beginJsonResponse(JsonResponse& r) {
+  r.startFree = ESP.getFreeHeap();
+  r.minFree = r.startFree;
+  r.socketUs = 0;
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, "application/json", "");
+  r.startUs = micros();
+}
+
+void endJsonResponse(JsonResponse& r, JsonStream& json) {
+  jsonStats.bytes = json.finish();
+  server.sendContent("");
+  jsonStats.chunks = json.getChunks();
+  jsonStats.serializeUs = micros() - r.startUs - r.socketUs;
+  jsonStats.peakHeapBytes = r.startFree > r.minFree ? r.startFree - r.minFree : 0;
+  if (jsonStats.peakHeapBytes > jsonStats.maxPeakHeapBytes) {
+    jsonStats.maxPeakHeapBytes = jsonStats.peakHeapBytes;
+  }
+}
 
 // ================= GPS DATA ================
-double currentLat = 12.8406;
-double currentLon = 80.1534;
-String lastFallTimeStr = "N/A";
+int32_t latitudeE6 = 12840600;     // Last fix, or the default position
+int32_t longitudeE6 = 80153400;
+char lastFallTime[16] = "N/A";
+uint32_t lastFallS = STATE_NO_FALL;
+
+// ================= DEVICE STATE ============
+// Everything the dashboard shows, copied in one read so a response never
+// mixes values from before and after a change
+struct DeviceState {
+  uint32_t version;
+  int32_t latitudeE6;
+  int32_t longitudeE6;
+  char fallTime[16];
+  uint16_t falls;
+  uint8_t batteryLevel;
+  uint8_t wifiClients;
+  const char* status;
+  const char* gps;
+  const char* fallDetection;
+  const char* motion;
+  const char* fallState;
+};
+
+void readDeviceState(DeviceState& s) {
+  s.version = fieldVersions.getVersion();
+  s.latitudeE6 = latitudeE6;
+  s.longitudeE6 = longitudeE6;
+  memcpy(s.fallTime, lastFallTime, sizeof(s.fallTime));
+  s.falls = fallCount;
+  s.batteryLevel = batteryPercent;
+  s.wifiClients = clientTracker.getClientCount();
+  s.status = inactivityTriggered ? "critical" : batteryLow ? "warning" : "operational";
+  s.gps = gpsFix ? "active" : "searching";
+  s.fallDetection = inactivityTriggered ? "alert" : "active";
+  s.motion = powerManager.isStill() ? "Inactive" : "Active";
+  s.fallState = inactivityTriggered ? "alert" : "monitoring";
+}
 
-// ================= BUZZER CONTROL ==========
-void startBuzzer(int beeps) {
-  buzzerActive = true;
-  buzzerSteps = beeps * 2;
-  buzzerTimer = millis();
-  digitalWrite(BUZZER_PIN, HIGH);
+// The same state in binary, for the UDP broadcast
+void readStateSnapshot(StateSnapshot& s) {
+  s.flags = (gpsFix ? STATE_FLAG_GPS_FIX : 0) |
+            (inactivityTriggered ? STATE_FLAG_ALERT : 0) |
+            (batteryLow ? STATE_FLAG_BATTERY_LOW : 0) |
+            (powerManager.isStill() ? STATE_FLAG_STILL : 0);
+  s.uptimeMs = millis();
+  s.latitudeE6 = latitudeE6;
+  s.longitudeE6 = longitudeE6;
+  s.lastFallS = lastFallS;
+  s.version = fieldVersions.getVersion();
+  s.falls = fallCount;
+  s.batteryLevel = batteryPercent;
+  s.wifiClients = clientTracker.getClientCount();
 }
 
-void handleBuzzer() {
-  if (!buzzerActive) return;
+// Coordinates stay strings for existing clients
+constexpr JsonField GPS_FIELDS[] = {
+  JSON_FIXED(DeviceState, latitudeE6, "latitude", 6, JSON_FLAG_QUOTED),
+  JSON_FIXED(DeviceState, longitudeE6, "longitude", 6, JSON_FLAG_QUOTED),
+  JSON_FIELD(DeviceState, fallTime, "fallTime"),
+};
 
-  if (millis() - buzzerTimer >= 300) {
-    buzzerTimer = millis();
-    digitalWrite(BUZZER_PIN, !digitalRead(BUZZER_PIN));
-    buzzerSteps--;
+constexpr JsonField STATUS_COUNT_FIELDS[] = {
+  JSON_FIELD(DeviceState, batteryLevel, "batteryLevel"),
+  JSON_FIELD(DeviceState, wifiClients, "wifiClients"),
+};
 
-    if (buzzerSteps <= 0) {
-      buzzerActive = false;
-      digitalWrite(BUZZER_PIN, LOW);
-    }
+constexpr JsonField SENSORS_FIELDS[] = {
+  JSON_FIELD(DeviceState, motion, "motion"),
+  JSON_FIELD(DeviceState, fallState, "fallState"),
+  JSON_FIELD(DeviceState, falls, "falls"),
+  JSON_FIELD(DeviceState, fallTime, "lastFallTime"),
+};
+
+// In FieldId order, for /delta
+constexpr JsonField DELTA_FIELDS[] = {
+  GPS_FIELDS[0],
+  GPS_FIELDS[1],
+  JSON_FIELD(DeviceState, fallTime, "fallTime"),
+  JSON_FIELD(DeviceState, falls, "falls"),
+  JSON_FIELD(DeviceState, status, "status"),
+  JSON_FIELD(DeviceState, gps, "gps"),
+  JSON_FIELD(DeviceState, fallDetection, "fallDetection"),
+  JSON_FIELD(DeviceState, batteryLevel, "batteryLevel"),
+  JSON_FIELD(DeviceState, wifiClients, "wifiClients"),
+  JSON_FIELD(DeviceState, motion, "motion"),
+  JSON_FIELD(DeviceState, fallState, "fallState"),
+};
+static_assert(JSON_SCHEMA_SIZE(DELTA_FIELDS) == FIELD_COUNT, "DELTA_FIELDS must follow FieldId");
+
+// The bodies of /gps, /status and /sensors; key is NULL at the top level
+void writeGpsObject(JsonStream& json, const DeviceState& s, const char* key) {
+  json.beginObject(key);
+  json.fields(GPS_FIELDS, JSON_SCHEMA_SIZE(GPS_FIELDS), &s);
+  json.end();
+}
+
+void writeStatusObject(JsonStream& json, const DeviceState& s, const char* key) {
+  json.beginObject(key);
+  json.stringField("status", s.status);
+  json.beginObject("sensors");
+  json.stringField("mpu6050", "active");
+  json.stringField("gps", s.gps);
+  json.stringField("wifi", "active");
+  json.stringField("fallDetection", s.fallDetection);
+  json.end();
+  json.fields(STATUS_COUNT_FIELDS, JSON_SCHEMA_SIZE(STATUS_COUNT_FIELDS), &s);
+  json.end();
+}
+
+void writeSensorsObject(JsonStream& json, const DeviceState& s, const char* key) {
+  json.beginObject(key);
+  json.fields(SENSORS_FIELDS, JSON_SCHEMA_SIZE(SENSORS_FIELDS), &s);
+  json.end();
+}
+
+void handleGPS() {
+  DeviceState state;
+  readDeviceState(state);
+
+  JsonResponse response;
+  beginJsonResponse(response);
+  JsonStream json(sendJsonChunk, &response);
+  writeGpsObject(json, state, NULL);
+  endJsonResponse(response, json);
+}
+
+// ================= TRACK STREAMING =========
+constexpr JsonField TRACK_STATS_FIELDS[] = {
+  JSON_FIELD(TrackStats, fixesAppended, "fixes"),
+  JSON_FIELD(TrackStats, pointsStored, "stored"),
+  JSON_FIELD(TrackStats, bytesUsed, "bytes"),
+};
+
+// Each point is [t, lat, lon]
+void writeTrackPoint(const TrackPoint& p, void* context) {
+  JsonStream& json = *static_cast<JsonStream*>(context);
+  json.beginArray();
+  json.unsignedValue(p.timestamp);
+  json.scaledValue(p.latitudeE6, 6);
+  json.scaledValue(p.longitudeE6, 6);
+  json.end();
+}
+
+// A whole number up to limit, or fallback when the argument is absent;
+// false for anything else (a sign, a fraction, too many digits)
+bool unsignedArg(const char* name, uint32_t fallback, uint32_t limit, uint32_t& out) {
+  if (!server.hasArg(name)) {
+    out = fallback;
+    return true;
+  }
+  String text = server.arg(name);
+  if (text.length() == 0 || text.length() > 10) return false;
+  for (size_t i = 0; i < text.length(); i++) {
+    if (text[i] < '0' || text[i] > '9') return false;
+  }
+  unsigned long long value = strtoull(text.c_str(), NULL, 10);
+  if (value > limit) return false;
+  out = (uint32_t)value;
+  return true;
+}
+
+void handleTrack() {
+  uint32_t from, to, maxPoints;
+  if (!unsignedArg("from", 0, UINT32_MAX, from) || !unsignedArg("to", UINT32_MAX, UINT32_MAX, to) ||
+      !unsignedArg("max", TRACK_DEFAULT_MAX_POINTS, UINT16_MAX, maxPoints) || from > to) {
+    server.send(400, "text/plain", "Out of range");
+    return;
+  }
+
+  JsonResponse response;
+  beginJsonResponse(response);
+  JsonStream json(sendJsonChunk, &response);
+  json.beginObject();
+  json.beginArray("points");
+  uint32_t sent = trackStore.query(from, to, (uint16_t)maxPoints, writeTrackPoint, &json);
+  json.end();
+
+  TrackStats stats = trackStore.getStats();
+  json.unsignedField("count", sent);
+  json.beginObject("stats");
+  json.fields(TRACK_STATS_FIELDS, JSON_SCHEMA_SIZE(TRACK_STATS_FIELDS), &stats);
+  json.fixedField("ratio", trackStore.getCompressionRatio(), 1);
+  json.fixedField("appendUsAvg", trackStore.getAverageAppendMicros(), 1);
+  json.unsignedField("appendUsMax", stats.maxAppendMicros);
+  json.end();
+  json.end();
+  endJsonResponse(response, json);
+}
+
+// ================= CACHED RESPONSES ========
+// Bodies that change far less often than they are polled. Each is kept
+// serialized and rebuilt only when a source it lists has changed.
+void writeStatus(JsonStream& json) {
+  DeviceState state;
+  readDeviceState(state);
+  writeStatusObject(json, state, NULL);
+}
+
+void writeSensors(JsonStream& json) {
+  DeviceState state;
+  readDeviceState(state);
+  writeSensorsObject(json, state, NULL);
+}
+
+constexpr JsonField FALL_CONFIG_FIELDS[] = {
+  JSON_FIXED(FallConfig, lowG, "lowThreshold", 2, 0),
+  JSON_FIXED(FallConfig, highG, "highThreshold", 2, 0),
+  JSON_FIELD(FallConfig, windowMs, "windowMs"),
+};
+
+void writeConfig(JsonStream& json) {
+  json.beginObject();
+  json.beginObject("fallDetection");
+  json.fields(FALL_CONFIG_FIELDS, JSON_SCHEMA_SIZE(FALL_CONFIG_FIELDS), &fallConfig);
+  json.end();
+  json.beginObject("inactivity");
+  json.unsignedField("timeoutMs", INACTIVITY_TIMEOUT_MS);
+  json.unsignedField("alertIntervalMs", INACTIVITY_ALERT_INTERVAL_MS);
+  json.end();
+  json.beginObject("wifi");
+  json.stringField("ssid", WIFI_AP_SSID);
+  json.unsignedField("channel", WIFI_CHANNEL);
+  json.unsignedField("maxClients", WIFI_MAX_CLIENTS);
+  json.end();
+  json.beginObject("emergency");
+  json.unsignedField("eventsPort", EMERGENCY_EVENTS_PORT);
+  json.end();
+  json.end();
+}
+
+// Same order as cachedResponses
+enum { CACHE_STATUS, CACHE_SENSORS, CACHE_CONFIG };
+
+constexpr CacheDef cachedResponses[] = {
+  { "/status", writeStatus, DATA_BIT(DATA_GPS) | DATA_BIT(DATA_BATTERY) | DATA_BIT(DATA_FALL) | DATA_BIT(DATA_CLIENTS) },
+  { "/sensors", writeSensors, DATA_BIT(DATA_FALL) | DATA_BIT(DATA_MOTION) },
+  { "/config", writeConfig, DATA_BIT(DATA_CONFIG) },
+};
+
+void sendCached(uint8_t id) {
+  uint16_t length;
+  const char* body = responseCache.acquire(id, &length);
+  if (!body) {
+    // Too large to cache: written straight to the socket instead
+    JsonResponse response;
+    beginJsonResponse(response);
+    JsonStream json(sendJsonChunk, &response);
+    cachedResponses[id].writer(json);
+    endJsonResponse(response, json);
+    return;
+  }
+  server.setContentLength(length);
+  server.send(200, "application/json", "");
+  server.sendContent(body, length);
+  responseCache.release(id);
+}
+
+void handleStatus() { sendCached(CACHE_STATUS); }
+void handleSensors() { sendCached(CACHE_SENSORS); }
+void handleConfig() { sendCached(CACHE_CONFIG); }
+
+// Form or query parameters; all are checked before any is applied
+void handleConfigUpdate() {
+  FallConfig updated = fallConfig;
+  if (server.hasArg("lowThreshold")) updated.lowG = server.arg("lowThreshold").toFloat();
+  if (server.hasArg("highThreshold")) updated.highG = server.arg("highThreshold").toFloat();
+  if (server.hasArg("windowMs")) updated.windowMs = server.arg("windowMs").toInt();
+
+  if (updated.lowG < 0.1f || updated.lowG > 0.5f ||
+      updated.highG < 2.0f || updated.highG > 4.0f ||
+      updated.windowMs < 100 || updated.windowMs > 500) {
+    server.send(400, "text/plain", "Out of range");
+    return;
+  }
+
+  fallConfig = updated;
+  dataVersions.bump(DATA_CONFIG);
+  sendCached(CACHE_CONFIG);
+}
+
+// ================= DELTA ===================
+// Dashboard fields with per-field versions: a poll carries the version it
+// last saw and gets back only what changed since. Values are formatted as
+// in /gps, /status and /sensors.
+void writeField(JsonStream& json, uint8_t field, const void* state) {
+  json.fields(&DELTA_FIELDS[field], 1, state);
+}
+
+void handleDelta() {
+  uint32_t since = server.hasArg("since") ? strtoul(server.arg("since").c_str(), NULL, 10) : 0;
+  DeviceState state;
+  readDeviceState(state);
+
+  JsonResponse response;
+  beginJsonResponse(response);
+  JsonStream json(sendJsonChunk, &response);
+  fieldVersions.writeDelta(json, since, writeField, &state);
+  endJsonResponse(response, json);
+  fieldVersions.noteBytes(jsonStats.bytes);
+}
+
+// ================= DASHBOARD ===============
+// One consistent snapshot of everything the dashboard shows, with the
+// version to continue from on /delta
+void handleDashboard() {
+  DeviceState state;
+  readDeviceState(state);
+
+  JsonResponse response;
+  beginJsonResponse(response);
+  JsonStream json(sendJsonChunk, &response);
+  json.beginObject();
+  json.unsignedField("v", state.version);
+  writeGpsObject(json, state, "gps");
+  writeStatusObject(json, state, "status");
+  writeSensorsObject(json, state, "sensors");
+  json.end();
+  endJsonResponse(response, json);
+}
+
+// ================= METRICS =================
+// Field lists for the stats structs, declared once
+constexpr JsonField POWER_FIELDS[] = {
+  JSON_FIELD(PowerStats, activeMs, "activeMs"),
+  JSON_FIELD(PowerStats, stillMs, "stillMs"),
+  JSON_FIELD(PowerStats, lightSleepMs, "lightSleepMs"),
+  JSON_FIELD(PowerStats, stillEntries, "stillEntries"),
+  JSON_FIELD(PowerStats, motionWakes, "motionWakes"),
+  JSON_FIELD(PowerStats, lastWakeLatencyUs, "wakeLatencyUs"),
+  JSON_FIELD(PowerStats, maxWakeLatencyUs, "wakeLatencyMaxUs"),
+};
+
+constexpr JsonField CLOCK_FIELDS[] = {
+  JSON_FIELD(ClockStats, pmSupported, "pmSupported"),
+  JSON_FIELD(ClockStats, lowClockMs, "lowClockMs"),
+  JSON_FIELD(ClockStats, highClockMs, "highClockMs"),
+};
+
+constexpr JsonField FALL_PATH_FIELDS[] = {
+  JSON_FIELD(ClockStats, lastFallPathUs, "fallPathUs"),
+  JSON_FIELD(ClockStats, maxFallPathUs, "fallPathMaxUs"),
+  JSON_FIELD(ClockStats, fallPathOverruns, "fallPathOverruns"),
+};
+
+constexpr JsonField STAGE_FIELDS[] = {
+  JSON_FIELD(StageStats, deadlineUs, "deadlineUs"),
+  JSON_FIELD(StageStats, stallMs, "stallMs"),
+  JSON_FIELD(StageStats, lastUs, "lastUs"),
+  JSON_FIELD(StageStats, maxUs, "maxUs"),
+  JSON_FIELD(StageStats, runs, "runs"),
+  JSON_FIELD(StageStats, overruns, "overruns"),
+};
+
+constexpr JsonField ALERT_FIELDS[] = {
+  JSON_FIELD(AlertStats, posted, "alertsPosted"),
+  JSON_FIELD(AlertStats, dropped, "alertsDropped"),
+  JSON_FIELD(AlertStats, preempted, "alertsPreempted"),
+  JSON_FIELD(AlertStats, resumed, "alertsResumed"),
+  JSON_FIELD(AlertStats, lastLatencyUs, "alertLatencyUs"),
+  JSON_FIELD(AlertStats, maxLatencyUs, "alertLatencyMaxUs"),
+};
+
+constexpr JsonField TIMER_FIELDS[] = {
+  JSON_FIELD(TimerStats, active, "timersActive"),
+  JSON_FIELD(TimerStats, fired, "timersFired"),
+  JSON_FIELD(TimerStats, lastLateMs, "timerLateMs"),
+  JSON_FIELD(TimerStats, maxLateMs, "timerLateMaxMs"),
+};
+
+constexpr JsonField ROUTE_FIELDS[] = {
+  JSON_FIELD(RouteStats, count, "count"),
+};
+
+constexpr JsonField RATE_LIMIT_FIELDS[] = {
+  JSON_FIELD(RateLimitStats, allowed, "allowed"),
+  JSON_FIELD(RateLimitStats, throttled, "throttled"),
+  JSON_FIELD(RateLimitStats, evictions, "evictions"),
+};
+
+constexpr JsonField CLIENT_FIELDS[] = {
+  JSON_FIELD(ClientStats, joins, "joins"),
+  JSON_FIELD(ClientStats, leaves, "leaves"),
+  JSON_FIELD(ClientStats, dropped, "dropped"),
+};
+
+constexpr JsonField STATION_FIELDS[] = {
+  JSON_FIELD(WiFiClientRecord, rssi, "rssi"),
+};
+
+constexpr JsonField CACHE_FIELDS[] = {
+  JSON_FIELD(CacheStats, hits, "hits"),
+  JSON_FIELD(CacheStats, coalesced, "coalesced"),
+  JSON_FIELD(CacheStats, builds, "builds"),
+  JSON_FIELD(CacheStats, overflows, "overflows"),
+  JSON_FIELD(CacheStats, lastBuildUs, "buildUs"),
+  JSON_FIELD(CacheStats, maxBuildUs, "buildMaxUs"),
+  JSON_FIELD(CacheStats, savedUs, "savedUs"),
+};
+
+constexpr JsonField DELTA_STATS_FIELDS[] = {
+  JSON_FIELD(DeltaStats, requests, "requests"),
+  JSON_FIELD(DeltaStats, snapshots, "snapshots"),
+  JSON_FIELD(DeltaStats, fieldsSent, "fieldsSent"),
+  JSON_FIELD(DeltaStats, bytes, "bytes"),
+};
+
+constexpr JsonField OTA_FIELDS[] = {
+  JSON_FIELD(OtaStats, patch, "patch"),
+  JSON_FIELD(OtaStats, uploadBytes, "uploadBytes"),
+  JSON_FIELD(OtaStats, imageBytes, "imageBytes"),
+  JSON_FIELD(OtaStats, elapsedMs, "elapsedMs"),
+  JSON_FIELD(OtaStats, applyKBps, "applyKBps"),
+  JSON_FIELD(OtaStats, bootAttempts, "bootAttempts"),
+  JSON_FIELD(OtaStats, rollbacks, "rollbacks"),
+};
+
+constexpr JsonField BROADCAST_FIELDS[] = {
+  JSON_FIELD(BroadcastStats, sent, "sent"),
+  JSON_FIELD(BroadcastStats, urgent, "urgent"),
+  JSON_FIELD(BroadcastStats, repeats, "repeats"),
+  JSON_FIELD(BroadcastStats, deferred, "deferred"),
+  JSON_FIELD(BroadcastStats, failed, "failed"),
+  JSON_FIELD(BroadcastStats, bytes, "bytes"),
+  JSON_FIELD(BroadcastStats, lastSendUs, "sendUs"),
+  JSON_FIELD(BroadcastStats, maxSendUs, "sendMaxUs"),
+};
+
+constexpr JsonField LANE_FIELDS[] = {
+  JSON_FIELD(LaneStats, raised, "raised"),
+  JSON_FIELD(LaneStats, duplicates, "duplicates"),
+  JSON_FIELD(LaneStats, evicted, "evicted"),
+  JSON_FIELD(LaneStats, lastLatencyUs, "latencyUs"),
+  JSON_FIELD(LaneStats, maxLatencyUs, "latencyMaxUs"),
+};
+
+constexpr JsonField SINK_FIELDS[] = {
+  JSON_FIELD(SinkStats, name, "name"),
+  JSON_FIELD(SinkStats, delivered, "delivered"),
+  JSON_FIELD(SinkStats, retries, "retries"),
+  JSON_FIELD(SinkStats, failed, "failed"),
+  JSON_FIELD(SinkStats, unconfirmed, "unconfirmed"),
+  JSON_FIELD(SinkStats, late, "late"),
+  JSON_FIELD(SinkStats, lastLatencyUs, "latencyUs"),
+  JSON_FIELD(SinkStats, maxLatencyUs, "latencyMaxUs"),
+  JSON_FIELD(SinkStats, lastSendUs, "sendUs"),
+};
+
+constexpr JsonField EXPORT_FIELDS[] = {
+  JSON_FIELD(ExportStats, batches, "batches"),
+  JSON_FIELD(ExportStats, records, "records"),
+  JSON_FIELD(ExportStats, payloadBytes, "payloadBytes"),
+  JSON_FIELD(ExportStats, lastBatchRecords, "lastBatchRecords"),
+  JSON_FIELD(ExportStats, lastBatchBytes, "lastBatchBytes"),
+  JSON_FIELD(ExportStats, inboxDrops, "inboxDrops"),
+};
+
+constexpr JsonField QUEUE_FIELDS[] = {
+  JSON_FIELD(QueueStats, queued, "queued"),
+  JSON_FIELD(QueueStats, sent, "sent"),
+  JSON_FIELD(QueueStats, dropped, "dropped"),
+  JSON_FIELD(QueueStats, corrupt, "corrupt"),
+  JSON_FIELD(QueueStats, erases, "erases"),
+  JSON_FIELD(QueueStats, writeFailures, "writeFailures"),
+};
+
+constexpr JsonField MQTT_FIELDS[] = {
+  JSON_FIELD(MqttStats, connects, "connects"),
+  JSON_FIELD(MqttStats, refused, "refused"),
+  JSON_FIELD(MqttStats, timeouts, "timeouts"),
+  JSON_FIELD(MqttStats, publishes, "publishes"),
+  JSON_FIELD(MqttStats, acks, "acks"),
+  JSON_FIELD(MqttStats, pings, "pings"),
+  JSON_FIELD(MqttStats, bytesSent, "bytesSent"),
+  JSON_FIELD(MqttStats, bytesReceived, "bytesReceived"),
+  JSON_FIELD(MqttStats, lastAckMs, "ackMs"),
+  JSON_FIELD(MqttStats, maxAckMs, "ackMaxMs"),
+};
+
+constexpr JsonField JSON_STATS_FIELDS[] = {
+  JSON_FIELD(JsonResponseStats, bytes, "lastBytes"),
+  JSON_FIELD(JsonResponseStats, chunks, "lastChunks"),
+  JSON_FIELD(JsonResponseStats, serializeUs, "lastSerializeUs"),
+  JSON_FIELD(JsonResponseStats, peakHeapBytes, "lastPeakHeapBytes"),
+  JSON_FIELD(JsonResponseStats, maxPeakHeapBytes, "maxPeakHeapBytes"),
+};
+
+void handleMetrics() {
+  // Stats of the previous response; this one is still being written
+  JsonResponseStats lastJson = jsonStats;
+
+  JsonResponse response;
+  beginJsonResponse(response);
+  JsonStream json(sendJsonChunk, &response);
+  json.beginObject();
+  json.unsignedField("uptimeMs", millis());
+
+  PowerStats power = powerManager.getStats();
+  json.beginObject("power");
+  json.stringField("state", powerManager.isStill() ? "still" : "active");
+  json.fields(POWER_FIELDS, JSON_SCHEMA_SIZE(POWER_FIELDS), &power);
+  json.end();
+
+  ClockStats clock = powerManager.getClockStats();
+  json.beginObject("clock");
+  json.unsignedField("mhz", getCpuFrequencyMhz());
+  json.fields(CLOCK_FIELDS, JSON_SCHEMA_SIZE(CLOCK_FIELDS), &clock);
+  for (uint8_t i = 0; i < BOOST_REASON_COUNT; i++) {
+    char key[32];
+    const char* name = PowerManager::getBoostName((BoostReason)i);
+    snprintf(key, sizeof(key), "%sBoosts", name);
+    json.unsignedField(key, clock.boosts[i]);
+    snprintf(key, sizeof(key), "%sBoostMs", name);
+    json.unsignedField(key, clock.boostMs[i]);
+  }
+  json.fields(FALL_PATH_FIELDS, JSON_SCHEMA_SIZE(FALL_PATH_FIELDS), &clock);
+  json.fixedField("batteryHoursFixedClock", powerManager.estimateBatteryHours(false), 1);
+  json.fixedField("batteryHoursDfs", powerManager.estimateBatteryHours(true), 1);
+  json.end();
+
+  WatchdogRecord record = stageWatchdog.getRecord();
+  json.beginObject("watchdog");
+  json.unsignedField("resetReason", stageWatchdog.getResetReason());
+  json.unsignedField("restarts", record.totalRestarts);
+  json.unsignedField("consecutiveRestarts", record.consecutiveRestarts);
+  json.boolField("restartsSuppressed", stageWatchdog.areRestartsSuppressed());
+  json.stringField("lastStallStage", StageWatchdog::getStageName(record.lastStallStage));
+  json.stringField("lastOverrunStage", StageWatchdog::getStageName(stageWatchdog.getLastOverrunStage()));
+  json.beginObject("stages");
+  for (uint8_t i = 0; i < STAGE_COUNT; i++) {
+    const StageStats& stage = stageWatchdog.getStageStats((LoopStage)i);
+    json.beginObject(stage.name);
+    json.fields(STAGE_FIELDS, JSON_SCHEMA_SIZE(STAGE_FIELDS), &stage);
+    json.end();
+  }
+  json.end();
+  json.end();
+
+  BuzzerTimingStats tones = buzzer.getTimingStats();
+  AlertStats alerts = buzzer.getAlertStats();
+  json.beginObject("buzzer");
+  json.boolField("playing", buzzer.isPlaying());
+  json.unsignedField("steps", tones.steps);
+  json.unsignedField("lateAvgUs", tones.steps ? tones.totalLateUs / tones.steps : 0);
+  json.unsignedField("lateMaxUs", tones.maxLateUs);
+  json.fields(ALERT_FIELDS, JSON_SCHEMA_SIZE(ALERT_FIELDS), &alerts);
+  json.end();
+
+  TimerStats timers = timerService.getStats();
+  json.beginObject("loop");
+  json.fixedField("busyPct", 100.0f * loopBusyUs / ((uint64_t)millis() * 1000 + 1), 2);
+  json.unsignedField("wakes", timers.wakes);
+  json.unsignedField("blockedMs", (uint32_t)(timers.blockedUs / 1000));
+  json.fields(TIMER_FIELDS, JSON_SCHEMA_SIZE(TIMER_FIELDS), &timers);
+  json.end();
+
+  json.beginObject("routes");
+  json.unsignedField("misses", apiRouter.getMisses());
+  json.beginArray("endpoints");
+  for (uint8_t i = 0; i < apiRouter.getRouteCount(); i++) {
+    const RouteDef& route = apiRouter.getRoute(i);
+    const RouteStats& stats = apiRouter.getStats(i);
+    json.beginObject();
+    json.stringField("method", Router::getMethodName(route.method));
+    json.stringField("path", route.path);
+    json.fields(ROUTE_FIELDS, JSON_SCHEMA_SIZE(ROUTE_FIELDS), &stats);
+    json.unsignedField("avgUs", stats.count ? stats.totalUs / stats.count : 0);
+    json.unsignedField("maxUs", stats.maxUs);
+    json.beginArray("histogram");
+    for (uint8_t b = 0; b < ROUTE_LATENCY_BUCKETS; b++) json.unsignedValue(stats.histogram[b]);
+    json.end();
+    json.end();
+  }
+  json.end();
+  json.end();
+
+  RateLimitStats limits = rateLimiter.getStats();
+  json.beginObject("rateLimit");
+  json.unsignedField("clients", rateLimiter.getActiveClients(millis()));
+  json.fields(RATE_LIMIT_FIELDS, JSON_SCHEMA_SIZE(RATE_LIMIT_FIELDS), &limits);
+  json.unsignedField("tableBytes", RateLimiter::getTableBytes());
+  json.end();
+
+  WiFiClientRecord stations[WIFI_MAX_CLIENTS];
+  clientTracker.refreshRssi();
+  uint8_t stationCount = clientTracker.snapshot(stations, WIFI_MAX_CLIENTS);
+  ClientStats clientStats = clientTracker.getStats();
+  json.beginObject("clients");
+  json.unsignedField("count", stationCount);
+  json.fields(CLIENT_FIELDS, JSON_SCHEMA_SIZE(CLIENT_FIELDS), &clientStats);
+  json.beginArray("stations");
+  for (uint8_t i = 0; i < stationCount; i++) {
+    char text[18];
+    const uint8_t* ip = (const uint8_t*)&stations[i].ip;
+    json.beginObject();
+    ClientTracker::formatMac(stations[i].mac, text);
+    json.stringField("mac", text);
+    snprintf(text, sizeof(text), "%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+    json.stringField("ip", text);
+    json.fields(STATION_FIELDS, JSON_SCHEMA_SIZE(STATION_FIELDS), &stations[i]);
+    json.unsignedField("connectedS", (millis() - stations[i].connectTimeMs) / 1000);
+    json.end();
+  }
+  json.end();
+  json.end();
+
+  json.beginArray("cache");
+  for (uint8_t i = 0; i < responseCache.getCount(); i++) {
+    const CacheStats& stats = responseCache.getStats(i);
+    uint32_t requests = stats.hits + stats.coalesced + stats.builds;
+    json.beginObject();
+    json.stringField("path", cachedResponses[i].path);
+    json.fields(CACHE_FIELDS, JSON_SCHEMA_SIZE(CACHE_FIELDS), &stats);
+    json.fixedField("hitPct", requests ? 100.0f * (stats.hits + stats.coalesced) / requests : 0, 1);
+    json.end();
+  }
+  json.end();
+
+  json.beginObject("delta");
+  json.unsignedField("version", fieldVersions.getVersion());
+  json.fields(DELTA_STATS_FIELDS, JSON_SCHEMA_SIZE(DELTA_STATS_FIELDS), &fieldVersions.getStats());
+  json.end();
+
+  json.beginObject("broadcast");
+  json.unsignedField("sequence", stateBroadcaster.getSequence());
+  json.fields(BROADCAST_FIELDS, JSON_SCHEMA_SIZE(BROADCAST_FIELDS), &stateBroadcaster.getStats());
+  json.end();
+
+  json.beginObject("emergency");
+  json.fields(LANE_FIELDS, JSON_SCHEMA_SIZE(LANE_FIELDS), &emergencyLane.getStats());
+  json.boolField("pending", emergencyLane.isPending());
+  json.unsignedField("subscribers", emergencyLane.getSubscriberCount());
+  json.beginArray("sinks");
+  for (uint8_t i = 0; i < emergencyLane.getSinkCount(); i++) {
+    json.beginObject();
+    json.fields(SINK_FIELDS, JSON_SCHEMA_SIZE(SINK_FIELDS), &emergencyLane.getSinkStats(i));
+    json.end();
+  }
+  json.end();
+  json.end();
+
+  const OtaStats& ota = otaUpdater.getStats();
+  json.beginObject("ota");
+  json.stringField("state", OtaUpdater::getStateName(ota.state));
+  json.stringField("error", otaUpdater.getError());
+  json.boolField("pendingConfirm", otaUpdater.isPendingConfirm());
+  json.fields(OTA_FIELDS, JSON_SCHEMA_SIZE(OTA_FIELDS), &ota);
+  json.end();
+
+  const TelemetryQueue& queue = telemetryExporter.getQueue();
+  json.beginObject("telemetry");
+  json.boolField("enabled", TELEMETRY_ENABLED && queue.isMounted());
+  json.boolField("connected", telemetryExporter.isConnected());
+  json.unsignedField("pending", queue.getPending());
+  json.unsignedField("capacityBytes", queue.getCapacityBytes());
+  json.fields(EXPORT_FIELDS, JSON_SCHEMA_SIZE(EXPORT_FIELDS), &telemetryExporter.getStats());
+  json.beginObject("queue");
+  json.fields(QUEUE_FIELDS, JSON_SCHEMA_SIZE(QUEUE_FIELDS), &queue.getStats());
+  json.end();
+  json.beginObject("mqtt");
+  json.fields(MQTT_FIELDS, JSON_SCHEMA_SIZE(MQTT_FIELDS), &telemetryExporter.getMqttStats());
+  json.end();
+  json.end();
+
+  json.beginObject("json");
+  json.fields(JSON_STATS_FIELDS, JSON_SCHEMA_SIZE(JSON_STATS_FIELDS), &lastJson);
+  json.end();
+
+  json.end();
+  endJsonResponse(response, json);
+}
+
+// ================= ROUTES ==================
+// The perfect hash over method and path is generated at compile time;
+// a duplicate route fails the build. The location is what a rescuer
+// needs, so it is never throttled.
+constexpr RouteDef apiRoutes[] = {
+  { ROUTE_GET, "/gps", handleGPS, ROUTE_FLAG_NO_RATE_LIMIT },
+  { ROUTE_GET, "/track", handleTrack, 0 },
+  { ROUTE_GET, "/metrics", handleMetrics, 0 },
+  { ROUTE_GET, "/status", handleStatus, 0 },
+  { ROUTE_GET, "/sensors", handleSensors, 0 },
+  { ROUTE_GET, "/config", handleConfig, 0 },
+  { ROUTE_POST, "/config", handleConfigUpdate, 0 },
+  { ROUTE_GET, "/delta", handleDelta, 0 },
+  { ROUTE_GET, "/dashboard", handleDashboard, 0 },
+};
+constexpr RouteIndex apiRouteIndex = buildRouteIndex(apiRoutes);
+static_assert(apiRouteIndex.seed != ROUTE_NO_SEED, "No perfect hash for apiRoutes (duplicate route?)");
+
+bool toRouteMethod(HTTPMethod method, RouteMethod& out) {
+  switch (method) {
+    case HTTP_GET: out = ROUTE_GET; return true;
+    case HTTP_POST: out = ROUTE_POST; return true;
+    case HTTP_PUT: out = ROUTE_PUT; return true;
+    case HTTP_DELETE: out = ROUTE_DELETE; return true;
+    case HTTP_OPTIONS: out = ROUTE_OPTIONS; return true;
+    default: return false;
+  }
+}
+
+// Every request holds the full clock for DFS_HTTP_HOLD_MS so a burst of
+// dashboard requests is served at full speed
+void handleRequest() {
+  powerManager.boost(BOOST_HTTP);
+
+  RouteMethod method;
+  int route = -1;
+  if (toRouteMethod(server.method(), method)) route = apiRouter.find(method, server.uri().c_str());
+  if (route < 0) {
+    apiRouter.noteMiss();
+    server.send(404, "text/plain", "Not found");
+    return;
+  }
+
+  uint32_t retryAfterMs;
+  if (!(apiRouter.getRoute(route).flags & ROUTE_FLAG_NO_RATE_LIMIT) &&
+      !rateLimiter.allow(server.client().remoteIP(), millis(), &retryAfterMs)) {
+    server.sendHeader("Retry-After", String((retryAfterMs + 999) / 1000));
+    server.send(429, "text/plain", "Too many requests");
+    return;
+  }
+
+  apiRouter.run(route);
+}
+
+// ================= OTA =====================
+// Multipart upload of a full image or a patch against the running one.
+// Registered with the web server directly rather than in apiRoutes: the
+// body arrives through the upload callback, which the router does not
+// dispatch, so it takes its rate limit here. Each chunk is flashed as it
+// arrives, so the web stage keeps the watchdog informed. The upload must
+// carry its HMAC in X-OTA-Signature (ota_patch.h).
+bool updateLimited = false;
+uint32_t updateRetryMs = 0;
+
+void handleUpdateUpload() {
+  HTTPUpload& upload = server.upload();
+  stageWatchdog.keepAlive();
+  powerManager.boost(BOOST_HTTP);
+
+  if (upload.status == UPLOAD_FILE_START) {
+    updateLimited = !rateLimiter.allow(server.client().remoteIP(), millis(), &updateRetryMs);
+    if (!updateLimited) otaUpdater.start(server.header(OTA_SIGNATURE_HEADER).c_str());
+    return;
+  }
+  if (updateLimited) return;
+
+  switch (upload.status) {
+    case UPLOAD_FILE_WRITE: otaUpdater.write(upload.buf, upload.currentSize); break;
+    case UPLOAD_FILE_END: otaUpdater.end(); break;
+    case UPLOAD_FILE_ABORTED: otaUpdater.abort(); break;
+    default: break;
+  }
+}
+
+void handleUpdateDone() {
+  if (updateLimited) {
+    server.sendHeader("Retry-After", String((updateRetryMs + 999) / 1000));
+    server.send(429, "text/plain", "Too many requests");
+    return;
+  }
+  if (otaUpdater.getStats().state != OTA_READY) {
+    server.send(400, "text/plain", otaUpdater.getError());
+    return;
+  }
+  server.send(200, "text/plain", "Update written, restarting");
+  timerService.start(otaRestartTimer, OTA_RESTART_DELAY_MS);
+}
+
+uint32_t clockMs() { return millis(); }
+uint32_t clockUs() { return micros(); }
+
+// ================= PUBLISHING ==============
+// Every change to a reported value bumps its cache source and stamps the
+// fields it shows up in
+void setInactivityAlert(bool active) {
+  if (active == inactivityTriggered) return;
+  inactivityTriggered = active;
+  dataVersions.bump(DATA_FALL);
+  fieldVersions.touch(FIELD_STATUS);
+  fieldVersions.touch(FIELD_FALL_DETECTION);
+  fieldVersions.touch(FIELD_FALL_STATE);
+}
+
+void publishMotion() {
+  dataVersions.bump(DATA_MOTION);
+  fieldVersions.touch(FIELD_MOTION);
+}
+
+void publishPosition(double lat, double lon) {
+  int32_t lat6 = (int32_t)lround(lat * 1e6);
+  int32_t lon6 = (int32_t)lround(lon * 1e6);
+  if (lat6 != latitudeE6) fieldVersions.touch(FIELD_LATITUDE);
+  if (lon6 != longitudeE6) fieldVersions.touch(FIELD_LONGITUDE);
+  latitudeE6 = lat6;
+  longitudeE6 = lon6;
+}
+
+// ================= BROADCAST ===============
+// One UDP packet per interval for all caregivers on the AP, and one at
+// once (with repeats) for a fall
+void broadcastState(bool urgent) {
+  if (!STATE_BROADCAST_ENABLED || clientTracker.getClientCount() == 0) return;
+  StateSnapshot snapshot;
+  readStateSnapshot(snapshot);
+  stateBroadcaster.send(snapshot, urgent);
+  if (urgent) timerService.start(broadcastRepeatTimer, STATE_URGENT_REPEAT_MS, STATE_URGENT_REPEAT_MS);
+}
+
+void onBroadcast(void*) { broadcastState(false); }
+
+void onBroadcastRepeat(void*) {
+  if (!stateBroadcaster.repeat()) timerService.stop(broadcastRepeatTimer);
+}
+
+// ================= EMERGENCY ===============
+// A fall goes straight to the emergency lane task, which sends it to
+// every sink at once; no batch, queue or poll sits in between
+void raiseFallEmergency(uint32_t detectedUs) {
+  EmergencyEvent e;
+  e.id = emergencyLane.nextId();
+  e.detectedUs = detectedUs;
+  e.uptimeMs = millis();
+  e.latitudeE6 = latitudeE6;
+  e.longitudeE6 = longitudeE6;
+  e.falls = fallCount;
+  e.flags = gpsFix ? EMERGENCY_FLAG_GPS_FIX : 0;
+  emergencyLane.post(e);
+}
+
+// ================= TELEMETRY ===============
+// Records for the broker go to the exporter task, which batches them and
+// keeps them in flash until the broker has them
+void postTelemetryPoint(uint8_t type) {
+  TelemetryPoint point;
+  point.boot = telemetryExporter.getBoot();
+  point.uptimeS = millis() / 1000;
+  point.latitudeE6 = latitudeE6;
+  point.longitudeE6 = longitudeE6;
+  telemetryExporter.post(type, &point, sizeof(point));
+}
+
+// Activity since the last summary, from the power manager's accounting
+void onTelemetrySummary(void*) {
+  static uint32_t lastActiveMs = 0;
+  uint32_t activeMs = powerManager.getStats().activeMs;
+  TelemetrySummary summary;
+  summary.boot = telemetryExporter.getBoot();
+  summary.uptimeS = millis() / 1000;
+  summary.batteryLevel = batteryPercent;
+  summary.flags = (gpsFix ? TELEMETRY_FLAG_GPS_FIX : 0) |
+                  (batteryLow ? TELEMETRY_FLAG_BATTERY_LOW : 0) |
+                  (inactivityTriggered ? TELEMETRY_FLAG_ALERT : 0);
+  summary.activeS = (activeMs - lastActiveMs) / 1000;
+  summary.falls = fallCount;
+  lastActiveMs = activeMs;
+  telemetryExporter.post(TELEMETRY_SUMMARY, &summary, sizeof(summary));
+}
+
+// ================= MOVEMENT ================
+void noteMovement() {
+  setInactivityAlert(false);
+  timerService.stop(inactivityTimer);
+  timerService.start(stillTimer, IMU_STILL_TIMEOUT_MS);
+}
+
+// Never while a fall is being monitored for inactivity
+void onStillTimeout(void*) {
+  if (inactivityTriggered) return;
+  if (buzzer.isPlaying()) {
+    timerService.start(stillTimer, IMU_STILL_RETRY_MS);
+    return;
+  }
+  powerManager.enterStill();
+  publishMotion();
+  timerService.stop(imuTimer);
+}
+
+// ================= BATTERY =================
+// Linear between the cutoff and a full cell; only a change in whole
+// percent is published
+void onBatteryCheck(void*) {
+  float volts = analogReadMilliVolts(BATTERY_MONITOR_PIN) * BATTERY_DIVIDER_RATIO / 1000.0f;
+  float fraction = (volts - LOW_BATTERY_THRESHOLD) / (BATTERY_FULL_VOLTS - LOW_BATTERY_THRESHOLD);
+  uint8_t percent = fraction <= 0 ? 0 : fraction >= 1 ? 100 : (uint8_t)(fraction * 100 + 0.5f);
+  bool low = volts < LOW_BATTERY_THRESHOLD;
+  if (percent == batteryPercent && low == batteryLow) return;
+  if (percent != batteryPercent) fieldVersions.touch(FIELD_BATTERY);
+  if (low != batteryLow) fieldVersions.touch(FIELD_STATUS);
+  batteryPercent = percent;
+  batteryLow = low;
+  dataVersions.bump(DATA_BATTERY);
+}
+
+// Only poll the web server and broadcast while someone can reach them
+void updateWebPolling() {
+  if (clientTracker.getClientCount() > 0) {
+    if (!webTimer.isActive()) timerService.start(webTimer, 0, WEB_POLL_INTERVAL_MS);
+    if (!broadcastTimer.isActive()) timerService.start(broadcastTimer, 0, STATE_BROADCAST_INTERVAL_MS);
+  } else {
+    timerService.stop(webTimer);
+    timerService.stop(broadcastTimer);
   }
 }
 
 // ================= SETUP ===================
 void setup() {
-  Serial.begin(115200);
-
-  Wire.begin(21, 22);
-  mpu.initialize();
+  Serial.begin(SERIAL_BAUD_RATE);
+  timerService.begin(clockMs);
 
-  gpsSerial.begin(9600, SERIAL_8N1, 16, 17);
+  // First, so a new image that fails anywhere in setup still counts a boot
+  otaUpdater.begin();
 
-  pinMode(BUZZER_PIN, OUTPUT);
-  digitalWrite(BUZZER_PIN, LOW);
+  Wire.begin(MPU_SDA_PIN, MPU_SCL_PIN);
+  mpu.initialize();
+  powerManager.begin(mpu);
 
-  WiFi.softAP(ssid, password);
+  gpsSerial.begin(GPS_BAUD_RATE, SERIAL_8N1, GPS_RX_PIN, GPS_TX_PIN);
+  gpsSerial.onReceive([]() { timerService.postEvent(EVENT_GPS); });
 
-  server.on("/gps", []() {
-    if (gps.location.isValid()) {
-      currentLat = gps.location.lat();
-      currentLon = gps.location.lng();
-    }
+  buzzer.begin();
 
-    String json = "{";
-    json += "\"latitude\":\"" + String(currentLat, 6) + "\",";
-    json += "\"longitude\":\"" + String(currentLon, 6) + "\",";
-    json += "\"fallTime\":\"" + lastFallTimeStr + "\"}";
-    server.send(200, "application/json", json);
+  clientTracker.setConnectCallback([](const WiFiClientRecord&) {
+    dataVersions.bump(DATA_CLIENTS);
+    timerService.postEvent(EVENT_CLIENTS);
+  });
+  clientTracker.setDisconnectCallback([](const WiFiClientRecord&) {
+    dataVersions.bump(DATA_CLIENTS);
+    timerService.postEvent(EVENT_CLIENTS);
   });
+  clientTracker.begin();
+  WiFi.softAP(WIFI_AP_SSID, WIFI_AP_PASSWORD, WIFI_CHANNEL, 0, WIFI_MAX_CLIENTS);
+  WiFi.setSleep(true);    // Modem sleep on the station link; the AP stays on
 
+  apiRouter.begin(apiRoutes, apiRouteIndex, clockUs);
+  responseCache.begin(cachedResponses, dataVersions, clockUs);
+  fieldVersions.begin(esp_random());
+  if (OTA_ENABLED) {
+    static const char* updateHeaders[] = { OTA_SIGNATURE_HEADER };
+    server.collectHeaders(updateHeaders, 1);
+    server.on("/update", HTTP_POST, handleUpdateDone, handleUpdateUpload);
+  }
+  server.onNotFound(handleRequest);
   server.begin();
+  if (STATE_BROADCAST_ENABLED) stateBroadcaster.begin();
+  emergencyLane.begin();
+  if (TELEMETRY_ENABLED) {
+    telemetryExporter.begin();
+    timerService.start(telemetrySummaryTimer, TELEMETRY_SUMMARY_MS, TELEMETRY_SUMMARY_MS);
+  }
+
+  timerService.start(imuTimer, 0, 1000 / IMU_FULL_RATE_HZ);
+  timerService.start(stillTimer, IMU_STILL_TIMEOUT_MS);
+  timerService.start(batteryTimer, 0, BATTERY_CHECK_INTERVAL_MS);
+  if (otaUpdater.isPendingConfirm()) timerService.start(otaConfirmTimer, OTA_CONFIRM_MS);
+
+  // Last, so setup time never counts as a stall
+  stageWatchdog.begin();
 }
 
-// ================= LOOP ====================
-void loop() {
-  server.handleClient();
-  handleBuzzer();
+// ================= SERVICE =================
+void serviceEvents(uint32_t events) {
+  if (events & EVENT_CLIENTS) {
+    lastStationMs = millis();
+    fieldVersions.touch(FIELD_WIFI_CLIENTS);
+    updateWebPolling();
+    emergencyLane.wake();
+  }
+
+  if (events & EVENT_WEB) {
+    stageWatchdog.enter(STAGE_WEB);
+    server.handleClient();
+    stageWatchdog.leave();
+  }
 
+  stageWatchdog.enter(STAGE_BUZZER);
+  buzzer.update();
+  stageWatchdog.leave();
+
+  stageWatchdog.enter(STAGE_GPS);
+  if (gpsSerial.available()) powerManager.boost(BOOST_GPS);
   while (gpsSerial.available()) gps.encode(gpsSerial.read());
 
+  // ===== GPS BREADCRUMBS =====
+  if (gps.location.isUpdated() && gps.location.isValid()) {
+    trackStore.append(millis() / 1000, gps.location.lat(), gps.location.lng());
+    publishPosition(gps.location.lat(), gps.location.lng());
+    static uint32_t lastTrackS = 0;
+    uint32_t nowS = millis() / 1000;
+    if (TELEMETRY_ENABLED && (lastTrackS == 0 || nowS - lastTrackS >= TELEMETRY_TRACK_INTERVAL_S)) {
+      postTelemetryPoint(TELEMETRY_TRACK);
+      lastTrackS = nowS;
+    }
+  }
+  bool fix = gps.location.isValid() && gps.location.age() < GPS_TIMEOUT_MS;
+  if (fix != gpsFix) {
+    gpsFix = fix;
+    dataVersions.bump(DATA_GPS);
+    fieldVersions.touch(FIELD_GPS_STATE);
+  }
+  stageWatchdog.leave();
+
+  // ===== LOW POWER =====
+  // While still, only the motion interrupt brings the IMU back to full rate
+  if (powerManager.isStill()) {
+    if (!powerManager.hasMotion()) return;
+    powerManager.exitStill();
+    publishMotion();
+    timerService.start(imuTimer, 1000 / IMU_FULL_RATE_HZ, 1000 / IMU_FULL_RATE_HZ);
+    noteMovement();
+    events |= EVENT_IMU;
+  }
+
+  if (!(events & EVENT_IMU)) return;
+
+  uint32_t fallPathStart = micros();
+  stageWatchdog.enter(STAGE_IMU);
   int16_t ax, ay, az, gx, gy, gz;
   mpu.getMotion6(&ax, &ay, &az, &gx, &gy, &gz);
+  stageWatchdog.leave();
+  powerManager.noteSample();
+
+  stageWatchdog.enter(STAGE_FALL);
 
-  float axg = ax / 16384.0;
-  float ayg = ay / 16384.0;
-  float azg = az / 16384.0;
+  float axg = ax / MPU_ACCEL_SCALE;
+  float ayg = ay / MPU_ACCEL_SCALE;
+  float azg = az / MPU_ACCEL_SCALE;
 
   float totalAcc = sqrt(axg*axg + ayg*ayg + azg*azg);
-  unsigned long now = millis();
 
   static float lastAcc = 1.0;
-  if (fabs(totalAcc - lastAcc) > 0.05) {
-    lastMovementTime = now;
-    inactivityTriggered = false;
-  }
+  if (fabs(totalAcc - lastAcc) > 0.05) noteMovement();
   lastAcc = totalAcc;
 
   // ===== FALL DETECTION =====
-  if (now - lastFallTime > COOLDOWN_MS) {
-    if (!inLowWindow && totalAcc < FALL_LOW_G) {
+  if (!fallCooldownTimer.isActive()) {
+    if (!inLowWindow && totalAcc < fallConfig.lowG) {
       inLowWindow = true;
-      lastLowTime = now;
+      timerService.start(fallWindowTimer, fallConfig.windowMs);
+      powerManager.boost(BOOST_FALL);
     } 
-    else if (inLowWindow) {
-      if (totalAcc > FALL_HIGH_G) {
-        fallDetected = true;
-        inLowWindow = false;
-      }
-      if (now - lastLowTime > WINDOW_MS) inLowWindow = false;
+    else if (inLowWindow && totalAcc > fallConfig.highG) {
+      fallDetected = true;
+      inLowWindow = false;
+      timerService.stop(fallWindowTimer);
     }
   }
 
   // ===== FALL EVENT =====
   if (fallDetected) {
-    lastFallTime = now;
-    lastMovementTime = now;
+    fallDetected = false;
+    fallCount++;
+    raiseFallEmergency(fallPathStart);
+    timerService.start(fallCooldownTimer, FALL_COOLDOWN_MS);
 
-    startBuzzer(2);
+    buzzer.alert(BUZZ_PATTERN_DOUBLE, ALERT_PRIORITY_WARNING);
 
     unsigned long t = millis() / 1000;
-    char buf[16];
-    sprintf(buf, "%02lu:%02lu:%02lu",
-            (t/3600)%24, (t/60)%60, t%60);
-    lastFallTimeStr = buf;
+    snprintf(lastFallTime, sizeof(lastFallTime), "%02lu:%02lu:%02lu",
+             (t/3600)%24, (t/60)%60, t%60);
 
-    fallDetected = false;
-    inactivityTriggered = true;
-    lastBuzzToggle = now;
+    lastFallS = t;
+    dataVersions.bump(DATA_FALL);
+    fieldVersions.touch(FIELD_FALL_TIME);
+    fieldVersions.touch(FIELD_FALLS);
+
+    // ===== INACTIVITY ALERT =====
+    // Repeats until the wearer moves again
+    setInactivityAlert(true);
+    timerService.start(inactivityTimer, INACTIVITY_TIMEOUT_MS, INACTIVITY_ALERT_INTERVAL_MS);
+    broadcastState(true);
+    if (TELEMETRY_ENABLED) postTelemetryPoint(TELEMETRY_FALL);
   }
+  stageWatchdog.leave();
+  powerManager.noteFallPath(micros() - fallPathStart);
+}
 
-  // ===== INACTIVITY ALERT =====
-  if (inactivityTriggered && now - lastMovementTime > 10000) {
-    if (now - lastBuzzToggle > 10000) {
-      lastBuzzToggle = now;
-      startBuzzer(5);
-    }
+// ================= LOOP ====================
+// Light sleep silences the AP: a caregiver could not join, and the
+// telemetry link and the emergency lane's sinks would drop. The AP is
+// needed while a station is attached, for LIGHT_SLEEP_AP_IDLE_MS after
+// one was (or after boot), with the telemetry uplink, and while a fall is
+// in delivery.
+bool apNeeded() {
+  return clientTracker.getClientCount() > 0 || millis() - lastStationMs < LIGHT_SLEEP_AP_IDLE_MS ||
+         TELEMETRY_ENABLED || emergencyLane.isPending();
+}
+
+void loop() {
+  stageWatchdog.feed();
+
+  // Block until a timer is due or an event arrives
+  if (powerManager.isStill() && !powerManager.hasMotion()) {
+    powerManager.idle(!buzzer.isPlaying() && !apNeeded(), timerService.msUntilNext());
+    timerService.advance();
+  } else {
+    timerService.wait(LOOP_MAX_BLOCK_MS);
   }
+
+  uint32_t workStart = micros();
+  serviceEvents(timerService.takeEvents());
+  loopBusyUs += micros() - workStart;
 }
@@ -0,0 +1,39 @@
+#include "field_versions.h"
+#include <string.h>
+
+FieldVersions::FieldVersions() {
+    begin(0);
+}
+
+void FieldVersions::begin(uint32_t bootBase) {
+    // Every field starts stamped base + 1; base itself is never handed out
+    base = bootBase;
+    current = bootBase + 1;
+    for (uint8_t i = 0; i < FIELD_COUNT; i++) changed[i] = current;
+    memset(&stats, 0, sizeof(stats));
+}
+
+void FieldVersions::writeDelta(JsonStream& json, uint32_t since, FieldWriter writer, const void* context) {
+    bool full = !isKnown(since);
+    stats.requests++;
+    if (full) stats.snapshots++;
+
+    json.beginObject();
+    json.unsignedField("v", current);
+    json.boolField("full", full);
+    json.beginObject("changes");
+    for (uint8_t i = 0; i < FIELD_COUNT; i++) {
+        // Wrap-safe: stamped after since
+        if (!full && (int32_t)(changed[i] - since) <= 0) continue;
+        writer(json, i, context);
+        stats.fieldsSent++;
+    }
+    json.end();
+    json.end();
+}
+
+// ================= Device =================
+
+#ifdef ARDUINO
+FieldVersions fieldVersions;
+#endif
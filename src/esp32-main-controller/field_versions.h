@@ -0,0 +1,66 @@
+#ifndef FIELD_VERSIONS_H
+#define FIELD_VERSIONS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "config.h"
+#include "json_stream.h"
+
+// Every field the dashboard shows, as published in /delta
+typedef enum {
+    FIELD_LATITUDE,
+    FIELD_LONGITUDE,
+    FIELD_FALL_TIME,
+    FIELD_FALLS,
+    FIELD_STATUS,
+    FIELD_GPS_STATE,
+    FIELD_FALL_DETECTION,
+    FIELD_BATTERY,
+    FIELD_WIFI_CLIENTS,
+    FIELD_MOTION,
+    FIELD_FALL_STATE,
+    FIELD_COUNT
+} FieldId;
+
+// Writes one field, key and value, from the caller's state
+typedef void (*FieldWriter)(JsonStream& json, uint8_t field, const void* context);
+
+// Delta endpoint counters
+typedef struct {
+    uint32_t requests;
+    uint32_t snapshots;             // Full answers: first poll, reboot, stale version
+    uint32_t fieldsSent;
+    uint32_t bytes;
+} DeltaStats;
+
+// One global version counter; each change stamps its field with the next
+// value. Versions start at a per-boot base so a version from before a
+// reboot is recognised and answered with a full snapshot.
+class FieldVersions {
+private:
+    uint32_t base;
+    uint32_t current;
+    uint32_t changed[FIELD_COUNT];
+    DeltaStats stats;
+
+public:
+    FieldVersions();
+    void begin(uint32_t bootBase);
+
+    // Loop only
+    void touch(FieldId field) { changed[field] = ++current; }
+
+    uint32_t getVersion() const { return current; }
+    uint32_t getChanged(FieldId field) const { return changed[field]; }
+    bool isKnown(uint32_t since) const { return since != base && since - base <= current - base; }
+
+    // {"v":<version>,"full":<bool>,"changes":{...}} with every field
+    // stamped after since, or all of them if since is not from this boot
+    void writeDelta(JsonStream& json, uint32_t since, FieldWriter writer, const void* context);
+    void noteBytes(uint32_t bytes) { stats.bytes += bytes; }
+    const DeltaStats& getStats() const { return stats; }
+};
+
+extern FieldVersions fieldVersions;
+
+#endif // FIELD_VERSIONS_H
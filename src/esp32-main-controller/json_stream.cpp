@@ -0,0 +1,220 @@
+#include "json_stream.h"
+#include <string.h>
+#include <math.h>
+
+#define JSON_MAX_DEPTH 31           // One bit of firstMask/arrayMask per level
+
+static const uint32_t POW10[] = {
+    1UL, 10UL, 100UL, 1000UL, 10000UL, 100000UL, 1000000UL, 10000000UL, 100000000UL, 1000000000UL
+};
+#define MAX_DECIMALS 9
+
+JsonStream::JsonStream(JsonSink sink, void* context)
+    : length(0), sink(sink), context(context), firstMask(0), arrayMask(0), depth(0),
+      afterKey(false), totalBytes(0), chunks(0) {
+}
+
+// ================= Output =================
+
+void JsonStream::flush() {
+    if (length == 0) return;
+    sink(buffer, length, context);
+    chunks++;
+    length = 0;
+}
+
+void JsonStream::put(char c) {
+    if (length == JSON_CHUNK_SIZE) flush();
+    buffer[length++] = c;
+    totalBytes++;
+}
+
+void JsonStream::write(const char* data, size_t n) {
+    while (n > 0) {
+        if (length == JSON_CHUNK_SIZE) flush();
+        size_t room = JSON_CHUNK_SIZE - length;
+        size_t take = n < room ? n : room;
+        memcpy(buffer + length, data, take);
+        length += take;
+        totalBytes += take;
+        data += take;
+        n -= take;
+    }
+}
+
+void JsonStream::writeString(const char* s) {
+    static const char HEX_DIGITS[] = "0123456789abcdef";
+    put('"');
+    for (; *s; s++) {
+        uint8_t c = (uint8_t)*s;
+        if (c == '"' || c == '\\') {
+            put('\\');
+            put(c);
+        } else if (c < 0x20) {
+            write("\\u00", 4);
+            put(HEX_DIGITS[c >> 4]);
+            put(HEX_DIGITS[c & 0x0F]);
+        } else {
+            put(c);
+        }
+    }
+    put('"');
+}
+
+void JsonStream::writeUnsigned(uint64_t value) {
+    char digits[20];
+    uint8_t n = 0;
+    do {
+        digits[n++] = '0' + value % 10;
+        value /= 10;
+    } while (value);
+    while (n) put(digits[--n]);
+}
+
+void JsonStream::writeFixed(int64_t scaled, uint8_t decimals) {
+    if (decimals > MAX_DECIMALS) decimals = MAX_DECIMALS;
+    uint64_t magnitude = scaled < 0 ? (uint64_t)(-scaled) : (uint64_t)scaled;
+    if (scaled < 0) put('-');
+    writeUnsigned(magnitude / POW10[decimals]);
+    if (decimals == 0) return;
+
+    put('.');
+    uint32_t fraction = magnitude % POW10[decimals];
+    for (uint8_t d = decimals; d > 0; d--) put('0' + (fraction / POW10[d - 1]) % 10);
+}
+
+void JsonStream::writeFloat(float value, uint8_t decimals) {
+    if (decimals > MAX_DECIMALS) decimals = MAX_DECIMALS;
+    double scaled = (double)value * POW10[decimals];
+    // Out of int64 range is as unrepresentable here as NaN
+    if (!isfinite(value) || fabs(scaled) >= 9.2e18) {
+        write("null", 4);
+        return;
+    }
+    writeFixed((int64_t)(scaled < 0 ? scaled - 0.5 : scaled + 0.5), decimals);
+}
+
+// ================= Structure =================
+
+// Comma before every member or element but the first of its container
+void JsonStream::separate() {
+    if (afterKey) {
+        afterKey = false;
+        return;
+    }
+    if (depth == 0) return;
+    uint32_t bit = 1UL << depth;
+    if (firstMask & bit) firstMask &= ~bit;
+    else put(',');
+}
+
+void JsonStream::open(char bracket, const char* name) {
+    if (name) key(name);
+    separate();
+    put(bracket);
+    if (depth >= JSON_MAX_DEPTH) return;
+    depth++;
+    firstMask |= 1UL << depth;
+    if (bracket == '[') arrayMask |= 1UL << depth;
+    else arrayMask &= ~(1UL << depth);
+}
+
+void JsonStream::beginObject(const char* name) {
+    open('{', name);
+}
+
+void JsonStream::beginArray(const char* name) {
+    open('[', name);
+}
+
+void JsonStream::end() {
+    if (depth == 0) return;
+    put(arrayMask & (1UL << depth) ? ']' : '}');
+    depth--;
+}
+
+void JsonStream::key(const char* name) {
+    separate();
+    writeString(name);
+    put(':');
+    afterKey = true;
+}
+
+// ================= Values =================
+
+void JsonStream::unsignedValue(uint32_t value) {
+    separate();
+    writeUnsigned(value);
+}
+
+void JsonStream::signedValue(int32_t value) {
+    separate();
+    writeFixed(value, 0);
+}
+
+void JsonStream::boolValue(bool value) {
+    separate();
+    if (value) write("true", 4);
+    else write("false", 5);
+}
+
+void JsonStream::stringValue(const char* value) {
+    separate();
+    if (value) writeString(value);
+    else write("null", 4);
+}
+
+void JsonStream::scaledValue(int32_t scaled, uint8_t decimals) {
+    separate();
+    writeFixed(scaled, decimals);
+}
+
+void JsonStream::fixedValue(float value, uint8_t decimals) {
+    separate();
+    writeFloat(value, decimals);
+}
+
+void JsonStream::fields(const JsonField* schema, size_t count, const void* record) {
+    const uint8_t* base = static_cast<const uint8_t*>(record);
+
+    for (size_t i = 0; i < count; i++) {
+        const JsonField& f = schema[i];
+        const uint8_t* p = base + f.offset;
+        key(f.key);
+        separate();
+
+        bool quoted = f.flags & JSON_FLAG_QUOTED;
+        if (quoted) put('"');
+
+        switch (f.type) {
+            case JSON_TYPE_U8: writeFixed(*p, f.decimals); break;
+            case JSON_TYPE_U16: { uint16_t v; memcpy(&v, p, sizeof(v)); writeFixed(v, f.decimals); break; }
+            case JSON_TYPE_U32: { uint32_t v; memcpy(&v, p, sizeof(v)); writeFixed(v, f.decimals); break; }
+            case JSON_TYPE_I8: writeFixed((int8_t)*p, f.decimals); break;
+            case JSON_TYPE_I16: { int16_t v; memcpy(&v, p, sizeof(v)); writeFixed(v, f.decimals); break; }
+            case JSON_TYPE_I32: { int32_t v; memcpy(&v, p, sizeof(v)); writeFixed(v, f.decimals); break; }
+            case JSON_TYPE_BOOL: if (*p) write("true", 4); else write("false", 5); break;
+            case JSON_TYPE_FLOAT: {
+                float v;
+                memcpy(&v, p, sizeof(v));
+                writeFloat(v, f.decimals);
+                break;
+            }
+            case JSON_TYPE_STRING: {
+                const char* v;
+                memcpy(&v, p, sizeof(v));
+                if (v) writeString(v);
+                else write("null", 4);
+                break;
+            }
+            case JSON_TYPE_CHARS: writeString((const char*)p); break;
+        }
+
+        if (quoted) put('"');
+    }
+}
+
+uint32_t JsonStream::finish() {
+    flush();
+    return totalBytes;
+}
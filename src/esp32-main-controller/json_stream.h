@@ -0,0 +1,126 @@
+#ifndef JSON_STREAM_H
+#define JSON_STREAM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "config.h"
+
+// ================= Schema =================
+
+typedef enum {
+    JSON_TYPE_U8,
+    JSON_TYPE_U16,
+    JSON_TYPE_U32,
+    JSON_TYPE_I8,
+    JSON_TYPE_I16,
+    JSON_TYPE_I32,
+    JSON_TYPE_BOOL,
+    JSON_TYPE_FLOAT,
+    JSON_TYPE_STRING,               // const char*
+    JSON_TYPE_CHARS                 // char[N], NUL terminated
+} JsonType;
+
+#define JSON_FLAG_QUOTED 0x01       // Number written as a string
+
+// One field of a response: the key, and where and how to read its value
+// from a record. Declared once per response in a constexpr table.
+typedef struct {
+    const char* key;
+    uint8_t type;
+    uint8_t decimals;               // Fixed point: scaled integers and floats
+    uint8_t flags;
+    uint16_t offset;
+} JsonField;
+
+// Field type from the member's C++ type; unsupported types do not compile
+template <typename T> struct JsonTypeOf;
+template <> struct JsonTypeOf<uint8_t> { static constexpr uint8_t type = JSON_TYPE_U8; };
+template <> struct JsonTypeOf<uint16_t> { static constexpr uint8_t type = JSON_TYPE_U16; };
+template <> struct JsonTypeOf<uint32_t> { static constexpr uint8_t type = JSON_TYPE_U32; };
+template <> struct JsonTypeOf<int8_t> { static constexpr uint8_t type = JSON_TYPE_I8; };
+template <> struct JsonTypeOf<int16_t> { static constexpr uint8_t type = JSON_TYPE_I16; };
+template <> struct JsonTypeOf<int32_t> { static constexpr uint8_t type = JSON_TYPE_I32; };
+template <> struct JsonTypeOf<bool> { static constexpr uint8_t type = JSON_TYPE_BOOL; };
+template <> struct JsonTypeOf<float> { static constexpr uint8_t type = JSON_TYPE_FLOAT; };
+template <> struct JsonTypeOf<const char*> { static constexpr uint8_t type = JSON_TYPE_STRING; };
+template <size_t N> struct JsonTypeOf<char[N]> { static constexpr uint8_t type = JSON_TYPE_CHARS; };
+
+#define JSON_MEMBER_TYPE(Struct, member) JsonTypeOf<decltype(((Struct*)0)->member)>::type
+
+// A member written as is
+#define JSON_FIELD(Struct, member, key) \
+    { key, JSON_MEMBER_TYPE(Struct, member), 0, 0, (uint16_t)offsetof(Struct, member) }
+
+// A scaled integer (value / 10^decimals) or a float, in fixed point
+#define JSON_FIXED(Struct, member, key, decimals, flags) \
+    { key, JSON_MEMBER_TYPE(Struct, member), decimals, flags, (uint16_t)offsetof(Struct, member) }
+
+#define JSON_SCHEMA_SIZE(schema) (sizeof(schema) / sizeof(schema[0]))
+
+// ================= Stream =================
+
+typedef void (*JsonSink)(const char* data, size_t length, void* context);
+
+// Writes JSON into a fixed chunk buffer that is handed to the sink each
+// time it fills, so a response of any size needs only JSON_CHUNK_SIZE
+// bytes and no intermediate document. Numbers are formatted as integers
+// or fixed point without printf.
+class JsonStream {
+private:
+    char buffer[JSON_CHUNK_SIZE];
+    size_t length;
+    JsonSink sink;
+    void* context;
+    uint32_t firstMask;             // Bit per nesting level: nothing written yet
+    uint32_t arrayMask;             // Bit per nesting level: array, else object
+    uint8_t depth;
+    bool afterKey;
+    uint32_t totalBytes;
+    uint16_t chunks;
+
+    void flush();
+    void put(char c);
+    void write(const char* data, size_t n);
+    void writeString(const char* s);
+    void writeUnsigned(uint64_t value);
+    void writeFixed(int64_t scaled, uint8_t decimals);
+    void writeFloat(float value, uint8_t decimals);
+    void separate();
+    void open(char bracket, const char* name);
+
+public:
+    JsonStream(JsonSink sink, void* context);
+
+    // Containers; key is NULL inside arrays and at the top level
+    void beginObject(const char* key = NULL);
+    void beginArray(const char* key = NULL);
+    void end();                     // Closes the innermost container
+
+    // Keyed members (inside objects). Named per type rather than
+    // overloaded: uint32_t is unsigned int or unsigned long depending on
+    // the IDF version, which makes overloads ambiguous.
+    void key(const char* key);
+    void unsignedField(const char* key, uint32_t value) { this->key(key); unsignedValue(value); }
+    void signedField(const char* key, int32_t value) { this->key(key); signedValue(value); }
+    void boolField(const char* key, bool value) { this->key(key); boolValue(value); }
+    void stringField(const char* key, const char* value) { this->key(key); stringValue(value); }
+    void scaledField(const char* key, int32_t scaled, uint8_t decimals) { this->key(key); scaledValue(scaled, decimals); }
+    void fixedField(const char* key, float value, uint8_t decimals) { this->key(key); fixedValue(value, decimals); }
+
+    // Bare values (array elements, or after key())
+    void unsignedValue(uint32_t value);
+    void signedValue(int32_t value);
+    void boolValue(bool value);
+    void stringValue(const char* value);
+    void scaledValue(int32_t scaled, uint8_t decimals);
+    void fixedValue(float value, uint8_t decimals);
+
+    // Every field of a schema, read from record
+    void fields(const JsonField* schema, size_t count, const void* record);
+
+    // Hands any buffered bytes to the sink; returns the total written
+    uint32_t finish();
+    uint16_t getChunks() const { return chunks; }
+};
+
+#endif // JSON_STREAM_H
@@ -0,0 +1,222 @@
+#include "mqtt_session.h"
+#include <string.h>
+
+#define MQTT_CONNECT 0x10
+#define MQTT_CONNACK 0x20
+#define MQTT_PUBLISH_QOS1 0x32
+#define MQTT_PUBACK 0x40
+#define MQTT_PINGREQ 0xC0
+#define MQTT_PINGRESP 0xD0
+
+#define MQTT_PROTOCOL_LEVEL 4           // 3.1.1
+#define MQTT_CLEAN_SESSION 0x02
+
+static size_t putLength(uint8_t* out, size_t length) {
+    size_t n = 0;
+    do {
+        uint8_t byte = length & 0x7F;
+        length >>= 7;
+        if (length) byte |= 0x80;
+        out[n++] = byte;
+    } while (length);
+    return n;
+}
+
+static size_t putString(uint8_t* out, const char* s, size_t length) {
+    out[0] = (uint8_t)(length >> 8);
+    out[1] = (uint8_t)length;
+    memcpy(out + 2, s, length);
+    return 2 + length;
+}
+
+MqttSession::MqttSession()
+    : sendFn(NULL), context(NULL), state(MQTT_DISCONNECTED), keepAliveMs(0), nextPacketId(1),
+      inFlightId(0), ackedId(0), inFlightSince(0), stateSince(0), lastSendMs(0),
+      pingOutstanding(false), pingSince(0), rxType(0), rxRemaining(0), rxLengthShift(0),
+      rxInLength(false), rxBodyLength(0) {
+    memset(&stats, 0, sizeof(stats));
+}
+
+void MqttSession::begin(MqttSendFn send, void* ctx) {
+    sendFn = send;
+    context = ctx;
+    reset();
+}
+
+void MqttSession::reset() {
+    state = MQTT_DISCONNECTED;
+    inFlightId = 0;
+    pingOutstanding = false;
+    rxType = 0;
+    rxInLength = false;
+    rxRemaining = 0;
+    rxBodyLength = 0;
+}
+
+size_t MqttSession::publishSize(size_t topicLength, size_t payloadLength) {
+    size_t remaining = 2 + topicLength + 2 + payloadLength;
+    uint8_t length[4];
+    return 1 + putLength(length, remaining) + remaining;
+}
+
+bool MqttSession::send(const uint8_t* data, size_t length, uint32_t nowMs) {
+    if (!sendFn(data, length, context)) return false;
+    stats.bytesSent += length;
+    lastSendMs = nowMs;
+    return true;
+}
+
+// ================= Outgoing =================
+
+bool MqttSession::connect(const char* clientId, uint16_t keepAliveS, uint32_t nowMs) {
+    reset();
+    size_t idLength = strlen(clientId);
+    if (idLength > MQTT_TOPIC_MAX) idLength = MQTT_TOPIC_MAX;
+
+    uint8_t packet[16 + MQTT_TOPIC_MAX];
+    uint8_t body[12 + MQTT_TOPIC_MAX];
+    size_t n = putString(body, "MQTT", 4);
+    body[n++] = MQTT_PROTOCOL_LEVEL;
+    body[n++] = MQTT_CLEAN_SESSION;
+    body[n++] = (uint8_t)(keepAliveS >> 8);
+    body[n++] = (uint8_t)keepAliveS;
+    n += putString(body + n, clientId, idLength);
+
+    packet[0] = MQTT_CONNECT;
+    size_t header = 1 + putLength(packet + 1, n);
+    memcpy(packet + header, body, n);
+
+    keepAliveMs = (uint32_t)keepAliveS * 1000;
+    if (!send(packet, header + n, nowMs)) return false;
+    state = MQTT_CONNECTING;
+    stateSince = nowMs;
+    return true;
+}
+
+uint16_t MqttSession::publish(const char* topic, const uint8_t* payload, size_t length, uint32_t nowMs) {
+    if (!isReady()) return 0;
+    size_t topicLength = strlen(topic);
+    if (topicLength > MQTT_TOPIC_MAX) return 0;
+
+    uint16_t id = nextPacketId;
+    nextPacketId = nextPacketId == 0xFFFF ? 1 : nextPacketId + 1;
+
+    // Fixed header, topic and packet id in one piece; the payload as is
+    uint8_t header[1 + 4 + 2 + MQTT_TOPIC_MAX + 2];
+    header[0] = MQTT_PUBLISH_QOS1;
+    size_t n = 1 + putLength(header + 1, 2 + topicLength + 2 + length);
+    n += putString(header + n, topic, topicLength);
+    header[n++] = (uint8_t)(id >> 8);
+    header[n++] = (uint8_t)id;
+
+    if (!send(header, n, nowMs) || !send(payload, length, nowMs)) return 0;
+    inFlightId = id;
+    inFlightSince = nowMs;
+    stats.publishes++;
+    return id;
+}
+
+uint16_t MqttSession::takeAcked() {
+    uint16_t id = ackedId;
+    ackedId = 0;
+    return id;
+}
+
+bool MqttSession::poll(uint32_t nowMs) {
+    if (state == MQTT_DISCONNECTED) return true;
+
+    bool expired = (state == MQTT_CONNECTING && nowMs - stateSince > MQTT_CONNECT_TIMEOUT_MS) ||
+                   (inFlightId && nowMs - inFlightSince > MQTT_ACK_TIMEOUT_MS) ||
+                   (pingOutstanding && nowMs - pingSince > MQTT_ACK_TIMEOUT_MS);
+    if (expired) {
+        stats.timeouts++;
+        reset();
+        return false;
+    }
+
+    // The broker allows 1.5 keepalives of silence, so one idle keepalive
+    // plus the ack timeout is still in time
+    if (state == MQTT_CONNECTED && keepAliveMs && !pingOutstanding && nowMs - lastSendMs >= keepAliveMs) {
+        const uint8_t ping[2] = { MQTT_PINGREQ, 0 };
+        if (!send(ping, sizeof(ping), nowMs)) {
+            reset();
+            return false;
+        }
+        pingOutstanding = true;
+        pingSince = nowMs;
+        stats.pings++;
+    }
+    return true;
+}
+
+// ================= Incoming =================
+
+void MqttSession::onPacket(uint32_t nowMs) {
+    switch (rxType & 0xF0) {
+        case MQTT_CONNACK:
+            if (state != MQTT_CONNECTING || rxBodyLength < 2) break;
+            if (rxBody[1] == 0) {
+                state = MQTT_CONNECTED;
+                stats.connects++;
+            } else {
+                stats.refused++;
+                state = MQTT_DISCONNECTED;
+            }
+            break;
+
+        case MQTT_PUBACK: {
+            if (rxBodyLength < 2) break;
+            uint16_t id = (uint16_t)((rxBody[0] << 8) | rxBody[1]);
+            if (id != inFlightId) break;
+            uint32_t ackMs = nowMs - inFlightSince;
+            stats.lastAckMs = ackMs;
+            if (ackMs > stats.maxAckMs) stats.maxAckMs = ackMs;
+            stats.acks++;
+            inFlightId = 0;
+            ackedId = id;
+            break;
+        }
+
+        case MQTT_PINGRESP:
+            pingOutstanding = false;
+            break;
+
+        default:
+            break;                  // Nothing is subscribed; anything else is ignored
+    }
+}
+
+void MqttSession::receive(const uint8_t* data, size_t length, uint32_t nowMs) {
+    stats.bytesReceived += length;
+    for (size_t i = 0; i < length; i++) {
+        uint8_t byte = data[i];
+
+        if (rxType == 0) {
+            rxType = byte ? byte : 0x01;    // Type 0 is reserved; keep it distinct from idle
+            rxRemaining = 0;
+            rxLengthShift = 0;
+            rxBodyLength = 0;
+            rxInLength = true;
+            continue;
+        }
+
+        if (rxInLength) {
+            rxRemaining |= (uint32_t)(byte & 0x7F) << rxLengthShift;
+            rxLengthShift += 7;
+            if (byte & 0x80) continue;
+            rxInLength = false;
+            if (rxRemaining == 0) {
+                onPacket(nowMs);
+                rxType = 0;
+            }
+            continue;
+        }
+
+        if (rxBodyLength < sizeof(rxBody)) rxBody[rxBodyLength] = byte;
+        if (rxBodyLength < 0xFF) rxBodyLength++;
+        if (--rxRemaining == 0) {
+            onPacket(nowMs);
+            rxType = 0;
+        }
+    }
+}
@@ -0,0 +1,86 @@
+#ifndef MQTT_SESSION_H
+#define MQTT_SESSION_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "config.h"
+
+// The caller owns the socket and passes bytes both ways.
+
+#define MQTT_TOPIC_MAX 64
+
+typedef bool (*MqttSendFn)(const uint8_t* data, size_t length, void* context);
+
+typedef enum {
+    MQTT_DISCONNECTED,
+    MQTT_CONNECTING,                // CONNECT sent, waiting for CONNACK
+    MQTT_CONNECTED
+} MqttState;
+
+typedef struct {
+    uint32_t connects;
+    uint32_t refused;               // CONNACK with a non-zero return code
+    uint32_t timeouts;              // CONNACK, PUBACK or PINGRESP never came
+    uint32_t publishes;
+    uint32_t acks;
+    uint32_t pings;
+    uint32_t bytesSent;
+    uint32_t bytesReceived;
+    uint32_t lastAckMs;             // PUBLISH to PUBACK
+    uint32_t maxAckMs;
+} MqttStats;
+
+// The subset of MQTT 3.1.1 an uplink needs: clean-session CONNECT,
+// QoS 1 PUBLISH with one message in flight, keepalive pings. The single
+// in-flight message is the backpressure: nothing more is sent until the
+// broker has acknowledged it.
+class MqttSession {
+private:
+    MqttSendFn sendFn;
+    void* context;
+    uint8_t state;
+    uint32_t keepAliveMs;
+    uint16_t nextPacketId;
+    uint16_t inFlightId;
+    uint16_t ackedId;
+    uint32_t inFlightSince;
+    uint32_t stateSince;
+    uint32_t lastSendMs;
+    bool pingOutstanding;
+    uint32_t pingSince;
+
+    // Incoming packet parser
+    uint8_t rxType;
+    uint32_t rxRemaining;
+    uint8_t rxLengthShift;
+    bool rxInLength;
+    uint8_t rxBody[4];
+    uint8_t rxBodyLength;
+    MqttStats stats;
+
+    bool send(const uint8_t* data, size_t length, uint32_t nowMs);
+    void onPacket(uint32_t nowMs);
+
+public:
+    MqttSession();
+
+    void begin(MqttSendFn send, void* context);
+    bool connect(const char* clientId, uint16_t keepAliveS, uint32_t nowMs);
+    void reset();                   // The connection is gone
+
+    // QoS 1; returns the packet id, 0 if not connected or one is in flight
+    uint16_t publish(const char* topic, const uint8_t* payload, size_t length, uint32_t nowMs);
+    uint16_t takeAcked();           // Packet id acknowledged since the last call, or 0
+
+    void receive(const uint8_t* data, size_t length, uint32_t nowMs);
+    bool poll(uint32_t nowMs);      // Keepalive; false when the connection should be dropped
+
+    uint8_t getState() const { return state; }
+    bool isReady() const { return state == MQTT_CONNECTED && inFlightId == 0; }
+    const MqttStats& getStats() const { return stats; }
+
+    // Bytes of a QoS 1 PUBLISH on the wire (without TCP/IP)
+    static size_t publishSize(size_t topicLength, size_t payloadLength);
+};
+
+#endif // MQTT_SESSION_H
@@ -0,0 +1,482 @@
+#include "ota_patch.h"
+#include <string.h>
+
+static uint32_t readLe32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+bool parsePatchHeader(const uint8_t* data, size_t length, PatchHeader& out) {
+    if (length < PATCH_HEADER_SIZE) return false;
+    out.magic = readLe32(data);
+    out.version = data[4];
+    out.flags = data[5];
+    out.reserved = (uint16_t)(data[6] | (data[7] << 8));
+    out.sourceSize = readLe32(data + 8);
+    out.sourceCrc = readLe32(data + 12);
+    out.targetSize = readLe32(data + 16);
+    out.targetCrc = readLe32(data + 20);
+    return out.magic == PATCH_MAGIC && out.version == PATCH_VERSION && out.targetSize > 0;
+}
+
+const char* getPatchResultName(PatchResult result) {
+    static const char* const names[] = {
+        "ok", "done", "bad header", "bad op", "copy outside source", "target overflow",
+        "read failed", "write failed", "truncated", "crc mismatch"
+    };
+    return result <= PATCH_CRC_MISMATCH ? names[result] : "unknown";
+}
+
+// Nibble table: 64 bytes of flash instead of 1 KB, fast enough to keep up
+// with flash writes
+uint32_t patchCrc32(uint32_t crc, const uint8_t* data, size_t length) {
+    static const uint32_t table[16] = {
+        0x00000000UL, 0x1DB71064UL, 0x3B6E20C8UL, 0x26D930ACUL,
+        0x76DC4190UL, 0x6B6B51F4UL, 0x4DB26158UL, 0x5005713CUL,
+        0xEDB88320UL, 0xF00F9344UL, 0xD6D6A3E8UL, 0xCB61B38CUL,
+        0x9B64C2B0UL, 0x86D3D2D4UL, 0xA00AE278UL, 0xBDBDF21CUL
+    };
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        crc = (crc >> 4) ^ table[crc & 0x0F];
+        crc = (crc >> 4) ^ table[crc & 0x0F];
+    }
+    return ~crc;
+}
+
+// ================= Signature =================
+
+OtaSignature::OtaSignature() : started(false) {
+    mbedtls_md_init(&hmac);
+    memset(expected, 0, sizeof(expected));
+}
+
+OtaSignature::~OtaSignature() {
+    mbedtls_md_free(&hmac);
+}
+
+static int hexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// The HMAC runs over the upload as it arrives
+bool OtaSignature::begin(const char* secret, const char* signatureHex) {
+    started = false;
+    if (!secret || !*secret || !signatureHex || strlen(signatureHex) != OTA_SIGNATURE_SIZE * 2) return false;
+    for (size_t i = 0; i < OTA_SIGNATURE_SIZE; i++) {
+        int high = hexDigit(signatureHex[2 * i]);
+        int low = hexDigit(signatureHex[2 * i + 1]);
+        if (high < 0 || low < 0) return false;
+        expected[i] = (uint8_t)(high << 4 | low);
+    }
+
+    // A fresh context per upload; setup allocates the HMAC pads
+    mbedtls_md_free(&hmac);
+    mbedtls_md_init(&hmac);
+    if (mbedtls_md_setup(&hmac, mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), 1) != 0 ||
+        mbedtls_md_hmac_starts(&hmac, (const unsigned char*)secret, strlen(secret)) != 0) {
+        return false;
+    }
+    started = true;
+    return true;
+}
+
+void OtaSignature::update(const uint8_t* data, size_t length) {
+    if (started && mbedtls_md_hmac_update(&hmac, data, length) != 0) started = false;
+}
+
+bool OtaSignature::verify() {
+    if (!started) return false;
+    started = false;
+    uint8_t actual[OTA_SIGNATURE_SIZE];
+    if (mbedtls_md_hmac_finish(&hmac, actual) != 0) return false;
+
+    uint8_t diff = 0;
+    for (size_t i = 0; i < OTA_SIGNATURE_SIZE; i++) diff |= actual[i] ^ expected[i];
+    return diff == 0;
+}
+
+// ================= Applier =================
+
+PatchApplier::PatchApplier()
+    : readSource(NULL), writeTarget(NULL), context(NULL), state(STATE_END), varint(0),
+      varintShift(0), length(0), sourceCursor(0), written(0), crc(0), error(PATCH_OK) {
+    memset(&header, 0, sizeof(header));
+}
+
+void PatchApplier::begin(const PatchHeader& patch, PatchReadFn read, PatchWriteFn write, void* ctx) {
+    header = patch;
+    readSource = read;
+    writeTarget = write;
+    context = ctx;
+    state = STATE_OP;
+    varint = 0;
+    varintShift = 0;
+    length = 0;
+    sourceCursor = 0;
+    written = 0;
+    crc = 0;
+    error = PATCH_OK;
+}
+
+// LEB128; true once the last byte is in
+bool PatchApplier::takeVarint(uint8_t byte) {
+    if (varintShift < 32) varint |= (uint32_t)(byte & 0x7F) << varintShift;
+    varintShift += 7;
+    return !(byte & 0x80);
+}
+
+PatchResult PatchApplier::emit(const uint8_t* data, size_t n) {
+    if (written + n > header.targetSize) return PATCH_TARGET_OVERFLOW;
+    if (!writeTarget(data, n, context)) return PATCH_WRITE_FAILED;
+    crc = patchCrc32(crc, data, n);
+    written += n;
+    return PATCH_OK;
+}
+
+PatchResult PatchApplier::copy(int32_t delta) {
+    uint32_t from = sourceCursor + (uint32_t)delta;
+    if (from > header.sourceSize || length > header.sourceSize - from) return PATCH_SOURCE_RANGE;
+
+    uint32_t remaining = length;
+    while (remaining > 0) {
+        size_t n = remaining < PATCH_COPY_CHUNK ? remaining : PATCH_COPY_CHUNK;
+        if (!readSource(from, copyBuffer, n, context)) return PATCH_READ_FAILED;
+        PatchResult result = emit(copyBuffer, n);
+        if (result != PATCH_OK) return result;
+        from += n;
+        remaining -= n;
+    }
+    sourceCursor = from;
+    return PATCH_OK;
+}
+
+PatchResult PatchApplier::feed(const uint8_t* ops, size_t n) {
+    if (error != PATCH_OK) return error;
+
+    size_t i = 0;
+    while (i < n) {
+        if (state == STATE_INSERT_DATA) {
+            // Literal runs go out as one piece, not byte by byte
+            size_t take = n - i < length ? n - i : length;
+            error = emit(ops + i, take);
+            if (error != PATCH_OK) return error;
+            i += take;
+            length -= take;
+            if (length == 0) state = STATE_OP;
+            continue;
+        }
+
+        uint8_t byte = ops[i++];
+        switch (state) {
+            case STATE_OP:
+                varint = 0;
+                varintShift = 0;
+                if (byte == PATCH_OP_COPY) state = STATE_COPY_LENGTH;
+                else if (byte == PATCH_OP_INSERT) state = STATE_INSERT_LENGTH;
+                else if (byte == PATCH_OP_END) state = STATE_END;
+                else return error = PATCH_BAD_OP;
+                break;
+
+            case STATE_COPY_LENGTH:
+                if (!takeVarint(byte)) break;
+                length = varint;
+                varint = 0;
+                varintShift = 0;
+                state = STATE_COPY_OFFSET;
+                break;
+
+            case STATE_COPY_OFFSET: {
+                if (!takeVarint(byte)) break;
+                int32_t delta = (int32_t)(varint >> 1) ^ -(int32_t)(varint & 1);   // Zigzag
+                error = copy(delta);
+                if (error != PATCH_OK) return error;
+                state = STATE_OP;
+                break;
+            }
+
+            case STATE_INSERT_LENGTH:
+                if (!takeVarint(byte)) break;
+                length = varint;
+                state = length ? STATE_INSERT_DATA : STATE_OP;
+                break;
+
+            case STATE_END:
+                return error = PATCH_BAD_OP;     // Nothing may follow END
+
+            case STATE_INSERT_DATA:
+                break;
+        }
+    }
+    return PATCH_OK;
+}
+
+PatchResult PatchApplier::finish() {
+    if (error != PATCH_OK) return error;
+    if (state != STATE_END || written != header.targetSize) return PATCH_TRUNCATED;
+    if (crc != header.targetCrc) return PATCH_CRC_MISMATCH;
+    return PATCH_DONE;
+}
+
+// ================= Device =================
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include <Update.h>
+#include <Preferences.h>
+#include <esp_system.h>
+#include <esp_ota_ops.h>
+#include <esp_partition.h>
+#include <esp32/rom/miniz.h>
+#include "stage_watchdog.h"
+
+#define IMAGE_MAGIC 0xE9                // First byte of an app image
+#define SOURCE_CHECK_CHUNK 4096
+
+// A hung image only boots again through watchdog restarts, which stop
+// after MAX_RESTART_COUNT
+#if OTA_MAX_BOOT_ATTEMPTS > MAX_RESTART_COUNT
+#error "OTA_MAX_BOOT_ATTEMPTS must not exceed MAX_RESTART_COUNT"
+#endif
+
+OtaUpdater otaUpdater;
+
+// With bootloader rollback enabled the core would otherwise mark every
+// image valid at boot; confirm() does it once the image has proven itself
+extern "C" bool verifyRollbackLater() { return true; }
+
+OtaUpdater::OtaUpdater()
+    : headerLength(0), inflator(NULL), window(NULL), windowOffset(0), inflated(false),
+      source(NULL), startMs(0), pendingConfirm(false), error("") {
+    memset(&header, 0, sizeof(header));
+    memset(&stats, 0, sizeof(stats));
+}
+
+const char* OtaUpdater::getStateName(uint8_t state) {
+    static const char* const names[] = { "idle", "receiving", "ready", "failed" };
+    return state <= OTA_FAILED ? names[state] : "unknown";
+}
+
+// ================= Rollback =================
+
+// Works with or without bootloader rollback: the boot count lives in NVS
+// and the previous partition is selected again by hand
+void OtaUpdater::begin() {
+    Preferences prefs;
+    prefs.begin("ota", false);
+    stats.rollbacks = prefs.getUShort("rollbacks", 0);
+    pendingConfirm = prefs.getBool("pending", false);
+
+    if (pendingConfirm) {
+        uint8_t attempts = prefs.getUChar("attempts", 0) + 1;
+        stats.bootAttempts = attempts;
+        if (attempts <= OTA_MAX_BOOT_ATTEMPTS) {
+            prefs.putUChar("attempts", attempts);
+        } else {
+            String label = prefs.getString("fallback", "");
+            const esp_partition_t* previous = esp_partition_find_first(
+                ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_ANY, label.c_str());
+            prefs.putBool("pending", false);
+            prefs.putUShort("rollbacks", stats.rollbacks + 1);
+            prefs.end();
+
+            if (previous && previous != esp_ota_get_running_partition() &&
+                esp_ota_set_boot_partition(previous) == ESP_OK) {
+                Serial.printf("OTA: image failed %u boots, rolling back to %s\n", attempts - 1, label.c_str());
+                Serial.flush();
+                esp_restart();
+            }
+            pendingConfirm = false;
+            return;
+        }
+    }
+    prefs.end();
+}
+
+void OtaUpdater::confirm() {
+    if (!pendingConfirm) return;
+    esp_ota_mark_app_valid_cancel_rollback();
+
+    Preferences prefs;
+    prefs.begin("ota", false);
+    prefs.putBool("pending", false);
+    prefs.putUChar("attempts", 0);
+    prefs.end();
+    pendingConfirm = false;
+    stats.bootAttempts = 0;
+}
+
+// ================= Upload =================
+
+bool OtaUpdater::readSource(uint32_t offset, uint8_t* out, size_t length, void* context) {
+    OtaUpdater* self = static_cast<OtaUpdater*>(context);
+    return esp_partition_read((const esp_partition_t*)self->source, offset, out, length) == ESP_OK;
+}
+
+bool OtaUpdater::writeTarget(const uint8_t* data, size_t length, void*) {
+    return Update.write(const_cast<uint8_t*>(data), length) == length;
+}
+
+bool OtaUpdater::fail(const char* reason) {
+    if (stats.state == OTA_RECEIVING) Update.abort();
+    release();
+    error = reason;
+    stats.state = OTA_FAILED;
+    Serial.printf("OTA: %s\n", reason);
+    return false;
+}
+
+void OtaUpdater::release() {
+    free(inflator);
+    free(window);
+    inflator = NULL;
+    window = NULL;
+}
+
+void OtaUpdater::start(const char* signatureHex) {
+    release();
+    if (stats.state == OTA_RECEIVING) Update.abort();
+    headerLength = 0;
+    error = "";
+    stats.state = OTA_IDLE;
+    stats.patch = false;
+    stats.uploadBytes = 0;
+    stats.imageBytes = 0;
+    stats.elapsedMs = 0;
+    stats.applyKBps = 0;
+    startMs = millis();
+
+    if (!signature.begin(OTA_SECRET, signatureHex)) {
+        fail(*OTA_SECRET ? "missing or malformed " OTA_SIGNATURE_HEADER : "OTA_SECRET is not set");
+        return;
+    }
+    stats.state = OTA_RECEIVING;
+}
+
+// The patch must have been made against exactly the running image
+bool OtaUpdater::startPatch() {
+    if (!parsePatchHeader(headerBytes, headerLength, header)) return fail("bad patch header");
+
+    const esp_partition_t* running = esp_ota_get_running_partition();
+    if (header.sourceSize > running->size) return fail("patch source larger than running partition");
+    source = running;
+
+    uint8_t buffer[256];
+    uint32_t crc = 0;
+    for (uint32_t offset = 0; offset < header.sourceSize; offset += sizeof(buffer)) {
+        size_t n = header.sourceSize - offset < sizeof(buffer) ? header.sourceSize - offset : sizeof(buffer);
+        if (esp_partition_read(running, offset, buffer, n) != ESP_OK) return fail("source read failed");
+        crc = patchCrc32(crc, buffer, n);
+        if (offset % SOURCE_CHECK_CHUNK == 0) stageWatchdog.keepAlive();
+    }
+    if (crc != header.sourceCrc) return fail("patch was made for a different image");
+
+    inflator = malloc(sizeof(tinfl_decompressor));
+    window = (uint8_t*)malloc(TINFL_LZ_DICT_SIZE);
+    if (!inflator || !window) return fail("out of memory");
+    tinfl_init((tinfl_decompressor*)inflator);
+    windowOffset = 0;
+    inflated = false;
+
+    if (!Update.begin(header.targetSize, U_FLASH)) return fail("target does not fit the update partition");
+    applier.begin(header, readSource, writeTarget, this);
+    stats.patch = true;
+    return true;
+}
+
+// The window is both the inflate dictionary and the output buffer; each
+// run of output is applied before it can be overwritten
+bool OtaUpdater::inflate(const uint8_t* data, size_t length) {
+    const uint32_t flags = TINFL_FLAG_PARSE_ZLIB_HEADER | TINFL_FLAG_HAS_MORE_INPUT;
+
+    while (!inflated) {
+        size_t in = length;
+        size_t out = TINFL_LZ_DICT_SIZE - windowOffset;
+        tinfl_status status = tinfl_decompress((tinfl_decompressor*)inflator, data, &in,
+                                               window, window + windowOffset, &out, flags);
+        data += in;
+        length -= in;
+
+        if (out > 0) {
+            PatchResult result = applier.feed(window + windowOffset, out);
+            if (result != PATCH_OK) return fail(getPatchResultName(result));
+            windowOffset = (windowOffset + out) & (TINFL_LZ_DICT_SIZE - 1);
+        }
+
+        if (status == TINFL_STATUS_DONE) inflated = true;
+        else if (status < TINFL_STATUS_DONE) return fail("corrupt patch stream");
+        else if (status == TINFL_STATUS_NEEDS_MORE_INPUT && length == 0) break;
+    }
+    return true;
+}
+
+bool OtaUpdater::write(const uint8_t* data, size_t length) {
+    if (stats.state != OTA_RECEIVING) return false;
+    stats.uploadBytes += length;
+    signature.update(data, length);
+
+    // The first byte tells a full image from a patch
+    if (stats.uploadBytes == length && length > 0 && data[0] == IMAGE_MAGIC) {
+        if (!Update.begin(UPDATE_SIZE_UNKNOWN, U_FLASH)) return fail("update begin failed");
+        headerLength = PATCH_HEADER_SIZE;   // Nothing to collect
+    }
+
+    if (headerLength < PATCH_HEADER_SIZE) {
+        size_t take = PATCH_HEADER_SIZE - headerLength;
+        if (take > length) take = length;
+        memcpy(headerBytes + headerLength, data, take);
+        headerLength += take;
+        data += take;
+        length -= take;
+        if (headerLength < PATCH_HEADER_SIZE) return true;
+        if (!startPatch()) return false;
+    }
+
+    if (length == 0) return true;
+    if (stats.patch) return inflate(data, length);
+    if (Update.write(const_cast<uint8_t*>(data), length) != length) return fail(Update.errorString());
+    return true;
+}
+
+bool OtaUpdater::end() {
+    if (stats.state != OTA_RECEIVING) return false;
+
+    if (stats.patch) {
+        if (!inflated) return fail("patch stream truncated");
+        PatchResult result = applier.finish();
+        if (result != PATCH_DONE) return fail(getPatchResultName(result));
+        stats.imageBytes = applier.getWritten();
+    } else {
+        stats.imageBytes = Update.progress();
+    }
+    release();
+
+    // The image is in flash but not yet bootable; only a signed one gets that far
+    if (!signature.verify()) return fail("signature mismatch");
+
+    // Validates the image and makes its partition the boot partition
+    if (!Update.end(true)) return fail(Update.errorString());
+
+    stats.elapsedMs = millis() - startMs;
+    stats.applyKBps = stats.elapsedMs ? stats.imageBytes / stats.elapsedMs : 0;   // Bytes per ms is KB/s
+    stats.state = OTA_READY;
+
+    Preferences prefs;
+    prefs.begin("ota", false);
+    prefs.putBool("pending", true);
+    prefs.putUChar("attempts", 0);
+    prefs.putString("fallback", esp_ota_get_running_partition()->label);
+    prefs.end();
+
+    Serial.printf("OTA: %s of %lu bytes written in %lu ms\n", stats.patch ? "patch" : "image",
+                  (unsigned long)stats.imageBytes, (unsigned long)stats.elapsedMs);
+    return true;
+}
+
+void OtaUpdater::abort() {
+    if (stats.state == OTA_RECEIVING) fail("upload aborted");
+}
+#endif
@@ -0,0 +1,210 @@
+#ifndef OTA_PATCH_H
+#define OTA_PATCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <mbedtls/md.h>
+#include "config.h"
+
+// Patches are made by tools/ota_patch/ota_patch.py.
+
+// ================= Patch format =================
+//
+//   header (24 bytes, little endian, uncompressed)
+//   zlib stream of operations:
+//     0x01 COPY    varint length, zigzag varint source offset delta
+//     0x02 INSERT  varint length, literal bytes
+//     0x00 END
+//
+// COPY reads from the running image starting at the source cursor plus
+// the delta; the cursor then moves past the copied bytes. Code that
+// shifts by a few bytes costs one small delta per copied run.
+
+#define PATCH_MAGIC 0x31504744UL      // "DGP1"
+#define PATCH_VERSION 1
+#define PATCH_HEADER_SIZE 24
+
+#define PATCH_OP_END 0x00
+#define PATCH_OP_COPY 0x01
+#define PATCH_OP_INSERT 0x02
+
+typedef struct {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t flags;
+    uint16_t reserved;
+    uint32_t sourceSize;            // Bytes of the running image the patch was made against
+    uint32_t sourceCrc;
+    uint32_t targetSize;
+    uint32_t targetCrc;
+} PatchHeader;
+
+typedef enum {
+    PATCH_OK,
+    PATCH_DONE,                     // END seen, size and CRC match
+    PATCH_BAD_HEADER,
+    PATCH_BAD_OP,
+    PATCH_SOURCE_RANGE,             // COPY outside the source image
+    PATCH_TARGET_OVERFLOW,          // More output than targetSize
+    PATCH_READ_FAILED,
+    PATCH_WRITE_FAILED,
+    PATCH_TRUNCATED,                // finish() before END
+    PATCH_CRC_MISMATCH
+} PatchResult;
+
+bool parsePatchHeader(const uint8_t* data, size_t length, PatchHeader& out);
+const char* getPatchResultName(PatchResult result);
+
+// CRC-32 (IEEE, as zlib.crc32), continued from a previous value
+uint32_t patchCrc32(uint32_t crc, const uint8_t* data, size_t length);
+
+// ================= Applier =================
+
+typedef bool (*PatchReadFn)(uint32_t offset, uint8_t* out, size_t length, void* context);
+typedef bool (*PatchWriteFn)(const uint8_t* data, size_t length, void* context);
+
+// Runs the decompressed operation stream against the source image,
+// handed over in pieces of any size. Holds one PATCH_COPY_CHUNK buffer;
+// output goes straight to the write callback.
+class PatchApplier {
+private:
+    enum State : uint8_t {
+        STATE_OP,
+        STATE_COPY_LENGTH,
+        STATE_COPY_OFFSET,
+        STATE_INSERT_LENGTH,
+        STATE_INSERT_DATA,
+        STATE_END
+    };
+
+    PatchHeader header;
+    PatchReadFn readSource;
+    PatchWriteFn writeTarget;
+    void* context;
+
+    State state;
+    uint32_t varint;
+    uint8_t varintShift;
+    uint32_t length;
+    uint32_t sourceCursor;
+    uint32_t written;
+    uint32_t crc;
+    PatchResult error;
+    uint8_t copyBuffer[PATCH_COPY_CHUNK];
+
+    bool takeVarint(uint8_t byte);
+    PatchResult copy(int32_t delta);
+    PatchResult emit(const uint8_t* data, size_t n);
+
+public:
+    PatchApplier();
+
+    void begin(const PatchHeader& patch, PatchReadFn read, PatchWriteFn write, void* context);
+    PatchResult feed(const uint8_t* ops, size_t n);
+    PatchResult finish();           // PATCH_DONE when the target is complete and intact
+
+    uint32_t getWritten() const { return written; }
+};
+
+// ================= Signature =================
+//
+// Every upload is signed with HMAC-SHA256 over all of its bytes, keyed
+// with OTA_SECRET, and the signature comes as 64 hex digits in the
+// X-OTA-Signature request header. The key itself never crosses the air,
+// so the AP password alone is not enough to flash the controller. The
+// HMAC is mbedtls's, on the hardware SHA engine; host tests link a
+// stand-in for it.
+
+#define OTA_SIGNATURE_SIZE 32
+#define OTA_SIGNATURE_HEADER "X-OTA-Signature"
+
+class OtaSignature {
+private:
+    mbedtls_md_context_t hmac;
+    uint8_t expected[OTA_SIGNATURE_SIZE];
+    bool started;
+
+public:
+    OtaSignature();
+    ~OtaSignature();
+
+    // False without a secret or with a signature that is not 64 hex digits
+    bool begin(const char* secret, const char* signatureHex);
+    void update(const uint8_t* data, size_t length);
+    // Constant time; false unless begin() succeeded
+    bool verify();
+};
+
+// ================= Updater =================
+
+#ifdef ARDUINO
+typedef enum {
+    OTA_IDLE,
+    OTA_RECEIVING,
+    OTA_READY,                      // Written and verified, restart pending
+    OTA_FAILED
+} OtaState;
+
+typedef struct {
+    uint8_t state;
+    bool patch;                     // Last upload was a patch, not a full image
+    uint32_t uploadBytes;
+    uint32_t imageBytes;            // Written to the inactive partition
+    uint32_t elapsedMs;
+    uint32_t applyKBps;             // Image bytes per second over the upload
+    uint8_t bootAttempts;           // Unconfirmed boots of the running image
+    uint16_t rollbacks;
+} OtaStats;
+
+// Receives a full image or a patch into the inactive app partition and
+// keeps the previous image bootable until the new one has run stall
+// free for OTA_CONFIRM_MS.
+class OtaUpdater {
+private:
+    PatchApplier applier;
+    OtaSignature signature;
+    PatchHeader header;
+    uint8_t headerBytes[PATCH_HEADER_SIZE];
+    uint8_t headerLength;
+    void* inflator;                 // tinfl_decompressor, only during a patch
+    uint8_t* window;                // Inflate dictionary, ditto
+    size_t windowOffset;
+    bool inflated;
+    const void* source;             // Running partition
+    uint32_t startMs;
+    bool pendingConfirm;
+    const char* error;
+    OtaStats stats;
+
+    bool fail(const char* reason);
+    bool startPatch();
+    bool inflate(const uint8_t* data, size_t length);
+    void release();
+
+    static bool readSource(uint32_t offset, uint8_t* out, size_t length, void* context);
+    static bool writeTarget(const uint8_t* data, size_t length, void* context);
+
+public:
+    OtaUpdater();
+
+    // Boot: counts unconfirmed boots and rolls back after too many
+    void begin();
+    void confirm();
+    bool isPendingConfirm() const { return pendingConfirm; }
+
+    // Upload, in the order the web server delivers it. Nothing is made
+    // bootable unless the signature matches the whole upload.
+    void start(const char* signatureHex);
+    bool write(const uint8_t* data, size_t length);
+    bool end();
+    void abort();
+
+    const char* getError() const { return error; }
+    const OtaStats& getStats() const { return stats; }
+    static const char* getStateName(uint8_t state);
+};
+
+extern OtaUpdater otaUpdater;
+#endif
+
+#endif // OTA_PATCH_H
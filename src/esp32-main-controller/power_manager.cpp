@@ -0,0 +1,348 @@
+#include "power_manager.h"
+#include <esp_sleep.h>
+#include <driver/gpio.h>
+#include <esp_pm.h>
+#include <esp_idf_version.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#if IMU_STILL_WAKE_HZ >= 40
+#define IMU_WAKE_FREQ MPU6050_WAKE_FREQ_40
+#elif IMU_STILL_WAKE_HZ >= 20
+#define IMU_WAKE_FREQ MPU6050_WAKE_FREQ_20
+#elif IMU_STILL_WAKE_HZ >= 5
+#define IMU_WAKE_FREQ MPU6050_WAKE_FREQ_5
+#else
+#define IMU_WAKE_FREQ MPU6050_WAKE_FREQ_1P25
+#endif
+
+PowerManager powerManager;
+
+static const char* const boostNames[BOOST_REASON_COUNT] = { "http", "fall", "gps" };
+static const uint32_t boostHoldMs[BOOST_REASON_COUNT] = {
+    DFS_HTTP_HOLD_MS, DFS_FALL_HOLD_MS, DFS_GPS_HOLD_MS
+};
+
+volatile bool PowerManager::motionPending = false;
+volatile uint32_t PowerManager::wakeMicros = 0;
+void* PowerManager::loopTask = NULL;
+
+PowerManager::PowerManager()
+    : imu(NULL), currentState(POWER_STATE_ACTIVE), stateSince(0),
+      boostsHeld(0), clockSince(0), boostTimer(onBoostTimer, this) {
+    memset(&stats, 0, sizeof(stats));
+    memset(&clockStats, 0, sizeof(clockStats));
+    for (uint8_t i = 0; i < BOOST_REASON_COUNT; i++) {
+        pmLocks[i] = NULL;
+        boostHeld[i] = false;
+        boostSince[i] = 0;
+        boostUntil[i] = 0;
+    }
+}
+
+void IRAM_ATTR PowerManager::onMotionInterrupt() {
+    if (!motionPending) wakeMicros = micros();
+    motionPending = true;
+
+    BaseType_t woken = pdFALSE;
+    if (loopTask) vTaskNotifyGiveFromISR((TaskHandle_t)loopTask, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+void PowerManager::begin(MPU6050& mpu) {
+    imu = &mpu;
+    loopTask = xTaskGetCurrentTaskHandle();
+    stateSince = millis();
+
+    // Motion detection runs on the high-pass filtered accelerometer. The
+    // interrupt is latched until INT_STATUS is read so it can also serve as
+    // a level-triggered light-sleep wake source.
+    imu->setDHPFMode(MPU6050_DHPF_5);
+    imu->setMotionDetectionThreshold(IMU_MOTION_THRESHOLD);
+    imu->setMotionDetectionDuration(IMU_MOTION_DURATION);
+    imu->setInterruptMode(false);       // Active high
+    imu->setInterruptDrive(false);      // Push-pull
+    imu->setInterruptLatch(true);
+    imu->setInterruptLatchClear(false);
+    imu->setIntMotionEnabled(true);
+    configureFullRate();
+
+    pinMode(MPU_INT_PIN, INPUT);
+    attachInterrupt(digitalPinToInterrupt(MPU_INT_PIN), onMotionInterrupt, RISING);
+
+    beginClockPolicy();
+}
+
+void PowerManager::configureFullRate() {
+    // 1 kHz gyro output with the DLPF enabled, divided down to the full rate
+    imu->setWakeCycleEnabled(false);
+    imu->setStandbyXGyroEnabled(false);
+    imu->setStandbyYGyroEnabled(false);
+    imu->setStandbyZGyroEnabled(false);
+    imu->setTempSensorEnabled(true);
+    imu->setDLPFMode(MPU6050_DLPF_BW_42);
+    imu->setRate(1000 / IMU_FULL_RATE_HZ - 1);
+}
+
+void PowerManager::configureStill() {
+    // Accelerometer-only low-power cycle mode: the gyro and temperature
+    // sensor are parked and the accelerometer wakes at IMU_STILL_WAKE_HZ
+    imu->setStandbyXGyroEnabled(true);
+    imu->setStandbyYGyroEnabled(true);
+    imu->setStandbyZGyroEnabled(true);
+    imu->setTempSensorEnabled(false);
+    imu->setWakeFrequency(IMU_WAKE_FREQ);
+    imu->setWakeCycleEnabled(true);
+}
+
+void PowerManager::accountState(uint32_t now) {
+    uint32_t elapsed = now - stateSince;
+    if (currentState == POWER_STATE_STILL) {
+        stats.stillMs += elapsed;
+    } else {
+        stats.activeMs += elapsed;
+    }
+    stateSince = now;
+}
+
+void PowerManager::enterStill() {
+    if (!LOW_POWER_ENABLED || !imu || currentState == POWER_STATE_STILL) return;
+
+    accountState(millis());
+    configureStill();
+
+    // Drop any motion latched while we were active
+    imu->getIntStatus();
+    motionPending = false;
+
+    currentState = POWER_STATE_STILL;
+    stats.stillEntries++;
+}
+
+void PowerManager::exitStill() {
+    if (currentState != POWER_STATE_STILL) return;
+
+    accountState(millis());
+    configureFullRate();
+    imu->getIntStatus();
+    motionPending = false;
+
+    currentState = POWER_STATE_ACTIVE;
+    stats.motionWakes++;
+}
+
+bool PowerManager::isStill() {
+    return currentState == POWER_STATE_STILL;
+}
+
+bool PowerManager::hasMotion() {
+    return motionPending || digitalRead(MPU_INT_PIN) == HIGH;
+}
+
+PowerState PowerManager::getState() {
+    return currentState;
+}
+
+void PowerManager::lightSleep(uint32_t maxMs) {
+    if (maxMs > LOW_POWER_MAX_SLEEP_MS) maxMs = LOW_POWER_MAX_SLEEP_MS;
+
+    // The latched INT line is level-triggered here, so motion that arrives
+    // while we are going to sleep still wakes us immediately
+    gpio_wakeup_enable((gpio_num_t)MPU_INT_PIN, GPIO_INTR_HIGH_LEVEL);
+    esp_sleep_enable_gpio_wakeup();
+    esp_sleep_enable_timer_wakeup((uint64_t)maxMs * 1000);
+
+    uint32_t start = millis();
+    esp_light_sleep_start();
+    stats.lightSleepMs += millis() - start;
+    stats.lightSleeps++;
+
+    if (esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_GPIO) {
+        if (!motionPending) wakeMicros = micros();
+        motionPending = true;
+    }
+    gpio_wakeup_disable((gpio_num_t)MPU_INT_PIN);
+    // gpio_wakeup_enable() switched the pin to level-triggered; put back the
+    // rising edge begin() attached, or the still-latched line would fire the
+    // ISR on every return until exitStill() clears it
+    gpio_set_intr_type((gpio_num_t)MPU_INT_PIN, GPIO_INTR_POSEDGE);
+}
+
+void PowerManager::idle(bool allowLightSleep, uint32_t maxMs) {
+    if (hasMotion() || maxMs == 0) return;
+
+    if (LIGHT_SLEEP_ENABLED && allowLightSleep) {
+        lightSleep(maxMs);
+    } else {
+        // Blocks the loop task; the motion ISR notifies it immediately.
+        // The AP keeps beaconing, so stations stay attached.
+        if (maxMs > LOW_POWER_IDLE_POLL_MS) maxMs = LOW_POWER_IDLE_POLL_MS;
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(maxMs));
+    }
+}
+
+void PowerManager::noteSample() {
+    if (wakeMicros == 0) return;
+
+    uint32_t latency = micros() - wakeMicros;
+    wakeMicros = 0;
+    stats.lastWakeLatencyUs = latency;
+    if (latency > stats.maxWakeLatencyUs) stats.maxWakeLatencyUs = latency;
+
+    if (latency > (uint32_t)LOW_POWER_WAKE_BUDGET_MS * 1000 && DEBUG_ENABLED) {
+        Serial.printf("Power: wake-to-sample %lu us over budget\n", (unsigned long)latency);
+    }
+}
+
+// ================= Clock policy =================
+
+void PowerManager::beginClockPolicy() {
+    clockSince = millis();
+    if (!DFS_ENABLED) return;
+
+    // esp_pm needs CONFIG_PM_ENABLE in the core's sdkconfig. Without it we
+    // fall back to switching the clock ourselves when the first lock is
+    // taken and the last one released.
+#if ESP_IDF_VERSION_MAJOR >= 5
+    esp_pm_config_t config;
+#else
+    esp_pm_config_esp32_t config;
+#endif
+    config.max_freq_mhz = DFS_MAX_FREQ_MHZ;
+    config.min_freq_mhz = DFS_MIN_FREQ_MHZ;
+    config.light_sleep_enable = false;      // Light sleep is entered explicitly
+    clockStats.pmSupported = esp_pm_configure(&config) == ESP_OK;
+
+    if (clockStats.pmSupported) {
+        for (uint8_t i = 0; i < BOOST_REASON_COUNT; i++) {
+            esp_pm_lock_handle_t lock = NULL;
+            if (esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, boostNames[i], &lock) == ESP_OK) {
+                pmLocks[i] = lock;
+            }
+        }
+    } else {
+        setCpuFrequencyMhz(DFS_MIN_FREQ_MHZ);
+    }
+}
+
+void PowerManager::accountClock(uint32_t now) {
+    uint32_t elapsed = now - clockSince;
+    if (boostsHeld > 0 || !DFS_ENABLED) {
+        clockStats.highClockMs += elapsed;
+    } else {
+        clockStats.lowClockMs += elapsed;
+    }
+    clockSince = now;
+}
+
+void PowerManager::boost(BoostReason reason) {
+    uint32_t now = millis();
+    boostUntil[reason] = now + boostHoldMs[reason];
+    if (!DFS_ENABLED || boostHeld[reason]) return;
+
+    boostHeld[reason] = true;
+    boostSince[reason] = now;
+    clockStats.boosts[reason]++;
+
+    if (boostsHeld == 0) {
+        accountClock(now);
+        if (!clockStats.pmSupported) setCpuFrequencyMhz(DFS_MAX_FREQ_MHZ);
+    }
+    boostsHeld++;
+    if (pmLocks[reason]) esp_pm_lock_acquire((esp_pm_lock_handle_t)pmLocks[reason]);
+
+    if (!boostTimer.isActive() || (int32_t)(boostUntil[reason] - boostTimer.getExpiry()) < 0) {
+        timerService.start(boostTimer, boostHoldMs[reason]);
+    }
+}
+
+void PowerManager::onBoostTimer(void* context) {
+    static_cast<PowerManager*>(context)->updateBoosts();
+}
+
+void PowerManager::releaseBoost(BoostReason reason, uint32_t now) {
+    boostHeld[reason] = false;
+    clockStats.boostMs[reason] += now - boostSince[reason];
+    if (pmLocks[reason]) esp_pm_lock_release((esp_pm_lock_handle_t)pmLocks[reason]);
+
+    if (boostsHeld == 1) {
+        accountClock(now);
+        if (!clockStats.pmSupported) setCpuFrequencyMhz(DFS_MIN_FREQ_MHZ);
+    }
+    boostsHeld--;
+}
+
+void PowerManager::updateBoosts() {
+    if (boostsHeld == 0) return;
+
+    uint32_t now = millis();
+    int32_t nextExpiry = INT32_MAX;
+    for (uint8_t i = 0; i < BOOST_REASON_COUNT; i++) {
+        if (!boostHeld[i]) continue;
+
+        int32_t remaining = (int32_t)(boostUntil[i] - now);
+        if (remaining <= 0) {
+            releaseBoost((BoostReason)i, now);
+        } else if (remaining < nextExpiry) {
+            nextExpiry = remaining;
+        }
+    }
+
+    // Holds extended since the timer was armed
+    if (boostsHeld > 0) timerService.start(boostTimer, nextExpiry);
+}
+
+bool PowerManager::isBoosted() {
+    return boostsHeld > 0;
+}
+
+void PowerManager::noteFallPath(uint32_t elapsedUs) {
+    clockStats.lastFallPathUs = elapsedUs;
+    if (elapsedUs > clockStats.maxFallPathUs) clockStats.maxFallPathUs = elapsedUs;
+
+    // The fall path has to finish within one full-rate IMU sample period
+    if (elapsedUs > 1000000UL / IMU_FULL_RATE_HZ) clockStats.fallPathOverruns++;
+}
+
+const char* PowerManager::getBoostName(BoostReason reason) {
+    return boostNames[reason];
+}
+
+ClockStats PowerManager::getClockStats() {
+    accountClock(millis());
+
+    ClockStats snapshot = clockStats;
+    uint32_t now = millis();
+    for (uint8_t i = 0; i < BOOST_REASON_COUNT; i++) {
+        if (boostHeld[i]) snapshot.boostMs[i] += now - boostSince[i];
+    }
+    return snapshot;
+}
+
+float PowerManager::estimateBatteryHours(bool withPolicy) {
+    // Without the policy the CPU would have run at full clock throughout
+    float averageMa = CURRENT_MAX_FREQ_MA;
+    if (withPolicy) {
+        ClockStats s = getClockStats();
+        uint32_t total = s.lowClockMs + s.highClockMs;
+        if (total > 0) {
+            averageMa = ((float)s.highClockMs * CURRENT_MAX_FREQ_MA +
+                         (float)s.lowClockMs * CURRENT_MIN_FREQ_MA) / total;
+        }
+    }
+    return BATTERY_CAPACITY_MAH / averageMa;
+}
+
+PowerStats PowerManager::getStats() {
+    accountState(millis());
+    return stats;
+}
+
+void PowerManager::printStatus() {
+    PowerStats s = getStats();
+    Serial.printf("Power: %s, active %lu ms, still %lu ms (sleep %lu ms), wakes %lu, wake latency %lu/%lu us\n",
+                  isStill() ? "still" : "active",
+                  (unsigned long)s.activeMs, (unsigned long)s.stillMs,
+                  (unsigned long)s.lightSleepMs, (unsigned long)s.motionWakes,
+                  (unsigned long)s.lastWakeLatencyUs, (unsigned long)s.maxWakeLatencyUs);
+}
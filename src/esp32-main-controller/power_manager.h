@@ -0,0 +1,124 @@
+#ifndef POWER_MANAGER_H
+#define POWER_MANAGER_H
+
+#include <Arduino.h>
+#include <MPU6050.h>
+#include "config.h"
+#include "soft_timer.h"
+
+// In still mode the IMU only reports motion at IMU_STILL_WAKE_HZ. The
+// resulting detection delay plus the wake path has to leave most of the
+// free-fall window for full-rate sampling, or a fall could be missed.
+#if (1000 / IMU_STILL_WAKE_HZ) + LOW_POWER_WAKE_BUDGET_MS >= FALL_WINDOW_MS / 2
+#error "IMU_STILL_WAKE_HZ is too slow to catch the free-fall phase of a fall"
+#endif
+
+// Power states
+typedef enum {
+    POWER_STATE_ACTIVE,     // Full-rate IMU, loop running freely
+    POWER_STATE_STILL       // Accel-only cycle mode, loop blocked on motion
+} PowerState;
+
+// Reasons for holding the CPU at full clock
+typedef enum {
+    BOOST_HTTP,
+    BOOST_FALL,
+    BOOST_GPS,
+    BOOST_REASON_COUNT
+} BoostReason;
+
+// Clock policy statistics
+typedef struct {
+    bool pmSupported;               // esp_pm available, else manual switching
+    uint32_t lowClockMs;
+    uint32_t highClockMs;
+    uint32_t boosts[BOOST_REASON_COUNT];
+    uint32_t boostMs[BOOST_REASON_COUNT];
+    uint32_t lastFallPathUs;
+    uint32_t maxFallPathUs;
+    uint32_t fallPathOverruns;
+} ClockStats;
+
+// Power statistics
+typedef struct {
+    uint32_t activeMs;
+    uint32_t stillMs;
+    uint32_t lightSleepMs;
+    uint32_t stillEntries;
+    uint32_t motionWakes;
+    uint32_t lightSleeps;
+    uint32_t lastWakeLatencyUs;
+    uint32_t maxWakeLatencyUs;
+} PowerStats;
+
+class PowerManager {
+private:
+    MPU6050* imu;
+    PowerState currentState;
+    uint32_t stateSince;
+    PowerStats stats;
+
+    // Set from the motion ISR
+    static volatile bool motionPending;
+    static volatile uint32_t wakeMicros;
+    static void* loopTask;
+    static void IRAM_ATTR onMotionInterrupt();
+
+    // Clock policy
+    ClockStats clockStats;
+    void* pmLocks[BOOST_REASON_COUNT];
+    bool boostHeld[BOOST_REASON_COUNT];
+    uint32_t boostSince[BOOST_REASON_COUNT];
+    uint32_t boostUntil[BOOST_REASON_COUNT];
+    uint8_t boostsHeld;
+    uint32_t clockSince;
+    SoftTimer boostTimer;           // Earliest boost expiry
+    static void onBoostTimer(void* context);
+
+    void beginClockPolicy();
+    void accountClock(uint32_t now);
+    void releaseBoost(BoostReason reason, uint32_t now);
+
+    void configureFullRate();
+    void configureStill();
+    void accountState(uint32_t now);
+    void lightSleep(uint32_t maxMs);
+
+public:
+    PowerManager();
+
+    // Initialization
+    void begin(MPU6050& mpu);
+
+    // State management
+    void enterStill();
+    void exitStill();
+    bool isStill();
+    bool hasMotion();
+    PowerState getState();
+
+    // Blocks until motion or maxMs: in light sleep if allowed (the AP is
+    // not needed), otherwise on the motion ISR with the radio in modem sleep
+    void idle(bool allowLightSleep, uint32_t maxMs);
+
+    // Call after every IMU read to measure the wake-to-first-sample latency
+    void noteSample();
+
+    // Clock policy: hold the full clock for a while after each event.
+    // Holds are released from a soft timer; call from the main task.
+    void boost(BoostReason reason);
+    void updateBoosts();
+    bool isBoosted();
+    void noteFallPath(uint32_t elapsedUs);
+    static const char* getBoostName(BoostReason reason);
+
+    // Diagnostics
+    PowerStats getStats();
+    ClockStats getClockStats();
+    float estimateBatteryHours(bool withPolicy);
+    void printStatus();
+};
+
+extern PowerManager powerManager;
+
+#endif // POWER_MANAGER_H
@@ -0,0 +1,93 @@
+#include "rate_limiter.h"
+#include <string.h>
+
+#define SLOT_MASK (RATE_LIMIT_SLOTS - 1)
+#define BUCKET_CAPACITY_MS ((uint32_t)RATE_LIMIT_BURST * API_RATE_LIMIT_MS)
+
+// An aged-out client would have refilled completely anyway
+#if RATE_LIMIT_IDLE_MS < RATE_LIMIT_BURST * API_RATE_LIMIT_MS
+#error "RATE_LIMIT_IDLE_MS must cover a full bucket refill"
+#endif
+
+RateLimiter::RateLimiter() {
+    memset(table, 0, sizeof(table));
+    memset(&stats, 0, sizeof(stats));
+}
+
+RateBucket* RateLimiter::lookup(uint32_t ip, uint32_t nowMs) {
+    // Clients on one subnet differ only in the last octet, the high byte
+    // in network order, so mix every bit down into the slot index
+    uint32_t h = ip ^ (ip >> 16);
+    h *= 0x85EBCA6BUL;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35UL;
+    h ^= h >> 16;
+    uint32_t start = h & SLOT_MASK;
+    RateBucket* reusable = NULL;
+    RateBucket* oldest = NULL;
+
+    for (uint8_t k = 0; k < RATE_LIMIT_PROBES; k++) {
+        RateBucket& b = table[(start + k) & SLOT_MASK];
+        if (b.ip == ip) return &b;
+
+        // Slots are never freed, so the client cannot be further along
+        if (b.ip == 0) {
+            if (!reusable) reusable = &b;
+            break;
+        }
+
+        if (!reusable && nowMs - b.lastSeenMs >= RATE_LIMIT_IDLE_MS) reusable = &b;
+        if (!oldest || (int32_t)(b.lastSeenMs - oldest->lastSeenMs) < 0) oldest = &b;
+    }
+
+    // New client: a free or idle slot, else push out the least recently
+    // seen one in the window
+    RateBucket* slot;
+    if (reusable) {
+        if (reusable->ip) stats.reused++;
+        slot = reusable;
+    } else {
+        stats.evictions++;
+        slot = oldest;
+    }
+    slot->ip = ip;
+    slot->creditMs = BUCKET_CAPACITY_MS;
+    slot->lastSeenMs = nowMs;
+    return slot;
+}
+
+bool RateLimiter::allow(uint32_t ip, uint32_t nowMs, uint32_t* retryAfterMs) {
+    // No peer address to key on
+    if (ip == 0) {
+        stats.allowed++;
+        return true;
+    }
+
+    RateBucket* b = lookup(ip, nowMs);
+    uint32_t elapsed = nowMs - b->lastSeenMs;
+    b->creditMs = elapsed >= BUCKET_CAPACITY_MS - b->creditMs ? BUCKET_CAPACITY_MS
+                                                              : b->creditMs + elapsed;
+    b->lastSeenMs = nowMs;
+
+    if (b->creditMs < API_RATE_LIMIT_MS) {
+        stats.throttled++;
+        if (retryAfterMs) *retryAfterMs = API_RATE_LIMIT_MS - b->creditMs;
+        return false;
+    }
+
+    b->creditMs -= API_RATE_LIMIT_MS;
+    stats.allowed++;
+    return true;
+}
+
+uint8_t RateLimiter::getActiveClients(uint32_t nowMs) const {
+    uint8_t active = 0;
+    for (uint8_t i = 0; i < RATE_LIMIT_SLOTS; i++) {
+        if (table[i].ip && nowMs - table[i].lastSeenMs < RATE_LIMIT_IDLE_MS) active++;
+    }
+    return active;
+}
+
+#ifdef ARDUINO
+RateLimiter rateLimiter;
+#endif
@@ -0,0 +1,59 @@
+#ifndef RATE_LIMITER_H
+#define RATE_LIMITER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "config.h"
+
+#if (RATE_LIMIT_SLOTS & (RATE_LIMIT_SLOTS - 1)) != 0
+#error "RATE_LIMIT_SLOTS must be a power of two"
+#endif
+
+#if RATE_LIMIT_PROBES > RATE_LIMIT_SLOTS
+#error "RATE_LIMIT_PROBES must not exceed RATE_LIMIT_SLOTS"
+#endif
+
+// One client's token bucket. Credit is kept in milliseconds of refill
+// time, so a request costs API_RATE_LIMIT_MS and refill is just elapsed
+// time, with no division.
+typedef struct {
+    uint32_t ip;                    // IPv4 in network order, 0 for a free slot
+    uint32_t creditMs;
+    uint32_t lastSeenMs;
+} RateBucket;
+
+// Rate limiter statistics
+typedef struct {
+    uint32_t allowed;
+    uint32_t throttled;
+    uint32_t evictions;             // Live clients pushed out by a new one
+    uint32_t reused;                // Idle slots taken over
+} RateLimitStats;
+
+// Fixed-size open-addressing table of per-client token buckets. Slots are
+// never emptied, only aged out, so a lookup scans at most
+// RATE_LIMIT_PROBES slots and stops at the first free one.
+class RateLimiter {
+private:
+    RateBucket table[RATE_LIMIT_SLOTS];
+    RateLimitStats stats;
+
+    RateBucket* lookup(uint32_t ip, uint32_t nowMs);
+
+public:
+    RateLimiter();
+
+    // Takes a token for this client; false when it is over its rate. On
+    // refusal, retryAfterMs is when the next token is due.
+    bool allow(uint32_t ip, uint32_t nowMs, uint32_t* retryAfterMs = NULL);
+
+    // Clients seen within RATE_LIMIT_IDLE_MS
+    uint8_t getActiveClients(uint32_t nowMs) const;
+
+    RateLimitStats getStats() const { return stats; }
+    static size_t getTableBytes() { return sizeof(RateBucket) * RATE_LIMIT_SLOTS; }
+};
+
+extern RateLimiter rateLimiter;
+
+#endif // RATE_LIMITER_H
@@ -0,0 +1,114 @@
+#include "response_cache.h"
+#include <string.h>
+
+#ifdef ARDUINO
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#define CACHE_WAIT() vTaskDelay(1)
+#else
+#include <thread>
+#define CACHE_WAIT() std::this_thread::yield()
+#endif
+
+DataVersions::DataVersions() {
+    for (uint8_t i = 0; i < DATA_SOURCE_COUNT; i++) versions[i].store(0);
+}
+
+ResponseCache::ResponseCache()
+    : defs(NULL), count(0), versions(NULL), clock(NULL) {
+    for (uint8_t i = 0; i < RESPONSE_CACHE_ENTRIES; i++) {
+        entries[i].length = 0;
+        entries[i].valid = false;
+        entries[i].locked.store(false);
+        memset(entries[i].tags, 0, sizeof(entries[i].tags));
+        memset(&entries[i].stats, 0, sizeof(entries[i].stats));
+    }
+}
+
+void ResponseCache::setTable(const CacheDef* table, uint8_t tableCount, DataVersions& dataVersions,
+                             uint32_t (*clockUs)()) {
+    defs = table;
+    count = tableCount;
+    versions = &dataVersions;
+    clock = clockUs;
+    for (uint8_t i = 0; i < count; i++) invalidate(i);
+}
+
+bool ResponseCache::isFresh(const CacheDef& def, const Entry& entry) const {
+    if (!entry.valid) return false;
+    for (uint8_t s = 0; s < DATA_SOURCE_COUNT; s++) {
+        if ((def.depends & DATA_BIT(s)) && entry.tags[s] != versions->get((DataSource)s)) return false;
+    }
+    return true;
+}
+
+// JsonStream sink: copies into the entry, length past the end marks overflow
+void ResponseCache::append(const char* data, size_t length, void* context) {
+    Entry& entry = *static_cast<Entry*>(context);
+    if (entry.length + length <= RESPONSE_CACHE_BODY_BYTES) {
+        memcpy(entry.body + entry.length, data, length);
+    }
+    size_t total = entry.length + length;
+    entry.length = total > UINT16_MAX ? UINT16_MAX : total;
+}
+
+const char* ResponseCache::acquire(uint8_t id, uint16_t* length) {
+    if (id >= count) return NULL;
+    const CacheDef& def = defs[id];
+    Entry& entry = entries[id];
+
+    // Only contended when a body is asked for from two tasks at once; the
+    // web server itself runs requests one at a time
+    bool waited = false;
+    while (entry.locked.exchange(true, std::memory_order_acquire)) {
+        waited = true;
+        CACHE_WAIT();
+    }
+
+    if (isFresh(def, entry)) {
+        if (waited) entry.stats.coalesced++;
+        else entry.stats.hits++;
+        entry.stats.savedUs += entry.stats.lastBuildUs;
+        *length = entry.length;
+        return entry.body;
+    }
+
+    // Versions are read before the body so a change while writing leaves
+    // it stale rather than mislabelled
+    for (uint8_t s = 0; s < DATA_SOURCE_COUNT; s++) entry.tags[s] = versions->get((DataSource)s);
+    entry.length = 0;
+
+    uint32_t start = clock();
+    JsonStream json(append, &entry);
+    def.writer(json);
+    json.finish();
+    uint32_t elapsed = clock() - start;
+
+    entry.stats.builds++;
+    entry.stats.lastBuildUs = elapsed;
+    if (elapsed > entry.stats.maxBuildUs) entry.stats.maxBuildUs = elapsed;
+
+    entry.valid = entry.length <= RESPONSE_CACHE_BODY_BYTES;
+    if (!entry.valid) {
+        entry.stats.overflows++;
+        release(id);
+        return NULL;
+    }
+    *length = entry.length;
+    return entry.body;
+}
+
+void ResponseCache::release(uint8_t id) {
+    entries[id].locked.store(false, std::memory_order_release);
+}
+
+void ResponseCache::invalidate(uint8_t id) {
+    if (id < RESPONSE_CACHE_ENTRIES) entries[id].valid = false;
+}
+
+// ================= Device =================
+
+#ifdef ARDUINO
+DataVersions dataVersions;
+ResponseCache responseCache;
+#endif
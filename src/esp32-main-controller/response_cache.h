@@ -0,0 +1,111 @@
+#ifndef RESPONSE_CACHE_H
+#define RESPONSE_CACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include "config.h"
+#include "json_stream.h"
+
+// ================= Data versions =================
+
+// Subsystems a response can depend on. Each has a counter that its owner
+// bumps whenever the values it reports change.
+typedef enum {
+    DATA_GPS,                       // Fix acquired or lost
+    DATA_BATTERY,                   // Battery percentage
+    DATA_FALL,                      // Fall time, inactivity alert
+    DATA_MOTION,                    // Active or still
+    DATA_CONFIG,                    // Runtime configuration
+    DATA_CLIENTS,                   // AP station count
+    DATA_SOURCE_COUNT
+} DataSource;
+
+#define DATA_BIT(source) (1U << (source))
+
+// Bumped from the loop and the WiFi event task
+class DataVersions {
+private:
+    std::atomic<uint32_t> versions[DATA_SOURCE_COUNT];
+
+public:
+    DataVersions();
+    void bump(DataSource source) { versions[source].fetch_add(1, std::memory_order_release); }
+    uint32_t get(DataSource source) const { return versions[source].load(std::memory_order_acquire); }
+};
+
+extern DataVersions dataVersions;
+
+// ================= Cache =================
+
+typedef void (*BodyWriter)(JsonStream& json);
+
+// One cached response: the writer that produces its body and the sources
+// it reads
+typedef struct {
+    const char* path;               // For reporting
+    BodyWriter writer;
+    uint8_t depends;                // DATA_BIT() mask
+} CacheDef;
+
+// Per-response counters
+typedef struct {
+    uint32_t hits;                  // Served from the stored body
+    uint32_t builds;                // Body regenerated
+    uint32_t coalesced;             // Waited for, and shared, a body another caller built
+    uint32_t overflows;             // Body larger than RESPONSE_CACHE_BODY_BYTES
+    uint32_t lastBuildUs;
+    uint32_t maxBuildUs;
+    uint32_t savedUs;               // Build time not spent thanks to hits
+} CacheStats;
+
+// Serialized bodies tagged with the versions of the sources they were
+// built from. A body is rebuilt only when one of those versions has moved;
+// until then every request shares it. A caller holds the entry from
+// acquire() until release(), so a request that arrives while a body is
+// being built waits for it instead of building it again.
+class ResponseCache {
+private:
+    struct Entry {
+        char body[RESPONSE_CACHE_BODY_BYTES];
+        uint16_t length;
+        bool valid;
+        std::atomic<bool> locked;
+        uint32_t tags[DATA_SOURCE_COUNT];
+        CacheStats stats;
+    };
+
+    const CacheDef* defs;
+    uint8_t count;
+    Entry entries[RESPONSE_CACHE_ENTRIES];
+    DataVersions* versions;
+    uint32_t (*clock)();
+
+    bool isFresh(const CacheDef& def, const Entry& entry) const;
+    static void append(const char* data, size_t length, void* context);
+
+public:
+    ResponseCache();
+
+    template <size_t N>
+    void begin(const CacheDef (&table)[N], DataVersions& dataVersions, uint32_t (*clockUs)()) {
+        static_assert(N <= RESPONSE_CACHE_ENTRIES, "Raise RESPONSE_CACHE_ENTRIES");
+        setTable(table, N, dataVersions, clockUs);
+    }
+    void setTable(const CacheDef* table, uint8_t count, DataVersions& dataVersions,
+                  uint32_t (*clockUs)());
+
+    // The current body, rebuilt first if a dependency changed. NULL (and
+    // nothing to release) if it does not fit; the caller then writes the
+    // response directly.
+    const char* acquire(uint8_t id, uint16_t* length);
+    void release(uint8_t id);
+    void invalidate(uint8_t id);
+
+    uint8_t getCount() const { return count; }
+    const CacheStats& getStats(uint8_t id) const { return entries[id].stats; }
+};
+
+extern ResponseCache responseCache;
+
+#endif // RESPONSE_CACHE_H
@@ -0,0 +1,75 @@
+#include "route_table.h"
+#include <string.h>
+
+#define ROUTE_FIRST_BUCKET_BITS 7       // Bucket 0 is below 128 us
+
+Router::Router()
+    : routes(NULL), routeCount(0), index(NULL), clock(NULL), misses(0) {
+    memset(stats, 0, sizeof(stats));
+}
+
+void Router::setTable(const RouteDef* table, uint8_t count, const RouteIndex& routeIndex,
+                      uint32_t (*clockUs)()) {
+    routes = table;
+    routeCount = count;
+    index = &routeIndex;
+    clock = clockUs;
+    memset(stats, 0, sizeof(stats));
+    misses = 0;
+}
+
+int Router::find(RouteMethod method, const char* path) const {
+    if (!index) return -1;
+
+    // The slot names the only candidate; one compare rules out paths that
+    // are not in the table but hash to an occupied slot
+    int8_t i = index->slots[routeSlot(index->seed, method, path)];
+    if (i < 0 || routes[i].method != method || strcmp(routes[i].path, path) != 0) return -1;
+    return i;
+}
+
+bool Router::dispatch(RouteMethod method, const char* path) {
+    int i = find(method, path);
+    if (i < 0) {
+        noteMiss();
+        return false;
+    }
+    run(i);
+    return true;
+}
+
+void Router::run(uint8_t route) {
+    uint32_t start = clock();
+    routes[route].handler();
+    uint32_t elapsed = clock() - start;
+
+    RouteStats& s = stats[route];
+    s.count++;
+    s.totalUs += elapsed;
+    if (elapsed > s.maxUs) s.maxUs = elapsed;
+
+    uint8_t bucket = 0;
+    while (bucket < ROUTE_LATENCY_BUCKETS - 1 && elapsed >= getBucketLimitUs(bucket)) bucket++;
+    s.histogram[bucket]++;
+}
+
+// Upper bound of a histogram bucket; the last one is open ended
+uint32_t Router::getBucketLimitUs(uint8_t bucket) {
+    if (bucket >= ROUTE_LATENCY_BUCKETS - 1) return UINT32_MAX;
+    return 1UL << (ROUTE_FIRST_BUCKET_BITS + bucket);
+}
+
+const char* Router::getMethodName(RouteMethod method) {
+    switch (method) {
+        case ROUTE_GET: return "GET";
+        case ROUTE_POST: return "POST";
+        case ROUTE_PUT: return "PUT";
+        case ROUTE_DELETE: return "DELETE";
+        case ROUTE_OPTIONS: return "OPTIONS";
+        default: return "?";
+    }
+}
+
+#ifdef ARDUINO
+Router apiRouter;
+#endif
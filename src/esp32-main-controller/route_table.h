@@ -0,0 +1,172 @@
+#ifndef ROUTE_TABLE_H
+#define ROUTE_TABLE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "config.h"
+
+// Written as C++11 constexpr (single return, recursion) so the index is
+// generated by any toolchain the sketch builds with.
+
+#define ROUTE_TABLE_SLOTS (1 << ROUTE_TABLE_BITS)
+#define ROUTE_NO_SEED 0xFFFFFFFFUL
+
+#if ROUTE_MAX_ROUTES > 127
+#error "ROUTE_MAX_ROUTES must fit the int8_t slot index"
+#endif
+
+typedef enum {
+    ROUTE_GET,
+    ROUTE_POST,
+    ROUTE_PUT,
+    ROUTE_DELETE,
+    ROUTE_OPTIONS,
+    ROUTE_METHOD_COUNT
+} RouteMethod;
+
+typedef void (*RouteHandler)();
+
+// Route flags
+#define ROUTE_FLAG_NO_RATE_LIMIT 0x01   // Never throttled (emergency endpoints)
+
+// One endpoint of a constexpr route table
+typedef struct {
+    RouteMethod method;
+    const char* path;
+    RouteHandler handler;
+    uint8_t flags;
+} RouteDef;
+
+// Perfect hash for one route table: every route lands in its own slot
+typedef struct {
+    uint32_t seed;
+    int8_t slots[ROUTE_TABLE_SLOTS];    // Route index, -1 for empty
+} RouteIndex;
+
+// Per-endpoint statistics
+typedef struct {
+    uint32_t count;
+    uint32_t totalUs;
+    uint32_t maxUs;
+    uint32_t histogram[ROUTE_LATENCY_BUCKETS];
+} RouteStats;
+
+// ================= Hash =================
+
+// FNV-1a over method and path, seeded, with a final multiply so the top
+// bits used as the slot depend on every character
+constexpr uint32_t routeHashStep(uint32_t hash, const char* path) {
+    return *path ? routeHashStep((hash ^ (uint8_t)*path) * 16777619UL, path + 1) : hash;
+}
+
+constexpr uint32_t routeAvalanche(uint32_t hash) {
+    return (hash ^ (hash >> 15)) * 0x2C1B3C6DUL;
+}
+
+constexpr uint32_t routeHash(uint32_t seed, RouteMethod method, const char* path) {
+    return routeAvalanche(routeHashStep(((2166136261UL + seed * 0x9E3779B9UL) ^ method) * 16777619UL, path));
+}
+
+constexpr uint32_t routeSlot(uint32_t seed, RouteMethod method, const char* path) {
+    return (routeHash(seed, method, path) >> (32 - ROUTE_TABLE_BITS)) & (ROUTE_TABLE_SLOTS - 1);
+}
+
+// ================= Seed search =================
+
+constexpr uint32_t routeSlotOf(const RouteDef* routes, uint32_t seed, size_t i) {
+    return routeSlot(seed, routes[i].method, routes[i].path);
+}
+
+constexpr bool routeDistinctFrom(const RouteDef* routes, size_t count, uint32_t seed, size_t i, size_t j) {
+    return j >= count ||
+           (routeSlotOf(routes, seed, i) != routeSlotOf(routes, seed, j) &&
+            routeDistinctFrom(routes, count, seed, i, j + 1));
+}
+
+constexpr bool routesDistinct(const RouteDef* routes, size_t count, uint32_t seed, size_t i) {
+    return i >= count ||
+           (routeDistinctFrom(routes, count, seed, i, i + 1) &&
+            routesDistinct(routes, count, seed, i + 1));
+}
+
+// First seed that separates every route, ROUTE_NO_SEED if none within the
+// limit (duplicate routes never separate)
+constexpr uint32_t findRouteSeed(const RouteDef* routes, size_t count, uint32_t seed) {
+    return seed >= ROUTE_SEED_LIMIT ? ROUTE_NO_SEED :
+           routesDistinct(routes, count, seed, 0) ? seed :
+           findRouteSeed(routes, count, seed + 1);
+}
+
+constexpr int8_t routeInSlot(const RouteDef* routes, size_t count, uint32_t seed, uint32_t slot, size_t i) {
+    return i >= count ? -1 :
+           routeSlotOf(routes, seed, i) == slot ? (int8_t)i :
+           routeInSlot(routes, count, seed, slot, i + 1);
+}
+
+// ================= Index =================
+
+template <size_t... I> struct RouteSlotList {};
+template <size_t N, size_t... I> struct MakeRouteSlots : MakeRouteSlots<N - 1, N - 1, I...> {};
+template <size_t... I> struct MakeRouteSlots<0, I...> { typedef RouteSlotList<I...> type; };
+
+template <size_t N, size_t... I>
+constexpr RouteIndex buildRouteIndex(const RouteDef (&routes)[N], uint32_t seed, RouteSlotList<I...>) {
+    return RouteIndex{ seed, { routeInSlot(routes, N, seed, I, 0)... } };
+}
+
+// Generates the perfect hash for a constexpr route table. Check the result
+// with a static_assert on seed != ROUTE_NO_SEED.
+template <size_t N>
+constexpr RouteIndex buildRouteIndex(const RouteDef (&routes)[N]) {
+    return buildRouteIndex(routes, findRouteSeed(routes, N, 0),
+                           typename MakeRouteSlots<ROUTE_TABLE_SLOTS>::type());
+}
+
+// ================= Router =================
+
+// Dispatches a request with one hash and one string compare, no
+// allocation, and records access counts and latency per endpoint
+class Router {
+private:
+    const RouteDef* routes;
+    uint8_t routeCount;
+    const RouteIndex* index;
+    uint32_t (*clock)();            // Microseconds
+    RouteStats stats[ROUTE_MAX_ROUTES];
+    uint32_t misses;
+
+    void setTable(const RouteDef* table, uint8_t count, const RouteIndex& routeIndex,
+                  uint32_t (*clockUs)());
+
+public:
+    Router();
+
+    template <size_t N>
+    void begin(const RouteDef (&table)[N], const RouteIndex& routeIndex, uint32_t (*clockUs)()) {
+        static_assert(N <= ROUTE_MAX_ROUTES, "Too many routes, raise ROUTE_MAX_ROUTES");
+        setTable(table, N, routeIndex, clockUs);
+    }
+
+    // Route index, -1 if the method and path are not in the table
+    int find(RouteMethod method, const char* path) const;
+
+    // Runs the handler; false if there is none
+    bool dispatch(RouteMethod method, const char* path);
+
+    // The two halves of dispatch(), for callers that check a route's
+    // flags before running it
+    void run(uint8_t route);
+    void noteMiss() { misses++; }
+
+    // Diagnostics
+    uint8_t getRouteCount() const { return routeCount; }
+    const RouteDef& getRoute(uint8_t i) const { return routes[i]; }
+    const RouteStats& getStats(uint8_t i) const { return stats[i]; }
+    uint32_t getMisses() const { return misses; }
+    static uint32_t getBucketLimitUs(uint8_t bucket);
+    static const char* getMethodName(RouteMethod method);
+};
+
+extern Router apiRouter;
+
+#endif // ROUTE_TABLE_H
@@ -0,0 +1,236 @@
+#include "soft_timer.h"
+#include <string.h>
+
+#define SLOT_MASK (TIMER_WHEEL_SLOTS - 1)
+#define LEVEL_SHIFT(level) ((level) * TIMER_WHEEL_BITS)
+#define WHEEL_HORIZON (1ULL << (TIMER_WHEEL_LEVELS * TIMER_WHEEL_BITS))
+
+SoftTimer::SoftTimer(TimerCallback callback, void* context)
+    : callback(callback), context(context), events(0), expires(0), period(0),
+      next(NULL), pprev(NULL) {
+}
+
+SoftTimer::SoftTimer(uint32_t events)
+    : callback(NULL), context(NULL), events(events), expires(0), period(0),
+      next(NULL), pprev(NULL) {
+}
+
+TimerService::TimerService()
+    : clock(NULL), current(0), pendingEvents(0), wakeHandler(NULL) {
+    memset(wheel, 0, sizeof(wheel));
+    memset(&stats, 0, sizeof(stats));
+}
+
+void TimerService::begin(uint32_t (*clockSource)()) {
+    clock = clockSource;
+    current = clock();
+}
+
+void TimerService::setWakeHandler(void (*handler)()) {
+    wakeHandler = handler;
+}
+
+// ================= Wheel =================
+
+void TimerService::insert(SoftTimer& timer, bool cascading) {
+    uint32_t delta = timer.expires - current;
+    SoftTimer** slot;
+
+    if ((int32_t)delta <= 0) {
+        // Due already. A cascade runs just before the current slot expires;
+        // otherwise the current slot is done and the next one is soonest.
+        slot = &wheel[0][(current + (cascading ? 0 : 1)) & SLOT_MASK];
+    } else if (delta >= WHEEL_HORIZON) {
+        // Beyond the top level: park in its last slot and re-place on cascade
+        uint8_t top = TIMER_WHEEL_LEVELS - 1;
+        slot = &wheel[top][((current >> LEVEL_SHIFT(top)) + SLOT_MASK) & SLOT_MASK];
+    } else {
+        uint8_t level = 0;
+        while (delta >= (1UL << LEVEL_SHIFT(level + 1))) level++;
+        slot = &wheel[level][(timer.expires >> LEVEL_SHIFT(level)) & SLOT_MASK];
+    }
+
+    timer.next = *slot;
+    if (timer.next) timer.next->pprev = &timer.next;
+    timer.pprev = slot;
+    *slot = &timer;
+    stats.active++;
+}
+
+void TimerService::unlink(SoftTimer& timer) {
+    *timer.pprev = timer.next;
+    if (timer.next) timer.next->pprev = timer.pprev;
+    timer.next = NULL;
+    timer.pprev = NULL;
+    stats.active--;
+}
+
+void TimerService::cascade(uint8_t level, uint32_t index) {
+    SoftTimer* list = wheel[level][index];
+    wheel[level][index] = NULL;
+
+    while (list) {
+        SoftTimer* timer = list;
+        list = timer->next;
+        stats.active--;
+        insert(*timer, true);
+    }
+}
+
+void TimerService::expire(uint32_t index) {
+    // Detach the slot so callbacks can start and stop timers freely,
+    // including ones still waiting in this list
+    SoftTimer* list = wheel[0][index];
+    wheel[0][index] = NULL;
+    if (list) list->pprev = &list;
+
+    while (list) {
+        SoftTimer* timer = list;
+        unlink(*timer);
+
+        if ((int32_t)(timer->expires - current) > 0) {
+            insert(*timer, false);
+            continue;
+        }
+
+        uint32_t late = clock() - timer->expires;
+        stats.fired++;
+        stats.lastLateMs = late;
+        if (late > stats.maxLateMs) stats.maxLateMs = late;
+
+        // Re-arm before the callback so it can stop its own timer. Periodic
+        // timers keep their phase unless they fell a whole period behind.
+        if (timer->period) {
+            timer->expires += timer->period;
+            if ((int32_t)(timer->expires - current) <= 0) timer->expires = current + timer->period;
+            insert(*timer, false);
+        }
+
+        if (timer->callback) timer->callback(timer->context);
+        if (timer->events) postEvent(timer->events);
+    }
+}
+
+// ================= Timers =================
+
+void TimerService::start(SoftTimer& timer, uint32_t delayMs, uint32_t periodMs) {
+    if (timer.isActive()) unlink(timer);
+
+    timer.expires = clock() + delayMs;
+    timer.period = periodMs;
+    insert(timer, false);
+}
+
+void TimerService::stop(SoftTimer& timer) {
+    if (timer.isActive()) unlink(timer);
+}
+
+void TimerService::advance() {
+    uint32_t now = clock();
+    while ((int32_t)(now - current) > 0) {
+        current++;
+
+        // At a block boundary, cascade every level whose slot index just
+        // changed, highest first so entries can fall through several levels
+        if ((current & SLOT_MASK) == 0) {
+            uint8_t level = 1;
+            while (level < TIMER_WHEEL_LEVELS - 1 &&
+                   ((current >> LEVEL_SHIFT(level)) & SLOT_MASK) == 0) {
+                level++;
+            }
+            for (; level >= 1; level--) {
+                cascade(level, (current >> LEVEL_SHIFT(level)) & SLOT_MASK);
+            }
+        }
+
+        expire(current & SLOT_MASK);
+    }
+}
+
+uint32_t TimerService::msUntilNext() {
+    uint32_t best = UINT32_MAX;
+
+    // Level 0 slots hold exact expiries
+    for (uint32_t k = 1; k <= TIMER_WHEEL_SLOTS; k++) {
+        if (wheel[0][(current + k) & SLOT_MASK]) {
+            best = k;
+            break;
+        }
+    }
+
+    // Higher levels: the next cascade of a non-empty slot is a lower bound
+    for (uint8_t level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+        uint32_t block = current >> LEVEL_SHIFT(level);
+        for (uint32_t j = 1; j <= TIMER_WHEEL_SLOTS; j++) {
+            if (wheel[level][(block + j) & SLOT_MASK]) {
+                uint32_t until = ((block + j) << LEVEL_SHIFT(level)) - current;
+                if (until < best) best = until;
+                break;
+            }
+        }
+    }
+
+    if (best == UINT32_MAX) return best;
+    uint32_t elapsed = clock() - current;
+    return best > elapsed ? best - elapsed : 0;
+}
+
+// ================= Events =================
+
+void TimerService::postEvent(uint32_t events) {
+    pendingEvents.fetch_or(events, std::memory_order_release);
+    if (wakeHandler) wakeHandler();
+}
+
+uint32_t TimerService::takeEvents() {
+    return pendingEvents.exchange(0, std::memory_order_acquire);
+}
+
+TimerStats TimerService::getStats() {
+    return stats;
+}
+
+// ================= Device =================
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+TimerService timerService;
+
+static TaskHandle_t waitingTask = NULL;
+
+static void notifyWaitingTask() {
+    if (!waitingTask) return;
+
+    if (xPortInIsrContext()) {
+        BaseType_t woken = pdFALSE;
+        vTaskNotifyGiveFromISR(waitingTask, &woken);
+        portYIELD_FROM_ISR(woken);
+    } else {
+        xTaskNotifyGive(waitingTask);
+    }
+}
+
+void TimerService::wait(uint32_t maxMs) {
+    if (!waitingTask) {
+        waitingTask = xTaskGetCurrentTaskHandle();
+        setWakeHandler(notifyWaitingTask);
+    }
+
+    advance();
+    uint32_t ms = msUntilNext();
+    if (ms > maxMs) ms = maxMs;
+
+    if (ms > 0 && pendingEvents.load(std::memory_order_relaxed) == 0) {
+        // An event posted after the check leaves the notification pending,
+        // so the take returns at once instead of missing it
+        uint32_t start = micros();
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(ms));
+        stats.blockedUs += micros() - start;
+    }
+    stats.wakes++;
+    advance();
+}
+#endif
@@ -0,0 +1,89 @@
+#ifndef SOFT_TIMER_H
+#define SOFT_TIMER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include "config.h"
+
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_BITS)
+
+typedef void (*TimerCallback)(void* context);
+
+// A timer owned by the module that uses it. It either calls back or
+// posts event bits to the main loop when it expires.
+class SoftTimer {
+private:
+    friend class TimerService;
+
+    TimerCallback callback;
+    void* context;
+    uint32_t events;
+    uint32_t expires;
+    uint32_t period;                // 0 for one-shot
+    SoftTimer* next;
+    SoftTimer** pprev;              // NULL while stopped
+
+public:
+    SoftTimer(TimerCallback callback, void* context = NULL);
+    SoftTimer(uint32_t events);
+
+    bool isActive() const { return pprev != NULL; }
+    uint32_t getExpiry() const { return expires; }
+};
+
+// Timer service statistics
+typedef struct {
+    uint32_t active;
+    uint32_t fired;
+    uint32_t lastLateMs;            // Expiry to callback
+    uint32_t maxLateMs;
+    uint32_t wakes;
+    uint64_t blockedUs;
+} TimerStats;
+
+// Hierarchical timing wheel: level 0 has 1 ms slots, each level above
+// covers a whole revolution of the one below and is cascaded down at its
+// slot boundaries. Start, stop and expiry are O(1).
+class TimerService {
+private:
+    SoftTimer* wheel[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+    uint32_t (*clock)();
+    uint32_t current;               // Last tick processed
+    std::atomic<uint32_t> pendingEvents;
+    void (*wakeHandler)();
+    TimerStats stats;
+
+    void insert(SoftTimer& timer, bool cascading);
+    void unlink(SoftTimer& timer);
+    void cascade(uint8_t level, uint32_t index);
+    void expire(uint32_t index);
+
+public:
+    TimerService();
+
+    // Initialization
+    void begin(uint32_t (*clockSource)());
+    void setWakeHandler(void (*handler)());
+
+    // Timers, main task only
+    void start(SoftTimer& timer, uint32_t delayMs, uint32_t periodMs = 0);
+    void stop(SoftTimer& timer);
+    void advance();
+    uint32_t msUntilNext();
+
+    // Events, safe from ISRs and any task
+    void postEvent(uint32_t events);
+    uint32_t takeEvents();
+
+    // Blocks the main task until the next deadline, an event or maxMs,
+    // then runs the timers that are due
+    void wait(uint32_t maxMs);
+
+    // Diagnostics
+    TimerStats getStats();
+};
+
+extern TimerService timerService;
+
+#endif // SOFT_TIMER_H
@@ -0,0 +1,201 @@
+#include "stage_watchdog.h"
+#include <esp_system.h>
+#include <esp_task_wdt.h>
+#include <esp_idf_version.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#define WATCHDOG_RECORD_MAGIC 0x44475744    // "DGWD"
+
+StageWatchdog stageWatchdog;
+
+static RTC_NOINIT_ATTR WatchdogRecord rtcRecord;
+
+static const char* const stageNames[STAGE_COUNT] = {
+    "web", "gps", "imu", "fall", "buzzer"
+};
+static const uint32_t stageDeadlines[STAGE_COUNT] = {
+    STAGE_WEB_DEADLINE_US, STAGE_GPS_DEADLINE_US, STAGE_IMU_DEADLINE_US,
+    STAGE_FALL_DEADLINE_US, STAGE_BUZZER_DEADLINE_US
+};
+static const uint32_t stageStalls[STAGE_COUNT] = {
+    WATCHDOG_WEB_TIMEOUT_MS, WATCHDOG_TIMEOUT_MS, WATCHDOG_TIMEOUT_MS,
+    WATCHDOG_TIMEOUT_MS, WATCHDOG_TIMEOUT_MS
+};
+
+#if WATCHDOG_WEB_TIMEOUT_MS < WATCHDOG_TIMEOUT_MS
+#error "WATCHDOG_WEB_TIMEOUT_MS must not be shorter than WATCHDOG_TIMEOUT_MS"
+#endif
+
+StageWatchdog::StageWatchdog()
+    : lastOverrunStage(STAGE_NONE), restartsSuppressed(false), recovered(false),
+      resetReason(0), loopTask(NULL), currentStage(STAGE_NONE), stageStart(0), lastFeed(0) {
+    for (uint8_t i = 0; i < STAGE_COUNT; i++) {
+        memset(&stages[i], 0, sizeof(StageStats));
+        stages[i].name = stageNames[i];
+        stages[i].deadlineUs = stageDeadlines[i];
+        stages[i].stallMs = stageStalls[i];
+    }
+}
+
+void StageWatchdog::begin() {
+    resetReason = esp_reset_reason();
+    if (resetReason == ESP_RST_POWERON || rtcRecord.magic != WATCHDOG_RECORD_MAGIC) {
+        memset(&rtcRecord, 0, sizeof(rtcRecord));
+        rtcRecord.magic = WATCHDOG_RECORD_MAGIC;
+        rtcRecord.lastStallStage = STAGE_NONE;
+    } else if (resetReason == ESP_RST_TASK_WDT || resetReason == ESP_RST_INT_WDT) {
+        // The hardware backstop fired before the monitor could record it
+        rtcRecord.totalRestarts++;
+        rtcRecord.consecutiveRestarts++;
+    }
+    restartsSuppressed = rtcRecord.consecutiveRestarts >= MAX_RESTART_COUNT;
+
+    // Hardware task watchdog as a backstop at twice the longest controlled
+    // timeout, so the monitor always gets to record the stalled stage first
+    uint32_t backstopMs = WATCHDOG_WEB_TIMEOUT_MS * 2;
+#if ESP_IDF_VERSION_MAJOR >= 5
+    // Idle tasks stay watched as the sdkconfig has them
+    uint32_t idleCores = 0;
+#if CONFIG_ESP_TASK_WDT_CHECK_IDLE_TASK_CPU0
+    idleCores |= 1 << 0;
+#endif
+#if CONFIG_ESP_TASK_WDT_CHECK_IDLE_TASK_CPU1
+    idleCores |= 1 << 1;
+#endif
+    esp_task_wdt_config_t config;
+    config.timeout_ms = backstopMs;
+    config.idle_core_mask = idleCores;
+    config.trigger_panic = true;
+    if (esp_task_wdt_reconfigure(&config) != ESP_OK) esp_task_wdt_init(&config);
+#else
+    esp_task_wdt_init(backstopMs / 1000, true);
+#endif
+
+    loopTask = xTaskGetCurrentTaskHandle();
+    if (!restartsSuppressed) esp_task_wdt_add((TaskHandle_t)loopTask);
+
+    lastFeed = millis();
+    xTaskCreatePinnedToCore(monitorTask, "stage_wdt", 2048, this, 2, NULL, 0);
+
+    if (rtcRecord.totalRestarts > 0) {
+        Serial.printf("Watchdog: restart %u (stage %s stalled %lu ms)%s\n",
+                      rtcRecord.totalRestarts, getStageName(rtcRecord.lastStallStage),
+                      (unsigned long)rtcRecord.lastStallMs,
+                      restartsSuppressed ? ", further restarts suppressed" : "");
+    }
+}
+
+void StageWatchdog::setDeadline(LoopStage stage, uint32_t deadlineUs) {
+    if (stage < STAGE_COUNT) stages[stage].deadlineUs = deadlineUs;
+}
+
+void StageWatchdog::enter(LoopStage stage) {
+    stageStart = micros();
+    currentStage = stage;
+}
+
+void StageWatchdog::leave() {
+    uint8_t stage = currentStage;
+    if (stage >= STAGE_COUNT) return;
+
+    uint32_t elapsed = micros() - stageStart;
+    currentStage = STAGE_NONE;
+
+    StageStats& s = stages[stage];
+    s.runs++;
+    s.lastUs = elapsed;
+    if (elapsed > s.maxUs) s.maxUs = elapsed;
+    if (elapsed > s.deadlineUs) {
+        s.overruns++;
+        lastOverrunStage = stage;
+    }
+}
+
+void StageWatchdog::feed() {
+    lastFeed = millis();
+    if (!restartsSuppressed) esp_task_wdt_reset();
+
+    // A stall-free stretch after boot ends a run of consecutive restarts
+    if (!recovered && millis() > ERROR_RECOVERY_DELAY_MS) {
+        recovered = true;
+        rtcRecord.consecutiveRestarts = 0;
+    }
+}
+
+// Work that legitimately runs for seconds inside one stage (a firmware
+// upload) reports each step of progress so it is not taken for a stall
+void StageWatchdog::keepAlive() {
+    stageStart = micros();
+    feed();
+}
+
+void StageWatchdog::monitorTask(void* context) {
+    StageWatchdog* watchdog = static_cast<StageWatchdog*>(context);
+    for (;;) {
+        vTaskDelay(pdMS_TO_TICKS(WATCHDOG_CHECK_INTERVAL_MS));
+        watchdog->checkStall();
+    }
+}
+
+void StageWatchdog::checkStall() {
+    uint8_t stage = currentStage;
+    uint32_t stalledMs;
+    uint32_t limitMs = WATCHDOG_TIMEOUT_MS;
+    if (stage < STAGE_COUNT) {
+        stalledMs = (micros() - stageStart) / 1000;
+        limitMs = stages[stage].stallMs;
+    } else {
+        stalledMs = millis() - lastFeed;
+    }
+
+    if (stalledMs > limitMs) controlledRestart(stage, stalledMs);
+}
+
+void StageWatchdog::controlledRestart(uint8_t stage, uint32_t stalledMs) {
+    if (restartsSuppressed) return;
+
+    rtcRecord.lastStallStage = stage;
+    rtcRecord.lastStallMs = stalledMs;
+    rtcRecord.totalRestarts++;
+    rtcRecord.consecutiveRestarts++;
+
+    Serial.printf("Watchdog: stage %s stalled for %lu ms, restarting\n",
+                  getStageName(stage), (unsigned long)stalledMs);
+    Serial.flush();
+    esp_restart();
+}
+
+const StageStats& StageWatchdog::getStageStats(LoopStage stage) {
+    return stages[stage];
+}
+
+uint8_t StageWatchdog::getLastOverrunStage() {
+    return lastOverrunStage;
+}
+
+WatchdogRecord StageWatchdog::getRecord() {
+    return rtcRecord;
+}
+
+bool StageWatchdog::areRestartsSuppressed() {
+    return restartsSuppressed;
+}
+
+int StageWatchdog::getResetReason() {
+    return resetReason;
+}
+
+const char* StageWatchdog::getStageName(uint8_t stage) {
+    if (stage >= STAGE_COUNT) return "none";
+    return stageNames[stage];
+}
+
+void StageWatchdog::printStatus() {
+    for (uint8_t i = 0; i < STAGE_COUNT; i++) {
+        const StageStats& s = stages[i];
+        Serial.printf("Stage %-6s deadline %6lu us, last %6lu us, max %6lu us, overruns %lu/%lu\n",
+                      s.name, (unsigned long)s.deadlineUs, (unsigned long)s.lastUs,
+                      (unsigned long)s.maxUs, (unsigned long)s.overruns, (unsigned long)s.runs);
+    }
+}
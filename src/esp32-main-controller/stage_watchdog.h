@@ -0,0 +1,81 @@
+#ifndef STAGE_WATCHDOG_H
+#define STAGE_WATCHDOG_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// Processing stages of one loop iteration
+typedef enum {
+    STAGE_WEB,
+    STAGE_GPS,
+    STAGE_IMU,
+    STAGE_FALL,
+    STAGE_BUZZER,
+    STAGE_COUNT,
+    STAGE_NONE = 0xFF
+} LoopStage;
+
+// Per-stage timing
+typedef struct {
+    const char* name;
+    uint32_t deadlineUs;
+    uint32_t stallMs;               // Stuck this long is a stall
+    uint32_t runs;
+    uint32_t overruns;
+    uint32_t lastUs;
+    uint32_t maxUs;
+} StageStats;
+
+// Survives software and watchdog resets (RTC slow memory)
+typedef struct {
+    uint32_t magic;
+    uint16_t totalRestarts;         // Since power-on
+    uint8_t consecutiveRestarts;    // Without a stall-free ERROR_RECOVERY_DELAY_MS in between
+    uint8_t lastStallStage;
+    uint32_t lastStallMs;
+} WatchdogRecord;
+
+class StageWatchdog {
+private:
+    StageStats stages[STAGE_COUNT];
+    uint8_t lastOverrunStage;
+    bool restartsSuppressed;
+    bool recovered;
+    int resetReason;
+    void* loopTask;
+
+    // Read by the monitor task
+    volatile uint8_t currentStage;
+    volatile uint32_t stageStart;
+    volatile uint32_t lastFeed;
+
+    static void monitorTask(void* context);
+    void checkStall();
+    void controlledRestart(uint8_t stage, uint32_t stalledMs);
+
+public:
+    StageWatchdog();
+
+    // Initialization
+    void begin();
+    void setDeadline(LoopStage stage, uint32_t deadlineUs);
+
+    // Stage timing
+    void enter(LoopStage stage);
+    void leave();
+    void feed();
+    void keepAlive();               // Progress inside a long stage
+
+    // Diagnostics
+    const StageStats& getStageStats(LoopStage stage);
+    uint8_t getLastOverrunStage();
+    WatchdogRecord getRecord();
+    bool areRestartsSuppressed();
+    int getResetReason();
+    static const char* getStageName(uint8_t stage);
+    void printStatus();
+};
+
+extern StageWatchdog stageWatchdog;
+
+#endif // STAGE_WATCHDOG_H
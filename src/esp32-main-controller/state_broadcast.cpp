@@ -0,0 +1,130 @@
+#include "state_broadcast.h"
+#include <string.h>
+
+static void putLe16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void putLe32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static uint16_t getLe16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t getLe32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// ================= Packet =================
+
+size_t encodeStatePacket(const StateSnapshot& s, uint8_t* out) {
+    putLe16(out, STATE_PACKET_MAGIC);
+    out[2] = STATE_PACKET_VERSION;
+    out[3] = s.flags;
+    putLe32(out + 4, s.sequence);
+    putLe32(out + 8, s.uptimeMs);
+    putLe32(out + 12, (uint32_t)s.latitudeE6);
+    putLe32(out + 16, (uint32_t)s.longitudeE6);
+    putLe32(out + 20, s.lastFallS);
+    putLe32(out + 24, s.version);
+    putLe16(out + 28, s.falls);
+    out[30] = s.batteryLevel;
+    out[31] = s.wifiClients;
+    return STATE_PACKET_SIZE;
+}
+
+// Longer packets from a later version keep this layout as a prefix
+bool decodeStatePacket(const uint8_t* data, size_t length, StateSnapshot& out) {
+    if (length < STATE_PACKET_SIZE || getLe16(data) != STATE_PACKET_MAGIC) return false;
+    if (data[2] < STATE_PACKET_VERSION) return false;
+    out.flags = data[3];
+    out.sequence = getLe32(data + 4);
+    out.uptimeMs = getLe32(data + 8);
+    out.latitudeE6 = (int32_t)getLe32(data + 12);
+    out.longitudeE6 = (int32_t)getLe32(data + 16);
+    out.lastFallS = getLe32(data + 20);
+    out.version = getLe32(data + 24);
+    out.falls = getLe16(data + 28);
+    out.batteryLevel = data[30];
+    out.wifiClients = data[31];
+    return true;
+}
+
+// ================= Broadcaster =================
+
+StateBroadcaster::StateBroadcaster() : sequence(0), repeatsLeft(0) {
+    memset(packet, 0, sizeof(packet));
+    memset(&stats, 0, sizeof(stats));
+}
+
+const uint8_t* StateBroadcaster::prepare(StateSnapshot& s, bool urgent) {
+    if (!urgent && repeatsLeft > 0) {
+        stats.deferred++;
+        return NULL;
+    }
+    s.sequence = ++sequence;
+    if (urgent) s.flags |= STATE_FLAG_URGENT;
+    encodeStatePacket(s, packet);
+    repeatsLeft = urgent ? STATE_URGENT_REPEATS : 0;
+    if (urgent) stats.urgent++;
+    return packet;
+}
+
+bool StateBroadcaster::takeRepeat() {
+    if (repeatsLeft == 0) return false;
+    repeatsLeft--;
+    stats.repeats++;
+    return true;
+}
+
+void StateBroadcaster::noteSent(bool ok, uint32_t elapsedUs) {
+    if (!ok) {
+        stats.failed++;
+        return;
+    }
+    stats.sent++;
+    stats.bytes += STATE_PACKET_SIZE;
+    stats.lastSendUs = elapsedUs;
+    if (elapsedUs > stats.maxSendUs) stats.maxSendUs = elapsedUs;
+}
+
+// ================= Device =================
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include <WiFi.h>
+#include <WiFiUdp.h>
+
+StateBroadcaster stateBroadcaster;
+
+static WiFiUDP broadcastSocket;
+
+void StateBroadcaster::begin() {
+    broadcastSocket.begin(STATE_BROADCAST_PORT);
+}
+
+bool StateBroadcaster::transmit() {
+    uint32_t start = micros();
+    bool ok = broadcastSocket.beginPacket(WiFi.softAPBroadcastIP(), STATE_BROADCAST_PORT) &&
+              broadcastSocket.write(packet, STATE_PACKET_SIZE) == STATE_PACKET_SIZE &&
+              broadcastSocket.endPacket();
+    noteSent(ok, micros() - start);
+    return ok;
+}
+
+void StateBroadcaster::send(StateSnapshot& s, bool urgent) {
+    if (prepare(s, urgent)) transmit();
+}
+
+bool StateBroadcaster::repeat() {
+    if (!takeRepeat()) return false;
+    transmit();
+    return true;
+}
+#endif
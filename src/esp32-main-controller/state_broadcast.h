@@ -0,0 +1,98 @@
+#ifndef STATE_BROADCAST_H
+#define STATE_BROADCAST_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "config.h"
+
+// Decoded by tools/state_listener/state_listener.py.
+
+// ================= Packet =================
+//
+// 32 bytes, little endian:
+//   0 magic "DS"   2 version   3 flags   4 sequence   8 uptime ms
+//  12 latitude e6  16 longitude e6       20 last fall s
+//  24 field version (as /delta)          28 falls u16
+//  30 battery %    31 WiFi clients
+
+#define STATE_PACKET_MAGIC 0x5344       // "DS"
+#define STATE_PACKET_VERSION 1
+#define STATE_PACKET_SIZE 32
+
+#define STATE_FLAG_GPS_FIX 0x01
+#define STATE_FLAG_ALERT 0x02           // Fall followed by inactivity
+#define STATE_FLAG_BATTERY_LOW 0x04
+#define STATE_FLAG_STILL 0x08
+#define STATE_FLAG_URGENT 0x10          // Sent for an event, not on the interval
+
+#define STATE_NO_FALL 0xFFFFFFFFUL
+
+typedef struct {
+    uint8_t flags;
+    uint32_t sequence;
+    uint32_t uptimeMs;
+    int32_t latitudeE6;
+    int32_t longitudeE6;
+    uint32_t lastFallS;             // Uptime of the last fall, STATE_NO_FALL if none
+    uint32_t version;
+    uint16_t falls;
+    uint8_t batteryLevel;
+    uint8_t wifiClients;
+} StateSnapshot;
+
+size_t encodeStatePacket(const StateSnapshot& s, uint8_t* out);     // STATE_PACKET_SIZE bytes
+bool decodeStatePacket(const uint8_t* data, size_t length, StateSnapshot& out);
+
+// ================= Broadcaster =================
+
+typedef struct {
+    uint32_t sent;
+    uint32_t urgent;
+    uint32_t repeats;               // Extra copies of urgent packets
+    uint32_t deferred;              // Interval packets skipped during repeats
+    uint32_t failed;
+    uint32_t bytes;
+    uint32_t lastSendUs;
+    uint32_t maxSendUs;
+} BroadcastStats;
+
+// One packet per state update for every listener on the subnet, so the
+// cost does not grow with the number of caregivers. Urgent packets are
+// sent again STATE_URGENT_REPEATS times under the same sequence number,
+// since broadcast frames are never acknowledged or retried. An interval
+// packet due while copies are pending is skipped: it would cancel them,
+// and its newer sequence would make the remaining copies look stale.
+class StateBroadcaster {
+private:
+    uint8_t packet[STATE_PACKET_SIZE];
+    uint32_t sequence;
+    uint8_t repeatsLeft;
+    BroadcastStats stats;
+
+#ifdef ARDUINO
+    bool transmit();
+#endif
+
+public:
+    StateBroadcaster();
+
+    // Builds the next packet; returns it for sending, or NULL for an
+    // interval packet while urgent copies are pending
+    const uint8_t* prepare(StateSnapshot& s, bool urgent);
+    bool takeRepeat();              // True while an urgent copy is still due
+    void noteSent(bool ok, uint32_t elapsedUs);
+
+    const uint8_t* getPacket() const { return packet; }
+    uint32_t getSequence() const { return sequence; }
+    const BroadcastStats& getStats() const { return stats; }
+
+#ifdef ARDUINO
+    void begin();
+    void send(StateSnapshot& s, bool urgent);
+    bool repeat();                  // False once no copy is left
+#endif
+};
+
+extern StateBroadcaster stateBroadcaster;
+
+#endif // STATE_BROADCAST_H
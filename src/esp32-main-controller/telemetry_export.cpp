@@ -0,0 +1,264 @@
+#include "telemetry_export.h"
+#include <string.h>
+
+static size_t putVarint(uint8_t* out, uint32_t value) {
+    size_t n = 0;
+    while (value >= 0x80) {
+        out[n++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    out[n++] = (uint8_t)value;
+    return n;
+}
+
+static uint32_t zigzag(int32_t value) {
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+// ================= Batch =================
+
+TelemetryBatch::TelemetryBatch() {
+    reset();
+}
+
+void TelemetryBatch::reset() {
+    buffer[0] = TELEMETRY_BATCH_VERSION;
+    length = 1;
+    count = 0;
+    boot = 0;
+    uptimeS = 0;
+    latitudeE6 = 0;
+    longitudeE6 = 0;
+}
+
+bool TelemetryBatch::add(const TelemetryRecord& record) {
+    // boot and uptimeS lead both record layouts
+    TelemetryPoint point;
+    TelemetrySummary summary;
+    uint16_t recordBoot;
+    uint32_t recordUptime;
+    if (record.type == TELEMETRY_SUMMARY && record.length == sizeof(summary)) {
+        memcpy(&summary, record.data, sizeof(summary));
+        recordBoot = summary.boot;
+        recordUptime = summary.uptimeS;
+    } else if ((record.type == TELEMETRY_FALL || record.type == TELEMETRY_TRACK) && record.length == sizeof(point)) {
+        memcpy(&point, record.data, sizeof(point));
+        recordBoot = point.boot;
+        recordUptime = point.uptimeS;
+    } else {
+        return true;                // Unknown or stale layout: nothing to send
+    }
+
+    uint8_t encoded[32];
+    size_t n = 0;
+    bool absolute = count == 0 || recordBoot != boot || recordUptime < uptimeS;
+    encoded[n++] = record.type | (absolute ? TELEMETRY_TAG_ABSOLUTE : 0);
+    if (absolute) {
+        n += putVarint(encoded + n, recordBoot);
+        n += putVarint(encoded + n, recordUptime);
+    } else {
+        n += putVarint(encoded + n, recordUptime - uptimeS);
+    }
+
+    if (record.type == TELEMETRY_SUMMARY) {
+        encoded[n++] = summary.batteryLevel;
+        encoded[n++] = summary.flags;
+        n += putVarint(encoded + n, summary.activeS);
+        n += putVarint(encoded + n, summary.falls);
+    } else {
+        n += putVarint(encoded + n, zigzag(point.latitudeE6 - latitudeE6));
+        n += putVarint(encoded + n, zigzag(point.longitudeE6 - longitudeE6));
+    }
+
+    if (length + n > sizeof(buffer)) return false;
+    memcpy(buffer + length, encoded, n);
+    length += n;
+    count++;
+    boot = recordBoot;
+    uptimeS = recordUptime;
+    if (record.type != TELEMETRY_SUMMARY) {
+        latitudeE6 = point.latitudeE6;
+        longitudeE6 = point.longitudeE6;
+    }
+    return true;
+}
+
+// ================= Device =================
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include <WiFi.h>
+#include <Preferences.h>
+#include <esp_partition.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+
+TelemetryExporter telemetryExporter;
+
+static WiFiClient brokerClient;
+static const esp_partition_t* queuePartition = NULL;
+
+static bool flashRead(uint32_t address, void* out, size_t length, void*) {
+    return esp_partition_read(queuePartition, address, out, length) == ESP_OK;
+}
+
+static bool flashWrite(uint32_t address, const void* data, size_t length, void*) {
+    return esp_partition_write(queuePartition, address, data, length) == ESP_OK;
+}
+
+static bool flashErase(uint16_t sector, void*) {
+    return esp_partition_erase_range(queuePartition, (uint32_t)sector * TELEMETRY_SECTOR_SIZE,
+                                     TELEMETRY_SECTOR_SIZE) == ESP_OK;
+}
+
+static bool socketSend(const uint8_t* data, size_t length, void*) {
+    return brokerClient.write(data, length) == length;
+}
+
+TelemetryExporter::TelemetryExporter()
+    : inbox(NULL), batchDrops(0), batchId(0), boot(0), urgent(false), pendingSinceMs(0), lastAttemptMs(0) {
+    batchEnd.sector = batchEnd.offset = 0;
+    topic[0] = '\0';
+    clientId[0] = '\0';
+    memset(&stats, 0, sizeof(stats));
+}
+
+void TelemetryExporter::begin() {
+    Preferences prefs;
+    prefs.begin("telemetry", false);
+    boot = prefs.getUShort("boot", 0) + 1;
+    prefs.putUShort("boot", boot);
+    prefs.end();
+
+    queuePartition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                              TELEMETRY_PARTITION_LABEL);
+    if (!queuePartition) {
+        Serial.println("Telemetry: no " TELEMETRY_PARTITION_LABEL " partition, uplink disabled");
+        return;
+    }
+    uint32_t sectors = queuePartition->size / TELEMETRY_SECTOR_SIZE;
+    if (sectors > TELEMETRY_QUEUE_SECTORS) sectors = TELEMETRY_QUEUE_SECTORS;
+    FlashStorage flash = { flashRead, flashWrite, flashErase, NULL, (uint16_t)sectors };
+    if (!queue.begin(flash)) return;
+    // A backlog from before the reboot goes out as soon as there is a broker
+    if (queue.getPending() > 0) urgent = true;
+
+    uint8_t mac[6];
+    WiFi.macAddress(mac);
+    snprintf(clientId, sizeof(clientId), "drishti-%02x%02x%02x%02x%02x%02x",
+             mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    snprintf(topic, sizeof(topic), MQTT_TOPIC_PREFIX "/%s/telemetry", clientId + 8);
+    mqtt.begin(socketSend, NULL);
+
+    WiFi.setAutoReconnect(true);
+    WiFi.begin(WIFI_STA_SSID, WIFI_STA_PASSWORD);   // Joins the AP as AP+STA
+
+    inbox = xQueueCreate(TELEMETRY_INBOX_SIZE, sizeof(TelemetryRecord));
+    xTaskCreatePinnedToCore(task, "telemetry", 4096, this, 1, NULL, 0);
+}
+
+// Loop side: never blocks; a full inbox drops the record
+bool TelemetryExporter::post(uint8_t type, const void* data, uint8_t length) {
+    if (!inbox || length > TELEMETRY_RECORD_MAX) return false;
+    TelemetryRecord record;
+    record.type = type;
+    record.length = length;
+    memcpy(record.data, data, length);
+    if (xQueueSend((QueueHandle_t)inbox, &record, 0) != pdTRUE) {
+        stats.inboxDrops++;
+        return false;
+    }
+    return true;
+}
+
+void TelemetryExporter::task(void* context) {
+    TelemetryExporter* exporter = static_cast<TelemetryExporter*>(context);
+    for (;;) {
+        vTaskDelay(pdMS_TO_TICKS(TELEMETRY_SERVICE_MS));
+        exporter->service(millis());
+    }
+}
+
+void TelemetryExporter::drainInbox(uint32_t nowMs) {
+    TelemetryRecord record;
+    while (xQueueReceive((QueueHandle_t)inbox, &record, 0) == pdTRUE) {
+        if (queue.getPending() == 0) pendingSinceMs = nowMs;
+        queue.push(record.type, record.data, record.length);
+        if (record.type == TELEMETRY_FALL) urgent = true;
+    }
+}
+
+bool TelemetryExporter::connectBroker(uint32_t nowMs) {
+    if (nowMs - lastAttemptMs < MQTT_RETRY_MS && lastAttemptMs != 0) return false;
+    lastAttemptMs = nowMs;
+    if (!brokerClient.connect(MQTT_BROKER_HOST, MQTT_BROKER_PORT, MQTT_CONNECT_TIMEOUT_MS)) return false;
+    brokerClient.setNoDelay(true);
+    return mqtt.connect(clientId, MQTT_KEEPALIVE_S, nowMs);
+}
+
+// The batch takes as many of the oldest records as fit; its end cursor
+// is kept until the broker acknowledges it
+void TelemetryExporter::publishBatch(uint32_t nowMs) {
+    static TelemetryRecord records[TELEMETRY_BATCH_RECORDS];
+    QueueCursor end;
+    uint8_t n = queue.peek(records, TELEMETRY_BATCH_RECORDS, (size_t)-1, end);
+    if (n == 0) return;
+
+    batch.reset();
+    uint8_t taken = 0;
+    while (taken < n && batch.add(records[taken])) taken++;
+    if (taken < n) queue.peek(records, taken, (size_t)-1, end);
+
+    batchId = mqtt.publish(topic, batch.getData(), batch.getLength(), nowMs);
+    if (!batchId) return;
+    batchEnd = end;
+    batchDrops = queue.getStats().dropped;
+    stats.lastBatchRecords = taken;
+    stats.lastBatchBytes = batch.getLength();
+}
+
+void TelemetryExporter::service(uint32_t nowMs) {
+    drainInbox(nowMs);
+    if (WiFi.status() != WL_CONNECTED) return;
+
+    if (!brokerClient.connected()) {
+        if (mqtt.getState() != MQTT_DISCONNECTED) {
+            mqtt.reset();
+            batchId = 0;            // Unacknowledged: sent again after reconnecting
+        }
+        if (!connectBroker(nowMs)) return;
+    }
+
+    uint8_t buffer[64];
+    int available;
+    while ((available = brokerClient.available()) > 0) {
+        int n = brokerClient.read(buffer, available < (int)sizeof(buffer) ? available : sizeof(buffer));
+        if (n <= 0) break;
+        mqtt.receive(buffer, n, nowMs);
+    }
+    if (!mqtt.poll(nowMs)) {
+        brokerClient.stop();
+        batchId = 0;
+        return;
+    }
+
+    uint16_t acked = mqtt.takeAcked();
+    if (acked && acked == batchId) {
+        // If the ring wrapped over the batch meanwhile, its end is gone;
+        // what is left of it goes out again
+        if (queue.getStats().dropped == batchDrops) queue.markSent(batchEnd);
+        stats.batches++;
+        stats.records += stats.lastBatchRecords;
+        stats.payloadBytes += stats.lastBatchBytes;
+        batchId = 0;
+        pendingSinceMs = nowMs;
+        if (queue.getPending() == 0) urgent = false;
+    }
+
+    // Backpressure: one batch in flight, the next once it is acknowledged
+    if (!mqtt.isReady() || batchId || queue.getPending() == 0) return;
+    bool full = queue.getPending() >= TELEMETRY_BATCH_RECORDS;
+    if (full || urgent || nowMs - pendingSinceMs >= TELEMETRY_FLUSH_MS) publishBatch(nowMs);
+}
+#endif
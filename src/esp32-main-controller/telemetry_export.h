@@ -0,0 +1,140 @@
+#ifndef TELEMETRY_EXPORT_H
+#define TELEMETRY_EXPORT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "config.h"
+#include "telemetry_queue.h"
+#include "mqtt_session.h"
+
+// Batches are decoded by tools/telemetry/telemetry_decode.py.
+
+// A ping goes out after one idle keepalive; its answer has to arrive
+// before the broker's limit of one and a half
+#if MQTT_ACK_TIMEOUT_MS >= MQTT_KEEPALIVE_S * 500
+#error "MQTT_ACK_TIMEOUT_MS must be under half of MQTT_KEEPALIVE_S"
+#endif
+
+// ================= Records =================
+
+typedef enum {
+    TELEMETRY_SUMMARY = 1,
+    TELEMETRY_FALL = 2,
+    TELEMETRY_TRACK = 3
+} TelemetryType;
+
+#define TELEMETRY_FLAG_GPS_FIX 0x01
+#define TELEMETRY_FLAG_BATTERY_LOW 0x02
+#define TELEMETRY_FLAG_ALERT 0x04
+
+// Queued as is. Boot counts restarts, so uptimes from before a reboot
+// stay ordered.
+typedef struct {
+    uint16_t boot;
+    uint32_t uptimeS;
+    uint8_t batteryLevel;
+    uint8_t flags;
+    uint16_t activeS;               // Not in still mode during the period
+    uint16_t falls;
+} TelemetrySummary;
+
+typedef struct {
+    uint16_t boot;
+    uint32_t uptimeS;
+    int32_t latitudeE6;
+    int32_t longitudeE6;
+} TelemetryPoint;                   // Fall and track records
+
+static_assert(sizeof(TelemetrySummary) <= TELEMETRY_RECORD_MAX, "TelemetrySummary too large");
+static_assert(sizeof(TelemetryPoint) <= TELEMETRY_RECORD_MAX, "TelemetryPoint too large");
+
+// ================= Batch =================
+//
+// Version byte, then per record:
+//   tag     type, | 0x80 when boot and time follow in full
+//   time    varint boot, varint uptime s   or   varint seconds since previous
+//   summary battery u8, flags u8, varint active s, varint falls
+//   point   zigzag varint latitude and longitude e6, relative to the
+//           previous point of the batch
+
+#define TELEMETRY_BATCH_VERSION 1
+#define TELEMETRY_TAG_ABSOLUTE 0x80
+
+class TelemetryBatch {
+private:
+    uint8_t buffer[TELEMETRY_BATCH_BYTES];
+    size_t length;
+    uint8_t count;
+    uint16_t boot;
+    uint32_t uptimeS;
+    int32_t latitudeE6;
+    int32_t longitudeE6;
+
+public:
+    TelemetryBatch();
+
+    void reset();
+    bool add(const TelemetryRecord& record);    // False if it does not fit
+
+    const uint8_t* getData() const { return buffer; }
+    size_t getLength() const { return length; }
+    uint8_t getCount() const { return count; }
+};
+
+// ================= Exporter =================
+
+#ifdef ARDUINO
+typedef struct {
+    uint32_t batches;
+    uint32_t records;
+    uint32_t payloadBytes;
+    uint32_t inboxDrops;            // Loop posted faster than the task drained
+    uint8_t lastBatchRecords;
+    uint16_t lastBatchBytes;
+} ExportStats;
+
+// Runs in its own task so connecting, flash writes and socket I/O never
+// hold up the loop. The loop posts records; the task queues them in
+// flash and publishes a batch when one fills, a fall is waiting, or the
+// oldest record has waited TELEMETRY_FLUSH_MS. Queued records are only
+// marked sent once the broker acknowledges their batch.
+class TelemetryExporter {
+private:
+    void* inbox;                    // FreeRTOS queue of TelemetryRecord
+    TelemetryQueue queue;
+    MqttSession mqtt;
+    TelemetryBatch batch;
+    QueueCursor batchEnd;
+    uint32_t batchDrops;            // Queue drops when the batch was read
+    uint16_t batchId;
+    uint16_t boot;
+    bool urgent;
+    uint32_t pendingSinceMs;
+    uint32_t lastAttemptMs;
+    char topic[MQTT_TOPIC_MAX + 1];
+    char clientId[24];
+    ExportStats stats;
+
+    static void task(void* context);
+    void service(uint32_t nowMs);
+    void drainInbox(uint32_t nowMs);
+    bool connectBroker(uint32_t nowMs);
+    void publishBatch(uint32_t nowMs);
+
+public:
+    TelemetryExporter();
+
+    void begin();
+    bool post(uint8_t type, const void* data, uint8_t length);
+    uint16_t getBoot() const { return boot; }
+
+    bool isConnected() const { return mqtt.getState() == MQTT_CONNECTED; }
+    const TelemetryQueue& getQueue() const { return queue; }
+    const MqttStats& getMqttStats() const { return mqtt.getStats(); }
+    const ExportStats& getStats() const { return stats; }
+};
+
+extern TelemetryExporter telemetryExporter;
+#endif
+
+#endif // TELEMETRY_EXPORT_H
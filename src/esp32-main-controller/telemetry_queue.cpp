@@ -0,0 +1,232 @@
+#include "telemetry_queue.h"
+#include <string.h>
+
+#define QUEUE_MAGIC 0x51544744UL        // "DGTQ"
+#define SECTOR_HEADER_SIZE 8
+#define RECORD_HEADER_SIZE 4            // length, type, check, state
+#define RECORD_FREE 0xFF
+#define RECORD_SENT 0x00
+
+#define RECORD_END 0
+#define RECORD_CORRUPT -1
+
+// CRC-8 (poly 0x07) over length, type and payload
+static uint8_t recordCheck(uint8_t length, uint8_t type, const uint8_t* data) {
+    uint8_t crc = 0;
+    uint8_t bytes[2] = { length, type };
+    for (size_t i = 0; i < (size_t)length + 2; i++) {
+        crc ^= i < 2 ? bytes[i] : data[i - 2];
+        for (uint8_t b = 0; b < 8; b++) crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+    }
+    return crc;
+}
+
+TelemetryQueue::TelemetryQueue() : mounted(false), headSequence(0), pending(0) {
+    memset(&storage, 0, sizeof(storage));
+    head.sector = tail.sector = 0;
+    head.offset = tail.offset = SECTOR_HEADER_SIZE;
+    memset(&stats, 0, sizeof(stats));
+}
+
+// ================= Sectors =================
+
+bool TelemetryQueue::readSequence(uint16_t sector, uint32_t& sequence) {
+    uint32_t header[2];
+    if (!storage.read((uint32_t)sector * TELEMETRY_SECTOR_SIZE, header, sizeof(header), storage.context)) return false;
+    sequence = header[1];
+    return header[0] == QUEUE_MAGIC;
+}
+
+bool TelemetryQueue::openSector(uint16_t sector, uint32_t sequence) {
+    stats.erases++;
+    uint32_t header[2] = { QUEUE_MAGIC, sequence };
+    if (!storage.erase(sector, storage.context) ||
+        !storage.write((uint32_t)sector * TELEMETRY_SECTOR_SIZE, header, sizeof(header), storage.context)) {
+        stats.writeFailures++;
+        return false;
+    }
+    headSequence = sequence;
+    head.sector = sector;
+    head.offset = SECTOR_HEADER_SIZE;
+    return true;
+}
+
+// Size of the record at c (header included), RECORD_END past the last
+// one in its sector, or RECORD_CORRUPT for a torn write
+static int readRecord(const FlashStorage& storage, uint32_t address, uint16_t offset,
+                      TelemetryRecord* out, bool& sent) {
+    uint8_t header[RECORD_HEADER_SIZE];
+    if (offset + RECORD_HEADER_SIZE > TELEMETRY_SECTOR_SIZE) return RECORD_END;
+    if (!storage.read(address, header, sizeof(header), storage.context)) return RECORD_CORRUPT;
+    if (header[0] == RECORD_FREE) return RECORD_END;
+    if (header[0] == 0 || header[0] > TELEMETRY_RECORD_MAX ||
+        offset + RECORD_HEADER_SIZE + header[0] > TELEMETRY_SECTOR_SIZE) return RECORD_CORRUPT;
+
+    TelemetryRecord record;
+    if (!storage.read(address + RECORD_HEADER_SIZE, record.data, header[0], storage.context)) return RECORD_CORRUPT;
+    if (recordCheck(header[0], header[1], record.data) != header[2]) return RECORD_CORRUPT;
+
+    record.type = header[1];
+    record.length = header[0];
+    sent = header[3] == RECORD_SENT;
+    if (out) *out = record;
+    return RECORD_HEADER_SIZE + header[0];
+}
+
+// Pending records still in a sector the head is about to reuse are lost
+void TelemetryQueue::dropSector(uint16_t sector) {
+    QueueCursor c = tail;
+    uint32_t lost = 0;
+    bool sent;
+    int size;
+    while ((size = readRecord(storage, address(c), c.offset, NULL, sent)) > 0) {
+        if (!sent) lost++;
+        c.offset += size;
+    }
+    pending -= lost < pending ? lost : pending;
+    stats.dropped += lost;
+    tail.sector = (sector + 1) % storage.sectors;
+    tail.offset = SECTOR_HEADER_SIZE;
+}
+
+// ================= Mount =================
+
+// Walks one sector: finds the first unsent record and, for the newest
+// sector, the first free byte
+void TelemetryQueue::scan(uint16_t sector, bool isHead) {
+    QueueCursor c = { sector, SECTOR_HEADER_SIZE };
+    bool sent;
+    int size;
+    while ((size = readRecord(storage, address(c), c.offset, NULL, sent)) > 0) {
+        if (!sent) {
+            if (pending == 0) tail = c;
+            pending++;
+        }
+        c.offset += size;
+    }
+    if (size == RECORD_CORRUPT) {
+        stats.corrupt++;
+        c.offset = TELEMETRY_SECTOR_SIZE;   // Never append after a torn write
+    }
+    if (isHead) head = c;
+}
+
+bool TelemetryQueue::begin(const FlashStorage& flash) {
+    storage = flash;
+    mounted = false;
+    pending = 0;
+    if (storage.sectors < 2) return false;
+
+    int newest = -1;
+    uint32_t newestSequence = 0;
+    for (uint16_t s = 0; s < storage.sectors; s++) {
+        uint32_t sequence;
+        if (readSequence(s, sequence) && (newest < 0 || sequence > newestSequence)) {
+            newest = s;
+            newestSequence = sequence;
+        }
+    }
+
+    if (newest < 0) {
+        if (!openSector(0, 1)) return false;
+        tail = head;
+        mounted = true;
+        return true;
+    }
+
+    // The live sectors run back from the newest with consecutive sequences
+    uint16_t oldest = newest;
+    for (uint16_t n = 1; n < storage.sectors; n++) {
+        uint16_t previous = (newest + storage.sectors - n) % storage.sectors;
+        uint32_t sequence;
+        if (!readSequence(previous, sequence) || sequence != newestSequence - n) break;
+        oldest = previous;
+    }
+
+    headSequence = newestSequence;
+    for (uint16_t s = oldest;; s = (s + 1) % storage.sectors) {
+        scan(s, s == newest);
+        if (s == newest) break;
+    }
+    if (pending == 0) tail = head;
+    mounted = true;
+    return true;
+}
+
+// ================= Queue =================
+
+bool TelemetryQueue::push(uint8_t type, const void* data, uint8_t length) {
+    if (!mounted || length == 0 || length > TELEMETRY_RECORD_MAX) return false;
+
+    uint16_t size = RECORD_HEADER_SIZE + length;
+    if (head.offset + size > TELEMETRY_SECTOR_SIZE) {
+        uint16_t next = (head.sector + 1) % storage.sectors;
+        if (pending > 0 && tail.sector == next) dropSector(next);
+        if (!openSector(next, headSequence + 1)) return false;
+    }
+    if (pending == 0) tail = head;
+
+    uint8_t record[RECORD_HEADER_SIZE + TELEMETRY_RECORD_MAX];
+    record[0] = length;
+    record[1] = type;
+    record[2] = recordCheck(length, type, (const uint8_t*)data);
+    record[3] = RECORD_FREE;
+    memcpy(record + RECORD_HEADER_SIZE, data, length);
+    if (!storage.write(address(head), record, size, storage.context)) {
+        stats.writeFailures++;
+        head.offset = TELEMETRY_SECTOR_SIZE;   // Whatever landed is skipped
+        return false;
+    }
+
+    head.offset += size;
+    pending++;
+    stats.queued++;
+    return true;
+}
+
+uint8_t TelemetryQueue::peek(TelemetryRecord* out, uint8_t max, size_t maxBytes, QueueCursor& next) {
+    QueueCursor c = tail;
+    uint8_t n = 0;
+    size_t bytes = 0;
+
+    while (n < max && !(c.sector == head.sector && c.offset >= head.offset)) {
+        bool sent;
+        int size = readRecord(storage, address(c), c.offset, &out[n], sent);
+        if (size <= 0) {
+            if (c.sector == head.sector) break;
+            c.sector = (c.sector + 1) % storage.sectors;
+            c.offset = SECTOR_HEADER_SIZE;
+            continue;
+        }
+        if (!sent) {
+            if (n > 0 && bytes + out[n].length > maxBytes) break;
+            bytes += out[n].length;
+            n++;
+        }
+        c.offset += size;
+    }
+    next = c;
+    return n;
+}
+
+// Marks each record up to next as sent, so a reboot does not resend it
+void TelemetryQueue::markSent(const QueueCursor& next) {
+    const uint8_t sentState = RECORD_SENT;
+    while (!(tail.sector == next.sector && tail.offset == next.offset)) {
+        bool sent;
+        int size = readRecord(storage, address(tail), tail.offset, NULL, sent);
+        if (size <= 0) {
+            if (tail.sector == head.sector) break;
+            tail.sector = (tail.sector + 1) % storage.sectors;
+            tail.offset = SECTOR_HEADER_SIZE;
+            continue;
+        }
+        if (!sent) {
+            if (!storage.write(address(tail) + 3, &sentState, 1, storage.context)) stats.writeFailures++;
+            if (pending > 0) pending--;
+            stats.sent++;
+        }
+        tail.offset += size;
+    }
+    if (pending == 0) tail = head;
+}
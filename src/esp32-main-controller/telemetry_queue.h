@@ -0,0 +1,81 @@
+#ifndef TELEMETRY_QUEUE_H
+#define TELEMETRY_QUEUE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "config.h"
+
+#define TELEMETRY_SECTOR_SIZE 4096
+
+// NOR flash: erase sets a sector to 0xFF, writes only clear bits
+typedef struct {
+    bool (*read)(uint32_t address, void* out, size_t length, void* context);
+    bool (*write)(uint32_t address, const void* data, size_t length, void* context);
+    bool (*erase)(uint16_t sector, void* context);
+    void* context;
+    uint16_t sectors;
+} FlashStorage;
+
+typedef struct {
+    uint8_t type;
+    uint8_t length;
+    uint8_t data[TELEMETRY_RECORD_MAX];
+} TelemetryRecord;
+
+// Position of a record in the ring
+typedef struct {
+    uint16_t sector;
+    uint16_t offset;
+} QueueCursor;
+
+typedef struct {
+    uint32_t queued;
+    uint32_t sent;
+    uint32_t dropped;               // Unsent records overwritten while full
+    uint32_t corrupt;               // Torn writes skipped at mount
+    uint32_t erases;
+    uint32_t writeFailures;
+} QueueStats;
+
+// Bounded store-and-forward queue of small records, written as a log
+// across a ring of flash sectors. Each sector starts with a sequence
+// number so the order survives a reboot; each record carries a check
+// byte so a write torn by a reset is skipped. Sent records are marked by
+// clearing one byte in place. When the ring is full the oldest sector is
+// erased, unsent or not.
+class TelemetryQueue {
+private:
+    FlashStorage storage;
+    bool mounted;
+    uint32_t headSequence;
+    QueueCursor head;               // Next free byte
+    QueueCursor tail;               // First unsent record
+    uint32_t pending;
+    QueueStats stats;
+
+    uint32_t address(const QueueCursor& c) const { return (uint32_t)c.sector * TELEMETRY_SECTOR_SIZE + c.offset; }
+    bool readSequence(uint16_t sector, uint32_t& sequence);
+    bool openSector(uint16_t sector, uint32_t sequence);
+    void dropSector(uint16_t sector);
+    void scan(uint16_t sector, bool isHead);
+
+public:
+    TelemetryQueue();
+
+    // Recovers head, tail and the pending count, or formats the ring
+    bool begin(const FlashStorage& flash);
+    bool isMounted() const { return mounted; }
+
+    bool push(uint8_t type, const void* data, uint8_t length);
+
+    // Oldest unsent records, up to max records or maxBytes of payload;
+    // next is where reading stopped, to hand to markSent()
+    uint8_t peek(TelemetryRecord* out, uint8_t max, size_t maxBytes, QueueCursor& next);
+    void markSent(const QueueCursor& next);
+
+    uint32_t getPending() const { return pending; }
+    uint32_t getCapacityBytes() const { return (uint32_t)storage.sectors * TELEMETRY_SECTOR_SIZE; }
+    const QueueStats& getStats() const { return stats; }
+};
+
+#endif // TELEMETRY_QUEUE_H
@@ -0,0 +1,362 @@
+#include "track_store.h"
+#include <string.h>
+#include <math.h>
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#define TRACK_MICROS() micros()
+#else
+#include <chrono>
+#define TRACK_MICROS() ((uint32_t)std::chrono::duration_cast<std::chrono::microseconds>( \
+    std::chrono::steady_clock::now().time_since_epoch()).count())
+#endif
+
+// Metres per 1e-6 degree of latitude
+#define METERS_PER_E6 0.11132f
+#define RADIANS_PER_DEGREE 0.0174532925f
+
+// Worst case for one (dt, dlat, dlon) record: three 5-byte varints
+#define MAX_RECORD_BYTES 15
+
+// Wider than any track on Earth: a query pass at this tolerance keeps only
+// the first and last points
+#define MAX_QUERY_TOLERANCE_M 4.0e7f
+
+// ================= TrackSimplifier =================
+
+TrackSimplifier::TrackSimplifier(float tolerance, float deadband, uint32_t maxGap)
+    : toleranceM(tolerance), deadbandM(deadband), maxGapS(maxGap) {
+    reset();
+}
+
+void TrackSimplifier::reset() {
+    hasAnchor = false;
+    metersPerLonE6 = METERS_PER_E6;
+    windowStart = 0;
+    windowCount = 0;
+}
+
+void TrackSimplifier::toLocal(const TrackPoint& point, float& x, float& y) const {
+    x = (float)(point.longitudeE6 - anchor.longitudeE6) * metersPerLonE6;
+    y = (float)(point.latitudeE6 - anchor.latitudeE6) * METERS_PER_E6;
+}
+
+float TrackSimplifier::segmentDistance(const TrackPoint& point, float bx, float by) const {
+    float px, py;
+    toLocal(point, px, py);
+
+    float lengthSq = bx * bx + by * by;
+    float t = 0.0f;
+    if (lengthSq > 0.0f) {
+        t = (px * bx + py * by) / lengthSq;
+        if (t < 0.0f) t = 0.0f;
+        if (t > 1.0f) t = 1.0f;
+    }
+
+    float dx = px - t * bx;
+    float dy = py - t * by;
+    return sqrtf(dx * dx + dy * dy);
+}
+
+const TrackPoint& TrackSimplifier::lastPending() const {
+    return window[(windowStart + windowCount - 1) % TRACK_WINDOW_POINTS];
+}
+
+void TrackSimplifier::emit(const TrackPoint& point, TrackPointSink sink, void* context) {
+    anchor = point;
+    hasAnchor = true;
+    metersPerLonE6 = METERS_PER_E6 * cosf((float)point.latitudeE6 * 1e-6f * RADIANS_PER_DEGREE);
+    windowStart = 0;
+    windowCount = 0;
+
+    if (sink) sink(point, context);
+}
+
+void TrackSimplifier::add(const TrackPoint& point, TrackPointSink sink, void* context) {
+    if (!hasAnchor) {
+        emit(point, sink, context);
+        return;
+    }
+
+    float bx, by;
+    toLocal(point, bx, by);
+    bool gapExceeded = maxGapS > 0 && point.timestamp - anchor.timestamp >= maxGapS;
+
+    // Standing still: drop jitter around the anchor, but keep a heartbeat
+    if (windowCount == 0 && sqrtf(bx * bx + by * by) < deadbandM) {
+        if (gapExceeded) emit(point, sink, context);
+        return;
+    }
+
+    bool fits = !gapExceeded;
+    for (uint8_t i = 0; fits && i < windowCount; i++) {
+        const TrackPoint& pending = window[(windowStart + i) % TRACK_WINDOW_POINTS];
+        if (segmentDistance(pending, bx, by) > toleranceM) fits = false;
+    }
+
+    if (!fits) {
+        if (windowCount == 0) {
+            emit(point, sink, context);
+            return;
+        }
+        // The last pending point was the furthest one that still fit
+        TrackPoint pivot = lastPending();
+        emit(pivot, sink, context);
+    }
+
+    if (windowCount < TRACK_WINDOW_POINTS) {
+        window[(windowStart + windowCount) % TRACK_WINDOW_POINTS] = point;
+        windowCount++;
+    } else {
+        window[windowStart] = point;
+        windowStart = (windowStart + 1) % TRACK_WINDOW_POINTS;
+    }
+}
+
+void TrackSimplifier::flush(TrackPointSink sink, void* context) {
+    if (windowCount > 0) {
+        TrackPoint pivot = lastPending();
+        emit(pivot, sink, context);
+    }
+}
+
+bool TrackSimplifier::peekPending(TrackPoint& point) const {
+    if (windowCount == 0) return false;
+    point = lastPending();
+    return true;
+}
+
+// ================= TrackStore =================
+
+TrackStore::TrackStore() {
+    clear();
+}
+
+void TrackStore::clear() {
+    oldestBlock = 0;
+    blockCount = 0;
+    simplifier.reset();
+    memset(&stats, 0, sizeof(stats));
+}
+
+uint8_t TrackStore::writeVarint(uint8_t* out, int32_t value) {
+    uint32_t zigzag = ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+    uint8_t n = 0;
+    while (zigzag >= 0x80) {
+        out[n++] = (uint8_t)(zigzag | 0x80);
+        zigzag >>= 7;
+    }
+    out[n++] = (uint8_t)zigzag;
+    return n;
+}
+
+uint8_t TrackStore::readVarint(const uint8_t* in, int32_t& value) {
+    uint32_t zigzag = 0;
+    uint8_t n = 0;
+    uint8_t shift = 0;
+    uint8_t byte;
+    do {
+        byte = in[n++];
+        zigzag |= (uint32_t)(byte & 0x7F) << shift;
+        shift += 7;
+    } while ((byte & 0x80) && n < 5);
+    value = (int32_t)(zigzag >> 1) ^ -(int32_t)(zigzag & 1);
+    return n;
+}
+
+TrackStore::TrackBlock& TrackStore::newestBlock() {
+    return blocks[(oldestBlock + blockCount - 1) % TRACK_BLOCK_COUNT];
+}
+
+void TrackStore::openBlock(const TrackPoint& point) {
+    if (blockCount == TRACK_BLOCK_COUNT) {
+        TrackBlock& evicted = blocks[oldestBlock];
+        uint32_t evictedBytes = sizeof(TrackPoint) + evicted.used;
+        stats.pointsStored -= evicted.count;
+        stats.bytesUsed -= evictedBytes;
+        stats.bytesEvicted += evictedBytes;
+        stats.blocksEvicted++;
+        oldestBlock = (oldestBlock + 1) % TRACK_BLOCK_COUNT;
+        blockCount--;
+    }
+
+    blockCount++;
+    TrackBlock& block = newestBlock();
+    block.first = point;
+    block.lastTimestamp = point.timestamp;
+    block.used = 0;
+    block.count = 1;
+
+    lastStored = point;
+    stats.pointsStored++;
+    stats.bytesUsed += sizeof(TrackPoint);
+}
+
+void TrackStore::store(const TrackPoint& point) {
+    if (blockCount == 0 || newestBlock().used + MAX_RECORD_BYTES > TRACK_BLOCK_BYTES) {
+        openBlock(point);
+        return;
+    }
+
+    TrackBlock& block = newestBlock();
+    uint8_t* out = block.data + block.used;
+    uint8_t n = writeVarint(out, (int32_t)(point.timestamp - lastStored.timestamp));
+    n += writeVarint(out + n, point.latitudeE6 - lastStored.latitudeE6);
+    n += writeVarint(out + n, point.longitudeE6 - lastStored.longitudeE6);
+
+    block.used += n;
+    block.count++;
+    block.lastTimestamp = point.timestamp;
+
+    lastStored = point;
+    stats.pointsStored++;
+    stats.bytesUsed += n;
+}
+
+void TrackStore::storeSink(const TrackPoint& point, void* context) {
+    static_cast<TrackStore*>(context)->store(point);
+}
+
+void TrackStore::append(uint32_t timestamp, double latitude, double longitude) {
+    uint32_t start = TRACK_MICROS();
+
+    TrackPoint point;
+    point.timestamp = timestamp;
+    point.latitudeE6 = (int32_t)lround(latitude * 1e6);
+    point.longitudeE6 = (int32_t)lround(longitude * 1e6);
+    simplifier.add(point, storeSink, this);
+
+    uint32_t elapsed = TRACK_MICROS() - start;
+    stats.fixesAppended++;
+    stats.totalAppendMicros += elapsed;
+    if (elapsed > stats.maxAppendMicros) stats.maxAppendMicros = elapsed;
+}
+
+uint32_t TrackStore::scan(uint32_t from, uint32_t to, TrackPointSink sink, void* context) {
+    uint32_t visited = 0;
+
+    for (uint8_t b = 0; b < blockCount; b++) {
+        const TrackBlock& block = blocks[(oldestBlock + b) % TRACK_BLOCK_COUNT];
+        if (block.lastTimestamp < from) continue;
+        if (block.first.timestamp > to) break;
+
+        TrackPoint point = block.first;
+        uint16_t pos = 0;
+        for (uint16_t i = 0; i < block.count; i++) {
+            if (i > 0) {
+                int32_t dt, dlat, dlon;
+                pos += readVarint(block.data + pos, dt);
+                pos += readVarint(block.data + pos, dlat);
+                pos += readVarint(block.data + pos, dlon);
+                point.timestamp += (uint32_t)dt;
+                point.latitudeE6 += dlat;
+                point.longitudeE6 += dlon;
+            }
+            if (point.timestamp > to) return visited;
+            if (point.timestamp < from) continue;
+
+            if (sink) sink(point, context);
+            visited++;
+        }
+    }
+    return visited;
+}
+
+// One simplification pass over a query range
+typedef struct {
+    TrackSimplifier* simplifier;
+    TrackPointSink sink;
+    void* context;
+    uint32_t emitted;
+} TrackQueryPass;
+
+static void queryEmit(const TrackPoint& point, void* context) {
+    TrackQueryPass* pass = static_cast<TrackQueryPass*>(context);
+    pass->emitted++;
+    if (pass->sink) pass->sink(point, pass->context);
+}
+
+static void queryFeed(const TrackPoint& point, void* context) {
+    TrackQueryPass* pass = static_cast<TrackQueryPass*>(context);
+    pass->simplifier->add(point, queryEmit, pass);
+}
+
+static void keepLast(const TrackPoint& point, void* context) {
+    *static_cast<TrackPoint*>(context) = point;
+}
+
+uint32_t TrackStore::query(uint32_t from, uint32_t to, uint16_t maxPoints,
+                           TrackPointSink sink, void* context) {
+    // Include the not-yet-committed tail so the track reaches the latest fix
+    TrackPoint tail;
+    bool hasTail = simplifier.peekPending(tail) &&
+                   tail.timestamp >= from && tail.timestamp <= to;
+
+    uint32_t available = scan(from, to, NULL, NULL) + (hasTail ? 1 : 0);
+    if (maxPoints == 0 || available <= maxPoints) {
+        scan(from, to, sink, context);
+        if (hasTail && sink) sink(tail, context);
+        return available;
+    }
+
+    // A line needs two points; one is where the wearer is now
+    if (maxPoints == 1) {
+        TrackPoint last = tail;
+        if (!hasTail) scan(from, to, keepLast, &last);
+        if (sink) sink(last, context);
+        return 1;
+    }
+
+    // Over budget: double the tolerance until a counting pass fits, which
+    // two points always do. Each pass is a streaming decode, so memory
+    // stays constant.
+    float tolerance = TRACK_TOLERANCE_M * 2.0f;
+    for (;;) {
+        TrackSimplifier counter(tolerance, 0.0f, 0);
+        TrackQueryPass pass = { &counter, NULL, NULL, 0 };
+        scan(from, to, queryFeed, &pass);
+        if (hasTail) queryFeed(tail, &pass);
+        counter.flush(queryEmit, &pass);
+        if (pass.emitted <= maxPoints || tolerance >= MAX_QUERY_TOLERANCE_M) break;
+        tolerance *= 2.0f;
+    }
+
+    TrackSimplifier reducer(tolerance, 0.0f, 0);
+    TrackQueryPass pass = { &reducer, sink, context, 0 };
+    scan(from, to, queryFeed, &pass);
+    if (hasTail) queryFeed(tail, &pass);
+    reducer.flush(queryEmit, &pass);
+    return pass.emitted;
+}
+
+TrackStats TrackStore::getStats() {
+    return stats;
+}
+
+uint32_t TrackStore::getPointCount() {
+    return stats.pointsStored;
+}
+
+float TrackStore::getCompressionRatio() {
+    uint32_t written = stats.bytesUsed + stats.bytesEvicted;
+    if (written == 0) return 0.0f;
+    return (float)stats.fixesAppended * sizeof(TrackPoint) / written;
+}
+
+float TrackStore::getAverageAppendMicros() {
+    if (stats.fixesAppended == 0) return 0.0f;
+    return (float)stats.totalAppendMicros / stats.fixesAppended;
+}
+
+// ================= Device =================
+
+#ifdef ARDUINO
+TrackStore trackStore;
+
+void TrackStore::printStats() {
+    Serial.printf("Track: %lu fixes -> %lu points, %lu bytes (%.1fx), append avg %.1f us max %lu us\n",
+                  (unsigned long)stats.fixesAppended, (unsigned long)stats.pointsStored,
+                  (unsigned long)stats.bytesUsed, getCompressionRatio(),
+                  getAverageAppendMicros(), (unsigned long)stats.maxAppendMicros);
+}
+#endif
@@ -0,0 +1,121 @@
+#ifndef TRACK_STORE_H
+#define TRACK_STORE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "config.h"
+
+// A single breadcrumb. Coordinates are fixed point (degrees * 1e6),
+// which keeps ~0.1 m resolution and makes deltas small integers.
+typedef struct {
+    uint32_t timestamp;     // Seconds since boot
+    int32_t latitudeE6;
+    int32_t longitudeE6;
+} TrackPoint;
+
+// Compression and cost counters
+typedef struct {
+    uint32_t fixesAppended;
+    uint32_t pointsStored;
+    uint32_t bytesUsed;
+    uint32_t blocksEvicted;
+    uint32_t bytesEvicted;
+    uint32_t totalAppendMicros;
+    uint32_t maxAppendMicros;
+} TrackStats;
+
+typedef void (*TrackPointSink)(const TrackPoint& point, void* context);
+
+// Online line simplifier (opening window). The anchor is the last emitted
+// point; a new point is accepted into the window as long as every pending
+// point stays within the tolerance of the anchor->new segment. When the
+// window is full the oldest pending point is dropped from the check set,
+// so memory stays bounded at TRACK_WINDOW_POINTS.
+class TrackSimplifier {
+private:
+    float toleranceM;
+    float deadbandM;
+    uint32_t maxGapS;
+
+    TrackPoint anchor;
+    bool hasAnchor;
+    float metersPerLonE6;
+
+    TrackPoint window[TRACK_WINDOW_POINTS];
+    uint8_t windowStart;
+    uint8_t windowCount;
+
+    void toLocal(const TrackPoint& point, float& x, float& y) const;
+    float segmentDistance(const TrackPoint& point, float bx, float by) const;
+    void emit(const TrackPoint& point, TrackPointSink sink, void* context);
+    const TrackPoint& lastPending() const;
+
+public:
+    TrackSimplifier(float tolerance = TRACK_TOLERANCE_M,
+                    float deadband = TRACK_DEADBAND_M,
+                    uint32_t maxGap = TRACK_MAX_GAP_S);
+
+    void reset();
+    void add(const TrackPoint& point, TrackPointSink sink, void* context);
+    void flush(TrackPointSink sink, void* context);
+    bool peekPending(TrackPoint& point) const;
+};
+
+// Breadcrumb store. Points are kept in a ring of fixed-size blocks; each
+// block starts with an absolute keyframe followed by zigzag-varint deltas
+// (dt, dlat, dlon), so evicting the oldest block never breaks decoding.
+class TrackStore {
+private:
+    typedef struct {
+        TrackPoint first;
+        uint32_t lastTimestamp;
+        uint16_t used;
+        uint16_t count;
+        uint8_t data[TRACK_BLOCK_BYTES];
+    } TrackBlock;
+
+    TrackBlock blocks[TRACK_BLOCK_COUNT];
+    uint8_t oldestBlock;
+    uint8_t blockCount;
+    TrackPoint lastStored;
+
+    TrackSimplifier simplifier;
+    TrackStats stats;
+
+    static void storeSink(const TrackPoint& point, void* context);
+    void store(const TrackPoint& point);
+    TrackBlock& newestBlock();
+    void openBlock(const TrackPoint& point);
+
+    // Visits stored points in [from, to], oldest first
+    uint32_t scan(uint32_t from, uint32_t to, TrackPointSink sink, void* context);
+
+public:
+    TrackStore();
+
+    void clear();
+    void append(uint32_t timestamp, double latitude, double longitude);
+
+    // Streams the points in [from, to] to sink, simplified so that at most
+    // maxPoints are emitted (0 = no budget; 1 = the latest point). Returns
+    // the number emitted.
+    uint32_t query(uint32_t from, uint32_t to, uint16_t maxPoints,
+                   TrackPointSink sink, void* context);
+
+    TrackStats getStats();
+    uint32_t getPointCount();
+    float getCompressionRatio();
+    float getAverageAppendMicros();
+
+    // Zigzag varint of the block records, at most 5 bytes
+    static uint8_t writeVarint(uint8_t* out, int32_t value);
+    static uint8_t readVarint(const uint8_t* in, int32_t& value);
+
+#ifdef ARDUINO
+    void printStats();
+#endif
+};
+
+extern TrackStore trackStore;
+
+#endif // TRACK_STORE_H
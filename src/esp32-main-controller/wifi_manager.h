@@ -4,45 +4,27 @@
 #include <Arduino.h>
 #include <WiFi.h>
 #include <WebServer.h>
-#include <ArduinoJson.h>
+#include "route_table.h"
+#include "client_tracker.h"
+#include "json_stream.h"
 
-// WiFi modes
+// WiFi modes (prefixed to stay clear of the IDF's WIFI_MODE_* values)
 typedef enum {
-    WIFI_MODE_AP,           // Access Point mode
-    WIFI_MODE_STATION,      // Station mode
-    WIFI_MODE_DUAL          // Both AP and Station
+    WIFI_MANAGER_AP,        // Access Point mode
+    WIFI_MANAGER_STATION,   // Station mode
+    WIFI_MANAGER_DUAL       // Both AP and Station
 } WiFiMode;
 
-// Client connection structure
-typedef struct {
-    String macAddress;
-    String ipAddress;
-    uint32_t connectTime;
-    uint8_t rssi;
-    bool isActive;
-} WiFiClient;
-
-// API endpoint structure
-typedef struct {
-    String path;
-    String method;
-    void (*handler)();
-    uint32_t lastAccess;
-    uint32_t accessCount;
-} APIEndpoint;
-
 class WiFiManager {
 private:
     WebServer* server;
     WiFiMode currentMode;
     
-    // Client management
-    WiFiClient clients[8];
-    uint8_t clientCount;
+    // Client management: tracked from WiFi events, see client_tracker.h
+    ClientTracker* tracker;
     
-    // API management
-    APIEndpoint endpoints[16];
-    uint8_t endpointCount;
+    // API management: constexpr route table, see route_table.h
+    Router* router;
     
     // Statistics
     uint32_t totalRequests;
@@ -52,9 +34,9 @@ private:
     // Private methods
     void handleNotFound();
     void handleCORS();
-    void sendJSON(JsonDocument& doc, int statusCode = 200);
+    void sendJSON(void (*write)(JsonStream& json), int statusCode = 200);
     void logRequest(String method, String path);
-    bool checkRateLimit(String clientIP);
+    bool checkRateLimit(uint32_t clientIP);     // See rate_limiter.h
 
 public:
     WiFiManager();
@@ -66,11 +48,10 @@ public:
     WiFiMode getMode();
     
     // Client management
-    void updateClientList();
-    WiFiClient* getConnectedClients();
+    uint8_t getConnectedClients(WiFiClientRecord* out, uint8_t max);
     uint8_t getClientCount();
-    bool isClientConnected(String macAddress);
-    void disconnectClient(String macAddress);
+    bool isClientConnected(const uint8_t* mac);
+    void disconnectClient(const uint8_t* mac);
     
     // Server management
     bool startServer(int port = 80);
@@ -78,9 +59,8 @@ public:
     void handleRequests();
     
     // API endpoint management
-    void registerEndpoint(const char* path, const char* method, void (*handler)());
-    void unregisterEndpoint(const char* path);
-    APIEndpoint* getEndpoint(const char* path);
+    void setRouter(Router& routes);
+    const RouteStats* getEndpointStats(RouteMethod method, const char* path);
     
     // Built-in endpoints
     void handleStatus();
@@ -105,7 +85,7 @@ public:
     float getThroughput();
     
     // Advanced features
-    void enableOTA(bool enabled);
+    void enableOTA(bool enabled);   // The sketch uses OtaUpdater (ota_patch.h)
     void enableMDNS(bool enabled);
     void setCaptivePortal(bool enabled);
     bool scanNetworks();
@@ -125,14 +105,14 @@ public:
     int getRSSI();
     
     // JSON helpers
-    void createStatusJSON(JsonDocument& doc);
-    void createGPSJSON(JsonDocument& doc);
-    void createSensorJSON(JsonDocument& doc);
-    void createConfigJSON(JsonDocument& doc);
+    void writeStatusJSON(JsonStream& json);
+    void writeGPSJSON(JsonStream& json);
+    void writeSensorJSON(JsonStream& json);
+    void writeConfigJSON(JsonStream& json);
     
     // Callback functions
-    void setClientConnectCallback(void (*callback)(WiFiClient));
-    void setClientDisconnectCallback(void (*callback)(WiFiClient));
+    void setClientConnectCallback(ClientCallback callback);
+    void setClientDisconnectCallback(ClientCallback callback);
     void setAPIAccessCallback(void (*callback)(String, String));
 };
 
@@ -0,0 +1,82 @@
+#include "espnow_packet.h"
+
+#define PACKET_CRC_OFFSET offsetof(PacketHeader, crc)
+
+uint16_t packetCrc16(uint16_t crc, const uint8_t* data, size_t length) {
+    static const uint16_t table[16] = {
+        0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+        0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+    };
+    for (size_t i = 0; i < length; i++) {
+        crc = (uint16_t)((crc << 4) ^ table[((crc >> 12) ^ (data[i] >> 4)) & 0x0F]);
+        crc = (uint16_t)((crc << 4) ^ table[((crc >> 12) ^ data[i]) & 0x0F]);
+    }
+    return crc;
+}
+
+// ================= Encoding =================
+
+uint8_t* beginPacket(uint8_t* buffer, PacketType type, uint8_t nodeId, uint16_t sequence,
+                     uint32_t timestampUs) {
+    PacketHeader* header = reinterpret_cast<PacketHeader*>(buffer);
+    header->versionType = (uint8_t)(PACKET_VERSION << 4 | (type & 0x0F));
+    header->nodeId = nodeId;
+    header->sequence = sequence;
+    header->timestampUs = timestampUs;
+    header->length = 0;
+    header->crc = 0;
+    return buffer + sizeof(PacketHeader);
+}
+
+size_t sealPacket(uint8_t* buffer, size_t payloadLength) {
+    if (payloadLength > PACKET_MAX_SIZE - sizeof(PacketHeader)) return 0;
+    PacketHeader* header = reinterpret_cast<PacketHeader*>(buffer);
+    header->length = (uint8_t)payloadLength;
+    uint16_t crc = packetCrc16(0xFFFF, buffer, PACKET_CRC_OFFSET);
+    header->crc = packetCrc16(crc, buffer + sizeof(PacketHeader), payloadLength);
+    return sizeof(PacketHeader) + payloadLength;
+}
+
+// ================= Decoding =================
+
+// Trailing bytes past the payload are ignored, so a sender may pad
+PacketError parsePacket(const uint8_t* data, size_t length, PacketView* view) {
+    if (length < sizeof(PacketHeader)) return PACKET_TRUNCATED;
+    const PacketHeader* header = reinterpret_cast<const PacketHeader*>(data);
+    if ((header->versionType >> 4) != PACKET_VERSION) return PACKET_BAD_VERSION;
+    if (length - sizeof(PacketHeader) < header->length) return PACKET_TRUNCATED;
+
+    uint16_t crc = packetCrc16(0xFFFF, data, PACKET_CRC_OFFSET);
+    crc = packetCrc16(crc, data + sizeof(PacketHeader), header->length);
+    if (crc != header->crc) return PACKET_BAD_CRC;
+
+    view->header = header;
+    view->payload = data + sizeof(PacketHeader);
+    return PACKET_OK;
+}
+
+const char* getPacketErrorName(PacketError error) {
+    switch (error) {
+        case PACKET_OK: return "ok";
+        case PACKET_TRUNCATED: return "truncated";
+        case PACKET_BAD_VERSION: return "bad version";
+        case PACKET_BAD_CRC: return "bad CRC";
+    }
+    return "unknown";
+}
+
+const DistancePayload* getDistancePayload(const PacketView& view) {
+    if (packetType(view) != PACKET_DISTANCE || view.header->length < offsetof(DistancePayload, readings)) {
+        return NULL;
+    }
+    const DistancePayload* payload = reinterpret_cast<const DistancePayload*>(view.payload);
+    if (payload->count > PACKET_READINGS_MAX || view.header->length != distancePayloadSize(payload->count)) {
+        return NULL;
+    }
+    return payload;
+}
+
+const StatusPayload* getStatusPayload(const PacketView& view) {
+    if (packetType(view) != PACKET_STATUS || view.header->length != sizeof(StatusPayload)) return NULL;
+    return reinterpret_cast<const StatusPayload*>(view.payload);
+}
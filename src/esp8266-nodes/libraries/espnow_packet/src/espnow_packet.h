@@ -0,0 +1,116 @@
+#ifndef ESPNOW_PACKET_H
+#define ESPNOW_PACKET_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ESP-NOW wire format shared by every node.
+
+// ================= Packet =================
+//
+// 11-byte header, packed, little endian, then `length` payload bytes:
+//   0 version << 4 | type   1 node id   2 sequence u16
+//   4 timestamp us u32      8 payload length   9 CRC u16
+//
+// The CRC (CRC-16/CCITT-FALSE) covers the 9 header bytes before it and
+// the payload. Structs are packed so a received buffer can be read in
+// place: every field has alignment 1 and the compiler loads multi-byte
+// fields bytewise, which the ESP8266 needs for unaligned addresses.
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "espnow_packet.h assumes a little-endian target"
+#endif
+
+#define PACKET_VERSION 1
+#define PACKET_MAX_SIZE 250             // ESP-NOW payload limit
+#define PACKET_READINGS_MAX 4
+#define PACKET_NO_READING 0xFFFF        // Sensor did not answer
+
+#define PACKET_PACKED __attribute__((packed))
+
+typedef enum {
+    PACKET_DISTANCE = 1,                // DistancePayload
+    PACKET_STATUS = 2                   // StatusPayload
+} PacketType;
+
+typedef struct PACKET_PACKED {
+    uint8_t versionType;
+    uint8_t nodeId;
+    uint16_t sequence;                  // Per node, wraps
+    uint32_t timestampUs;               // Sender's micros() when measured
+    uint8_t length;                     // Payload bytes
+    uint16_t crc;
+} PacketHeader;
+
+static_assert(sizeof(PacketHeader) == 11, "PacketHeader must stay packed");
+
+// ================= Payloads =================
+
+typedef struct PACKET_PACKED {
+    uint16_t distance;                  // cm; PACKET_NO_READING if the sensor did not answer
+    uint8_t confidence;                 // %
+} PacketReading;
+
+// Only `count` readings are sent
+typedef struct PACKET_PACKED {
+    uint8_t rate;                       // Sampling rate (Hz)
+    uint8_t count;
+    PacketReading readings[PACKET_READINGS_MAX];
+} DistancePayload;
+
+typedef struct PACKET_PACKED {
+    uint8_t battery;                    // %
+    int16_t temperature;                // 0.1 °C
+    uint8_t humidity;                   // %
+    uint16_t light;                     // Raw ADC reading
+    int8_t rssi;                        // dBm
+    uint8_t errorFlags;
+} StatusPayload;
+
+inline size_t distancePayloadSize(uint8_t count) {
+    return offsetof(DistancePayload, readings) + count * sizeof(PacketReading);
+}
+
+static_assert(sizeof(PacketHeader) + sizeof(DistancePayload) <= PACKET_MAX_SIZE, "Distance packet too large");
+
+// ================= Encoding =================
+
+typedef enum {
+    PACKET_OK,
+    PACKET_TRUNCATED,                   // Shorter than the header, or than its length says
+    PACKET_BAD_VERSION,
+    PACKET_BAD_CRC
+} PacketError;
+
+// A parsed packet, pointing into the received buffer
+typedef struct {
+    const PacketHeader* header;
+    const uint8_t* payload;
+} PacketView;
+
+// CRC-16/CCITT-FALSE, continued from a previous value (start at 0xFFFF)
+uint16_t packetCrc16(uint16_t crc, const uint8_t* data, size_t length);
+
+// Writes the header at the start of buffer (PACKET_MAX_SIZE bytes) and
+// returns where the payload goes
+uint8_t* beginPacket(uint8_t* buffer, PacketType type, uint8_t nodeId, uint16_t sequence,
+                     uint32_t timestampUs);
+// Fills in the length and CRC once the payload is written; returns the
+// bytes to send, 0 if the payload does not fit
+size_t sealPacket(uint8_t* buffer, size_t payloadLength);
+
+// Checks length, version and CRC without copying
+PacketError parsePacket(const uint8_t* data, size_t length, PacketView* view);
+const char* getPacketErrorName(PacketError error);
+
+inline uint8_t packetVersion(const PacketView& view) { return view.header->versionType >> 4; }
+inline uint8_t packetType(const PacketView& view) { return view.header->versionType & 0x0F; }
+
+// The payload of a parsed packet, or NULL if it is another type or malformed
+const DistancePayload* getDistancePayload(const PacketView& view);
+const StatusPayload* getStatusPayload(const PacketView& view);
+
+// Sequence a is after b, across the wrap
+inline bool sequenceAfter(uint16_t a, uint16_t b) { return (int16_t)(a - b) > 0; }
+
+#endif // ESPNOW_PACKET_H
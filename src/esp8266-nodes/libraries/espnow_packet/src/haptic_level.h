@@ -0,0 +1,20 @@
+#ifndef HAPTIC_LEVEL_H
+#define HAPTIC_LEVEL_H
+
+#include <stdint.h>
+
+// Distance-to-haptic mapping shared by the nodes: the receiver drives one
+// motor more per band, and the transmitter sends whenever a reading moves
+// into another band.
+
+#define HAPTIC_LEVELS 5
+
+// Motors on for a distance: none beyond 100 cm, one more per 20 cm closer
+inline uint8_t hapticLevel(uint16_t cm) {
+    static const uint16_t bands[HAPTIC_LEVELS] = { 100, 80, 60, 40, 20 };
+    uint8_t level = 0;
+    while (level < HAPTIC_LEVELS && cm <= bands[level]) level++;
+    return level;
+}
+
+#endif // HAPTIC_LEVEL_H
@@ -27,6 +27,10 @@
 // ================= ESP-NOW Settings =================
 #define CHANNEL 1               // WiFi channel for ESP-NOW
 #define PACKET_SIZE 32          // ESP-NOW packet size
+#define PACKET_RING_SIZE 8      // Packets queued from the callback for loop() (power of two)
+#define NODE_TRACK_MAX 4        // Transmitters whose sequence numbers are tracked
+#define RESTART_SEQUENCE_GAP 256    // A sequence this far behind the last is a rebooted node
+#define RESTART_TIME_GAP_US 1000000 // So is a timestamp this far behind the last (us)
 
 // ================= Power Management =================
 #define DEEP_SLEEP_ENABLED false     // Enable deep sleep mode
@@ -37,6 +41,7 @@
 // ================= Debug Settings =================
 #define DEBUG_ENABLED true       // Enable serial debug output
 #define BAUD_RATE 115200        // Serial communication speed
+#define STATS_INTERVAL 5000     // Callback time and queue report interval (ms)
 
 // ================= Safety Features =================
 #define WATCHDOG_TIMEOUT 5000    // Watchdog timer timeout (ms)
@@ -0,0 +1,52 @@
+#include "node_tracker.h"
+#include <string.h>
+
+NodeTracker::NodeTracker() {
+    memset(nodes, 0, sizeof(nodes));
+}
+
+NodeState* NodeTracker::lookup(uint8_t nodeId, uint32_t nowMs) {
+    NodeState* oldest = &nodes[0];
+    for (uint8_t i = 0; i < NODE_TRACK_MAX; i++) {
+        if (nodes[i].used && nodes[i].nodeId == nodeId) return &nodes[i];
+        if (!oldest->used) continue;
+        if (!nodes[i].used || nowMs - nodes[i].lastHeardMs > nowMs - oldest->lastHeardMs) oldest = &nodes[i];
+    }
+    memset(oldest, 0, sizeof(*oldest));
+    oldest->nodeId = nodeId;
+    return oldest;
+}
+
+NodeVerdict NodeTracker::accept(const PacketHeader& header, uint32_t nowMs) {
+    NodeState* node = lookup(header.nodeId, nowMs);
+    uint16_t sequence = header.sequence;
+    uint32_t timestampUs = header.timestampUs;
+    NodeVerdict verdict = NODE_ACCEPTED;
+
+    if (node->used) {
+        // Wrap-safe: micros() and the sequence both roll over in service
+        bool timeBack = (int32_t)(timestampUs - node->lastTimestampUs) < -(int32_t)RESTART_TIME_GAP_US;
+        bool sequenceBack = (uint16_t)(node->lastSequence - sequence) > RESTART_SEQUENCE_GAP &&
+                            !sequenceAfter(sequence, node->lastSequence);
+        if (timeBack || sequenceBack) {
+            node->restarts++;
+            verdict = NODE_RESTARTED;
+        } else if (!sequenceAfter(sequence, node->lastSequence)) {
+            return NODE_STALE;
+        } else {
+            node->lost += (uint16_t)(sequence - node->lastSequence - 1);
+        }
+    }
+    node->used = true;
+    node->lastSequence = sequence;
+    node->lastTimestampUs = timestampUs;
+    node->lastHeardMs = nowMs;
+    return verdict;
+}
+
+const NodeState* NodeTracker::getNode(uint8_t nodeId) const {
+    for (uint8_t i = 0; i < NODE_TRACK_MAX; i++) {
+        if (nodes[i].used && nodes[i].nodeId == nodeId) return &nodes[i];
+    }
+    return NULL;
+}
@@ -0,0 +1,45 @@
+#ifndef NODE_TRACKER_H
+#define NODE_TRACKER_H
+
+#include <stdint.h>
+#include <espnow_packet.h>
+#include "config.h"
+
+typedef enum {
+    NODE_ACCEPTED,
+    NODE_RESTARTED,                 // Accepted; the node rebooted and was resynced
+    NODE_STALE                      // Repeated or out of order, dropped
+} NodeVerdict;
+
+// Sequence state of one transmitter
+typedef struct {
+    uint8_t nodeId;
+    bool used;
+    uint16_t lastSequence;
+    uint32_t lastTimestampUs;
+    uint32_t lastHeardMs;
+    uint32_t lost;
+    uint32_t restarts;
+} NodeState;
+
+// Drops repeated and out-of-order packets per node and counts the ones
+// lost between them. A node that reboots starts again from sequence 0
+// and a timestamp near 0; a packet well behind the last on either is
+// taken as a restart and resyncs the node rather than being dropped. A
+// new node past NODE_TRACK_MAX replaces the one heard from longest ago.
+class NodeTracker {
+private:
+    NodeState nodes[NODE_TRACK_MAX];
+
+    NodeState* lookup(uint8_t nodeId, uint32_t nowMs);
+
+public:
+    NodeTracker();
+
+    NodeVerdict accept(const PacketHeader& header, uint32_t nowMs);
+
+    // NULL if the node has not been heard from
+    const NodeState* getNode(uint8_t nodeId) const;
+};
+
+#endif // NODE_TRACKER_H
@@ -0,0 +1,42 @@
+#include "packet_ring.h"
+#include <string.h>
+
+#define RING_MASK (PACKET_RING_SIZE - 1)
+
+PacketRing::PacketRing() : head(0), tail(0), dropped(0), highWater(0) {
+}
+
+// No read-modify-write atomics: the ESP8266 has none, and each counter
+// has a single writer
+bool PacketRing::push(const uint8_t* data, size_t length, uint32_t receivedUs) {
+    if (length > PACKET_MAX_SIZE) return false;
+    uint8_t h = head.load(std::memory_order_relaxed);
+    if ((uint8_t)(h - tail.load(std::memory_order_acquire)) >= PACKET_RING_SIZE) {
+        dropped.store(dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return false;
+    }
+    RingPacket& slot = slots[h & RING_MASK];
+    slot.receivedUs = receivedUs;
+    slot.length = (uint8_t)length;
+    memcpy(slot.data, data, length);
+    head.store((uint8_t)(h + 1), std::memory_order_release);
+    return true;
+}
+
+const RingPacket* PacketRing::front() {
+    uint8_t t = tail.load(std::memory_order_relaxed);
+    uint8_t queued = (uint8_t)(head.load(std::memory_order_acquire) - t);
+    if (queued == 0) return NULL;
+    if (queued > highWater) highWater = queued;
+    return &slots[t & RING_MASK];
+}
+
+void PacketRing::pop() {
+    uint8_t t = tail.load(std::memory_order_relaxed);
+    if (t == head.load(std::memory_order_acquire)) return;
+    tail.store((uint8_t)(t + 1), std::memory_order_release);
+}
+
+uint8_t PacketRing::size() const {
+    return (uint8_t)(head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire));
+}
@@ -0,0 +1,48 @@
+#ifndef PACKET_RING_H
+#define PACKET_RING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <espnow_packet.h>
+#include "config.h"
+
+static_assert((PACKET_RING_SIZE & (PACKET_RING_SIZE - 1)) == 0 && PACKET_RING_SIZE <= 128,
+              "PACKET_RING_SIZE must be a power of two up to 128");
+
+// A validated packet as it came off the radio
+typedef struct {
+    uint32_t receivedUs;
+    uint8_t length;
+    uint8_t data[PACKET_MAX_SIZE];
+} RingPacket;
+
+// Single-producer, single-consumer queue of packets. The ESP-NOW
+// callback pushes and loop() takes them in order, with no lock on either
+// side: each index is written by one side only, and published with
+// release ordering after the slot it covers. A packet that finds the
+// ring full is dropped and counted.
+class PacketRing {
+private:
+    RingPacket slots[PACKET_RING_SIZE];
+    std::atomic<uint8_t> head;      // Next slot to fill, producer only
+    std::atomic<uint8_t> tail;      // Next slot to take, consumer only
+    std::atomic<uint32_t> dropped;  // Producer only
+    uint8_t highWater;              // Consumer only
+
+public:
+    PacketRing();
+
+    // Producer: copies the packet; false if it is too long or the ring is full
+    bool push(const uint8_t* data, size_t length, uint32_t receivedUs);
+
+    // Consumer: the oldest packet, or NULL if empty; pop() releases it
+    const RingPacket* front();
+    void pop();
+
+    uint8_t size() const;
+    uint8_t getHighWater() const { return highWater; }
+    uint32_t getDropped() const { return dropped.load(std::memory_order_relaxed); }
+};
+
+#endif // PACKET_RING_H
@@ -1,65 +1,145 @@
 #include <ESP8266WiFi.h>
 #include <espnow.h>
+#include <espnow_packet.h>
+#include <haptic_level.h>
 
-// Define motor pins
-#define MOTOR1 D1
-#define MOTOR2 D2
-#define MOTOR3 D3
-#define MOTOR4 D4
-#define MOTOR5 D5
+#include "config.h"
+#include "packet_ring.h"
+#include "node_tracker.h"
 
-// Structure for receiving data
-typedef struct struct_message {
-  int distance;
-} struct_message;
+// The transmitter sends on change and at least every second; silence for
+// longer than this is a lost link
+#define LINK_TIMEOUT 3500       // ms
+#define LINK_LOST_PULSE 150     // While it is down, the first motor buzzes this long (ms)
+#define LINK_LOST_PERIOD 2000   // every this often (ms)
 
-struct_message incomingData;
+const uint8_t motorPins[HAPTIC_LEVELS] = {MOTOR1, MOTOR2, MOTOR3, MOTOR4, MOTOR5};
+uint8_t motorLevel = 0;
 
-// ESP-NOW receive callback
+// Filled by the ESP-NOW callback, drained by loop()
+PacketRing packetRing;
+
+// Written by the callback only
+volatile uint32_t callbackCount = 0;
+volatile uint32_t callbackTotalUs = 0;
+volatile uint32_t callbackMaxUs = 0;
+volatile uint32_t packetsRejected = 0;
+volatile uint8_t lastError = PACKET_OK;
+
+// Link state, loop() only
+uint32_t lastPacketMs = 0;
+bool linkUp = false;
+
+// Sequences per transmitter, to drop stale and repeated packets
+NodeTracker nodeTracker;
+bool heardFrom = false;
+uint32_t badPayloads = 0;
+
+// Reported every STATS_INTERVAL
+uint32_t lastStatsMs = 0;
+uint32_t reportedRejected = 0;
+uint32_t statsCallbacks = 0;
+uint32_t statsCallbackUs = 0;
+uint32_t logSkipped = 0;
+
+// One motor more per 20 cm band; pins are only written when the level changes
+void setMotors(uint8_t level) {
+  if (level == motorLevel) return;
+  for (uint8_t i = 0; i < HAPTIC_LEVELS; i++) {
+    digitalWrite(motorPins[i], i < level ? HIGH : LOW);
+  }
+  motorLevel = level;
+}
+
+// Runs in the WiFi stack: validates the packet and queues it, nothing else
 void OnDataRecv(uint8_t * mac, uint8_t *incomingDataBytes, uint8_t len) {
-  memcpy(&incomingData, incomingDataBytes, sizeof(incomingData));
-
-  int d = incomingData.distance;
-  Serial.print("Distance Received: ");
-  Serial.println(d);
-
-  // Reset all motors
-  digitalWrite(MOTOR1, LOW);
-  digitalWrite(MOTOR2, LOW);
-  digitalWrite(MOTOR3, LOW);
-  digitalWrite(MOTOR4, LOW);
-  digitalWrite(MOTOR5, LOW);
-
-  // Distance-to-haptic mapping
-  if (d <= 100 && d > 80) {
-    digitalWrite(MOTOR1, HIGH);
+  uint32_t start = micros();
+  PacketView packet;
+  PacketError error = parsePacket(incomingDataBytes, len, &packet);
+  if (error != PACKET_OK) {
+    lastError = error;
+    packetsRejected++;
+  } else {
+    // Padding past the payload stays behind; a full ring counts a drop
+    packetRing.push(incomingDataBytes, sizeof(PacketHeader) + packet.header->length, start);
   }
-  else if (d <= 80 && d > 60) {
-    digitalWrite(MOTOR1, HIGH);
-    digitalWrite(MOTOR2, HIGH);
+  uint32_t elapsed = micros() - start;
+  callbackTotalUs += elapsed;
+  callbackCount++;
+  if (elapsed > callbackMaxUs) callbackMaxUs = elapsed;
+}
+
+// Logging never waits for the UART: a line that does not fit its FIFO is skipped
+void logLine(const char *line) {
+  if (Serial.availableForWrite() >= (int)strlen(line) + 2) Serial.println(line);
+  else logSkipped++;
+}
+
+// One queued packet; true if it left a distance line to log
+bool handlePacket(const RingPacket &entry, char *line, size_t size) {
+  // Validated by the callback
+  PacketView packet;
+  packet.header = reinterpret_cast<const PacketHeader *>(entry.data);
+  packet.payload = entry.data + sizeof(PacketHeader);
+
+  // One sequence per node across packet types
+  uint8_t nodeId = packet.header->nodeId;
+  NodeVerdict verdict = nodeTracker.accept(*packet.header, millis());
+  if (verdict == NODE_STALE) return false;
+  if (verdict == NODE_RESTARTED) {
+    // Not in line: that holds the newest distance for loop() to log
+    char note[48];
+    snprintf(note, sizeof(note), "Node %u restarted, resynced at #%u", nodeId, packet.header->sequence);
+    logLine(note);
   }
-  else if (d <= 60 && d > 40) {
-    digitalWrite(MOTOR1, HIGH);
-    digitalWrite(MOTOR2, HIGH);
-    digitalWrite(MOTOR3, HIGH);
+  heardFrom = true;
+  lastPacketMs = millis();
+
+  // Status packets are for other listeners
+  if (packetType(packet) != PACKET_DISTANCE) return false;
+  const DistancePayload *data = getDistancePayload(packet);
+  if (!data) {
+    badPayloads++;
+    logLine("Packet rejected: bad distance payload");
+    return false;
   }
-  else if (d <= 40 && d > 20) {
-    digitalWrite(MOTOR1, HIGH);
-    digitalWrite(MOTOR2, HIGH);
-    digitalWrite(MOTOR3, HIGH);
-    digitalWrite(MOTOR4, HIGH);
+
+  // The nearest obstacle any sensor sees drives the motors
+  int d = PACKET_NO_READING;
+  uint8_t confidence = 0;
+  for (uint8_t i = 0; i < data->count; i++) {
+    if (data->readings[i].distance < d) {
+      d = data->readings[i].distance;
+      confidence = data->readings[i].confidence;
+    }
   }
-  else if (d <= 20) {
-    digitalWrite(MOTOR1, HIGH);
-    digitalWrite(MOTOR2, HIGH);
-    digitalWrite(MOTOR3, HIGH);
-    digitalWrite(MOTOR4, HIGH);
-    digitalWrite(MOTOR5, HIGH);
+  snprintf(line, size, "Distance Received: %d cm (%u%%) at %u Hz, node %u #%u, lost %u, rejected %u",
+           d, confidence, data->rate, nodeId, packet.header->sequence,
+           (unsigned)nodeTracker.getNode(nodeId)->lost, (unsigned)(packetsRejected + badPayloads));
+
+  if (!linkUp) {
+    linkUp = true;
+    Serial.println("Link up");
   }
+  setMotors(hapticLevel(d));
+  return true;
+}
+
+void reportStats(uint32_t now) {
+  if (now - lastStatsMs < STATS_INTERVAL) return;
+  uint32_t count = callbackCount, totalUs = callbackTotalUs;
+  uint32_t calls = count - statsCallbacks;
+  Serial.printf("Callback %u us mean, %u us max, %u calls, queued max %u, dropped %u, log skipped %u\n",
+                (unsigned)(calls ? (totalUs - statsCallbackUs) / calls : 0), (unsigned)callbackMaxUs,
+                (unsigned)calls, (unsigned)packetRing.getHighWater(), (unsigned)packetRing.getDropped(),
+                (unsigned)logSkipped);
+  statsCallbacks = count;
+  statsCallbackUs = totalUs;
+  lastStatsMs = now;
 }
 
 void setup() {
-  Serial.begin(115200);
+  Serial.begin(BAUD_RATE);
 
   pinMode(MOTOR1, OUTPUT);
   pinMode(MOTOR2, OUTPUT);
@@ -84,5 +164,32 @@ void setup() {
 }
 
 void loop() {
-  // All logic handled via ESP-NOW callback
+  // Everything the callback queued, oldest first; only the newest distance is logged
+  char line[96];
+  bool haveLine = false;
+  const RingPacket *entry;
+  while ((entry = packetRing.front()) != NULL) {
+    if (handlePacket(*entry, line, sizeof(line))) haveLine = true;
+    packetRing.pop();
+  }
+  if (haveLine) logLine(line);
+
+  uint32_t rejected = packetsRejected;
+  if (rejected != reportedRejected) {
+    reportedRejected = rejected;
+    Serial.print("Packet rejected: ");
+    Serial.println(getPacketErrorName((PacketError)lastError));
+  }
+
+  uint32_t now = millis();
+  if (DEBUG_ENABLED) reportStats(now);
+
+  // Watch the link once the transmitter has been heard
+  if (!heardFrom) return;
+  if (linkUp && now - lastPacketMs > LINK_TIMEOUT) {
+    linkUp = false;
+    Serial.println("Link lost: no packet from the transmitter");
+  }
+  // A short buzz every LINK_LOST_PERIOD tells the wearer warnings have stopped
+  if (!linkUp) setMotors(now % LINK_LOST_PERIOD < LINK_LOST_PULSE ? 1 : 0);
 }
@@ -7,13 +7,48 @@
 
 // ================= ESP-NOW Settings =================
 // MAC address of Receiver ESP (update with your receiver's MAC)
-uint8_t receiverAddress[] = {0x24, 0x6F, 0x28, 0x12, 0x34, 0x56};
+#define RECEIVER_MAC_ADDRESS {0x24, 0x6F, 0x28, 0x12, 0x34, 0x56}
+#define NODE_ID 1               // Identifies this transmitter in every packet
 
 // ================= Sensor Settings =================
 #define MAX_DISTANCE 400        // Maximum detection distance (cm)
 #define MIN_DISTANCE 2          // Minimum detection distance (cm)
 #define SAMPLE_RATE 200         // Sampling interval (ms)
-#define TIMEOUT_DURATION 30000  // Ultrasonic sensor timeout (μs)
+#define TIMEOUT_DURATION ((uint32_t)(2 * MAX_DISTANCE / SPEED_OF_SOUND))  // Echo timeout: round trip at MAX_DISTANCE (μs)
+#define ECHO_START_TIMEOUT 3000 // Trigger to echo start before the sensor counts as missing (μs)
+#define ECHO_SETTLE_TIMEOUT 60000   // Longest the sensor holds its echo line without a target (μs)
+#define ECHO_GUARD_TIME 10000   // Quiet time after a measurement for late echoes to die out (μs)
+
+// ================= Sensor Array =================
+// One HC-SR04 per entry, in packet order: centre, left, right, low. The
+// centre sensor is the one on TRIG_PIN/ECHO_PIN; fit the others in order.
+#define SENSOR_COUNT 1          // Sensors fitted (1-SENSOR_MAX)
+#define SENSOR_MAX 4
+#define SENSOR_TRIG_PINS {TRIG_PIN, D0, D3, D4}
+#define SENSOR_ECHO_PINS {ECHO_PIN, D7, D1, D2}
+#define SENSOR_SLOTS {0, 1, 2, 3}   // Slot per sensor; sensors sharing a slot fire together
+#define SENSOR_STAGGER 40000    // Trigger to trigger between slots; echoes from up to 6.5 m are back (μs)
+
+// ================= Ranging Filter =================
+#define FILTER_ENABLED true     // Hampel outlier filter over each sensor's pings; else one raw ping per sample
+#define PING_BURST 3            // Pings per sample when filtering a single sensor; an array pings once per scan
+#define FILTER_WINDOW 5         // Latest pings the filter votes over, per sensor
+#define FILTER_THRESHOLD 3      // Outlier beyond this many scaled deviations from the median
+#define FILTER_MIN_SPREAD 10    // Pings this close to the median always pass (cm)
+
+// ================= Adaptive Sampling =================
+#define ADAPTIVE_SAMPLING true  // Else sample every SAMPLE_RATE ms
+#define SAMPLE_INTERVAL_MIN 25  // Fastest sampling, near or closing obstacle (ms)
+#define SAMPLE_INTERVAL_MAX 200 // Slowest sampling, empty and static scene (ms)
+#define SAMPLE_NEAR_DISTANCE 50 // Sample fastest at or below this distance (cm)
+#define SAMPLE_FAR_DISTANCE 300 // Sample slowest at or beyond this distance (cm)
+#define SAMPLE_STEP 5           // Most an approaching obstacle may move between samples (cm)
+#define SAMPLE_MAX_SPEED 1000   // Faster changes are a different obstacle, not motion (cm/s)
+
+// ================= Send on Change =================
+#define SEND_ON_CHANGE true     // Else send every scan
+#define SEND_DELTA 10           // Change sent even within a haptic band (cm)
+#define HEARTBEAT_INTERVAL 1000 // Longest gap between packets; the receiver counts silence as link loss (ms)
 
 // ================= Communication Settings =================
 #define RETRY_COUNT 3           // Number of transmission retries
@@ -29,12 +64,11 @@ uint8_t receiverAddress[] = {0x24, 0x6F, 0x28, 0x12, 0x34, 0x56};
 // ================= Debug Settings =================
 #define DEBUG_ENABLED true       // Enable serial debug output
 #define BAUD_RATE 115200        // Serial communication speed
+#define STATS_INTERVAL 5000     // Loop latency and sample rate report interval (ms)
 
 // ================= Calibration Settings =================
 #define SPEED_OF_SOUND 0.034    // Speed of sound correction factor
 #define DISTANCE_OFFSET 0       // Distance measurement offset (cm)
-#define FILTER_ENABLED true     // Enable median filter for readings
-#define FILTER_WINDOW 5         // Median filter window size
 
 // ================= Performance Optimization =================
 #define TRANSMISSION_POWER 82   // RF transmit power (0-82 dBm)
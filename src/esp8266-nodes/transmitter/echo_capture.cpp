@@ -0,0 +1,157 @@
+#include "echo_capture.h"
+#include <string.h>
+
+#ifdef ARDUINO
+#include <Arduino.h>
+// The interrupt and the loop share one core; the loop only has to keep
+// an edge from landing between reading and updating the state
+#define ECHO_LOCK() noInterrupts()
+#define ECHO_UNLOCK() interrupts()
+#define ECHO_ISR IRAM_ATTR
+#else
+#define ECHO_LOCK()
+#define ECHO_UNLOCK()
+#define ECHO_ISR
+#endif
+
+EchoCapture::EchoCapture()
+    : state(ECHO_IDLE), startUs(0), endUs(0), triggerUs(0), settleUs(0), resultUs(0),
+      guarded(false) {
+    memset(&stats, 0, sizeof(stats));
+}
+
+// ================= Edges =================
+
+void EchoCapture::arm(uint32_t nowUs) {
+    ECHO_LOCK();
+    triggerUs = nowUs;
+    state = ECHO_WAIT_START;
+    ECHO_UNLOCK();
+}
+
+void ECHO_ISR EchoCapture::onEdge(bool high, uint32_t nowUs) {
+    switch (state) {
+        case ECHO_WAIT_START:
+            if (high) {
+                startUs = nowUs;
+                state = ECHO_WAIT_END;
+                return;
+            }
+            break;
+        case ECHO_WAIT_END:
+            if (!high) {
+                endUs = nowUs;
+                state = ECHO_DONE;
+                return;
+            }
+            break;
+        case ECHO_SETTLE:
+            if (!high) {
+                state = ECHO_IDLE;
+                return;
+            }
+            break;
+    }
+    stats.spurious++;
+}
+
+// ================= Loop side =================
+
+EchoResult EchoCapture::poll(uint32_t nowUs, uint32_t* pulseUs) {
+    EchoResult result = ECHO_PENDING;
+    uint32_t cycleUs = 0;
+
+    ECHO_LOCK();
+    switch (state) {
+        case ECHO_WAIT_START:
+            if (nowUs - triggerUs > ECHO_START_TIMEOUT) {
+                state = ECHO_IDLE;
+                result = ECHO_NO_SENSOR;
+                cycleUs = nowUs - triggerUs;
+            }
+            break;
+        case ECHO_WAIT_END:
+            // Past the round trip the answer is known; the sensor's own
+            // timeout would only hold the line longer
+            if (nowUs - startUs > TIMEOUT_DURATION) {
+                state = ECHO_SETTLE;
+                settleUs = nowUs;
+                result = ECHO_NO_TARGET;
+                cycleUs = startUs + TIMEOUT_DURATION - triggerUs;
+            }
+            break;
+        case ECHO_DONE: {
+            uint32_t pulse = endUs - startUs;
+            state = ECHO_IDLE;
+            cycleUs = endUs - triggerUs;
+            if (pulse > TIMEOUT_DURATION) {
+                // Ended after the round trip but before a poll saw it
+                result = ECHO_NO_TARGET;
+                cycleUs -= pulse - TIMEOUT_DURATION;
+            } else {
+                result = ECHO_OK;
+                *pulseUs = pulse;
+            }
+            break;
+        }
+        case ECHO_SETTLE:
+            if (nowUs - settleUs > ECHO_SETTLE_TIMEOUT) {
+                state = ECHO_IDLE;
+                stats.stuck++;
+            }
+            break;
+    }
+    ECHO_UNLOCK();
+
+    if (result != ECHO_PENDING) finish(result, cycleUs, nowUs);
+    return result;
+}
+
+void EchoCapture::finish(EchoResult result, uint32_t cycleUs, uint32_t nowUs) {
+    if (result == ECHO_OK) stats.measurements++;
+    else if (result == ECHO_NO_TARGET) stats.noTarget++;
+    else stats.noSensor++;
+
+    stats.lastCycleUs = cycleUs;
+    if (cycleUs > stats.maxCycleUs) stats.maxCycleUs = cycleUs;
+    resultUs = nowUs;
+    guarded = true;
+}
+
+bool EchoCapture::ready(uint32_t nowUs) const {
+    if (state != ECHO_IDLE) return false;
+    return !guarded || nowUs - resultUs >= ECHO_GUARD_TIME;
+}
+
+uint16_t EchoCapture::toDistanceCm(uint32_t pulseUs) {
+    return (uint16_t)(pulseUs * SPEED_OF_SOUND / 2 + DISTANCE_OFFSET);
+}
+
+// ================= Device =================
+
+#ifdef ARDUINO
+void ECHO_ISR EchoCapture::onInterrupt(void* arg) {
+    EchoCapture* capture = static_cast<EchoCapture*>(arg);
+    capture->onEdge(digitalRead(capture->echoPin), micros());
+}
+
+void EchoCapture::begin(uint8_t trigPin, uint8_t echoPin) {
+    this->trigPin = trigPin;
+    this->echoPin = echoPin;
+    pinMode(trigPin, OUTPUT);
+    digitalWrite(trigPin, LOW);
+    pinMode(echoPin, INPUT);
+    attachInterruptArg(digitalPinToInterrupt(echoPin), onInterrupt, this, CHANGE);
+}
+
+// The only wait left: the sensor needs a 10 us trigger pulse
+bool EchoCapture::trigger() {
+    uint32_t now = micros();
+    if (!ready(now)) return false;
+    arm(now);
+    digitalWrite(trigPin, HIGH);
+    delayMicroseconds(10);
+    digitalWrite(trigPin, LOW);
+    return true;
+}
+#endif
@@ -0,0 +1,80 @@
+#ifndef ECHO_CAPTURE_H
+#define ECHO_CAPTURE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "config.h"
+
+typedef enum {
+    ECHO_IDLE,                      // Ready once the guard time has passed
+    ECHO_WAIT_START,                // Triggered, echo line still low
+    ECHO_WAIT_END,                  // Echo line high: the burst is in flight
+    ECHO_DONE,                      // Both edges captured, not yet collected
+    ECHO_SETTLE                     // Gave up; waiting for the sensor to release the line
+} EchoState;
+
+typedef enum {
+    ECHO_PENDING,                   // Nothing new
+    ECHO_OK,                        // Echo time in pulseUs
+    ECHO_NO_TARGET,                 // Nothing within MAX_DISTANCE
+    ECHO_NO_SENSOR                  // The echo never started
+} EchoResult;
+
+// Echo capture statistics
+typedef struct {
+    uint32_t measurements;          // Echoes timed
+    uint32_t noTarget;
+    uint32_t noSensor;
+    uint32_t stuck;                 // Echo line held past ECHO_SETTLE_TIMEOUT
+    uint32_t spurious;              // Edges outside a measurement
+    uint32_t lastCycleUs;           // Trigger to result
+    uint32_t maxCycleUs;
+} EchoStats;
+
+// HC-SR04 echo timing without pulseIn(). The echo pin interrupt stamps
+// both edges with micros(); the loop triggers when ready() and polls for
+// the result, so neither ever waits on the sensor. A measurement ends at
+// the falling edge, or TIMEOUT_DURATION after the rising one when nothing
+// is in range, instead of when the sensor gives up some 38 ms later.
+class EchoCapture {
+private:
+    volatile uint8_t state;
+    volatile uint32_t startUs;      // Rising edge
+    volatile uint32_t endUs;        // Falling edge
+    uint32_t triggerUs;
+    uint32_t settleUs;
+    uint32_t resultUs;
+    bool guarded;                   // A result was returned; hold off until ECHO_GUARD_TIME
+    EchoStats stats;
+#ifdef ARDUINO
+    uint8_t trigPin;
+    uint8_t echoPin;
+
+    static void onInterrupt(void* arg);
+#endif
+
+    void finish(EchoResult result, uint32_t cycleUs, uint32_t nowUs);
+
+public:
+    EchoCapture();
+
+    // Trigger pulse sent at nowUs
+    void arm(uint32_t nowUs);
+    // Echo pin edge; called from the interrupt
+    void onEdge(bool high, uint32_t nowUs);
+    // Advances the measurement; pulseUs is set on ECHO_OK
+    EchoResult poll(uint32_t nowUs, uint32_t* pulseUs);
+
+    bool ready(uint32_t nowUs) const;
+    uint8_t getState() const { return state; }
+    EchoStats getStats() const { return stats; }
+
+    static uint16_t toDistanceCm(uint32_t pulseUs);
+
+#ifdef ARDUINO
+    void begin(uint8_t trigPin, uint8_t echoPin);
+    bool trigger();                 // Sends the pulse if ready()
+#endif
+};
+
+#endif // ECHO_CAPTURE_H
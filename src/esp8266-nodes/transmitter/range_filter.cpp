@@ -0,0 +1,126 @@
+#include "range_filter.h"
+#include <string.h>
+
+#if FILTER_WINDOW < 1 || FILTER_WINDOW > 255
+#error "FILTER_WINDOW must be between 1 and 255"
+#endif
+
+// 1.4826 scales the median absolute deviation to a standard deviation
+// for normally distributed noise
+#define MAD_SCALE_PER_MILLE 1483
+
+RangeFilter::RangeFilter() : window(FILTER_ENABLED ? FILTER_WINDOW : 1) {
+    reset();
+}
+
+void RangeFilter::setWindow(uint8_t size) {
+    window = size < 1 ? 1 : size > FILTER_WINDOW ? FILTER_WINDOW : size;
+    reset();
+}
+
+void RangeFilter::reset() {
+    head = 0;
+    filled = 0;
+    valid = 0;
+    distance = DISTANCE_NO_SENSOR;
+    confidence = 0;
+    memset(&stats, 0, sizeof(stats));
+}
+
+// ================= Sorted window =================
+
+// First index whose value is not below cm
+static uint8_t lowerBound(const uint16_t* sorted, uint8_t n, uint16_t cm) {
+    uint8_t lo = 0, hi = n;
+    while (lo < hi) {
+        uint8_t mid = (lo + hi) / 2;
+        if (sorted[mid] < cm) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+void RangeFilter::insert(uint16_t cm) {
+    uint8_t i = lowerBound(sorted, valid, cm);
+    memmove(&sorted[i + 1], &sorted[i], (valid - i) * sizeof(uint16_t));
+    sorted[i] = cm;
+    valid++;
+}
+
+void RangeFilter::remove(uint16_t cm) {
+    uint8_t i = lowerBound(sorted, valid, cm);
+    valid--;
+    memmove(&sorted[i], &sorted[i + 1], (valid - i) * sizeof(uint16_t));
+}
+
+// k-th smallest |sorted[i] - median|. Below the median the deviations
+// grow towards the start of the window, above it towards the end: two
+// sorted runs, searched for the split that takes k + 1 from both.
+uint16_t RangeFilter::deviation(uint8_t k, uint16_t median) const {
+    uint8_t pivot = lowerBound(sorted, valid, median);
+    uint8_t below = pivot, above = valid - pivot;
+    auto fromBelow = [&](uint8_t j) { return (uint16_t)(median - sorted[pivot - 1 - j]); };
+    auto fromAbove = [&](uint8_t j) { return (uint16_t)(sorted[pivot + j] - median); };
+
+    uint8_t take = k + 1;
+    uint8_t lo = take > above ? take - above : 0;
+    uint8_t hi = take < below ? take : below;
+    while (lo < hi) {
+        uint8_t i = (lo + hi) / 2;
+        uint8_t j = take - i;
+        if (j > 0 && i < below && fromAbove(j - 1) > fromBelow(i)) lo = i + 1;
+        else hi = i;
+    }
+    uint8_t j = take - lo;
+    uint16_t lastBelow = lo > 0 ? fromBelow(lo - 1) : 0;
+    uint16_t lastAbove = j > 0 ? fromAbove(j - 1) : 0;
+    return lastBelow > lastAbove ? lastBelow : lastAbove;
+}
+
+// ================= Pings =================
+
+uint16_t RangeFilter::add(EchoResult result, uint16_t cm) {
+    stats.pings++;
+
+    uint16_t ping = DISTANCE_NO_SENSOR;
+    if (result == ECHO_NO_TARGET) ping = MAX_DISTANCE;
+    else if (result == ECHO_OK && cm >= MIN_DISTANCE) ping = cm > MAX_DISTANCE ? MAX_DISTANCE : cm;
+    else stats.rejected++;
+
+    if (filled == window) {
+        if (ring[head] != DISTANCE_NO_SENSOR) remove(ring[head]);
+    } else {
+        filled++;
+    }
+    ring[head] = ping;
+    head = (head + 1) % window;
+    if (ping != DISTANCE_NO_SENSOR) insert(ping);
+
+    if (!valid) {
+        distance = DISTANCE_NO_SENSOR;
+        confidence = 0;
+        return distance;
+    }
+
+    // With an even count the nearer middle ping is the median, erring
+    // towards an obstacle
+    uint8_t middle = (valid - 1) / 2;
+    uint16_t median = sorted[middle];
+    uint32_t threshold = (uint32_t)deviation(middle, median) * FILTER_THRESHOLD * MAD_SCALE_PER_MILLE / 1000;
+    if (threshold < FILTER_MIN_SPREAD) threshold = FILTER_MIN_SPREAD;
+
+    uint16_t low = median > threshold ? median - threshold : 0;
+    uint32_t high = median + threshold + 1;
+    uint8_t agree = lowerBound(sorted, valid, high > 0xFFFF ? 0xFFFF : high) - lowerBound(sorted, valid, low);
+    confidence = (uint8_t)(agree * 100 / window);
+
+    if (ping == DISTANCE_NO_SENSOR) {
+        distance = median;
+    } else if ((uint32_t)(ping > median ? ping - median : median - ping) > threshold) {
+        distance = median;
+        stats.outliers++;
+    } else {
+        distance = ping;
+    }
+    return distance;
+}
@@ -0,0 +1,62 @@
+#ifndef RANGE_FILTER_H
+#define RANGE_FILTER_H
+
+#include <stdint.h>
+#include "config.h"
+#include "echo_capture.h"
+
+#define DISTANCE_NO_SENSOR 0xFFFF   // Sensor did not answer; sorts after any distance
+
+// Range filter statistics
+typedef struct {
+    uint32_t pings;
+    uint32_t rejected;              // No sensor, or nearer than MIN_DISTANCE
+    uint32_t outliers;              // Replaced by the window median
+} FilterStats;
+
+// Hampel filter over one sensor's last pings. A ping further from the
+// window median than FILTER_THRESHOLD scaled median absolute deviations
+// is reported as the median instead. Timeouts count as nothing in range,
+// so a single missed echo no longer clears an obstacle and a single
+// ghost no longer raises one. Pings with no sensor or nearer than
+// MIN_DISTANCE take their place in the window but are never reported.
+//
+// The window is kept sorted: insertion and eviction find their place by
+// binary search, and the median absolute deviation is the k-th smallest
+// of the two sorted runs of deviations either side of the median, so
+// neither sorts per ping.
+class RangeFilter {
+private:
+    uint16_t ring[FILTER_WINDOW];   // Pings in arrival order; DISTANCE_NO_SENSOR if rejected
+    uint16_t sorted[FILTER_WINDOW]; // Valid pings in ascending order
+    uint8_t window;
+    uint8_t head;
+    uint8_t filled;
+    uint8_t valid;
+    uint16_t distance;
+    uint8_t confidence;
+    FilterStats stats;
+
+    void insert(uint16_t cm);
+    void remove(uint16_t cm);
+    uint16_t deviation(uint8_t k, uint16_t median) const;
+
+public:
+    RangeFilter();
+
+    // Window size, at most FILTER_WINDOW; 1 passes pings straight through
+    void setWindow(uint8_t size);
+    void reset();
+
+    // One ping; returns the distance to report
+    uint16_t add(EchoResult result, uint16_t cm);
+
+    // cm, MAX_DISTANCE when nothing is in range, DISTANCE_NO_SENSOR
+    // when the window holds no valid ping
+    uint16_t getDistance() const { return distance; }
+    // Share of the window agreeing with the median (%)
+    uint8_t getConfidence() const { return confidence; }
+    FilterStats getStats() const { return stats; }
+};
+
+#endif // RANGE_FILTER_H
@@ -0,0 +1,57 @@
+#include "sample_rate.h"
+
+#if SAMPLE_INTERVAL_MIN <= 0 || SAMPLE_INTERVAL_MIN > SAMPLE_INTERVAL_MAX
+#error "SAMPLE_INTERVAL_MIN must be between 1 and SAMPLE_INTERVAL_MAX"
+#endif
+
+SampleRate::SampleRate()
+    : intervalMs(SAMPLE_INTERVAL_MIN), lastDistance(0), lastMs(0), hasLast(false),
+      closingSpeed(0) {
+}
+
+uint16_t SampleRate::update(uint32_t nowMs, uint16_t distanceCm, bool inRange) {
+    if (!inRange) {
+        hasLast = false;
+        closingSpeed = 0;
+    } else {
+        if (hasLast && nowMs != lastMs) {
+            int32_t speed = ((int32_t)lastDistance - distanceCm) * 1000 / (int32_t)(nowMs - lastMs);
+            // A jump no one walks is another obstacle coming into view
+            if (speed > SAMPLE_MAX_SPEED || speed < -SAMPLE_MAX_SPEED) closingSpeed = 0;
+            else closingSpeed += (speed - closingSpeed) / 4;
+        }
+        lastDistance = distanceCm;
+        lastMs = nowMs;
+        hasLast = true;
+    }
+
+    uint16_t target = targetIntervalMs(distanceCm, closingSpeed, inRange);
+    if (target < intervalMs) {
+        intervalMs = target;
+    } else {
+        uint32_t slower = (uint32_t)intervalMs * 2;
+        intervalMs = slower < target ? slower : target;
+    }
+    return intervalMs;
+}
+
+uint16_t SampleRate::targetIntervalMs(uint16_t distanceCm, int32_t closingSpeed, bool inRange) {
+    if (!inRange) return SAMPLE_INTERVAL_MAX;
+
+    uint32_t interval;
+    if (distanceCm <= SAMPLE_NEAR_DISTANCE) {
+        interval = SAMPLE_INTERVAL_MIN;
+    } else if (distanceCm >= SAMPLE_FAR_DISTANCE) {
+        interval = SAMPLE_INTERVAL_MAX;
+    } else {
+        interval = SAMPLE_INTERVAL_MIN + (uint32_t)(SAMPLE_INTERVAL_MAX - SAMPLE_INTERVAL_MIN) *
+                   (distanceCm - SAMPLE_NEAR_DISTANCE) / (SAMPLE_FAR_DISTANCE - SAMPLE_NEAR_DISTANCE);
+    }
+
+    if (closingSpeed > 0) {
+        uint32_t limit = SAMPLE_STEP * 1000UL / closingSpeed;
+        if (limit < interval) interval = limit;
+    }
+    if (interval < SAMPLE_INTERVAL_MIN) interval = SAMPLE_INTERVAL_MIN;
+    return (uint16_t)interval;
+}
@@ -0,0 +1,34 @@
+#ifndef SAMPLE_RATE_H
+#define SAMPLE_RATE_H
+
+#include <stdint.h>
+#include "config.h"
+
+// Picks the interval to the next measurement from the last one. Near
+// obstacles are sampled fastest; an approaching one is sampled often
+// enough that it moves at most SAMPLE_STEP between samples. An empty or
+// distant, static scene backs off to SAMPLE_INTERVAL_MAX, doubling the
+// interval per sample so a brief lull does not drop straight to it.
+class SampleRate {
+private:
+    uint16_t intervalMs;
+    uint16_t lastDistance;
+    uint32_t lastMs;
+    bool hasLast;
+    int32_t closingSpeed;           // Smoothed cm/s, positive when approaching
+
+public:
+    SampleRate();
+
+    // One measurement; returns the interval to the next
+    uint16_t update(uint32_t nowMs, uint16_t distanceCm, bool inRange);
+
+    uint16_t getIntervalMs() const { return intervalMs; }
+    uint8_t getRateHz() const { return (uint8_t)((1000 + intervalMs / 2) / intervalMs); }
+    int32_t getClosingSpeed() const { return closingSpeed; }
+
+    // The interval a measurement calls for, before backing off gradually
+    static uint16_t targetIntervalMs(uint16_t distanceCm, int32_t closingSpeed, bool inRange);
+};
+
+#endif // SAMPLE_RATE_H
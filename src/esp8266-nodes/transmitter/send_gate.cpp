@@ -0,0 +1,45 @@
+#include "send_gate.h"
+#include <haptic_level.h>
+#include <string.h>
+
+SendGate::SendGate()
+    : sentCount(0), sentMs(0), hasSent(false), deltaCm(SEND_ON_CHANGE ? SEND_DELTA : 0),
+      heartbeatMs(SEND_ON_CHANGE ? HEARTBEAT_INTERVAL : 0) {
+    memset(sentDistance, 0, sizeof(sentDistance));
+    memset(&stats, 0, sizeof(stats));
+}
+
+bool SendGate::shouldSend(uint32_t nowMs, const SensorScan& scan) {
+    bool send = !hasSent || scan.count != sentCount;
+    bool levelChange = false;
+
+    for (uint8_t i = 0; i < scan.count && !send; i++) {
+        uint16_t now = scan.distance[i], last = sentDistance[i];
+        if ((now == DISTANCE_NO_SENSOR) != (last == DISTANCE_NO_SENSOR)) {
+            send = true;
+        } else if (hapticLevel(now) != hapticLevel(last)) {
+            send = levelChange = true;
+        } else if (now != DISTANCE_NO_SENSOR && (now > last ? now - last : last - now) >= deltaCm) {
+            send = true;
+        }
+    }
+    bool heartbeat = !send && nowMs - sentMs >= heartbeatMs;
+
+    if (!send && !heartbeat) {
+        stats.skipped++;
+        return false;
+    }
+    memcpy(sentDistance, scan.distance, scan.count * sizeof(uint16_t));
+    sentCount = scan.count;
+    sentMs = nowMs;
+    hasSent = true;
+    stats.sent++;
+    if (levelChange) stats.levelChanges++;
+    if (heartbeat) stats.heartbeats++;
+    return true;
+}
+
+void SendGate::noteFailed() {
+    hasSent = false;
+    stats.failed++;
+}
@@ -0,0 +1,47 @@
+#ifndef SEND_GATE_H
+#define SEND_GATE_H
+
+#include <stdint.h>
+#include "config.h"
+#include "sensor_array.h"
+
+// Send gate statistics
+typedef struct {
+    uint32_t sent;
+    uint32_t skipped;               // Scans the receiver already knew
+    uint32_t levelChanges;          // Sent because a sensor crossed a haptic band
+    uint32_t heartbeats;            // Sent only to show the link is up
+    uint32_t failed;                // Sends ESP-NOW reported undelivered
+} GateStats;
+
+// Decides which scans are sent. A scan goes out when any sensor's reading
+// moves into another haptic band, moves SEND_DELTA from what was last
+// sent, or starts or stops answering. Otherwise nothing is sent until
+// HEARTBEAT_INTERVAL after the last packet, so the receiver can still
+// tell a quiet scene from a lost link.
+class SendGate {
+private:
+    uint16_t sentDistance[SENSOR_MAX];
+    uint8_t sentCount;
+    uint32_t sentMs;
+    bool hasSent;
+    uint16_t deltaCm;
+    uint32_t heartbeatMs;
+    GateStats stats;
+
+public:
+    SendGate();
+
+    // A delta of 0 sends every scan
+    void setDelta(uint16_t cm) { deltaCm = cm; }
+    void setHeartbeat(uint32_t ms) { heartbeatMs = ms; }
+
+    // True if the scan should be sent; it then counts as sent at nowMs
+    bool shouldSend(uint32_t nowMs, const SensorScan& scan);
+    // The last send was not delivered; the next scan is sent whatever it holds
+    void noteFailed();
+
+    GateStats getStats() const { return stats; }
+};
+
+#endif // SEND_GATE_H
@@ -0,0 +1,135 @@
+#include "sensor_array.h"
+#include <string.h>
+
+#if SENSOR_COUNT < 1 || SENSOR_COUNT > SENSOR_MAX
+#error "SENSOR_COUNT must be between 1 and SENSOR_MAX"
+#endif
+
+SensorArray::SensorArray(EchoCapture* sensors, uint8_t count, SensorFireFn fire, void* context)
+    : sensors(sensors), count(count > SENSOR_MAX ? SENSOR_MAX : count), slotCount(0),
+      fire(fire), fireContext(context), staggerUs(SENSOR_STAGGER),
+      burst(FILTER_ENABLED && count == 1 ? PING_BURST : 1), scanning(false), pass(0), slot(0), pending(0),
+      staggered(false), deferring(false), slotFiredUs(0), scanStartUs(0) {
+    static const uint8_t defaults[SENSOR_MAX] = SENSOR_SLOTS;
+    setSlots(defaults);
+    memset(&stats, 0, sizeof(stats));
+}
+
+void SensorArray::setSlots(const uint8_t* slots) {
+    slotCount = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        this->slots[i] = slots[i];
+        if (slots[i] >= slotCount) slotCount = slots[i] + 1;
+    }
+}
+
+void SensorArray::setFilterWindow(uint8_t size) {
+    for (uint8_t i = 0; i < SENSOR_MAX; i++) filters[i].setWindow(size);
+}
+
+bool SensorArray::start(uint32_t nowUs) {
+    if (scanning) return false;
+    scanning = true;
+    pass = 0;
+    slot = 0;
+    pending = 0;
+    scanStartUs = nowUs;
+    return true;
+}
+
+// Past the last slot, starts the next pass of the burst
+void SensorArray::nextSlot() {
+    if (++slot == slotCount && ++pass < burst) slot = 0;
+}
+
+// Fires every sensor of the next slot with any, or none if one of them
+// is still releasing its echo line from the last ping
+bool SensorArray::fireSlot(uint32_t nowUs) {
+    for (; slot < slotCount; nextSlot()) {
+        uint8_t members = 0;
+        for (uint8_t i = 0; i < count; i++) {
+            if (slots[i] == slot) members |= 1 << i;
+        }
+        if (!members) continue;
+
+        for (uint8_t i = 0; i < count; i++) {
+            if ((members & (1 << i)) && !sensors[i].ready(nowUs)) {
+                if (!deferring) stats.deferred++;
+                deferring = true;
+                return false;
+            }
+        }
+        deferring = false;
+        if (slot == 0 && pass == 0) scanStartUs = nowUs;
+        // A lone slot is its own neighbour; the sensor's guard time covers it
+        staggered = slotCount > 1;
+        slotFiredUs = nowUs;
+        for (uint8_t i = 0; i < count; i++) {
+            if (!(members & (1 << i))) continue;
+            if (fire(i, nowUs, fireContext)) pending |= 1 << i;
+            else filters[i].add(ECHO_NO_SENSOR, 0);
+        }
+        if (pending) return true;
+    }
+    return false;
+}
+
+bool SensorArray::poll(uint32_t nowUs, SensorScan* out) {
+    if (!scanning) return false;
+
+    for (uint8_t i = 0; i < count && pending; i++) {
+        if (!(pending & (1 << i))) continue;
+        uint32_t pulse = 0;
+        EchoResult result = sensors[i].poll(nowUs, &pulse);
+        if (result == ECHO_PENDING) continue;
+
+        filters[i].add(result, result == ECHO_OK ? EchoCapture::toDistanceCm(pulse) : 0);
+        pending &= ~(1 << i);
+        if (!pending) nextSlot();
+    }
+
+    if (!pending && slot < slotCount && (!staggered || nowUs - slotFiredUs >= staggerUs)) {
+        fireSlot(nowUs);
+    }
+    if (pending || slot < slotCount) return false;
+
+    scanning = false;
+    out->count = count;
+    out->nearest = MAX_DISTANCE;
+    out->inRange = false;
+    for (uint8_t i = 0; i < count; i++) {
+        uint16_t distance = filters[i].getDistance();
+        out->distance[i] = distance;
+        out->confidence[i] = filters[i].getConfidence();
+        if (distance < MAX_DISTANCE) {
+            out->inRange = true;
+            if (distance < out->nearest) out->nearest = distance;
+        }
+    }
+    out->scanUs = nowUs - scanStartUs;
+
+    stats.scans++;
+    stats.lastScanUs = out->scanUs;
+    if (out->scanUs > stats.maxScanUs) stats.maxScanUs = out->scanUs;
+    return true;
+}
+
+// ================= Device =================
+
+#ifdef ARDUINO
+#include <Arduino.h>
+
+static EchoCapture echoSensors[SENSOR_COUNT];
+
+static bool fireSensor(uint8_t sensor, uint32_t nowUs, void* context) {
+    return echoSensors[sensor].trigger();
+}
+
+SensorArray sensorArray(echoSensors, SENSOR_COUNT, fireSensor, NULL);
+
+void SensorArray::begin() {
+    static const uint8_t trigPins[SENSOR_MAX] = SENSOR_TRIG_PINS;
+    static const uint8_t echoPins[SENSOR_MAX] = SENSOR_ECHO_PINS;
+    for (uint8_t i = 0; i < count; i++) sensors[i].begin(trigPins[i], echoPins[i]);
+}
+#endif
@@ -0,0 +1,91 @@
+#ifndef SENSOR_ARRAY_H
+#define SENSOR_ARRAY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "config.h"
+#include "echo_capture.h"
+#include "range_filter.h"
+
+// One filtered reading from every sensor
+typedef struct {
+    uint16_t distance[SENSOR_MAX];  // cm; MAX_DISTANCE when nothing is in range
+    uint8_t confidence[SENSOR_MAX]; // Share of the sensor's filter window agreeing (%)
+    uint8_t count;
+    uint16_t nearest;               // Nearest obstacle, MAX_DISTANCE if none
+    bool inRange;                   // Any sensor saw an obstacle
+    uint32_t scanUs;                // First trigger to last result
+} SensorScan;
+
+// Sensor array statistics
+typedef struct {
+    uint32_t scans;
+    uint32_t lastScanUs;
+    uint32_t maxScanUs;
+    uint32_t deferred;              // Slots held back by a sensor not ready to fire
+} ArrayStats;
+
+// Fires one sensor; false if it is not ready yet
+typedef bool (*SensorFireFn)(uint8_t sensor, uint32_t nowUs, void* context);
+
+// Scans the sensors slot by slot. Sensors sharing a slot fire together;
+// the next slot fires once every sensor in the last one has its result,
+// and no sooner than SENSOR_STAGGER after it fired, so the late echoes of
+// one burst have faded before another sensor listens. Round robin by
+// default; sensors facing apart can share a slot to shorten the scan.
+// Each sensor reports what its RangeFilter makes of its pings. A lone
+// sensor pings PING_BURST times per scan; an array pings each sensor once
+// so the scan rate holds, and the filter window spans consecutive scans.
+class SensorArray {
+private:
+    EchoCapture* sensors;
+    uint8_t count;
+    uint8_t slots[SENSOR_MAX];
+    uint8_t slotCount;
+    SensorFireFn fire;
+    void* fireContext;
+    uint32_t staggerUs;
+    uint8_t burst;
+    RangeFilter filters[SENSOR_MAX];
+
+    bool scanning;
+    uint8_t pass;
+    uint8_t slot;                   // Slot firing or next to fire
+    uint8_t pending;                // Bit per sensor of the slot still measuring
+    bool staggered;                 // A slot fired; the next waits staggerUs from it
+    bool deferring;                 // The slot due is waiting on a sensor
+    uint32_t slotFiredUs;
+    uint32_t scanStartUs;
+    ArrayStats stats;
+
+    bool fireSlot(uint32_t nowUs);
+    void nextSlot();
+
+public:
+    SensorArray(EchoCapture* sensors, uint8_t count, SensorFireFn fire, void* context);
+
+    void setSlots(const uint8_t* slots);
+    void setStagger(uint32_t us) { staggerUs = us; }
+    void setBurst(uint8_t pings) { burst = pings ? pings : 1; }
+    // Filter window per sensor; 1 reports every ping as it is
+    void setFilterWindow(uint8_t size);
+
+    // Starts a scan unless one is running
+    bool start(uint32_t nowUs);
+    // Fires due slots and collects results; true with a completed scan
+    bool poll(uint32_t nowUs, SensorScan* out);
+
+    bool isScanning() const { return scanning; }
+    uint8_t getCount() const { return count; }
+    EchoCapture& getSensor(uint8_t i) { return sensors[i]; }
+    const RangeFilter& getFilter(uint8_t i) const { return filters[i]; }
+    ArrayStats getStats() const { return stats; }
+
+#ifdef ARDUINO
+    void begin();
+#endif
+};
+
+extern SensorArray sensorArray;
+
+#endif // SENSOR_ARRAY_H
@@ -1,21 +1,34 @@
 #include <ESP8266WiFi.h>
 #include <espnow.h>
-
-#define TRIG_PIN D6
-#define ECHO_PIN D5
-
-// Structure for sending data
-typedef struct struct_message {
-  int distance;
-} struct_message;
-
-struct_message myData;
-
-// MAC address of Receiver ESP (replace with your receiver’s MAC)
-uint8_t receiverAddress[] = {0x24, 0x6F, 0x28, 0x12, 0x34, 0x56};
+#include <espnow_packet.h>
+#include "config.h"
+#include "sensor_array.h"
+#include "sample_rate.h"
+#include "send_gate.h"
+
+static_assert(SENSOR_MAX <= PACKET_READINGS_MAX, "A scan must fit in one distance packet");
+static_assert(DISTANCE_NO_SENSOR == PACKET_NO_READING, "Missing sensors must read the same on the wire");
+
+// Packet being sent; the scan is written straight into its payload
+uint8_t packet[PACKET_MAX_SIZE];
+uint16_t sequence = 0;
+SampleRate sampleRate;
+SendGate sendGate;
+
+// MAC address of Receiver ESP (set in config.h)
+uint8_t receiverAddress[] = RECEIVER_MAC_ADDRESS;
+
+// Loop timing, reported every STATS_INTERVAL
+uint32_t lastScanMs = 0;
+uint32_t lastStatsMs = 0;
+uint32_t loopMaxUs = 0;
+uint32_t samples = 0;
 
 // Callback when data is sent
 void OnDataSent(uint8_t *mac_addr, uint8_t sendStatus) {
+  // A lost band change is resent on the next scan, not at the heartbeat
+  if (sendStatus != 0) sendGate.noteFailed();
+  if (!DEBUG_ENABLED) return;
   Serial.print("Last Packet Send Status: ");
   if (sendStatus == 0) {
     Serial.println("Delivery success");
@@ -24,11 +37,71 @@ void OnDataSent(uint8_t *mac_addr, uint8_t sendStatus) {
   }
 }
 
+uint16_t sampleIntervalMs() {
+  return ADAPTIVE_SAMPLING ? sampleRate.getIntervalMs() : SAMPLE_RATE;
+}
+
+void sendScan(const SensorScan &scan, uint32_t measuredUs) {
+  DistancePayload *payload = (DistancePayload *) beginPacket(packet, PACKET_DISTANCE, NODE_ID,
+                                                             sequence++, measuredUs);
+  payload->rate = (1000 + sampleIntervalMs() / 2) / sampleIntervalMs();
+  payload->count = scan.count;
+  for (uint8_t i = 0; i < scan.count; i++) {
+    payload->readings[i].distance = scan.distance[i];
+    payload->readings[i].confidence = scan.confidence[i];
+  }
+
+  // Send data via ESP-NOW
+  if (esp_now_send(receiverAddress, packet, sealPacket(packet, distancePayloadSize(scan.count))) != 0) {
+    sendGate.noteFailed();
+  }
+
+  if (DEBUG_ENABLED) {
+    Serial.print("Distance Sent (cm):");
+    for (uint8_t i = 0; i < scan.count; i++) {
+      Serial.print(' ');
+      Serial.print(scan.distance[i]);
+      Serial.print(" (");
+      Serial.print(scan.confidence[i]);
+      Serial.print("%)");
+    }
+    Serial.println();
+  }
+}
+
+// Worst loop pass and scan rate since the last report
+void reportStats(uint32_t now) {
+  if (now - lastStatsMs < STATS_INTERVAL) return;
+  ArrayStats array = sensorArray.getStats();
+  uint32_t noTarget = 0, noSensor = 0, outliers = 0, rejected = 0;
+  for (uint8_t i = 0; i < sensorArray.getCount(); i++) {
+    EchoStats echo = sensorArray.getSensor(i).getStats();
+    FilterStats filter = sensorArray.getFilter(i).getStats();
+    noTarget += echo.noTarget;
+    noSensor += echo.noSensor;
+    outliers += filter.outliers;
+    rejected += filter.rejected;
+  }
+  GateStats gate = sendGate.getStats();
+  Serial.printf("Loop max %u us, %u.%u Hz (target %u Hz), scan %u us (max %u), no target %u, no sensor %u, "
+                "outliers %u, rejected %u, sent %u (heartbeats %u, failed %u), skipped %u\n",
+                (unsigned)loopMaxUs,
+                (unsigned)(samples * 1000 / (now - lastStatsMs)),
+                (unsigned)(samples * 10000 / (now - lastStatsMs) % 10),
+                (unsigned)((1000 + sampleIntervalMs() / 2) / sampleIntervalMs()),
+                (unsigned)array.lastScanUs, (unsigned)array.maxScanUs,
+                (unsigned)noTarget, (unsigned)noSensor, (unsigned)outliers, (unsigned)rejected,
+                (unsigned)gate.sent, (unsigned)gate.heartbeats, (unsigned)gate.failed,
+                (unsigned)gate.skipped);
+  lastStatsMs = now;
+  loopMaxUs = 0;
+  samples = 0;
+}
+
 void setup() {
-  Serial.begin(115200);
+  Serial.begin(BAUD_RATE);
 
-  pinMode(TRIG_PIN, OUTPUT);
-  pinMode(ECHO_PIN, INPUT);
+  sensorArray.begin();
 
   // Set device as Wi-Fi station
   WiFi.mode(WIFI_STA);
@@ -48,35 +121,40 @@ void setup() {
   // Add receiver peer
   esp_now_add_peer(receiverAddress,
                    ESP_NOW_ROLE_SLAVE,
-                   1,
+                   CHANNEL,
                    NULL,
                    0);
 }
 
 void loop() {
-  // Trigger ultrasonic pulse
-  digitalWrite(TRIG_PIN, LOW);
-  delayMicroseconds(2);
-  digitalWrite(TRIG_PIN, HIGH);
-  delayMicroseconds(10);
-  digitalWrite(TRIG_PIN, LOW);
+  uint32_t loopStart = micros();
+  uint32_t now = millis();
 
-  // Measure echo duration
-  long duration = pulseIn(ECHO_PIN, HIGH);
-
-  // Calculate distance in cm
-  int distance = duration * 0.034 / 2;
-
-  // Assign data
-  myData.distance = distance;
+  // Start a scan; each echo is timed by its interrupt
+  if (now - lastScanMs >= sampleIntervalMs() && sensorArray.start(micros())) {
+    lastScanMs = now;
+  }
 
-  // Send data via ESP-NOW
-  esp_now_send(receiverAddress,
-               (uint8_t *) &myData,
-               sizeof(myData));
+  SensorScan scan;
+  uint32_t pollUs = micros();
+  if (sensorArray.poll(pollUs, &scan)) {
+    // Filtered per sensor; nothing in range is sent as MAX_DISTANCE
+    sampleRate.update(now, scan.nearest, scan.inRange);
+    bool answered = false;
+    for (uint8_t i = 0; i < scan.count; i++) {
+      if (scan.distance[i] != DISTANCE_NO_SENSOR) answered = true;
+    }
+    samples++;
+    // Scans the receiver already knows are held back until the heartbeat
+    if (!answered) {
+      if (DEBUG_ENABLED) Serial.println("No echo: check the sensor wiring");
+    } else if (sendGate.shouldSend(now, scan)) {
+      sendScan(scan, pollUs);
+    }
+  }
 
-  Serial.print("Distance Sent (cm): ");
-  Serial.println(distance);
+  uint32_t loopUs = micros() - loopStart;
+  if (loopUs > loopMaxUs) loopMaxUs = loopUs;
 
-  delay(200);
+  if (DEBUG_ENABLED) reportStats(now);
 }
@@ -7,6 +7,12 @@ class DrishtiGuideInterface {
         this.updateInterval = null;
         this.alerts = [];
         this.startTime = Date.now();
+        this.trackPoints = [];
+        this.version = 0;
+        this.state = {};
+        this.refreshTimes = [];
+        this.seenEmergencies = new Set();
+        this.eventsPort = 81;       // EMERGENCY_EVENTS_PORT, if /config cannot be read
         
         this.init();
     }
@@ -14,6 +20,7 @@ class DrishtiGuideInterface {
     init() {
         this.bindEvents();
         this.startDataUpdates();
+        this.subscribeEmergencies();
         this.initializeMap();
         this.updateUptime();
     }
@@ -46,6 +53,24 @@ class DrishtiGuideInterface {
         }
     }
     
+    // Falls are pushed as soon as they are detected, over an event stream
+    // on the device's emergency port, which /config reports as
+    // emergency.eventsPort (EMERGENCY_EVENTS_PORT). A fall is shown once
+    // per event ID, however many times it arrives.
+    async subscribeEmergencies() {
+        if (!window.EventSource) return;
+        const config = await this.fetchData('/config');
+        const port = config && config.emergency ? config.emergency.eventsPort : this.eventsPort;
+        const url = new URL(this.apiBase);
+        const source = new EventSource(`${url.protocol}//${url.hostname}:${port}/events`);
+        source.addEventListener('fall', (event) => {
+            const fall = JSON.parse(event.data);
+            if (this.seenEmergencies.has(fall.id)) return;
+            this.seenEmergencies.add(fall.id);
+            this.addAlert('error', `Fall detected at ${fall.latitude}, ${fall.longitude}`);
+        });
+    }
+    
     // Data Updates
     async startDataUpdates() {
         // Initial data load
@@ -57,12 +82,73 @@ class DrishtiGuideInterface {
         }, 5000); // Update every 5 seconds
     }
     
+    // One request per refresh: the full /dashboard snapshot the first
+    // time, then only changed fields. The track is fetched again only
+    // when the position has moved.
     async updateAllData() {
-        await Promise.all([
-            this.updateGPSData(),
-            this.updateSystemStatus(),
-            this.updateSensorData()
-        ]);
+        const start = performance.now();
+        const moved = this.version === 0
+            ? await this.updateDashboardData()
+            : await this.updateDeltaData();
+        if (moved) {
+            await this.updateTrackData();
+        }
+        this.recordRefreshTime(performance.now() - start);
+    }
+    
+    // Returns whether the position changed
+    async updateDashboardData() {
+        const data = await this.fetchData('/dashboard');
+        if (!data) return false;
+        
+        const { sensors, ...status } = data.status;
+        this.state = {
+            ...data.gps,
+            ...status,
+            gps: sensors.gps,
+            fallDetection: sensors.fallDetection,
+            ...data.sensors
+        };
+        this.version = data.v;
+        this.updateConnectionStatus(true);
+        this.renderState();
+        return true;
+    }
+    
+    // Only the fields changed since the last version seen; the device
+    // answers with everything when it does not know that version
+    async updateDeltaData() {
+        const data = await this.fetchData(`/delta?since=${this.version}`);
+        if (!data) return false;
+        
+        this.state = data.full ? data.changes : { ...this.state, ...data.changes };
+        this.version = data.v;
+        this.updateConnectionStatus(true);
+        if (!data.full && Object.keys(data.changes).length === 0) return false;
+        
+        this.renderState();
+        return data.full || 'latitude' in data.changes || 'longitude' in data.changes;
+    }
+    
+    renderState() {
+        const state = this.state;
+        this.updateLocationDisplay(state);
+        this.updateMap(state.latitude, state.longitude);
+        this.updateSystemDisplay({
+            status: state.status,
+            sensors: { gps: state.gps, fallDetection: state.fallDetection, wifi: 'active' },
+            batteryLevel: state.batteryLevel
+        });
+        this.updateSensorDisplay(state);
+    }
+    
+    // Average over the last 12 refreshes (one minute), shown in the footer
+    recordRefreshTime(ms) {
+        this.refreshTimes.push(ms);
+        if (this.refreshTimes.length > 12) this.refreshTimes.shift();
+        const average = this.refreshTimes.reduce((a, b) => a + b, 0) / this.refreshTimes.length;
+        const element = document.getElementById('refreshTime');
+        if (element) element.textContent = `${Math.round(average)} ms`;
     }
     
     async updateGPSData() {
@@ -73,23 +159,16 @@ class DrishtiGuideInterface {
         }
     }
     
-    async updateSystemStatus() {
-        const data = await this.fetchData('/status');
-        if (data) {
-            this.updateSystemDisplay(data);
-            this.updateConnectionStatus(true);
+    async updateTrackData() {
+        // Breadcrumbs simplified on the device to fit the map
+        const data = await this.fetchData('/track?max=200');
+        if (data && Array.isArray(data.points)) {
+            this.trackPoints = data.points;
+            // renderState() drew the map before the new points arrived
+            this.updateMap(this.state.latitude, this.state.longitude);
         }
     }
     
-    async updateSensorData() {
-        // For now, we'll simulate sensor data
-        // In real implementation, this would come from /sensors endpoint
-        this.updateSensorDisplay({
-            distance: Math.floor(Math.random() * 400) + 10,
-            motion: Math.random() > 0.3 ? 'Active' : 'Inactive'
-        });
-    }
-    
     // Display Updates
     updateLocationDisplay(data) {
         const elements = {
@@ -201,10 +280,9 @@ class DrishtiGuideInterface {
     updateMap(latitude, longitude) {
         const mapElement = document.getElementById('map');
         if (mapElement && latitude && longitude) {
-            // Update map with new coordinates
-            // This is a placeholder implementation
             mapElement.innerHTML = `
-                <div style="text-align: center; padding: 2rem;">
+                ${this.renderTrack()}
+                <div style="text-align: center; padding: 1rem;">
                     <i class="fas fa-map-marker-alt" style="font-size: 2rem; color: var(--primary-color); margin-bottom: 1rem;"></i>
                     <p style="margin: 0; font-weight: 600;">Location Tracked</p>
                     <p style="margin: 0; color: var(--text-secondary); font-size: 0.875rem;">
@@ -215,6 +293,31 @@ class DrishtiGuideInterface {
         }
     }
     
+    renderTrack() {
+        // Points are [timestamp, latitude, longitude]
+        const points = this.trackPoints;
+        if (!points || points.length < 2) return '';
+        
+        const lats = points.map(p => p[1]);
+        const lons = points.map(p => p[2]);
+        const minLat = Math.min(...lats), maxLat = Math.max(...lats);
+        const minLon = Math.min(...lons), maxLon = Math.max(...lons);
+        const span = Math.max(maxLat - minLat, maxLon - minLon) || 1e-6;
+        
+        const size = 200;
+        const coords = points.map(p => {
+            const x = ((p[2] - minLon) / span) * size;
+            const y = size - ((p[1] - minLat) / span) * size;
+            return `${x.toFixed(1)},${y.toFixed(1)}`;
+        }).join(' ');
+        
+        return `
+            <svg viewBox="-5 -5 ${size + 10} ${size + 10}" style="width: 100%; max-height: 220px;">
+                <polyline points="${coords}" fill="none" stroke="var(--primary-color)" stroke-width="2" />
+            </svg>
+        `;
+    }
+    
     // Alert Management
     addAlert(type, message) {
         const alert = {
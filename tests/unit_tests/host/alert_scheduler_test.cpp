@@ -0,0 +1,286 @@
+// Host harness for AlertScheduler. Run with a case name; exits non-zero
+// on failure and prints the reason.
+
+#include "alert_scheduler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#define CHECK(cond) do { if (!(cond)) { \
+    std::printf("FAIL %s:%d %s\n", __FILE__, __LINE__, #cond); return 1; } } while (0)
+
+static AlertRequest makeRequest(uint8_t pattern, uint8_t priority, uint32_t delayMs = 0) {
+    AlertRequest request;
+    std::memset(&request, 0, sizeof(request));
+    request.pattern = pattern;
+    request.priority = priority;
+    request.delayMs = delayMs;
+    return request;
+}
+
+static uint32_t nowUs() {
+    using namespace std::chrono;
+    return (uint32_t)duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+static int testPriorityOrder() {
+    AlertScheduler s;
+    CHECK(s.post(makeRequest(1, ALERT_PRIORITY_LOW)));
+    CHECK(s.post(makeRequest(2, ALERT_PRIORITY_NORMAL)));
+    CHECK(s.post(makeRequest(3, ALERT_PRIORITY_EMERGENCY)));
+    CHECK(s.post(makeRequest(4, ALERT_PRIORITY_NORMAL)));
+    CHECK(s.post(makeRequest(5, ALERT_PRIORITY_WARNING)));
+    s.collect(0);
+
+    CHECK(s.topPriority() == ALERT_PRIORITY_EMERGENCY);
+    const uint8_t expected[] = { 3, 5, 2, 4, 1 };
+    AlertRequest out;
+    for (uint8_t pattern : expected) {
+        CHECK(s.pop(out));
+        CHECK(out.pattern == pattern);
+    }
+    CHECK(!s.pop(out));
+    CHECK(s.topPriority() == -1);
+    return 0;
+}
+
+static int testPreemptResume() {
+    AlertScheduler s;
+    CHECK(s.post(makeRequest(1, ALERT_PRIORITY_WARNING)));
+    CHECK(s.post(makeRequest(2, ALERT_PRIORITY_WARNING)));
+    s.collect(0);
+
+    AlertRequest playing;
+    CHECK(s.pop(playing));
+    CHECK(playing.pattern == 1);
+
+    // An emergency arrives while pattern 1 is halfway through
+    CHECK(s.post(makeRequest(9, ALERT_PRIORITY_EMERGENCY)));
+    s.collect(0);
+    CHECK(s.topPriority() > playing.priority);
+
+    AlertRequest resumed = playing;
+    resumed.flags = ALERT_FLAG_RESUME;
+    resumed.resumeStep = 3;
+    resumed.resumeRepeats = 2;
+    s.requeue(resumed);
+    s.notePreemption();
+
+    AlertRequest out;
+    CHECK(s.pop(out) && out.pattern == 9);
+    CHECK(s.pop(out) && out.pattern == 1 && out.resumeStep == 3 && out.resumeRepeats == 2);
+    CHECK(s.pop(out) && out.pattern == 2);
+    CHECK(s.getStats().preempted == 1);
+    return 0;
+}
+
+static int testTimerWheel() {
+    AlertScheduler s;
+    const uint32_t horizon = ALERT_WHEEL_SLOTS * ALERT_WHEEL_TICK_MS;
+    CHECK(s.post(makeRequest(1, ALERT_PRIORITY_NORMAL, 120)));
+    CHECK(s.post(makeRequest(2, ALERT_PRIORITY_NORMAL, 20)));
+    CHECK(s.post(makeRequest(3, ALERT_PRIORITY_NORMAL, horizon * 2 + 10)));
+    s.collect(1000);
+    CHECK(s.delayedPending() == 3);
+
+    uint32_t dueMs;
+    CHECK(s.nextDue(dueMs));
+    CHECK(dueMs >= 1020 && dueMs < 1020 + ALERT_WHEEL_TICK_MS);
+
+    // Step a virtual clock and record when each alert becomes ready
+    uint32_t firedAt[4] = { 0, 0, 0, 0 };
+    AlertRequest out;
+    for (uint32_t t = 1000; t <= 1000 + horizon * 3; t += 10) {
+        s.collect(t);
+        while (s.pop(out)) firedAt[out.pattern] = t;
+    }
+    CHECK(firedAt[2] >= 1020 && firedAt[2] < 1020 + ALERT_WHEEL_TICK_MS);
+    CHECK(firedAt[1] >= 1120 && firedAt[1] < 1120 + ALERT_WHEEL_TICK_MS);
+    CHECK(firedAt[3] >= 1000 + horizon * 2 + 10);
+    CHECK(firedAt[3] < 1000 + horizon * 2 + 10 + ALERT_WHEEL_TICK_MS);
+    CHECK(s.delayedPending() == 0);
+
+    // A clock jump over several revolutions still fires everything due
+    CHECK(s.post(makeRequest(1, ALERT_PRIORITY_NORMAL, 100)));
+    s.collect(20000);
+    s.collect(20000 + horizon * 5);
+    CHECK(s.pop(out) && out.pattern == 1);
+    return 0;
+}
+
+// millis() wraps after 49.7 days; delayed alerts across it fire on time
+// and the next due time stays a short wrap-safe wait
+static int testClockWrap() {
+    AlertScheduler s;
+    const uint32_t start = 0xFFFFFFFFUL - 95;
+    s.collect(start - 1000);
+    CHECK(s.post(makeRequest(1, ALERT_PRIORITY_NORMAL, 300)));
+    CHECK(s.post(makeRequest(2, ALERT_PRIORITY_NORMAL, 50)));
+    s.collect(start);
+    CHECK(s.delayedPending() == 2);
+
+    uint32_t dueMs;
+    CHECK(s.nextDue(dueMs));
+    int32_t waitMs = (int32_t)(dueMs - start);
+    CHECK(waitMs >= 50 && waitMs < 50 + ALERT_WHEEL_TICK_MS);
+
+    // Nothing fires early, right before the wrap
+    AlertRequest out;
+    s.collect(start + 40);
+    CHECK(!s.pop(out));
+
+    uint32_t firedAt[3] = { 0, 0, 0 };
+    bool fired[3] = { false, false, false };
+    for (uint32_t elapsed = 40; elapsed <= 1000; elapsed += 10) {
+        s.collect(start + elapsed);
+        while (s.pop(out)) {
+            firedAt[out.pattern] = elapsed;
+            fired[out.pattern] = true;
+        }
+        if (!fired[1] && s.nextDue(dueMs)) {
+            waitMs = (int32_t)(dueMs - (start + elapsed));
+            CHECK(waitMs > -ALERT_WHEEL_TICK_MS && waitMs < 300);
+        }
+    }
+    CHECK(fired[2] && firedAt[2] >= 50 && firedAt[2] < 50 + ALERT_WHEEL_TICK_MS);
+    CHECK(fired[1] && firedAt[1] >= 300 && firedAt[1] < 300 + ALERT_WHEEL_TICK_MS);
+    CHECK(!s.nextDue(dueMs));
+    return 0;
+}
+
+static int testClear() {
+    AlertScheduler s;
+    CHECK(s.post(makeRequest(1, ALERT_PRIORITY_NORMAL)));
+    CHECK(s.post(makeRequest(2, ALERT_PRIORITY_NORMAL, 500)));
+    AlertRequest clear = makeRequest(0, 0);
+    clear.flags = ALERT_FLAG_CLEAR_READY;
+    CHECK(s.post(clear));
+    CHECK(s.post(makeRequest(3, ALERT_PRIORITY_LOW)));
+    s.collect(0);
+
+    AlertRequest out;
+    CHECK(s.pop(out) && out.pattern == 3);
+    CHECK(!s.pop(out));
+    CHECK(s.delayedPending() == 1);
+
+    clear.flags = ALERT_FLAG_CLEAR_DELAYED;
+    CHECK(s.post(clear));
+    s.collect(0);
+    s.collect(1000);
+    CHECK(s.delayedPending() == 0);
+    CHECK(!s.pop(out));
+    return 0;
+}
+
+static int testRingFull() {
+    AlertScheduler s;
+    for (uint32_t i = 0; i < ALERT_QUEUE_SIZE; i++) {
+        CHECK(s.post(makeRequest(1, ALERT_PRIORITY_LOW)));
+    }
+    CHECK(!s.post(makeRequest(1, ALERT_PRIORITY_LOW)));
+    CHECK(s.getStats().dropped == 1);
+    s.collect(0);
+    CHECK(s.post(makeRequest(1, ALERT_PRIORITY_LOW)));
+    return 0;
+}
+
+// Several producer threads post concurrently while one consumer drains.
+// Every accepted post must be delivered exactly once (or counted as a
+// ready-queue drop), order per producer and priority must hold, and the
+// post-to-pop latency must stay small.
+static int testConcurrentProducers() {
+    const int producers = 4;
+    const int perProducer = 20000;
+    AlertScheduler s;
+    std::atomic<int> running(producers);
+    std::atomic<uint32_t> accepted(0);
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; p++) {
+        threads.emplace_back([&, p]() {
+            for (int i = 0; i < perProducer; i++) {
+                AlertRequest request = makeRequest((uint8_t)p, (uint8_t)(i % ALERT_PRIORITY_COUNT));
+                request.resumeStep = (uint8_t)i;                 // Low bits of the sequence
+                request.resumeRepeats = (uint8_t)(i >> 8);
+                request.postedUs = nowUs();
+                if (s.post(request)) accepted++;
+                else std::this_thread::yield();
+            }
+            running--;
+        });
+    }
+
+    std::vector<uint32_t> latencies;
+    latencies.reserve(producers * perProducer);
+    int lastSeq[producers][ALERT_PRIORITY_COUNT];
+    std::memset(lastSeq, -1, sizeof(lastSeq));
+    uint32_t delivered = 0;
+    bool ordered = true;
+    bool priorityOrdered = true;
+
+    AlertRequest out;
+    for (;;) {
+        bool done = running.load() == 0;
+        s.collect(0);
+        int previousPriority = ALERT_PRIORITY_COUNT;
+        while (s.pop(out)) {
+            if (out.priority > previousPriority) priorityOrdered = false;
+            previousPriority = out.priority;
+
+            int seq = out.resumeStep | (out.resumeRepeats << 8);
+            if (seq <= lastSeq[out.pattern][out.priority]) ordered = false;
+            lastSeq[out.pattern][out.priority] = seq;
+
+            latencies.push_back(nowUs() - out.postedUs);
+            delivered++;
+        }
+        if (done) break;
+    }
+    for (std::thread& t : threads) t.join();
+    s.collect(0);
+    while (s.pop(out)) delivered++;
+
+    AlertStats stats = s.getStats();
+    uint32_t rejected = producers * perProducer - accepted.load();
+    std::printf("posted %u accepted %u rejected %u delivered %u ready drops %u\n",
+                stats.posted, accepted.load(), rejected, delivered, stats.dropped - rejected);
+
+    CHECK(ordered);
+    CHECK(priorityOrdered);
+    CHECK(stats.posted == accepted.load());
+    CHECK(accepted.load() == delivered + (stats.dropped - rejected));
+    CHECK(delivered > 0);
+
+    std::sort(latencies.begin(), latencies.end());
+    uint32_t p50 = latencies[latencies.size() / 2];
+    uint32_t p99 = latencies[latencies.size() * 99 / 100];
+    std::printf("latency p50 %u us p99 %u us max %u us\n", p50, p99, latencies.back());
+    CHECK(p99 < 100000);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    struct { const char* name; int (*run)(); } cases[] = {
+        { "priority_order", testPriorityOrder },
+        { "preempt_resume", testPreemptResume },
+        { "timer_wheel", testTimerWheel },
+        { "clock_wrap", testClockWrap },
+        { "clear", testClear },
+        { "ring_full", testRingFull },
+        { "concurrent_producers", testConcurrentProducers },
+    };
+
+    int failures = 0;
+    for (auto& c : cases) {
+        if (argc > 1 && std::strcmp(argv[1], c.name) != 0) continue;
+        int result = c.run();
+        std::printf("%s %s\n", result == 0 ? "PASS" : "FAIL", c.name);
+        failures += result;
+    }
+    return failures == 0 ? 0 : 1;
+}
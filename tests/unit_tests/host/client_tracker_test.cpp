@@ -0,0 +1,144 @@
+// Host harness for ClientTracker. Run with a case name; exits non-zero on
+// failure and prints the reason.
+
+#include "client_tracker.h"
+
+#include <cstdio>
+#include <cstring>
+
+#define CHECK(cond) do { if (!(cond)) { \
+    std::printf("FAIL %s:%d %s\n", __FILE__, __LINE__, #cond); return 1; } } while (0)
+
+static const uint8_t macs[][CLIENT_MAC_LEN] = {
+    { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 },
+    { 0x02, 0x00, 0x00, 0x00, 0x00, 0x02 },
+    { 0x02, 0x00, 0x00, 0x00, 0x00, 0x03 },
+    { 0x02, 0x00, 0x00, 0x00, 0x00, 0x04 },
+    { 0x02, 0x00, 0x00, 0x00, 0x00, 0x05 },
+    { 0xAC, 0x67, 0xB2, 0x0F, 0xE1, 0x9D },
+};
+
+static int connects = 0;
+static int disconnects = 0;
+static WiFiClientRecord lastEvent;
+static void onConnect(const WiFiClientRecord& c) { connects++; lastEvent = c; }
+static void onDisconnect(const WiFiClientRecord& c) { disconnects++; lastEvent = c; }
+
+static int testJoinLeave() {
+    ClientTracker tracker;
+    tracker.setConnectCallback(onConnect);
+    tracker.setDisconnectCallback(onDisconnect);
+    connects = disconnects = 0;
+
+    tracker.onJoined(macs[0], 1, 1000);
+    tracker.onJoined(macs[1], 2, 2000);
+    CHECK(tracker.getClientCount() == 2);
+    CHECK(connects == 2);
+    CHECK(std::memcmp(lastEvent.mac, macs[1], CLIENT_MAC_LEN) == 0);
+    CHECK(lastEvent.aid == 2 && lastEvent.connectTimeMs == 2000 && lastEvent.active);
+    CHECK(tracker.isConnected(macs[0]));
+    CHECK(!tracker.isConnected(macs[2]));
+
+    tracker.onLeft(macs[0]);
+    CHECK(tracker.getClientCount() == 1);
+    CHECK(disconnects == 1);
+    CHECK(std::memcmp(lastEvent.mac, macs[0], CLIENT_MAC_LEN) == 0 && !lastEvent.active);
+    CHECK(!tracker.isConnected(macs[0]));
+
+    // Leaving twice, or without joining, changes nothing
+    tracker.onLeft(macs[0]);
+    tracker.onLeft(macs[3]);
+    CHECK(tracker.getClientCount() == 1);
+    CHECK(disconnects == 1);
+
+    WiFiClientRecord out[WIFI_MAX_CLIENTS];
+    CHECK(tracker.snapshot(out, WIFI_MAX_CLIENTS) == 1);
+    CHECK(std::memcmp(out[0].mac, macs[1], CLIENT_MAC_LEN) == 0);
+
+    ClientStats stats = tracker.getStats();
+    CHECK(stats.joins == 2 && stats.leaves == 1 && stats.dropped == 0);
+    return 0;
+}
+
+// A station that reassociates without a leave keeps one record
+static int testRejoin() {
+    ClientTracker tracker;
+    tracker.onJoined(macs[0], 1, 1000);
+    tracker.onIpAssigned(macs[0], 0x0204A8C0UL);
+    tracker.onJoined(macs[0], 3, 5000);
+    CHECK(tracker.getClientCount() == 1);
+
+    WiFiClientRecord out[WIFI_MAX_CLIENTS];
+    CHECK(tracker.snapshot(out, WIFI_MAX_CLIENTS) == 1);
+    CHECK(out[0].aid == 3 && out[0].connectTimeMs == 5000 && out[0].ip == 0);
+    return 0;
+}
+
+static int testFull() {
+    ClientTracker tracker;
+    for (int i = 0; i < WIFI_MAX_CLIENTS + 1; i++) tracker.onJoined(macs[i], i + 1, 100 * i);
+    CHECK(tracker.getClientCount() == WIFI_MAX_CLIENTS);
+    CHECK(tracker.getStats().dropped == 1);
+    CHECK(!tracker.isConnected(macs[WIFI_MAX_CLIENTS]));
+
+    // A freed slot is reused
+    tracker.onLeft(macs[1]);
+    tracker.onJoined(macs[WIFI_MAX_CLIENTS], 9, 9000);
+    CHECK(tracker.getClientCount() == WIFI_MAX_CLIENTS);
+    CHECK(tracker.isConnected(macs[WIFI_MAX_CLIENTS]));
+
+    WiFiClientRecord out[2];
+    CHECK(tracker.snapshot(out, 2) == 2);
+    return 0;
+}
+
+static int testIpAssigned() {
+    ClientTracker tracker;
+    tracker.onJoined(macs[0], 1, 1000);
+    tracker.onJoined(macs[1], 2, 2000);
+
+    tracker.onIpAssigned(macs[0], 0x0204A8C0UL);
+    // Without a MAC the newest station lacking an address gets it
+    tracker.onIpAssigned(NULL, 0x0304A8C0UL);
+    tracker.onIpAssigned(macs[4], 0x0904A8C0UL);   // Unknown station
+
+    WiFiClientRecord out[WIFI_MAX_CLIENTS];
+    uint8_t n = tracker.snapshot(out, WIFI_MAX_CLIENTS);
+    CHECK(n == 2);
+    for (uint8_t i = 0; i < n; i++) {
+        if (out[i].aid == 1) CHECK(out[i].ip == 0x0204A8C0UL);
+        else CHECK(out[i].ip == 0x0304A8C0UL);
+    }
+
+    tracker.setRssi(macs[1], -61);
+    tracker.snapshot(out, WIFI_MAX_CLIENTS);
+    CHECK(out[0].rssi == 0 && out[1].rssi == -61);
+    return 0;
+}
+
+static int testRecord() {
+    CHECK(sizeof(WiFiClientRecord) <= 20);
+    char text[18];
+    ClientTracker::formatMac(macs[5], text);
+    CHECK(std::strcmp(text, "AC:67:B2:0F:E1:9D") == 0);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    struct { const char* name; int (*run)(); } cases[] = {
+        { "join_leave", testJoinLeave },
+        { "rejoin", testRejoin },
+        { "full", testFull },
+        { "ip_assigned", testIpAssigned },
+        { "record", testRecord },
+    };
+
+    int failures = 0;
+    for (auto& c : cases) {
+        if (argc > 1 && std::strcmp(argv[1], c.name) != 0) continue;
+        int result = c.run();
+        std::printf("%s %s\n", result == 0 ? "PASS" : "FAIL", c.name);
+        failures += result;
+    }
+    return failures == 0 ? 0 : 1;
+}
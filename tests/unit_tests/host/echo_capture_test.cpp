@@ -0,0 +1,204 @@
+// Host harness for EchoCapture. Run with a case name; exits non-zero on
+// failure and prints the reason.
+
+#include "echo_capture.h"
+
+#include <cstdio>
+#include <cstring>
+
+#define CHECK(cond) do { if (!(cond)) { \
+    std::printf("FAIL %s:%d %s\n", __FILE__, __LINE__, #cond); return 1; } } while (0)
+
+// HC-SR04: the echo line rises once the burst is out and falls when the
+// echo returns, or after NO_ECHO_HOLD_US without one
+#define BURST_US 460
+#define NO_ECHO_HOLD_US 38000
+
+static uint32_t pulseFor(uint32_t cm) {
+    return (uint32_t)(2 * cm / SPEED_OF_SOUND);
+}
+
+static int testEcho() {
+    EchoCapture echo;
+    uint32_t pulse = 0;
+    CHECK(echo.ready(0));
+
+    echo.arm(1000);
+    CHECK(!echo.ready(1000));
+    CHECK(echo.poll(1200, &pulse) == ECHO_PENDING);
+    echo.onEdge(true, 1000 + BURST_US);
+    CHECK(echo.getState() == ECHO_WAIT_END);
+    CHECK(echo.poll(3000, &pulse) == ECHO_PENDING);
+    echo.onEdge(false, 1000 + BURST_US + pulseFor(100));
+
+    // The edges are stamped by the interrupt, so a late poll reads the same
+    CHECK(echo.poll(20000, &pulse) == ECHO_OK);
+    CHECK(pulse == pulseFor(100));
+    CHECK(EchoCapture::toDistanceCm(pulse) >= 99 && EchoCapture::toDistanceCm(pulse) <= 100);
+    CHECK(echo.poll(20001, &pulse) == ECHO_PENDING);
+
+    EchoStats stats = echo.getStats();
+    CHECK(stats.measurements == 1 && stats.spurious == 0);
+    CHECK(stats.lastCycleUs == BURST_US + pulseFor(100));
+
+    // Guard time before the next trigger
+    CHECK(!echo.ready(20000 + ECHO_GUARD_TIME - 1));
+    CHECK(echo.ready(20000 + ECHO_GUARD_TIME));
+    return 0;
+}
+
+// Nothing in range: the result comes at the round trip of MAX_DISTANCE,
+// not when the sensor drops the line
+static int testNoTarget() {
+    EchoCapture echo;
+    uint32_t pulse = 12345;
+    echo.arm(0);
+    echo.onEdge(true, BURST_US);
+    CHECK(echo.poll(BURST_US + TIMEOUT_DURATION, &pulse) == ECHO_PENDING);
+    CHECK(echo.poll(BURST_US + TIMEOUT_DURATION + 1, &pulse) == ECHO_NO_TARGET);
+    CHECK(pulse == 12345);
+    CHECK(echo.getStats().lastCycleUs == BURST_US + TIMEOUT_DURATION);
+
+    // No new trigger until the sensor releases the line
+    CHECK(echo.getState() == ECHO_SETTLE);
+    CHECK(!echo.ready(BURST_US + NO_ECHO_HOLD_US - 1));
+    echo.onEdge(false, BURST_US + NO_ECHO_HOLD_US);
+    CHECK(echo.poll(BURST_US + NO_ECHO_HOLD_US, &pulse) == ECHO_PENDING);
+    CHECK(echo.ready(BURST_US + TIMEOUT_DURATION + 1 + ECHO_GUARD_TIME));
+    CHECK(echo.getStats().noTarget == 1);
+
+    // An echo that ended past the round trip before a poll saw it
+    echo.arm(100000);
+    echo.onEdge(true, 100000 + BURST_US);
+    echo.onEdge(false, 100000 + BURST_US + TIMEOUT_DURATION + 500);
+    CHECK(echo.poll(140000, &pulse) == ECHO_NO_TARGET);
+    CHECK(echo.getState() == ECHO_IDLE);
+    CHECK(echo.getStats().lastCycleUs == BURST_US + TIMEOUT_DURATION);
+    return 0;
+}
+
+static int testNoSensor() {
+    EchoCapture echo;
+    uint32_t pulse;
+    echo.arm(0);
+    CHECK(echo.poll(ECHO_START_TIMEOUT, &pulse) == ECHO_PENDING);
+    CHECK(echo.poll(ECHO_START_TIMEOUT + 1, &pulse) == ECHO_NO_SENSOR);
+    CHECK(echo.getState() == ECHO_IDLE);
+    CHECK(echo.getStats().noSensor == 1);
+    return 0;
+}
+
+// A line held high forever does not wedge the state machine
+static int testStuck() {
+    EchoCapture echo;
+    uint32_t pulse;
+    echo.arm(0);
+    echo.onEdge(true, BURST_US);
+    CHECK(echo.poll(100000, &pulse) == ECHO_NO_TARGET);
+    CHECK(echo.poll(100000 + ECHO_SETTLE_TIMEOUT, &pulse) == ECHO_PENDING);
+    CHECK(echo.getState() == ECHO_SETTLE);
+    CHECK(echo.poll(100000 + ECHO_SETTLE_TIMEOUT + 1, &pulse) == ECHO_PENDING);
+    CHECK(echo.getState() == ECHO_IDLE);
+    CHECK(echo.getStats().stuck == 1);
+    return 0;
+}
+
+static int testSpurious() {
+    EchoCapture echo;
+    uint32_t pulse;
+    echo.onEdge(true, 10);
+    echo.onEdge(false, 20);
+    CHECK(echo.getState() == ECHO_IDLE);
+
+    echo.arm(100);
+    echo.onEdge(false, 150);        // Noise before the echo starts
+    echo.onEdge(true, 100 + BURST_US);
+    echo.onEdge(true, 700);         // Repeated rising edge
+    echo.onEdge(false, 100 + BURST_US + 1000);
+    echo.onEdge(true, 5000);        // After the echo, before the poll
+    CHECK(echo.poll(6000, &pulse) == ECHO_OK);
+    CHECK(pulse == 1000);
+    CHECK(echo.getStats().spurious == 5);
+    return 0;
+}
+
+// micros() wraps every 71 minutes
+static int testWrap() {
+    EchoCapture echo;
+    uint32_t pulse;
+    uint32_t t = 0xFFFFFFFFUL - 300;
+    echo.arm(t);
+    echo.onEdge(true, t + BURST_US);
+    echo.onEdge(false, t + BURST_US + pulseFor(50));
+    CHECK(echo.poll(t + 10000, &pulse) == ECHO_OK);
+    CHECK(pulse == pulseFor(50));
+    CHECK(!echo.ready(t + 10000 + ECHO_GUARD_TIME - 1));
+    CHECK(echo.ready(t + 10000 + ECHO_GUARD_TIME));
+    return 0;
+}
+
+// Back-to-back measurements against a simulated sensor, with the loop
+// polling every LOOP_US: the achievable sample rate per target distance
+#define LOOP_US 50
+
+static int measureRate(uint32_t cm, double* hz, uint32_t* maxCycleUs) {
+    EchoCapture echo;
+    uint32_t riseAt = 0, fallAt = 0;
+    bool rising = false, falling = false;
+    uint32_t results = 0;
+    const uint32_t duration = 1000000;
+
+    for (uint32_t t = 0; t < duration; t += LOOP_US) {
+        if (rising && t >= riseAt) { echo.onEdge(true, riseAt); rising = false; }
+        if (falling && !rising && t >= fallAt) { echo.onEdge(false, fallAt); falling = false; }
+        if (!rising && !falling && echo.ready(t)) {
+            echo.arm(t);
+            riseAt = t + BURST_US;
+            fallAt = riseAt + (cm ? pulseFor(cm) : NO_ECHO_HOLD_US);
+            rising = falling = true;
+        }
+        uint32_t pulse;
+        EchoResult r = echo.poll(t, &pulse);
+        if (r == ECHO_NO_SENSOR) return 1;
+        if (r != ECHO_PENDING) results++;
+    }
+    *hz = results * 1e6 / duration;
+    *maxCycleUs = echo.getStats().maxCycleUs;
+    return 0;
+}
+
+static int testRate() {
+    static const uint32_t distances[] = { 20, 100, 200, MAX_DISTANCE, 0 };
+    for (uint32_t cm : distances) {
+        double hz;
+        uint32_t maxCycleUs;
+        CHECK(measureRate(cm, &hz, &maxCycleUs) == 0);
+        // A result within the burst and the round trip of MAX_DISTANCE
+        CHECK(maxCycleUs <= BURST_US + TIMEOUT_DURATION);
+        if (cm) std::printf("RATE %ucm %.1f Hz cycle %u us\n", (unsigned)cm, hz, (unsigned)maxCycleUs);
+        else std::printf("RATE none %.1f Hz cycle %u us\n", hz, (unsigned)maxCycleUs);
+        CHECK(hz > 0);
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    struct { const char* name; int (*run)(); } cases[] = {
+        { "echo", testEcho },
+        { "no_target", testNoTarget },
+        { "no_sensor", testNoSensor },
+        { "stuck", testStuck },
+        { "spurious", testSpurious },
+        { "wrap", testWrap },
+        { "rate", testRate },
+    };
+
+    int failures = 0;
+    for (auto& c : cases) {
+        if (argc > 1 && std::strcmp(argv[1], c.name) != 0) continue;
+        int result = c.run();
+        std::printf("%s %s\n", result == 0 ? "PASS" : "FAIL", c.name);
+        failures += result;
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,444 @@
+// Host harness for EmergencyLane against a virtual clock. Run with a
+// case name; exits non-zero on failure and prints the reason.
+// "deliver <host> <http port> <udp port>" raises one fall and sends it to
+// a real webhook and UDP listener, which acknowledges the packet, printing
+// what each sink took.
+
+#include "emergency_lane.h"
+
+#include <arpa/inet.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <vector>
+
+#define CHECK(cond) do { if (!(cond)) { \
+    std::printf("FAIL %s:%d %s\n", __FILE__, __LINE__, #cond); return 1; } } while (0)
+
+static uint32_t nowUs = 0;
+static uint32_t virtualClock() { return nowUs; }
+
+// A sink that fails a set number of times, taking sendUs per attempt;
+// one that awaits hands every attempt on for confirm()
+struct FakeSink {
+    int failuresLeft;
+    uint32_t sendUs;
+    std::vector<uint32_t> attemptsAtUs;
+    std::vector<uint32_t> ids;
+    std::vector<uint8_t> attemptNumbers;
+    bool awaits;
+};
+
+static EmergencySendResult fakeSend(const EmergencyEvent& e, uint8_t attempt, void* context) {
+    FakeSink& s = *static_cast<FakeSink*>(context);
+    s.attemptsAtUs.push_back(nowUs);
+    s.ids.push_back(e.id);
+    s.attemptNumbers.push_back(attempt);
+    nowUs += s.sendUs;
+    if (s.failuresLeft > 0) {
+        s.failuresLeft--;
+        return EMERGENCY_SEND_FAILED;
+    }
+    return s.awaits ? EMERGENCY_SEND_AWAITING : EMERGENCY_SEND_DELIVERED;
+}
+
+static EmergencyEvent makeEvent(uint32_t id, uint32_t detectedUs) {
+    EmergencyEvent e;
+    std::memset(&e, 0, sizeof(e));
+    e.id = id;
+    e.detectedUs = detectedUs;
+    e.uptimeMs = 3723000;
+    e.latitudeE6 = 12840600;
+    e.longitudeE6 = -80153400;
+    e.falls = 2;
+    e.flags = EMERGENCY_FLAG_GPS_FIX;
+    return e;
+}
+
+// Runs service() at every deadline it asks for, up to a limit
+static void runUntilIdle(EmergencyLane& lane, uint32_t limitUs) {
+    uint32_t start = nowUs;
+    for (;;) {
+        uint32_t wait = lane.service();
+        if (wait == EMERGENCY_IDLE_US || nowUs - start + wait > limitUs) return;
+        nowUs += wait;
+    }
+}
+
+static int testDeliver() {
+    EmergencyLane lane;
+    lane.setClock(virtualClock);
+    FakeSink udp = { 0, 300, {}, {}, {}, false };
+    FakeSink sse = { 0, 900, {}, {}, {}, false };
+    FakeSink hook = { 0, 12000, {}, {}, {}, false };
+    CHECK(lane.addSink("udp", fakeSend, &udp) == 0);
+    lane.addSink("sse", fakeSend, &sse);
+    lane.addSink("webhook", fakeSend, &hook);
+    CHECK(lane.getSinkCount() == 3);
+
+    nowUs = 1000000;
+    CHECK(!lane.isPending());
+    CHECK(lane.raise(makeEvent(7, 999000)));
+    CHECK(lane.isPending());
+    CHECK(lane.service() == EMERGENCY_IDLE_US);
+    CHECK(!lane.isPending());
+
+    // Every sink on the first pass, in order
+    CHECK(udp.attemptsAtUs.size() == 1 && sse.attemptsAtUs.size() == 1 && hook.attemptsAtUs.size() == 1);
+    CHECK(udp.attemptsAtUs[0] < sse.attemptsAtUs[0] && sse.attemptsAtUs[0] < hook.attemptsAtUs[0]);
+    CHECK(udp.attemptNumbers[0] == 1 && hook.ids[0] == 7);
+
+    // Latency runs from the sample that showed the fall
+    CHECK(lane.getSinkStats(0).lastLatencyUs == 1000 + 300);
+    CHECK(lane.getSinkStats(1).lastLatencyUs == 1000 + 300 + 900);
+    CHECK(lane.getSinkStats(2).lastLatencyUs == 1000 + 300 + 900 + 12000);
+    CHECK(lane.getSinkStats(2).lastSendUs == 12000);
+    CHECK(lane.getStats().lastLatencyUs == 1300 && lane.getStats().raised == 1);
+    CHECK(lane.getSinkStats(0).late == 0);
+
+    EmergencyEvent latest;
+    CHECK(lane.getLatest(latest) && latest.id == 7);
+
+    // Past the deadline counts as late
+    hook.sendUs = EMERGENCY_DEADLINE_MS * 1000;
+    lane.raise(makeEvent(8, nowUs));
+    lane.service();
+    CHECK(lane.getSinkStats(2).late == 1 && lane.getSinkStats(0).late == 0);
+    return 0;
+}
+
+static int testBackoff() {
+    EmergencyLane lane;
+    lane.setClock(virtualClock);
+    FakeSink udp = { 0, 100, {}, {}, {}, false };
+    FakeSink hook = { 3, 0, {}, {}, {}, false };
+    lane.addSink("udp", fakeSend, &udp);
+    lane.addSink("webhook", fakeSend, &hook);
+
+    nowUs = 5000000;
+    lane.raise(makeEvent(1, nowUs));
+    uint32_t wait = lane.service();
+    CHECK(wait == EMERGENCY_RETRY_BASE_MS * 1000UL);
+    runUntilIdle(lane, 60000000);
+
+    // 0, +base, +2 base, +4 base; the other sink is not retried
+    CHECK(hook.attemptsAtUs.size() == 4);
+    for (uint8_t i = 1; i < 4; i++) {
+        CHECK(hook.attemptsAtUs[i] - hook.attemptsAtUs[i - 1] == EmergencyLane::backoffMs(i) * 1000);
+        CHECK(hook.ids[i] == 1 && hook.attemptNumbers[i] == i + 1);
+    }
+    CHECK(EmergencyLane::backoffMs(1) == EMERGENCY_RETRY_BASE_MS);
+    CHECK(EmergencyLane::backoffMs(2) == 2 * EMERGENCY_RETRY_BASE_MS);
+    CHECK(EmergencyLane::backoffMs(30) == EMERGENCY_RETRY_MAX_MS);
+    CHECK(udp.attemptsAtUs.size() == 1);
+    CHECK(lane.getSinkStats(1).retries == 3 && lane.getSinkStats(1).delivered == 1);
+    CHECK(lane.getSinkStats(1).lastLatencyUs == 100 + 7 * EMERGENCY_RETRY_BASE_MS * 1000UL);
+    CHECK(lane.getStats().lastLatencyUs == 100);
+    CHECK(!lane.isPending());
+
+    // A sink that never answers gives up after EMERGENCY_MAX_ATTEMPTS
+    hook.failuresLeft = 1000;
+    hook.attemptsAtUs.clear();
+    lane.raise(makeEvent(2, nowUs));
+    runUntilIdle(lane, 600000000);
+    CHECK(hook.attemptsAtUs.size() == EMERGENCY_MAX_ATTEMPTS);
+    CHECK(lane.getSinkStats(1).failed == 1);
+    CHECK(!lane.isPending());
+    uint32_t last = hook.attemptsAtUs.back() - hook.attemptsAtUs[hook.attemptsAtUs.size() - 2];
+    CHECK(last <= EMERGENCY_RETRY_MAX_MS * 1000UL);
+    return 0;
+}
+
+static int testDedup() {
+    EmergencyLane lane;
+    lane.setClock(virtualClock);
+    FakeSink hook = { 2, 0, {}, {}, {}, false };
+    lane.addSink("webhook", fakeSend, &hook);
+
+    lane.setIdBase(0xFFFFFFF0UL);
+    uint32_t a = lane.nextId();
+    uint32_t b = lane.nextId();
+    CHECK(a != b && a == 0xFFFFFFF1UL);
+
+    nowUs = 0;
+    CHECK(lane.raise(makeEvent(a, 0)));
+    lane.service();
+    // The same fall again while it is still being retried
+    CHECK(!lane.raise(makeEvent(a, 0)));
+    CHECK(lane.getStats().duplicates == 1 && lane.getStats().raised == 1);
+    runUntilIdle(lane, 60000000);
+
+    // Every attempt carried the same ID
+    CHECK(hook.ids.size() == 3);
+    for (size_t i = 0; i < hook.ids.size(); i++) CHECK(hook.ids[i] == a);
+    CHECK(lane.getSinkStats(0).delivered == 1);
+    return 0;
+}
+
+// More falls than slots while a sink is down: the oldest is dropped
+static int testEvict() {
+    EmergencyLane lane;
+    lane.setClock(virtualClock);
+    FakeSink hook = { 1000, 0, {}, {}, {}, false };
+    lane.addSink("webhook", fakeSend, &hook);
+
+    nowUs = 100;
+    for (uint32_t i = 1; i <= EMERGENCY_MAX_EVENTS + 1; i++) {
+        CHECK(lane.raise(makeEvent(i, nowUs)));
+        lane.service();
+        nowUs += 10;
+    }
+    CHECK(lane.getStats().evicted == 1);
+
+    hook.failuresLeft = 0;
+    hook.ids.clear();
+    runUntilIdle(lane, 60000000);
+    CHECK(hook.ids.size() == EMERGENCY_MAX_EVENTS);
+    for (size_t i = 0; i < hook.ids.size(); i++) CHECK(hook.ids[i] != 1);
+    CHECK(!lane.isPending());
+    return 0;
+}
+
+// A broadcast counts once a receiver acknowledges it, and is sent again
+// each time the wait for one runs out
+static int testConfirm() {
+    EmergencyLane lane;
+    lane.setClock(virtualClock);
+    FakeSink udp = { 0, 200, {}, {}, {}, true };
+    FakeSink sse = { 1000, 0, {}, {}, {}, false };
+    uint8_t udpSink = lane.addSink("udp", fakeSend, &udp);
+    uint8_t sseSink = lane.addSink("sse", fakeSend, &sse);
+
+    nowUs = 2000000;
+    lane.raise(makeEvent(5, nowUs));
+    CHECK(lane.service() == EMERGENCY_RETRY_BASE_MS * 1000UL);
+    CHECK(lane.isAwaiting(udpSink) && !lane.isAwaiting(sseSink));
+    // Handed on, and no subscriber: nothing has the fall yet
+    CHECK(lane.getSinkStats(udpSink).delivered == 0 && lane.getSinkStats(sseSink).delivered == 0);
+    CHECK(lane.getStats().lastLatencyUs == 0);
+
+    // No acknowledgement within the backoff: sent again at once
+    nowUs += EMERGENCY_RETRY_BASE_MS * 1000UL;
+    lane.service();
+    CHECK(udp.attemptsAtUs.size() == 2 && udp.attemptNumbers[1] == 2);
+    CHECK(lane.getSinkStats(udpSink).unconfirmed == 1 && lane.getSinkStats(udpSink).retries == 1);
+
+    // A late failure report for the first attempt leaves the second alone
+    CHECK(!lane.confirm(udpSink, 5, 1, false));
+    CHECK(lane.isAwaiting(udpSink));
+
+    // Latency runs to the acknowledgement
+    nowUs += 3000;
+    uint32_t latency = nowUs - 2000000;
+    CHECK(lane.confirm(udpSink, 5, 2, true));
+    CHECK(!lane.isAwaiting(udpSink));
+    CHECK(lane.getSinkStats(udpSink).delivered == 1 && lane.getSinkStats(udpSink).lastLatencyUs == latency);
+    CHECK(lane.getStats().lastLatencyUs == latency);
+    CHECK(!lane.confirm(udpSink, 5, 2, true));
+
+    // A subscriber that joins between retries gets the replay, which
+    // confirms the stream sink too
+    nowUs += 1000;
+    CHECK(lane.confirm(sseSink, 5, 0, true));
+    CHECK(lane.getSinkStats(sseSink).delivered == 1 && lane.getSinkStats(sseSink).failed == 0);
+    CHECK(!lane.isPending());
+    size_t sseAttempts = sse.attemptsAtUs.size();
+    runUntilIdle(lane, 60000000);
+    CHECK(sse.attemptsAtUs.size() == sseAttempts);
+
+    // A failure for the attempt in hand retries after the backoff
+    lane.raise(makeEvent(6, nowUs));
+    sse.failuresLeft = 0;
+    lane.service();
+    CHECK(lane.confirm(udpSink, 6, 1, false));
+    CHECK(lane.service() == EMERGENCY_RETRY_BASE_MS * 1000UL);
+    CHECK(lane.getSinkStats(udpSink).unconfirmed == 1);
+
+    // Never acknowledged: given up after EMERGENCY_MAX_ATTEMPTS
+    udp.attemptsAtUs.clear();
+    runUntilIdle(lane, 600000000);
+    CHECK(udp.attemptsAtUs.size() == EMERGENCY_MAX_ATTEMPTS - 1);
+    CHECK(lane.getSinkStats(udpSink).failed == 1 && lane.getSinkStats(udpSink).delivered == 1);
+    CHECK(lane.getSinkStats(udpSink).unconfirmed == 1 + EMERGENCY_MAX_ATTEMPTS - 1);
+    CHECK(!lane.isPending());
+
+    // A sink's own confirmation time replaces the backoff
+    EmergencyLane hookLane;
+    hookLane.setClock(virtualClock);
+    FakeSink hook = { 0, 0, {}, {}, {}, true };
+    hookLane.addSink("webhook", fakeSend, &hook, 3000);
+    hookLane.raise(makeEvent(9, nowUs));
+    CHECK(hookLane.service() == 3000000UL);
+    return 0;
+}
+
+static int testFormats() {
+    EmergencyEvent e = makeEvent(0xA1B2C3D4UL, 0);
+    uint8_t packet[EMERGENCY_PACKET_SIZE];
+    CHECK(encodeEmergencyPacket(e, 3, packet) == EMERGENCY_PACKET_SIZE);
+    CHECK(packet[0] == 'D' && packet[1] == 'E' && packet[2] == EMERGENCY_PACKET_VERSION);
+    CHECK(packet[4] == 0xD4 && packet[7] == 0xA1 && packet[22] == 3);
+
+    EmergencyEvent back;
+    CHECK(decodeEmergencyPacket(packet, sizeof(packet), back));
+    CHECK(back.id == e.id && back.latitudeE6 == e.latitudeE6 && back.longitudeE6 == e.longitudeE6);
+    CHECK(back.uptimeMs == e.uptimeMs && back.falls == 2 && back.flags == EMERGENCY_FLAG_GPS_FIX);
+    CHECK(!decodeEmergencyPacket(packet, sizeof(packet) - 1, back));
+    packet[0] = 'S';
+    CHECK(!decodeEmergencyPacket(packet, sizeof(packet), back));
+
+    char json[256];
+    CHECK(formatEmergencyJson(e, 2, json, sizeof(json)) > 0);
+    CHECK(std::strcmp(json, "{\"event\":\"fall\",\"id\":2712847316,\"uptimeMs\":3723000,"
+                            "\"latitude\":\"12.840600\",\"longitude\":\"-80.153400\",\"gpsFix\":true,"
+                            "\"falls\":2,\"attempt\":2}") == 0);
+    CHECK(formatEmergencyJson(e, 2, json, 20) == 0);
+
+    char request[512];
+    size_t n = formatWebhookRequest(e, 1, "192.168.4.2", "/fall", request, sizeof(request));
+    CHECK(n > 0 && n == std::strlen(request));
+    CHECK(std::strncmp(request, "POST /fall HTTP/1.1\r\nHost: 192.168.4.2\r\n", 40) == 0);
+    CHECK(std::strstr(request, "\r\nIdempotency-Key: fall-2712847316\r\n"));
+    const char* body = std::strstr(request, "\r\n\r\n") + 4;
+    char length[32];
+    std::snprintf(length, sizeof(length), "Content-Length: %u\r\n", (unsigned)std::strlen(body));
+    CHECK(std::strstr(request, length));
+
+    uint8_t ack[EMERGENCY_ACK_SIZE];
+    CHECK(encodeEmergencyAck(e.id, 4, ack) == EMERGENCY_ACK_SIZE);
+    CHECK(ack[0] == 'D' && ack[1] == 'A' && ack[3] == 4 && ack[4] == 0xD4);
+    uint32_t ackId = 0;
+    uint8_t ackAttempt = 0;
+    CHECK(decodeEmergencyAck(ack, sizeof(ack), ackId, ackAttempt) && ackId == e.id && ackAttempt == 4);
+    CHECK(!decodeEmergencyAck(ack, sizeof(ack) - 1, ackId, ackAttempt));
+    CHECK(!decodeEmergencyAck(packet, sizeof(packet), ackId, ackAttempt));
+
+    CHECK(parseHttpStatus("HTTP/1.1 200 OK") == 200);
+    CHECK(parseHttpStatus("HTTP/1.0 503 Service Unavailable") == 503);
+    CHECK(parseHttpStatus("HTTP/1.1 20") == 0);
+    CHECK(parseHttpStatus("") == 0);
+    CHECK(parseHttpStatus("SSH-2.0-OpenSSH") == 0);
+    return 0;
+}
+
+// ================= Live sinks =================
+
+static uint32_t wallUs() {
+    using namespace std::chrono;
+    return (uint32_t)duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+struct Endpoint {
+    const char* host;
+    const char* port;
+    int udpPort;
+    int udpFd;                      // Also takes the acknowledgements
+};
+
+static EmergencySendResult postWebhook(const EmergencyEvent& e, uint8_t attempt, void* context) {
+    const Endpoint& to = *static_cast<Endpoint*>(context);
+    char request[512];
+    size_t length = formatWebhookRequest(e, attempt, to.host, "/fall", request, sizeof(request));
+    addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* addr = NULL;
+    if (getaddrinfo(to.host, to.port, &hints, &addr) != 0) return EMERGENCY_SEND_FAILED;
+    int fd = socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol);
+    bool ok = fd >= 0 && connect(fd, addr->ai_addr, addr->ai_addrlen) == 0;
+    freeaddrinfo(addr);
+    timeval timeout = { EMERGENCY_CONNECT_TIMEOUT_MS / 1000, (EMERGENCY_CONNECT_TIMEOUT_MS % 1000) * 1000 };
+    if (ok) setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    ok = ok && send(fd, request, length, 0) == (ssize_t)length;
+
+    char line[48];
+    size_t n = 0;
+    while (ok && n < sizeof(line) - 1) {
+        char c;
+        if (recv(fd, &c, 1, 0) != 1 || c == '\n') break;
+        line[n++] = c;
+    }
+    line[n] = '\0';
+    if (fd >= 0) close(fd);
+    int status = parseHttpStatus(line);
+    return ok && status >= 200 && status < 300 ? EMERGENCY_SEND_DELIVERED : EMERGENCY_SEND_FAILED;
+}
+
+static EmergencySendResult sendPacket(const EmergencyEvent& e, uint8_t attempt, void* context) {
+    const Endpoint& to = *static_cast<Endpoint*>(context);
+    uint8_t packet[EMERGENCY_PACKET_SIZE];
+    encodeEmergencyPacket(e, attempt, packet);
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(to.udpPort);
+    inet_pton(AF_INET, to.host, &addr.sin_addr);
+    bool ok = sendto(to.udpFd, packet, sizeof(packet), 0, (sockaddr*)&addr, sizeof(addr)) == (ssize_t)sizeof(packet);
+    return ok ? EMERGENCY_SEND_AWAITING : EMERGENCY_SEND_FAILED;
+}
+
+// The device path with sockets and a real clock: the task's loop, sleeping
+// until each retry is due or an acknowledgement arrives
+static int runDeliver(Endpoint& to) {
+    EmergencyLane lane;
+    lane.setClock(wallUs);
+    lane.setIdBase(0x5EED0000UL);
+    to.udpFd = socket(AF_INET, SOCK_DGRAM, 0);
+    uint8_t udpSink = lane.addSink("udp", sendPacket, (void*)&to);
+    lane.addSink("webhook", postWebhook, (void*)&to);
+
+    EmergencyEvent e = makeEvent(lane.nextId(), wallUs());
+    CHECK(lane.raise(e));
+    for (;;) {
+        uint32_t wait = lane.service();
+        if (wait == EMERGENCY_IDLE_US) break;
+        pollfd ready = { to.udpFd, POLLIN, 0 };
+        if (poll(&ready, 1, (wait + 999) / 1000) <= 0) continue;
+        uint8_t ack[64];
+        ssize_t length = recv(to.udpFd, ack, sizeof(ack), 0);
+        uint32_t id;
+        uint8_t attempt;
+        if (length > 0 && decodeEmergencyAck(ack, length, id, attempt)) lane.confirm(udpSink, id, attempt, true);
+    }
+    close(to.udpFd);
+
+    std::printf("event %lu\n", (unsigned long)e.id);
+    for (uint8_t i = 0; i < lane.getSinkCount(); i++) {
+        const SinkStats& s = lane.getSinkStats(i);
+        std::printf("%-8s delivered %u retries %u failed %u unconfirmed %u latency %lu us\n", s.name,
+                    s.delivered, s.retries, s.failed, s.unconfirmed, (unsigned long)s.lastLatencyUs);
+    }
+    std::printf("first notification %lu us after the fall\n", (unsigned long)lane.getStats().lastLatencyUs);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc > 4 && std::strcmp(argv[1], "deliver") == 0) {
+        Endpoint to = { argv[2], argv[3], std::atoi(argv[4]), -1 };
+        return runDeliver(to);
+    }
+
+    struct { const char* name; int (*run)(); } cases[] = {
+        { "deliver", testDeliver },
+        { "backoff", testBackoff },
+        { "dedup", testDedup },
+        { "evict", testEvict },
+        { "confirm", testConfirm },
+        { "formats", testFormats },
+    };
+
+    int failures = 0;
+    for (auto& c : cases) {
+        if (argc > 1 && std::strcmp(argv[1], c.name) != 0) continue;
+        int result = c.run();
+        std::printf("%s %s\n", result == 0 ? "PASS" : "FAIL", c.name);
+        failures += result;
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,239 @@
+// Host harness for the shared ESP-NOW packet format. Run with a case name;
+// exits non-zero on failure and prints the reason.
+
+#include "espnow_packet.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+#define CHECK(cond) do { if (!(cond)) { \
+    std::printf("FAIL %s:%d %s\n", __FILE__, __LINE__, #cond); return 1; } } while (0)
+
+static size_t buildDistance(uint8_t* buffer, uint8_t count, uint16_t sequence, uint32_t timestampUs) {
+    DistancePayload* payload = reinterpret_cast<DistancePayload*>(
+        beginPacket(buffer, PACKET_DISTANCE, 7, sequence, timestampUs));
+    payload->rate = 40;
+    payload->count = count;
+    for (uint8_t i = 0; i < count; i++) {
+        payload->readings[i].distance = (uint16_t)(100 + i * 37);
+        payload->readings[i].confidence = (uint8_t)(100 - i * 20);
+    }
+    return sealPacket(buffer, distancePayloadSize(count));
+}
+
+// ================= Cases =================
+
+// The standard check value, and the layout on the wire
+static int testLayout() {
+    const uint8_t check[] = "123456789";
+    CHECK(packetCrc16(0xFFFF, check, 9) == 0x29B1);
+
+    uint8_t buffer[PACKET_MAX_SIZE];
+    size_t length = buildDistance(buffer, 1, 0x0102, 0x03040506);
+    CHECK(length == 11 + 2 + 3);
+    CHECK(buffer[0] == (PACKET_VERSION << 4 | PACKET_DISTANCE));
+    CHECK(buffer[1] == 7);
+    CHECK(buffer[2] == 0x02 && buffer[3] == 0x01);
+    CHECK(buffer[4] == 0x06 && buffer[5] == 0x05 && buffer[6] == 0x04 && buffer[7] == 0x03);
+    CHECK(buffer[8] == 5);
+    uint16_t crc = packetCrc16(packetCrc16(0xFFFF, buffer, 9), buffer + 11, 5);
+    CHECK(buffer[9] == (crc & 0xFF) && buffer[10] == (crc >> 8));
+    CHECK(buffer[11] == 40 && buffer[12] == 1);
+    CHECK(buffer[13] == 100 && buffer[14] == 0 && buffer[15] == 100);
+    return 0;
+}
+
+// Every field survives encoding and parsing, read in place
+static int testRoundTrip() {
+    uint8_t buffer[PACKET_MAX_SIZE];
+    for (uint8_t count = 0; count <= PACKET_READINGS_MAX; count++) {
+        size_t length = buildDistance(buffer, count, 65535, 4000000000UL);
+        PacketView view;
+        CHECK(parsePacket(buffer, length, &view) == PACKET_OK);
+        CHECK(view.payload == buffer + sizeof(PacketHeader));
+        CHECK(packetVersion(view) == PACKET_VERSION && packetType(view) == PACKET_DISTANCE);
+        CHECK(view.header->nodeId == 7);
+        CHECK(view.header->sequence == 65535);
+        CHECK(view.header->timestampUs == 4000000000UL);
+        const DistancePayload* payload = getDistancePayload(view);
+        CHECK(payload != NULL);
+        CHECK(getStatusPayload(view) == NULL);
+        CHECK(payload->rate == 40 && payload->count == count);
+        for (uint8_t i = 0; i < count; i++) {
+            CHECK(payload->readings[i].distance == 100 + i * 37);
+            CHECK(payload->readings[i].confidence == 100 - i * 20);
+        }
+    }
+
+    StatusPayload* status = reinterpret_cast<StatusPayload*>(
+        beginPacket(buffer, PACKET_STATUS, 3, 9, 1234));
+    status->battery = 87;
+    status->temperature = -125;
+    status->humidity = 55;
+    status->light = 1023;
+    status->rssi = -67;
+    status->errorFlags = 0x05;
+    size_t length = sealPacket(buffer, sizeof(StatusPayload));
+    CHECK(length == sizeof(PacketHeader) + 8);
+    PacketView view;
+    CHECK(parsePacket(buffer, length, &view) == PACKET_OK);
+    CHECK(getDistancePayload(view) == NULL);
+    const StatusPayload* parsed = getStatusPayload(view);
+    CHECK(parsed != NULL);
+    CHECK(parsed->battery == 87 && parsed->temperature == -125 && parsed->humidity == 55);
+    CHECK(parsed->light == 1023 && parsed->rssi == -67 && parsed->errorFlags == 0x05);
+    return 0;
+}
+
+// Packets at odd addresses, as a radio buffer may hand them over
+static int testUnaligned() {
+    uint8_t storage[PACKET_MAX_SIZE + 8];
+    for (int offset = 0; offset < 4; offset++) {
+        uint8_t* buffer = storage + offset;
+        size_t length = buildDistance(buffer, 3, 1000 + offset, 77777);
+        PacketView view;
+        CHECK(parsePacket(buffer, length, &view) == PACKET_OK);
+        CHECK(view.header->sequence == 1000 + offset && view.header->timestampUs == 77777);
+        const DistancePayload* payload = getDistancePayload(view);
+        CHECK(payload != NULL && payload->readings[2].distance == 174);
+    }
+    return 0;
+}
+
+// Every single-bit error, truncation, version and payload size is caught
+static int testRejects() {
+    uint8_t buffer[PACKET_MAX_SIZE];
+    size_t length = buildDistance(buffer, 4, 12, 34);
+    PacketView view;
+
+    for (size_t byte = 0; byte < length; byte++) {
+        for (int bit = 0; bit < 8; bit++) {
+            buffer[byte] ^= 1 << bit;
+            PacketError error = parsePacket(buffer, length, &view);
+            CHECK(error != PACKET_OK);
+            buffer[byte] ^= 1 << bit;
+        }
+    }
+    CHECK(parsePacket(buffer, length, &view) == PACKET_OK);
+
+    for (size_t n = 0; n < length; n++) CHECK(parsePacket(buffer, n, &view) == PACKET_TRUNCATED);
+    // Padding after the payload is ignored
+    CHECK(parsePacket(buffer, length + 5, &view) == PACKET_OK);
+
+    uint8_t other[PACKET_MAX_SIZE];
+    memcpy(other, buffer, length);
+    other[0] = (uint8_t)((PACKET_VERSION + 1) << 4 | PACKET_DISTANCE);
+    sealPacket(other, length - sizeof(PacketHeader));
+    CHECK(parsePacket(other, length, &view) == PACKET_BAD_VERSION);
+
+    // A count that disagrees with the length, or more readings than fit
+    DistancePayload* payload = reinterpret_cast<DistancePayload*>(
+        beginPacket(other, PACKET_DISTANCE, 1, 1, 1));
+    payload->count = 3;
+    size_t sealed = sealPacket(other, distancePayloadSize(2));
+    CHECK(parsePacket(other, sealed, &view) == PACKET_OK);
+    CHECK(getDistancePayload(view) == NULL);
+    payload->count = PACKET_READINGS_MAX + 1;
+    sealed = sealPacket(other, distancePayloadSize(PACKET_READINGS_MAX + 1));
+    CHECK(parsePacket(other, sealed, &view) == PACKET_OK);
+    CHECK(getDistancePayload(view) == NULL);
+    sealed = sealPacket(other, 1);
+    CHECK(parsePacket(other, sealed, &view) == PACKET_OK);
+    CHECK(getDistancePayload(view) == NULL);
+
+    CHECK(sealPacket(other, PACKET_MAX_SIZE) == 0);
+    CHECK(std::strcmp(getPacketErrorName(PACKET_BAD_CRC), "bad CRC") == 0);
+    return 0;
+}
+
+static int testSequence() {
+    CHECK(sequenceAfter(1, 0));
+    CHECK(!sequenceAfter(0, 0));
+    CHECK(!sequenceAfter(0, 1));
+    CHECK(sequenceAfter(0, 65535));
+    CHECK(sequenceAfter(10, 65530));
+    CHECK(!sequenceAfter(65530, 10));
+    return 0;
+}
+
+// ================= Benchmark =================
+
+// The struct the sketches sent before: copied whole, nothing checked
+typedef struct {
+    uint8_t rate;
+    uint8_t count;
+    uint16_t distance[PACKET_READINGS_MAX];
+    uint8_t confidence[PACKET_READINGS_MAX];
+} LegacyMessage;
+
+#define BENCH_PACKETS 2000000
+#define BENCH_DISTINCT 64
+
+static volatile uint32_t sink;
+
+static int testBenchmark() {
+    uint8_t buffer[PACKET_MAX_SIZE];
+    typedef std::chrono::steady_clock Clock;
+
+    Clock::time_point start = Clock::now();
+    for (uint32_t i = 0; i < BENCH_PACKETS; i++) {
+        sink = (uint32_t)buildDistance(buffer, 4, (uint16_t)i, i);
+    }
+    double encodeNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / BENCH_PACKETS;
+    // Distinct packets, so nothing can be hoisted out of the loop
+    static uint8_t packets[BENCH_DISTINCT][PACKET_MAX_SIZE];
+    size_t length = 0;
+    for (uint32_t i = 0; i < BENCH_DISTINCT; i++) length = buildDistance(packets[i], 4, (uint16_t)i, i);
+
+    uint32_t checksum = 0, valid = 0;
+    start = Clock::now();
+    for (uint32_t i = 0; i < BENCH_PACKETS; i++) {
+        PacketView view;
+        if (parsePacket(packets[i % BENCH_DISTINCT], length, &view) != PACKET_OK) continue;
+        const DistancePayload* payload = getDistancePayload(view);
+        if (!payload) continue;
+        checksum += payload->readings[0].distance + view.header->sequence;
+        valid++;
+    }
+    double decodeNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / BENCH_PACKETS;
+    sink = checksum;
+    CHECK(valid == BENCH_PACKETS);
+
+    uint8_t legacyBytes[sizeof(LegacyMessage)];
+    memset(legacyBytes, 0, sizeof(legacyBytes));
+    LegacyMessage legacy;
+    checksum = 0;
+    start = Clock::now();
+    for (uint32_t i = 0; i < BENCH_PACKETS; i++) {
+        legacyBytes[0] = (uint8_t)i;
+        memcpy(&legacy, legacyBytes, sizeof(legacy));
+        checksum += legacy.rate + legacy.distance[0];
+    }
+    double legacyNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / BENCH_PACKETS;
+    sink = checksum;
+
+    std::printf("BENCH packet %u bytes (was %u) encode %.1f ns decode %.1f ns copy %.1f ns\n",
+                (unsigned)length, (unsigned)sizeof(LegacyMessage), encodeNs, decodeNs, legacyNs);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    struct { const char* name; int (*run)(); } cases[] = {
+        { "layout", testLayout },
+        { "round_trip", testRoundTrip },
+        { "unaligned", testUnaligned },
+        { "rejects", testRejects },
+        { "sequence", testSequence },
+        { "benchmark", testBenchmark },
+    };
+
+    int failures = 0;
+    for (auto& c : cases) {
+        if (argc > 1 && std::strcmp(argv[1], c.name) != 0) continue;
+        int result = c.run();
+        std::printf("%s %s\n", result == 0 ? "PASS" : "FAIL", c.name);
+        failures += result;
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,240 @@
+// Host harness for FieldVersions. Run with a case name; exits non-zero on
+// failure and prints the reason.
+
+#include "field_versions.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#define CHECK(cond) do { if (!(cond)) { \
+    std::printf("FAIL %s:%d %s\n", __FILE__, __LINE__, #cond); return 1; } } while (0)
+
+// Device state as the sketch keeps it
+static struct {
+    int32_t latitudeE6;
+    int32_t longitudeE6;
+    char fallTime[16];
+    uint32_t falls;
+    bool inactivity;
+    bool gpsFix;
+    uint32_t battery;
+    uint32_t clients;
+    bool still;
+} device;
+
+static void resetDevice() {
+    device.latitudeE6 = 12840600;
+    device.longitudeE6 = 80153400;
+    std::strcpy(device.fallTime, "N/A");
+    device.falls = 0;
+    device.inactivity = false;
+    device.gpsFix = true;
+    device.battery = 85;
+    device.clients = 4;
+    device.still = false;
+}
+
+static void writeField(JsonStream& json, uint8_t field, const void*) {
+    switch (field) {
+        case FIELD_LATITUDE: json.key("latitude"); json.stringValue("12.840600"); break;
+        case FIELD_LONGITUDE: json.key("longitude"); json.stringValue("80.153400"); break;
+        case FIELD_FALL_TIME: json.stringField("fallTime", device.fallTime); break;
+        case FIELD_FALLS: json.unsignedField("falls", device.falls); break;
+        case FIELD_STATUS: json.stringField("status", device.inactivity ? "critical" : "operational"); break;
+        case FIELD_GPS_STATE: json.stringField("gps", device.gpsFix ? "active" : "searching"); break;
+        case FIELD_FALL_DETECTION: json.stringField("fallDetection", device.inactivity ? "alert" : "active"); break;
+        case FIELD_BATTERY: json.unsignedField("batteryLevel", device.battery); break;
+        case FIELD_WIFI_CLIENTS: json.unsignedField("wifiClients", device.clients); break;
+        case FIELD_MOTION: json.stringField("motion", device.still ? "Inactive" : "Active"); break;
+        case FIELD_FALL_STATE: json.stringField("fallState", device.inactivity ? "alert" : "monitoring"); break;
+    }
+}
+
+static void append(const char* data, size_t length, void* context) {
+    static_cast<std::string*>(context)->append(data, length);
+}
+
+static std::string delta(FieldVersions& versions, uint32_t since) {
+    std::string out;
+    JsonStream json(append, &out);
+    versions.writeDelta(json, since, writeField, NULL);
+    json.finish();
+    return out;
+}
+
+// Version field of a response
+static uint32_t versionOf(const std::string& response) {
+    return (uint32_t)std::strtoul(response.c_str() + std::strlen("{\"v\":"), NULL, 10);
+}
+
+static int testDelta() {
+    resetDevice();
+    FieldVersions versions;
+    versions.begin(1000);
+
+    std::string first = delta(versions, 0);
+    CHECK(first.find("\"full\":true") != std::string::npos);
+    CHECK(first.find("\"motion\":\"Active\"") != std::string::npos);
+    uint32_t v = versionOf(first);
+    CHECK(v == versions.getVersion());
+
+    // Nothing changed: an empty delta at the same version
+    CHECK(delta(versions, v) == "{\"v\":" + std::to_string(v) + ",\"full\":false,\"changes\":{}}");
+
+    device.battery = 84;
+    versions.touch(FIELD_BATTERY);
+    device.still = true;
+    versions.touch(FIELD_MOTION);
+    std::string second = delta(versions, v);
+    CHECK(second == "{\"v\":" + std::to_string(v + 2) + ",\"full\":false,\"changes\":"
+                    "{\"batteryLevel\":84,\"motion\":\"Inactive\"}}");
+
+    // A client one change behind gets only the newer one
+    CHECK(delta(versions, v + 1) == "{\"v\":" + std::to_string(v + 2) + ",\"full\":false,\"changes\":"
+                                    "{\"motion\":\"Inactive\"}}");
+
+    DeltaStats stats = versions.getStats();
+    CHECK(stats.requests == 4 && stats.snapshots == 1);
+    CHECK(stats.fieldsSent == FIELD_COUNT + 3);
+    return 0;
+}
+
+// Versions this boot never handed out get everything
+static int testSnapshot() {
+    resetDevice();
+    FieldVersions versions;
+    versions.begin(5000);
+    versions.touch(FIELD_BATTERY);
+    uint32_t v = versions.getVersion();
+
+    CHECK(delta(versions, 0).find("\"full\":true") != std::string::npos);
+    CHECK(delta(versions, 4000).find("\"full\":true") != std::string::npos);       // Before this boot
+    CHECK(delta(versions, 5000).find("\"full\":true") != std::string::npos);       // The base itself
+    CHECK(delta(versions, v + 1).find("\"full\":true") != std::string::npos);      // From the future
+    CHECK(delta(versions, v).find("\"full\":false") != std::string::npos);
+    CHECK(versions.getStats().snapshots == 4);
+    return 0;
+}
+
+// A base just below the wrap still orders versions correctly
+static int testWrap() {
+    resetDevice();
+    FieldVersions versions;
+    versions.begin(UINT32_MAX - 2);
+    uint32_t v = versions.getVersion();
+    for (int i = 0; i < 4; i++) versions.touch(FIELD_FALLS);
+    versions.touch(FIELD_BATTERY);
+    CHECK(versions.getVersion() < v);
+    CHECK(versions.isKnown(v) && versions.isKnown(versions.getVersion()));
+
+    std::string out = delta(versions, versions.getVersion() - 1);
+    CHECK(out.find("\"full\":false") != std::string::npos);
+    CHECK(out.find("batteryLevel") != std::string::npos && out.find("falls") == std::string::npos);
+    CHECK(delta(versions, v).find("falls") != std::string::npos);
+    return 0;
+}
+
+// An hour with 4 dashboards polling every 5 s. Before: /gps, /status and
+// /sensors each poll. After: one /delta. The wearer walks half the time
+// (a new position every second), the battery drops a percent every 4
+// minutes, and the device goes still for a minute every 10.
+static const uint32_t REQUEST_HEADER_BYTES = 350;   // Typical browser GET
+static const uint32_t RESPONSE_HEADER_BYTES = 110;  // WebServer status line and headers
+
+static size_t fullBody(const char* endpoint) {
+    std::string out;
+    JsonStream json(append, &out);
+    json.beginObject();
+    if (std::strcmp(endpoint, "/gps") == 0) {
+        writeField(json, FIELD_LATITUDE, NULL);
+        writeField(json, FIELD_LONGITUDE, NULL);
+        writeField(json, FIELD_FALL_TIME, NULL);
+    } else if (std::strcmp(endpoint, "/status") == 0) {
+        writeField(json, FIELD_STATUS, NULL);
+        json.beginObject("sensors");
+        json.stringField("mpu6050", "active");
+        writeField(json, FIELD_GPS_STATE, NULL);
+        json.stringField("wifi", "active");
+        writeField(json, FIELD_FALL_DETECTION, NULL);
+        json.end();
+        writeField(json, FIELD_BATTERY, NULL);
+        writeField(json, FIELD_WIFI_CLIENTS, NULL);
+    } else {
+        writeField(json, FIELD_MOTION, NULL);
+        writeField(json, FIELD_FALL_STATE, NULL);
+        writeField(json, FIELD_FALLS, NULL);
+        json.stringField("lastFallTime", device.fallTime);
+    }
+    json.end();
+    json.finish();
+    return out.size();
+}
+
+static int testBandwidth() {
+    resetDevice();
+    FieldVersions versions;
+    versions.begin(77);
+
+    const int dashboards = 4;
+    uint32_t seen[dashboards] = { 0, 0, 0, 0 };
+    uint64_t beforeBody = 0, beforeTotal = 0, afterBody = 0, afterTotal = 0;
+
+    for (uint32_t t = 0; t < 3600; t++) {
+        bool walking = (t / 300) % 2 == 0;
+        if (walking) {
+            versions.touch(FIELD_LATITUDE);
+            versions.touch(FIELD_LONGITUDE);
+        }
+        if (t % 240 == 239) {
+            device.battery--;
+            versions.touch(FIELD_BATTERY);
+        }
+        if (t % 600 == 540 || t % 600 == 599) {
+            device.still = !device.still;
+            versions.touch(FIELD_MOTION);
+        }
+        if (t % 5 != 0) continue;
+
+        for (int d = 0; d < dashboards; d++) {
+            const char* endpoints[] = { "/gps", "/status", "/sensors" };
+            for (const char* e : endpoints) {
+                size_t body = fullBody(e);
+                beforeBody += body;
+                beforeTotal += body + REQUEST_HEADER_BYTES + RESPONSE_HEADER_BYTES;
+            }
+            std::string out = delta(versions, seen[d]);
+            seen[d] = versionOf(out);
+            afterBody += out.size();
+            afterTotal += out.size() + REQUEST_HEADER_BYTES + RESPONSE_HEADER_BYTES;
+        }
+    }
+
+    CHECK(versions.getStats().snapshots == dashboards);
+    CHECK(afterBody < beforeBody / 2);
+
+    std::printf("bodies per hour: before %llu bytes, after %llu bytes (%.1f%%)\n",
+                (unsigned long long)beforeBody, (unsigned long long)afterBody, 100.0 * afterBody / beforeBody);
+    std::printf("with HTTP headers: before %llu bytes, after %llu bytes (%.1f%%)\n",
+                (unsigned long long)beforeTotal, (unsigned long long)afterTotal, 100.0 * afterTotal / beforeTotal);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    struct { const char* name; int (*run)(); } cases[] = {
+        { "delta", testDelta },
+        { "snapshot", testSnapshot },
+        { "wrap", testWrap },
+        { "bandwidth", testBandwidth },
+    };
+
+    int failures = 0;
+    for (auto& c : cases) {
+        if (argc > 1 && std::strcmp(argv[1], c.name) != 0) continue;
+        int result = c.run();
+        std::printf("%s %s\n", result == 0 ? "PASS" : "FAIL", c.name);
+        failures += result;
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,326 @@
+// Host harness for JsonStream. Run with a case name; exits non-zero on
+// failure and prints the reason.
+
+#include "json_stream.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+
+#define CHECK(cond) do { if (!(cond)) { \
+    std::printf("FAIL %s:%d %s\n", __FILE__, __LINE__, #cond); return 1; } } while (0)
+
+// Tracks live heap bytes so the benchmark can compare peaks
+static size_t liveBytes = 0;
+static size_t peakBytes = 0;
+static size_t allocations = 0;
+static const size_t HEADER = 16;
+
+void* operator new(size_t size) {
+    char* p = static_cast<char*>(std::malloc(size + HEADER));
+    if (!p) throw std::bad_alloc();
+    std::memcpy(p, &size, sizeof(size));
+    allocations++;
+    liveBytes += size;
+    if (liveBytes > peakBytes) peakBytes = liveBytes;
+    return p + HEADER;
+}
+void operator delete(void* p) noexcept {
+    if (!p) return;
+    char* base = static_cast<char*>(p) - HEADER;
+    size_t size;
+    std::memcpy(&size, base, sizeof(size));
+    liveBytes -= size;
+    std::free(base);
+}
+void operator delete(void* p, size_t) noexcept { operator delete(p); }
+
+static void resetHeap() {
+    peakBytes = liveBytes;
+    allocations = 0;
+}
+
+// Collects the stream's output and the size of each chunk
+struct Capture {
+    std::string text;
+    int chunks;
+    size_t largest;
+};
+
+static void capture(const char* data, size_t length, void* context) {
+    Capture& c = *static_cast<Capture*>(context);
+    c.text.append(data, length);
+    c.chunks++;
+    if (length > c.largest) c.largest = length;
+}
+
+static void discard(const char*, size_t, void* context) {
+    *static_cast<size_t*>(context) += 1;
+}
+
+static int testStructure() {
+    Capture out = {};
+    JsonStream json(capture, &out);
+    json.beginObject();
+    json.unsignedField("a", 1);
+    json.beginArray("list");
+    json.unsignedValue(1);
+    json.beginObject();
+    json.end();
+    json.beginArray();
+    json.end();
+    json.signedValue(-2);
+    json.end();
+    json.beginObject("nested");
+    json.boolField("ok", true);
+    json.stringField("none", NULL);
+    json.end();
+    json.end();
+    CHECK(json.finish() == out.text.size());
+    CHECK(out.text == "{\"a\":1,\"list\":[1,{},[],-2],\"nested\":{\"ok\":true,\"none\":null}}");
+    return 0;
+}
+
+static int testEscaping() {
+    Capture out = {};
+    JsonStream json(capture, &out);
+    json.beginObject();
+    json.stringField("s", "say \"hi\"\\\n\t\x01");
+    json.end();
+    json.finish();
+    CHECK(out.text == "{\"s\":\"say \\\"hi\\\"\\\\\\u000a\\u0009\\u0001\"}");
+    return 0;
+}
+
+static int testNumbers() {
+    Capture out = {};
+    JsonStream json(capture, &out);
+    json.beginArray();
+    json.unsignedValue(4294967295UL);
+    json.signedValue(-2147483647L - 1);
+    json.scaledValue(12840600, 6);
+    json.scaledValue(-801534, 6);
+    json.scaledValue(-5, 2);
+    json.fixedValue(3.14159f, 2);
+    json.fixedValue(-0.05f, 1);
+    json.fixedValue(99.95f, 0);
+    json.fixedValue(NAN, 1);
+    json.fixedValue(1e30f, 2);
+    json.end();
+    json.finish();
+    CHECK(out.text == "[4294967295,-2147483648,12.840600,-0.801534,-0.05,3.14,-0.1,100,null,null]");
+    return 0;
+}
+
+struct Record {
+    uint8_t u8;
+    int8_t i8;
+    uint16_t u16;
+    int16_t i16;
+    uint32_t u32;
+    int32_t i32E6;
+    bool flag;
+    float ratio;
+    const char* name;
+    char code[8];
+};
+
+constexpr JsonField RECORD_FIELDS[] = {
+    JSON_FIELD(Record, u8, "u8"),
+    JSON_FIELD(Record, i8, "i8"),
+    JSON_FIELD(Record, u16, "u16"),
+    JSON_FIELD(Record, i16, "i16"),
+    JSON_FIELD(Record, u32, "u32"),
+    JSON_FIXED(Record, i32E6, "lat", 6, JSON_FLAG_QUOTED),
+    JSON_FIELD(Record, flag, "flag"),
+    JSON_FIXED(Record, ratio, "ratio", 1, 0),
+    JSON_FIELD(Record, name, "name"),
+    JSON_FIELD(Record, code, "code"),
+};
+
+static int testSchema() {
+    static_assert(RECORD_FIELDS[5].offset == offsetof(Record, i32E6), "offset");
+    static_assert(RECORD_FIELDS[9].type == JSON_TYPE_CHARS, "char array type");
+
+    Record r = { 200, -7, 65535, -300, 123456, -12840600, true, 2.25f, "tx", "A1" };
+    Capture out = {};
+    JsonStream json(capture, &out);
+    json.beginObject();
+    json.unsignedField("first", 0);
+    json.fields(RECORD_FIELDS, JSON_SCHEMA_SIZE(RECORD_FIELDS), &r);
+    json.beginArray("after");
+    json.end();
+    json.end();
+    json.finish();
+    CHECK(out.text == "{\"first\":0,\"u8\":200,\"i8\":-7,\"u16\":65535,\"i16\":-300,\"u32\":123456,"
+                      "\"lat\":\"-12.840600\",\"flag\":true,\"ratio\":2.3,\"name\":\"tx\","
+                      "\"code\":\"A1\",\"after\":[]}");
+    return 0;
+}
+
+// Output larger than the buffer arrives in full chunks, byte for byte
+static int testChunks() {
+    Capture out = {};
+    std::string expected = "[";
+    JsonStream json(capture, &out);
+    json.beginArray();
+    for (uint32_t i = 0; i < 1000; i++) {
+        json.stringValue("abcdefghij");
+        json.unsignedValue(i);
+        if (i) expected += ",";
+        expected += "\"abcdefghij\"," + std::to_string(i);
+    }
+    json.end();
+    expected += "]";
+    uint32_t total = json.finish();
+
+    CHECK(total == expected.size());
+    CHECK(out.text == expected);
+    CHECK(out.largest == JSON_CHUNK_SIZE);
+    CHECK(out.chunks == (int)((expected.size() + JSON_CHUNK_SIZE - 1) / JSON_CHUNK_SIZE));
+    CHECK(json.getChunks() == out.chunks);
+
+    // Writing allocates nothing
+    size_t sinkCalls = 0;
+    resetHeap();
+    JsonStream quiet(discard, &sinkCalls);
+    quiet.beginArray();
+    for (uint32_t i = 0; i < 1000; i++) quiet.scaledValue(i, 3);
+    quiet.end();
+    quiet.finish();
+    CHECK(allocations == 0);
+    CHECK(sinkCalls > 1);
+    return 0;
+}
+
+// A /metrics-sized response, as String concatenation built it and as
+// streamed; String grows the way std::string does, by reallocating
+struct Stage {
+    uint32_t deadlineUs;
+    uint32_t lastUs;
+    uint32_t maxUs;
+    uint32_t runs;
+    uint32_t overruns;
+};
+
+constexpr JsonField STAGE_FIELDS[] = {
+    JSON_FIELD(Stage, deadlineUs, "deadlineUs"),
+    JSON_FIELD(Stage, lastUs, "lastUs"),
+    JSON_FIELD(Stage, maxUs, "maxUs"),
+    JSON_FIELD(Stage, runs, "runs"),
+    JSON_FIELD(Stage, overruns, "overruns"),
+};
+
+static const char* STAGE_NAMES[] = { "imu", "gps", "fall", "buzzer", "web", "wifi", "power", "timers" };
+static const int REPEAT = 8;
+
+static std::string buildConcatenated(const Stage* stages) {
+    std::string json = "{";
+    json += "\"uptimeMs\":" + std::to_string(123456789) + ",";
+    json += "\"busyPct\":" + std::to_string(1.25f).substr(0, 4) + ",";
+    for (int r = 0; r < REPEAT; r++) {
+        json += "\"stages" + std::to_string(r) + "\":{";
+        for (int i = 0; i < 8; i++) {
+            if (i) json += ",";
+            json += "\"" + std::string(STAGE_NAMES[i]) + "\":{";
+            json += "\"deadlineUs\":" + std::to_string(stages[i].deadlineUs) + ",";
+            json += "\"lastUs\":" + std::to_string(stages[i].lastUs) + ",";
+            json += "\"maxUs\":" + std::to_string(stages[i].maxUs) + ",";
+            json += "\"runs\":" + std::to_string(stages[i].runs) + ",";
+            json += "\"overruns\":" + std::to_string(stages[i].overruns) + "}";
+        }
+        json += "},";
+    }
+    json += "\"end\":true}";
+    return json;
+}
+
+static void buildStreamed(JsonStream& json, const Stage* stages) {
+    json.beginObject();
+    json.unsignedField("uptimeMs", 123456789);
+    json.fixedField("busyPct", 1.25f, 2);
+    for (int r = 0; r < REPEAT; r++) {
+        char key[16];
+        std::snprintf(key, sizeof(key), "stages%d", r);
+        json.beginObject(key);
+        for (int i = 0; i < 8; i++) {
+            json.beginObject(STAGE_NAMES[i]);
+            json.fields(STAGE_FIELDS, JSON_SCHEMA_SIZE(STAGE_FIELDS), &stages[i]);
+            json.end();
+        }
+        json.end();
+    }
+    json.boolField("end", true);
+    json.end();
+}
+
+static int testBenchmark() {
+    using namespace std::chrono;
+    Stage stages[8];
+    for (uint32_t i = 0; i < 8; i++) stages[i] = { 1000 * (i + 1), 37 * i + 5, 911 * i + 40, 1000000 + i, i % 3 };
+
+    // Same document either way
+    Capture out = {};
+    JsonStream check(capture, &out);
+    buildStreamed(check, stages);
+    check.finish();
+    std::string concatenated = buildConcatenated(stages);
+    CHECK(out.text == concatenated);
+
+    resetHeap();
+    size_t base = liveBytes;
+    { std::string json = buildConcatenated(stages); }
+    size_t concatPeak = peakBytes - base;
+    size_t concatAllocations = allocations;
+
+    resetHeap();
+    size_t sinkCalls = 0;
+    { JsonStream json(discard, &sinkCalls); buildStreamed(json, stages); json.finish(); }
+    size_t streamPeak = peakBytes - base;
+    CHECK(allocations == 0);
+
+    const int rounds = 20000;
+    volatile size_t sink = 0;
+    auto start = steady_clock::now();
+    for (int n = 0; n < rounds; n++) sink = sink + buildConcatenated(stages).size();
+    double concatUs = duration<double, std::micro>(steady_clock::now() - start).count() / rounds;
+
+    start = steady_clock::now();
+    for (int n = 0; n < rounds; n++) {
+        JsonStream json(discard, &sinkCalls);
+        buildStreamed(json, stages);
+        sink = sink + json.finish();
+    }
+    double streamUs = duration<double, std::micro>(steady_clock::now() - start).count() / rounds;
+
+    std::printf("response %zu bytes\n", concatenated.size());
+    std::printf("concatenated: %.2f us, peak heap %zu bytes, %zu allocations\n",
+                concatUs, concatPeak, concatAllocations);
+    std::printf("streamed:     %.2f us, peak heap %zu bytes, %d byte buffer on the stack\n",
+                streamUs, streamPeak, JSON_CHUNK_SIZE);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    struct { const char* name; int (*run)(); } cases[] = {
+        { "structure", testStructure },
+        { "escaping", testEscaping },
+        { "numbers", testNumbers },
+        { "schema", testSchema },
+        { "chunks", testChunks },
+        { "benchmark", testBenchmark },
+    };
+
+    int failures = 0;
+    for (auto& c : cases) {
+        if (argc > 1 && std::strcmp(argv[1], c.name) != 0) continue;
+        int result = c.run();
+        std::printf("%s %s\n", result == 0 ? "PASS" : "FAIL", c.name);
+        failures += result;
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,154 @@
+// Host harness for NodeTracker. Run with a case name; exits non-zero on
+// failure and prints the reason.
+
+#include "node_tracker.h"
+
+#include <cstdio>
+#include <cstring>
+
+#define CHECK(cond) do { if (!(cond)) { \
+    std::printf("FAIL %s:%d %s\n", __FILE__, __LINE__, #cond); return 1; } } while (0)
+
+// Transmitters send a scan about every 25 ms
+#define SEND_US 25000
+
+static PacketHeader makeHeader(uint8_t nodeId, uint16_t sequence, uint32_t timestampUs) {
+    PacketHeader header;
+    memset(&header, 0, sizeof(header));
+    header.nodeId = nodeId;
+    header.sequence = sequence;
+    header.timestampUs = timestampUs;
+    return header;
+}
+
+// ================= Cases =================
+
+static int testInOrder() {
+    NodeTracker tracker;
+    CHECK(tracker.getNode(1) == NULL);
+    CHECK(tracker.accept(makeHeader(1, 10, 1000), 0) == NODE_ACCEPTED);
+    CHECK(tracker.accept(makeHeader(1, 11, 2000), 25) == NODE_ACCEPTED);
+    // Three missed on air
+    CHECK(tracker.accept(makeHeader(1, 15, 6000), 125) == NODE_ACCEPTED);
+    const NodeState* node = tracker.getNode(1);
+    CHECK(node != NULL && node->lost == 3 && node->restarts == 0 && node->lastSequence == 15);
+    return 0;
+}
+
+// Repeats and late arrivals inside the window are dropped, not counted
+static int testStale() {
+    NodeTracker tracker;
+    CHECK(tracker.accept(makeHeader(1, 100, 100 * SEND_US), 0) == NODE_ACCEPTED);
+    CHECK(tracker.accept(makeHeader(1, 100, 100 * SEND_US), 1) == NODE_STALE);
+    CHECK(tracker.accept(makeHeader(1, 102, 102 * SEND_US), 2) == NODE_ACCEPTED);
+    CHECK(tracker.accept(makeHeader(1, 101, 101 * SEND_US), 3) == NODE_STALE);
+    CHECK(tracker.accept(makeHeader(1, 102 - RESTART_SEQUENCE_GAP, 90 * SEND_US), 4) == NODE_STALE);
+    const NodeState* node = tracker.getNode(1);
+    CHECK(node->lost == 1 && node->restarts == 0 && node->lastSequence == 102);
+    return 0;
+}
+
+// A transmitter that reboots after a long run starts again from 0. It
+// used to be dropped as stale for the next 32767 packets.
+static int testReboot() {
+    NodeTracker tracker;
+    uint32_t nowMs = 0;
+    for (uint16_t seq = 29990; seq <= 30000; seq++, nowMs += 25) {
+        CHECK(tracker.accept(makeHeader(1, seq, 750000000UL + seq * SEND_US), nowMs) == NODE_ACCEPTED);
+    }
+    // Back after a 300 ms boot
+    nowMs += 300;
+    CHECK(tracker.accept(makeHeader(1, 0, 300000), nowMs) == NODE_RESTARTED);
+    for (uint16_t seq = 1; seq < 50; seq++) {
+        nowMs += 25;
+        CHECK(tracker.accept(makeHeader(1, seq, 300000 + seq * SEND_US), nowMs) == NODE_ACCEPTED);
+    }
+    const NodeState* node = tracker.getNode(1);
+    CHECK(node->restarts == 1 && node->lost == 0 && node->lastSequence == 49);
+    return 0;
+}
+
+// A reboot soon after the last one leaves the sequence close behind;
+// the timestamp still gives it away
+static int testRebootByTime() {
+    NodeTracker tracker;
+    uint32_t ts = 0;
+    for (uint16_t seq = 0; seq < 100; seq++) {
+        ts = 200000 + seq * SEND_US;
+        CHECK(tracker.accept(makeHeader(2, seq, ts), seq * 25) == NODE_ACCEPTED);
+    }
+    CHECK(tracker.accept(makeHeader(2, 0, 200000), 3000) == NODE_RESTARTED);
+    CHECK(tracker.accept(makeHeader(2, 1, 200000 + SEND_US), 3025) == NODE_ACCEPTED);
+    CHECK(tracker.getNode(2)->restarts == 1);
+    return 0;
+}
+
+// The sequence and micros() both roll over without a restart
+static int testWrap() {
+    NodeTracker tracker;
+    uint32_t ts = 0xFFFFFFFFUL - 2 * SEND_US;
+    CHECK(tracker.accept(makeHeader(3, 65534, ts), 0) == NODE_ACCEPTED);
+    CHECK(tracker.accept(makeHeader(3, 65535, ts + SEND_US), 25) == NODE_ACCEPTED);
+    CHECK(tracker.accept(makeHeader(3, 0, ts + 2 * SEND_US), 50) == NODE_ACCEPTED);
+    CHECK(tracker.accept(makeHeader(3, 2, ts + 4 * SEND_US), 100) == NODE_ACCEPTED);
+    CHECK(tracker.accept(makeHeader(3, 65535, ts + SEND_US), 101) == NODE_STALE);
+    const NodeState* node = tracker.getNode(3);
+    CHECK(node->restarts == 0 && node->lost == 1 && node->lastSequence == 2);
+    return 0;
+}
+
+// Two transmitters interleaved keep their own sequences. A single
+// last-node check used to skip both the stale check and the loss count.
+static int testTwoNodes() {
+    NodeTracker tracker;
+    for (uint16_t i = 0; i < 20; i++) {
+        CHECK(tracker.accept(makeHeader(1, 500 + i, i * SEND_US), i * 25) == NODE_ACCEPTED);
+        if (i % 2 == 0) {
+            CHECK(tracker.accept(makeHeader(2, 7000 + i, 9000000 + i * SEND_US), i * 25 + 1) == NODE_ACCEPTED);
+        }
+        // A repeat of node 1 between node 2's packets is still caught
+        CHECK(tracker.accept(makeHeader(1, 500 + i, i * SEND_US), i * 25 + 2) == NODE_STALE);
+    }
+    CHECK(tracker.getNode(1)->lost == 0);
+    CHECK(tracker.getNode(2)->lost == 9);
+    return 0;
+}
+
+// Past NODE_TRACK_MAX the node heard from longest ago makes room
+static int testEviction() {
+    NodeTracker tracker;
+    for (uint8_t id = 0; id < NODE_TRACK_MAX; id++) {
+        CHECK(tracker.accept(makeHeader(id, 10, 1000), id * 10) == NODE_ACCEPTED);
+    }
+    // Node 0 is heard again, so node 1 is now the oldest
+    CHECK(tracker.accept(makeHeader(0, 11, 2000), 100) == NODE_ACCEPTED);
+    CHECK(tracker.accept(makeHeader(NODE_TRACK_MAX, 10, 1000), 110) == NODE_ACCEPTED);
+    CHECK(tracker.getNode(1) == NULL);
+    CHECK(tracker.getNode(0) != NULL && tracker.getNode(0)->lastSequence == 11);
+    CHECK(tracker.getNode(NODE_TRACK_MAX) != NULL);
+    // An evicted node starts fresh rather than being judged stale
+    CHECK(tracker.accept(makeHeader(1, 5, 500), 120) == NODE_ACCEPTED);
+    CHECK(tracker.getNode(1)->lost == 0);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    struct { const char* name; int (*run)(); } cases[] = {
+        { "in_order", testInOrder },
+        { "stale", testStale },
+        { "reboot", testReboot },
+        { "reboot_by_time", testRebootByTime },
+        { "wrap", testWrap },
+        { "two_nodes", testTwoNodes },
+        { "eviction", testEviction },
+    };
+
+    int failures = 0;
+    for (auto& c : cases) {
+        if (argc > 1 && std::strcmp(argv[1], c.name) != 0) continue;
+        int result = c.run();
+        std::printf("%s %s\n", result == 0 ? "PASS" : "FAIL", c.name);
+        failures += result;
+    }
+    return failures == 0 ? 0 : 1;
+}
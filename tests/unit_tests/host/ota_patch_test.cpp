@@ -0,0 +1,307 @@
+// Host harness for the OTA patch applier. Run with a case name; exits
+// non-zero on failure and prints the reason. "apply <old> <patch> <out>"
+// runs a patch from tools/ota_patch the way the device does: inflated
+// with zlib (tinfl in ROM on the device) in upload-sized pieces.
+// "sign <secret> <hex> <file>" checks the host tool's signature of a file.
+
+#include "ota_patch.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+#define CHECK(cond) do { if (!(cond)) { \
+    std::printf("FAIL %s:%d %s\n", __FILE__, __LINE__, #cond); return 1; } } while (0)
+
+#define UPLOAD_CHUNK 1436           // HTTPUpload buffer of the ESP32 WebServer
+
+typedef std::vector<uint8_t> Bytes;
+
+struct Images {
+    const Bytes* source;
+    Bytes target;
+    bool failWrite;
+};
+
+static bool readSource(uint32_t offset, uint8_t* out, size_t length, void* context) {
+    const Images* images = static_cast<const Images*>(context);
+    if (offset + length > images->source->size()) return false;
+    std::memcpy(out, images->source->data() + offset, length);
+    return true;
+}
+
+static bool writeTarget(const uint8_t* data, size_t length, void* context) {
+    Images* images = static_cast<Images*>(context);
+    if (images->failWrite) return false;
+    images->target.insert(images->target.end(), data, data + length);
+    return true;
+}
+
+static PatchHeader makeHeader(const Bytes& source, const Bytes& target) {
+    PatchHeader h;
+    h.magic = PATCH_MAGIC;
+    h.version = PATCH_VERSION;
+    h.flags = 0;
+    h.reserved = 0;
+    h.sourceSize = source.size();
+    h.sourceCrc = patchCrc32(0, source.data(), source.size());
+    h.targetSize = target.size();
+    h.targetCrc = patchCrc32(0, target.data(), target.size());
+    return h;
+}
+
+// Applies ops handed over piece bytes at a time
+static PatchResult run(const PatchHeader& h, const Bytes& source, const Bytes& ops, size_t piece, Images& images) {
+    PatchApplier applier;
+    images.source = &source;
+    images.target.clear();
+    applier.begin(h, readSource, writeTarget, &images);
+    for (size_t i = 0; i < ops.size(); i += piece) {
+        size_t n = ops.size() - i < piece ? ops.size() - i : piece;
+        PatchResult result = applier.feed(ops.data() + i, n);
+        if (result != PATCH_OK) return result;
+    }
+    return applier.finish();
+}
+
+static int testCrc() {
+    const uint8_t check[] = "123456789";
+    CHECK(patchCrc32(0, check, 9) == 0xCBF43926UL);
+    CHECK(patchCrc32(patchCrc32(0, check, 4), check + 4, 5) == 0xCBF43926UL);
+    CHECK(patchCrc32(0, check, 0) == 0);
+    return 0;
+}
+
+static int testHeader() {
+    // "DGP1", v1, sizes 0x100 and 0x200, CRCs 0x11223344 and 0x55667788
+    const uint8_t raw[PATCH_HEADER_SIZE] = {
+        'D', 'G', 'P', '1', 1, 0, 0, 0,
+        0x00, 0x01, 0, 0, 0x44, 0x33, 0x22, 0x11,
+        0x00, 0x02, 0, 0, 0x88, 0x77, 0x66, 0x55
+    };
+    PatchHeader h;
+    CHECK(parsePatchHeader(raw, sizeof(raw), h));
+    CHECK(h.sourceSize == 0x100 && h.sourceCrc == 0x11223344UL);
+    CHECK(h.targetSize == 0x200 && h.targetCrc == 0x55667788UL);
+    CHECK(!parsePatchHeader(raw, sizeof(raw) - 1, h));
+
+    uint8_t bad[PATCH_HEADER_SIZE];
+    std::memcpy(bad, raw, sizeof(bad));
+    bad[0] = 0xE9;                  // A full image, not a patch
+    CHECK(!parsePatchHeader(bad, sizeof(bad), h));
+    std::memcpy(bad, raw, sizeof(bad));
+    bad[4] = 2;
+    CHECK(!parsePatchHeader(bad, sizeof(bad), h));
+    return 0;
+}
+
+static int testOps() {
+    Bytes source;
+    for (int i = 0; i < 1000; i++) source.push_back((uint8_t)(i * 7));
+
+    // target = source[100..400) + "abc" + source[50..80) + source[80..600)
+    Bytes target(source.begin() + 100, source.begin() + 400);
+    target.push_back('a');
+    target.push_back('b');
+    target.push_back('c');
+    target.insert(target.end(), source.begin() + 50, source.begin() + 600);
+
+    const uint8_t ops[] = {
+        PATCH_OP_COPY, 0xAC, 0x02, 0xC8, 0x01,      // 300 from cursor 0 + 100
+        PATCH_OP_INSERT, 3, 'a', 'b', 'c',
+        PATCH_OP_COPY, 30, 0xBB, 0x05,              // 30 from cursor 400 - 350
+        PATCH_OP_COPY, 0x88, 0x04, 0,               // 520 continuing at 80
+        PATCH_OP_END
+    };
+    Bytes stream(ops, ops + sizeof(ops));
+    PatchHeader h = makeHeader(source, target);
+
+    // Any split of the stream gives the same image
+    for (size_t piece : { (size_t)1, (size_t)3, (size_t)7, sizeof(ops) }) {
+        Images images = { NULL, Bytes(), false };
+        CHECK(run(h, source, stream, piece, images) == PATCH_DONE);
+        CHECK(images.target == target);
+    }
+    return 0;
+}
+
+static int testErrors() {
+    Bytes source(256, 0x5A);
+    Bytes target(64, 0x5A);
+    PatchHeader h = makeHeader(source, target);
+    Images images = { NULL, Bytes(), false };
+
+    const uint8_t good[] = { PATCH_OP_COPY, 64, 0, PATCH_OP_END };
+    CHECK(run(h, source, Bytes(good, good + sizeof(good)), 64, images) == PATCH_DONE);
+
+    const uint8_t outside[] = { PATCH_OP_COPY, 64, 0xC0, 0x03, PATCH_OP_END };   // From 224
+    CHECK(run(h, source, Bytes(outside, outside + sizeof(outside)), 64, images) == PATCH_SOURCE_RANGE);
+
+    const uint8_t before[] = { PATCH_OP_COPY, 8, 0x01, PATCH_OP_END };            // From -1
+    CHECK(run(h, source, Bytes(before, before + sizeof(before)), 64, images) == PATCH_SOURCE_RANGE);
+
+    const uint8_t badOp[] = { 0x07 };
+    CHECK(run(h, source, Bytes(badOp, badOp + 1), 64, images) == PATCH_BAD_OP);
+
+    const uint8_t trailing[] = { PATCH_OP_COPY, 64, 0, PATCH_OP_END, PATCH_OP_END };
+    CHECK(run(h, source, Bytes(trailing, trailing + sizeof(trailing)), 64, images) == PATCH_BAD_OP);
+
+    const uint8_t noEnd[] = { PATCH_OP_COPY, 64, 0 };
+    CHECK(run(h, source, Bytes(noEnd, noEnd + sizeof(noEnd)), 64, images) == PATCH_TRUNCATED);
+
+    const uint8_t tooLong[] = { PATCH_OP_COPY, 65, 0, PATCH_OP_END };
+    CHECK(run(h, source, Bytes(tooLong, tooLong + sizeof(tooLong)), 64, images) == PATCH_TARGET_OVERFLOW);
+
+    const uint8_t other[] = { PATCH_OP_INSERT, 64 };
+    Bytes wrong(other, other + sizeof(other));
+    wrong.insert(wrong.end(), 64, 0x5B);
+    wrong.push_back(PATCH_OP_END);
+    CHECK(run(h, source, wrong, 64, images) == PATCH_CRC_MISMATCH);
+
+    images.failWrite = true;
+    CHECK(run(h, source, Bytes(good, good + sizeof(good)), 64, images) == PATCH_WRITE_FAILED);
+    return 0;
+}
+
+static bool readFile(const char* path, Bytes& out) {
+    FILE* f = std::fopen(path, "rb");
+    if (!f) return false;
+    uint8_t buffer[65536];
+    size_t n;
+    while ((n = std::fread(buffer, 1, sizeof(buffer), f)) > 0) out.insert(out.end(), buffer, buffer + n);
+    std::fclose(f);
+    return true;
+}
+
+static bool verifyPieces(const char* secret, const char* hex, const Bytes& data, size_t piece) {
+    OtaSignature signature;
+    if (!signature.begin(secret, hex)) return false;
+    for (size_t i = 0; i < data.size(); i += piece) {
+        signature.update(data.data() + i, data.size() - i < piece ? data.size() - i : piece);
+    }
+    return signature.verify();
+}
+
+// RFC 4231 vectors; the hash must not depend on how the upload is split
+static int testSignature() {
+    const char* data = "what do ya want for nothing?";
+    Bytes message(data, data + std::strlen(data));
+    const char* jefe = "5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843";
+    CHECK(verifyPieces("Jefe", jefe, message, 1));
+    CHECK(verifyPieces("Jefe", jefe, message, 7));
+    CHECK(verifyPieces("Jefe", jefe, message, UPLOAD_CHUNK));
+    CHECK(verifyPieces("Jefe", "5BDCC146BF60754E6A042426089575C75A003F089D2739839DEC58B964EC3843", message, 64));
+
+    // A key longer than a block is hashed first
+    std::string longKey(131, '\xaa');
+    data = "Test Using Larger Than Block-Size Key - Hash Key First";
+    Bytes large(data, data + std::strlen(data));
+    CHECK(verifyPieces(longKey.c_str(), "60e431591ee0b67f0d8a26aacbf5b77f8e0bc6213728c5140546040f0ee37f54",
+                       large, 5));
+
+    // Wrong key, changed data, no secret, malformed signatures
+    CHECK(!verifyPieces("jefe", jefe, message, 64));
+    message[0] ^= 1;
+    CHECK(!verifyPieces("Jefe", jefe, message, 64));
+    OtaSignature signature;
+    CHECK(!signature.begin("", jefe));
+    CHECK(!signature.begin("Jefe", NULL));
+    CHECK(!signature.begin("Jefe", ""));
+    CHECK(!signature.begin("Jefe", "5bdcc146"));
+    CHECK(!signature.begin("Jefe", "zbdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843"));
+    // verify() without a successful begin() never passes
+    CHECK(!signature.verify());
+    return 0;
+}
+
+static int signFile(const char* secret, const char* hex, const char* path) {
+    Bytes data;
+    CHECK(readFile(path, data));
+    CHECK(verifyPieces(secret, hex, data, UPLOAD_CHUNK));
+    // One flipped bit anywhere is caught
+    data[data.size() / 2] ^= 0x10;
+    CHECK(!verifyPieces(secret, hex, data, UPLOAD_CHUNK));
+    std::printf("PASS sign %zu bytes\n", data.size());
+    return 0;
+}
+
+// Upload pieces go through inflate into a 32 KB window, as on the device
+static int applyFile(const char* oldPath, const char* patchPath, const char* outPath) {
+    Bytes source, patch;
+    CHECK(readFile(oldPath, source));
+    CHECK(readFile(patchPath, patch));
+
+    auto start = std::chrono::steady_clock::now();
+    PatchHeader h;
+    CHECK(parsePatchHeader(patch.data(), patch.size(), h));
+    CHECK(h.sourceSize == source.size());
+    CHECK(patchCrc32(0, source.data(), source.size()) == h.sourceCrc);
+
+    Images images = { &source, Bytes(), false };
+    PatchApplier applier;
+    applier.begin(h, readSource, writeTarget, &images);
+
+    z_stream z;
+    std::memset(&z, 0, sizeof(z));
+    CHECK(inflateInit(&z) == Z_OK);
+    uint8_t window[32768];
+    int status = Z_OK;
+    for (size_t i = PATCH_HEADER_SIZE; i < patch.size() && status != Z_STREAM_END; i += UPLOAD_CHUNK) {
+        z.next_in = patch.data() + i;
+        z.avail_in = patch.size() - i < UPLOAD_CHUNK ? patch.size() - i : UPLOAD_CHUNK;
+        while (z.avail_in > 0 && status != Z_STREAM_END) {
+            z.next_out = window;
+            z.avail_out = sizeof(window);
+            status = inflate(&z, Z_NO_FLUSH);
+            CHECK(status == Z_OK || status == Z_STREAM_END || status == Z_BUF_ERROR);
+            PatchResult result = applier.feed(window, sizeof(window) - z.avail_out);
+            if (result != PATCH_OK) {
+                std::printf("FAIL apply: %s\n", getPatchResultName(result));
+                return 1;
+            }
+        }
+    }
+    inflateEnd(&z);
+    CHECK(status == Z_STREAM_END);
+    PatchResult result = applier.finish();
+    if (result != PATCH_DONE) {
+        std::printf("FAIL finish: %s\n", getPatchResultName(result));
+        return 1;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    FILE* f = std::fopen(outPath, "wb");
+    CHECK(f);
+    std::fwrite(images.target.data(), 1, images.target.size(), f);
+    std::fclose(f);
+
+    std::printf("applied %zu byte patch -> %zu byte image in %.2f ms (%.1f MB/s)\n",
+                patch.size(), images.target.size(), seconds * 1000,
+                images.target.size() / seconds / 1e6);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc == 5 && std::strcmp(argv[1], "apply") == 0) return applyFile(argv[2], argv[3], argv[4]);
+    if (argc == 5 && std::strcmp(argv[1], "sign") == 0) return signFile(argv[2], argv[3], argv[4]);
+
+    struct { const char* name; int (*run)(); } cases[] = {
+        { "crc", testCrc },
+        { "header", testHeader },
+        { "ops", testOps },
+        { "errors", testErrors },
+        { "signature", testSignature },
+    };
+
+    int failures = 0;
+    for (auto& c : cases) {
+        if (argc > 1 && std::strcmp(argv[1], c.name) != 0) continue;
+        int result = c.run();
+        std::printf("%s %s\n", result == 0 ? "PASS" : "FAIL", c.name);
+        failures += result;
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,351 @@
+// Host harness for the receiver's PacketRing. Run with a case name;
+// exits non-zero on failure and prints the reason.
+
+#include "packet_ring.h"
+#include <haptic_level.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <thread>
+#include <vector>
+
+#define CHECK(cond) do { if (!(cond)) { \
+    std::printf("FAIL %s:%d %s\n", __FILE__, __LINE__, #cond); return 1; } } while (0)
+
+static size_t buildDistance(uint8_t* buffer, uint8_t nodeId, uint16_t sequence, uint16_t cm) {
+    DistancePayload* payload = reinterpret_cast<DistancePayload*>(
+        beginPacket(buffer, PACKET_DISTANCE, nodeId, sequence, sequence * 25000UL));
+    payload->rate = 40;
+    payload->count = 1;
+    payload->readings[0].distance = cm;
+    payload->readings[0].confidence = 100;
+    return sealPacket(buffer, distancePayloadSize(1));
+}
+
+// ================= Cases =================
+
+// Packets come out whole and in order
+static int testOrder() {
+    PacketRing ring;
+    uint8_t buffer[PACKET_MAX_SIZE];
+    CHECK(ring.front() == NULL);
+    for (uint16_t i = 0; i < 5; i++) {
+        size_t length = buildDistance(buffer, 1, i, 100 + i);
+        CHECK(ring.push(buffer, length, i * 10));
+    }
+    CHECK(ring.size() == 5);
+    for (uint16_t i = 0; i < 5; i++) {
+        const RingPacket* entry = ring.front();
+        CHECK(entry != NULL);
+        CHECK(entry->receivedUs == i * 10u);
+        PacketView view;
+        CHECK(parsePacket(entry->data, entry->length, &view) == PACKET_OK);
+        CHECK(view.header->sequence == i);
+        CHECK(getDistancePayload(view)->readings[0].distance == 100 + i);
+        ring.pop();
+    }
+    CHECK(ring.front() == NULL);
+    CHECK(ring.getHighWater() == 5);
+    // Popping an empty ring does nothing
+    ring.pop();
+    CHECK(ring.size() == 0);
+    return 0;
+}
+
+// A full ring drops and counts the newest packet, and keeps the rest
+static int testFull() {
+    PacketRing ring;
+    uint8_t buffer[PACKET_MAX_SIZE];
+    for (uint16_t i = 0; i < PACKET_RING_SIZE + 3; i++) {
+        size_t length = buildDistance(buffer, 1, i, 50);
+        CHECK(ring.push(buffer, length, i) == (i < PACKET_RING_SIZE));
+    }
+    CHECK(ring.size() == PACKET_RING_SIZE);
+    CHECK(ring.getDropped() == 3);
+    CHECK(ring.front()->receivedUs == 0);
+    ring.pop();
+    CHECK(ring.push(buffer, 16, 99));
+    // Too long for a slot: refused, not a drop
+    CHECK(!ring.push(buffer, PACKET_MAX_SIZE + 1, 100));
+    CHECK(ring.getDropped() == 3);
+    return 0;
+}
+
+// The 8-bit indices wrap many times over
+static int testWrap() {
+    PacketRing ring;
+    uint8_t buffer[PACKET_MAX_SIZE];
+    for (uint32_t i = 0; i < 1000; i++) {
+        size_t length = buildDistance(buffer, 2, (uint16_t)i, 60);
+        CHECK(ring.push(buffer, length, i));
+        if (i % 3 == 2) {
+            while (const RingPacket* entry = ring.front()) {
+                CHECK(entry->receivedUs + ring.size() == i + 1);
+                ring.pop();
+            }
+        }
+    }
+    CHECK(ring.getDropped() == 0 && ring.getHighWater() == 3);
+    return 0;
+}
+
+// A producer and a consumer thread, as the callback and loop(). The
+// producer waits for room, so every packet must arrive intact and in order.
+static int testThreads() {
+    const uint32_t total = 1000000;
+    PacketRing ring;
+    uint32_t accepted = 0;
+    std::atomic<bool> finished(false);
+
+    std::thread producer([&]() {
+        uint8_t buffer[PACKET_MAX_SIZE];
+        for (uint32_t i = 0; i < total; i++) {
+            size_t length = buildDistance(buffer, 3, (uint16_t)i, (uint16_t)(i % 400));
+            while (ring.size() >= PACKET_RING_SIZE) std::this_thread::yield();
+            if (ring.push(buffer, length, i)) accepted++;
+        }
+        finished.store(true, std::memory_order_release);
+    });
+
+    uint32_t received = 0, lastUs = 0, errors = 0;
+    while (true) {
+        bool last = finished.load(std::memory_order_acquire);
+        const RingPacket* entry = ring.front();
+        if (!entry) {
+            if (last) break;
+            std::this_thread::yield();
+            continue;
+        }
+        PacketView view;
+        if (parsePacket(entry->data, entry->length, &view) != PACKET_OK) errors++;
+        else if (getDistancePayload(view)->readings[0].distance != entry->receivedUs % 400) errors++;
+        if (received > 0 && entry->receivedUs <= lastUs) errors++;
+        lastUs = entry->receivedUs;
+        received++;
+        ring.pop();
+    }
+    producer.join();
+    CHECK(errors == 0);
+    CHECK(accepted == total && received == total);
+    CHECK(ring.getDropped() == 0);
+    return 0;
+}
+
+// ================= Receiver timeline =================
+
+// The ESP8266 runs loop() and the WiFi stack cooperatively, so a frame
+// waits in the stack until neither is busy. Costs on the 80 MHz core:
+#define PARSE_US 10             // Header checks and CRC of a small packet
+#define PUSH_US 2               // Copy into the ring
+#define HANDLE_US 10            // Sequence tracking and mapping in loop()
+#define GPIO_US 1               // One digitalWrite
+#define PRINT_BYTE_US 1         // Print overhead per byte, FIFO not full
+#define UART_FIFO 128           // Hardware TX FIFO (bytes)
+#define UART_BYTE_US 86.8       // 10 bits at 115200 baud
+#define STACK_FRAMES 4          // Frames the stack holds for the callback
+#define TIMELINE_US 10000000
+
+typedef struct {
+    uint32_t us;
+    uint8_t node;
+    uint8_t type;
+} Arrival;
+
+class Uart {
+private:
+    double level = 0;
+    double levelUs = 0;
+
+    void drain(double t) {
+        level -= (t - levelUs) / UART_BYTE_US;
+        if (level < 0) level = 0;
+        levelUs = t;
+    }
+
+public:
+    double freeAt(double t) { drain(t); return UART_FIFO - level; }
+
+    // Time a print of n bytes holds the CPU, blocking while the FIFO is full
+    double write(double t, size_t n) {
+        drain(t);
+        double blocked = 0;
+        if (level + n > UART_FIFO) {
+            blocked = (level + n - UART_FIFO) * UART_BYTE_US;
+            level = UART_FIFO;
+            levelUs = t + blocked;
+        } else {
+            level += n;
+        }
+        return blocked + n * PRINT_BYTE_US;
+    }
+};
+
+typedef struct {
+    uint32_t frames;
+    uint32_t dropped;               // In the stack or the ring
+    double callbackTotalUs;
+    double callbackMaxUs;
+    uint32_t lines;
+    uint32_t linesSkipped;
+} TimelineResult;
+
+// Distance a node reports for a packet: an obstacle wandering 20-120 cm
+static uint16_t packetDistance(uint32_t us, uint8_t node) {
+    uint32_t phase = (us / 1000 + node * 700) % 4000;
+    return (uint16_t)(phase < 2000 ? 120 - phase / 20 : 20 + (phase - 2000) / 20);
+}
+
+static size_t lineLength(uint16_t cm, uint16_t sequence) {
+    char line[96];
+    return (size_t)std::snprintf(line, sizeof(line),
+        "Distance Received: %u cm (100%%) at 40 Hz, node 1 #%u, lost 0, rejected 0\r\n",
+        (unsigned)cm, (unsigned)sequence);
+}
+
+static TimelineResult runTimeline(const std::vector<Arrival>& arrivals, bool ring) {
+    TimelineResult result;
+    memset(&result, 0, sizeof(result));
+    Uart uart;
+    PacketRing packets;
+    std::deque<Arrival> stack;
+    uint8_t buffer[PACKET_MAX_SIZE];
+    uint16_t sequence[256] = { 0 };
+    uint8_t level = 0;
+
+    double t = 0;
+    size_t next = 0;
+    while (true) {
+        while (next < arrivals.size() && arrivals[next].us <= t) {
+            result.frames++;
+            if (stack.size() < STACK_FRAMES) stack.push_back(arrivals[next]);
+            else result.dropped++;
+            next++;
+        }
+
+        if (!stack.empty()) {
+            Arrival frame = stack.front();
+            stack.pop_front();
+            uint16_t cm = packetDistance(frame.us, frame.node);
+            size_t length;
+            if (frame.type == PACKET_DISTANCE) {
+                length = buildDistance(buffer, frame.node, sequence[frame.node]++, cm);
+            } else {
+                beginPacket(buffer, PACKET_STATUS, frame.node, sequence[frame.node]++, frame.us);
+                length = sealPacket(buffer, sizeof(StatusPayload));
+            }
+            double us = PARSE_US;
+            if (ring) {
+                us += PUSH_US;
+                if (!packets.push(buffer, length, frame.us)) result.dropped++;
+            } else if (frame.type == PACKET_DISTANCE) {
+                // Print the line, clear all five motors, set the level's
+                us += uart.write(t + us, lineLength(cm, sequence[frame.node]));
+                us += (HAPTIC_LEVELS + hapticLevel(cm)) * GPIO_US;
+                result.lines++;
+            }
+            result.callbackTotalUs += us;
+            if (us > result.callbackMaxUs) result.callbackMaxUs = us;
+            t += us;
+            continue;
+        }
+
+        if (ring && packets.size() > 0) {
+            // One loop() pass: drain, drive the motors, log the newest
+            double us = 0;
+            size_t line = 0;
+            while (const RingPacket* entry = packets.front()) {
+                PacketView view;
+                parsePacket(entry->data, entry->length, &view);
+                us += HANDLE_US;
+                const DistancePayload* payload = getDistancePayload(view);
+                if (payload) {
+                    uint8_t newLevel = hapticLevel(payload->readings[0].distance);
+                    if (newLevel != level) us += HAPTIC_LEVELS * GPIO_US;
+                    level = newLevel;
+                    line = lineLength(payload->readings[0].distance, view.header->sequence);
+                }
+                packets.pop();
+            }
+            if (line > 0 && uart.freeAt(t + us) >= line) {
+                us += uart.write(t + us, line);
+                result.lines++;
+            } else if (line > 0) {
+                result.linesSkipped++;
+            }
+            t += us;
+            continue;
+        }
+
+        if (next >= arrivals.size()) break;
+        t = arrivals[next].us;
+    }
+    return result;
+}
+
+// Distance packets from each node at 40 Hz, offset from one another,
+// plus a status packet per node each second and optional bursts
+static std::vector<Arrival> makeArrivals(uint8_t nodes, uint32_t burstEveryUs) {
+    std::vector<Arrival> arrivals;
+    for (uint32_t t = 0; t < TIMELINE_US; t += 25000) {
+        for (uint8_t n = 0; n < nodes; n++) {
+            uint32_t us = t + n * 6100;
+            arrivals.push_back({ us, (uint8_t)(n + 1), PACKET_DISTANCE });
+            if (t % 1000000 == 0) arrivals.push_back({ us + 3000, (uint8_t)(n + 1), PACKET_STATUS });
+        }
+        // Another sender's retries, half a millisecond apart
+        if (burstEveryUs && t % burstEveryUs == 0) {
+            for (uint8_t i = 0; i < 8; i++) arrivals.push_back({ t + 12000 + i * 500, 9, PACKET_DISTANCE });
+        }
+    }
+    std::sort(arrivals.begin(), arrivals.end(),
+              [](const Arrival& a, const Arrival& b) { return a.us < b.us; });
+    return arrivals;
+}
+
+static int testTimeline() {
+    struct { const char* name; uint8_t nodes; uint32_t burstUs; } scenarios[] = {
+        { "one_node", 1, 0 },
+        { "bursts", 1, 500000 },
+        { "four_nodes", 4, 0 },
+    };
+    for (auto& s : scenarios) {
+        std::vector<Arrival> arrivals = makeArrivals(s.nodes, s.burstUs);
+        TimelineResult before = runTimeline(arrivals, false);
+        TimelineResult after = runTimeline(arrivals, true);
+        CHECK(after.dropped == 0);
+        CHECK(after.callbackMaxUs <= PARSE_US + PUSH_US);
+
+        const TimelineResult* runs[] = { &before, &after };
+        for (const TimelineResult* run : runs) {
+            std::printf("TIMELINE %s %s callback %.0f us mean %.0f us max, dropped %u of %u, "
+                        "lines %u skipped %u\n",
+                        s.name, run == &before ? "inline" : "ring",
+                        run->callbackTotalUs / run->frames, run->callbackMaxUs,
+                        (unsigned)run->dropped, (unsigned)run->frames,
+                        (unsigned)run->lines, (unsigned)run->linesSkipped);
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    struct { const char* name; int (*run)(); } cases[] = {
+        { "order", testOrder },
+        { "full", testFull },
+        { "wrap", testWrap },
+        { "threads", testThreads },
+        { "timeline", testTimeline },
+    };
+
+    int failures = 0;
+    for (auto& c : cases) {
+        if (argc > 1 && std::strcmp(argv[1], c.name) != 0) continue;
+        int result = c.run();
+        std::printf("%s %s\n", result == 0 ? "PASS" : "FAIL", c.name);
+        failures += result;
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,313 @@
+// Host harness for RangeFilter. Run with a case name; exits non-zero on
+// failure and prints the reason.
+
+#include "range_filter.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#define CHECK(cond) do { if (!(cond)) { \
+    std::printf("FAIL %s:%d %s\n", __FILE__, __LINE__, #cond); return 1; } } while (0)
+
+// A ping that timed out, or whose sensor never answered
+#define TIMEOUT 0xFFFE
+#define MISSING 0xFFFF
+
+static uint16_t ping(RangeFilter& filter, uint16_t cm) {
+    if (cm == TIMEOUT) return filter.add(ECHO_NO_TARGET, 0);
+    if (cm == MISSING) return filter.add(ECHO_NO_SENSOR, 0);
+    return filter.add(ECHO_OK, cm);
+}
+
+// ================= Reference =================
+
+// The same Hampel filter, sorting the window for every ping
+struct Reference {
+    std::vector<uint16_t> ring;
+    size_t window;
+    uint8_t confidence;
+
+    explicit Reference(size_t window) : window(window), confidence(0) {}
+
+    uint16_t add(uint16_t cm) {
+        uint16_t p = DISTANCE_NO_SENSOR;
+        if (cm == TIMEOUT) p = MAX_DISTANCE;
+        else if (cm != MISSING && cm >= MIN_DISTANCE) p = std::min<uint16_t>(cm, MAX_DISTANCE);
+        ring.push_back(p);
+        if (ring.size() > window) ring.erase(ring.begin());
+
+        std::vector<uint16_t> valid;
+        for (uint16_t v : ring) if (v != DISTANCE_NO_SENSOR) valid.push_back(v);
+        if (valid.empty()) {
+            confidence = 0;
+            return DISTANCE_NO_SENSOR;
+        }
+        std::sort(valid.begin(), valid.end());
+        uint16_t median = valid[(valid.size() - 1) / 2];
+        std::vector<uint16_t> deviations;
+        for (uint16_t v : valid) deviations.push_back(std::abs((int)v - (int)median));
+        std::sort(deviations.begin(), deviations.end());
+        uint32_t threshold = (uint32_t)deviations[(valid.size() - 1) / 2] * FILTER_THRESHOLD * 1483 / 1000;
+        if (threshold < FILTER_MIN_SPREAD) threshold = FILTER_MIN_SPREAD;
+
+        size_t agree = 0;
+        for (uint16_t v : valid) if ((uint32_t)std::abs((int)v - (int)median) <= threshold) agree++;
+        confidence = (uint8_t)(agree * 100 / window);
+
+        if (p == DISTANCE_NO_SENSOR) return median;
+        return (uint32_t)std::abs((int)p - (int)median) > threshold ? median : p;
+    }
+};
+
+// ================= Cases =================
+
+// A window of one reports every valid ping as it is
+static int testPassthrough() {
+    RangeFilter filter;
+    filter.setWindow(1);
+    CHECK(ping(filter, 120) == 120);
+    CHECK(filter.getConfidence() == 100);
+    CHECK(ping(filter, 30) == 30);
+    CHECK(ping(filter, TIMEOUT) == MAX_DISTANCE);
+    CHECK(ping(filter, MAX_DISTANCE + 50) == MAX_DISTANCE);
+    CHECK(ping(filter, MISSING) == DISTANCE_NO_SENSOR);
+    CHECK(filter.getConfidence() == 0);
+    CHECK(ping(filter, 1) == DISTANCE_NO_SENSOR);
+    CHECK(filter.getStats().rejected == 2);
+    CHECK(filter.getStats().outliers == 0);
+    return 0;
+}
+
+// A ghost or a missed echo in a steady reading is replaced by the median
+static int testOutliers() {
+    RangeFilter filter;
+    for (int i = 0; i < FILTER_WINDOW; i++) ping(filter, 150 + i % 2);
+    CHECK(filter.getConfidence() == 100);
+
+    CHECK(ping(filter, 40) <= 151);
+    CHECK(filter.getDistance() >= 150);
+    CHECK(ping(filter, TIMEOUT) <= 151);
+    CHECK(ping(filter, 152) == 152);
+    CHECK(filter.getStats().outliers == 2);
+    CHECK(filter.getConfidence() == 100 * (FILTER_WINDOW - 2) / FILTER_WINDOW);
+
+    // Ring-down and a dropped sensor are never reported
+    CHECK(ping(filter, 0) >= 150);
+    CHECK(ping(filter, MISSING) >= 150);
+    CHECK(filter.getStats().rejected == 2);
+    return 0;
+}
+
+// A real change is followed once it holds most of the window
+static int testStep() {
+    RangeFilter filter;
+    for (int i = 0; i < FILTER_WINDOW; i++) ping(filter, TIMEOUT);
+    CHECK(filter.getDistance() == MAX_DISTANCE);
+
+    int pings = 0;
+    while (ping(filter, 70) != 70) pings++;
+    CHECK(pings == FILTER_WINDOW / 2);
+
+    pings = 0;
+    while (ping(filter, TIMEOUT) != MAX_DISTANCE) pings++;
+    CHECK(pings == FILTER_WINDOW / 2);
+
+    // Walking towards a wall passes through unchanged
+    for (int i = 0; i < FILTER_WINDOW; i++) ping(filter, 203);
+    for (int cm = 200; cm > 20; cm -= 3) CHECK(ping(filter, cm) == cm);
+    return 0;
+}
+
+// Distances, confidences and counts match sorting the window each time
+static int testAgainstReference() {
+    std::mt19937 rng(47);
+    for (int window = 1; window <= FILTER_WINDOW; window++) {
+        RangeFilter filter;
+        filter.setWindow(window);
+        Reference reference(window);
+        for (int i = 0; i < 20000; i++) {
+            uint16_t cm;
+            switch (rng() % 8) {
+                case 0: cm = TIMEOUT; break;
+                case 1: cm = MISSING; break;
+                case 2: cm = rng() % (MAX_DISTANCE + 40); break;
+                default: cm = 100 + rng() % 30; break;
+            }
+            uint16_t expected = reference.add(cm);
+            CHECK(ping(filter, cm) == expected);
+            CHECK(filter.getConfidence() == reference.confidence);
+        }
+    }
+    return 0;
+}
+
+// ================= Echo sequences =================
+
+// The receiver's distance-to-motor mapping
+static int motors(uint16_t cm) {
+    if (cm > 100) return 0;
+    if (cm > 80) return 1;
+    if (cm > 60) return 2;
+    if (cm > 40) return 3;
+    if (cm > 20) return 4;
+    return 5;
+}
+
+#define SAMPLE_MS 50                        // One sample per interval, as at 20 Hz
+#define PING_MS 12                          // Pings of a burst, echo and guard time apart
+#define TOLERANCE 10                        // cm either way before a level counts as wrong
+
+// HC-SR04 failure modes along a walk: missed echoes off soft or angled
+// surfaces, specular ghosts nearer than anything ahead, and ring-down
+// read as a few centimetres
+struct Sequence {
+    const char* name;
+    uint32_t durationMs;
+    float missed;
+    float ghosts;
+    float ringDown;
+    // Nearest obstacle at t, 0 for nothing in range
+    float (*truth)(uint32_t ms);
+};
+
+static float clearAhead(uint32_t) { return 0; }
+static float toWall(uint32_t ms) { return 350 - 0.14f * ms > 25 ? 350 - 0.14f * ms : 25; }
+// Someone crosses 70 cm ahead for a second, every four seconds
+static float crossing(uint32_t ms) { return ms % 4000 >= 2000 && ms % 4000 < 3000 ? 70 : 0; }
+static float clutter(uint32_t ms) { return 180 + 60 * ((ms / 1500) % 3); }
+
+static const Sequence SEQUENCES[] = {
+    { "clear", 60000, 0.00f, 0.03f, 0.01f, clearAhead },
+    { "wall", 2300, 0.08f, 0.03f, 0.01f, toWall },
+    { "crossing", 60000, 0.05f, 0.02f, 0.01f, crossing },
+    { "clutter", 60000, 0.10f, 0.04f, 0.02f, clutter },
+};
+
+struct Echoes {
+    std::mt19937 rng;
+    std::normal_distribution<float> jitter;
+
+    explicit Echoes(uint32_t seed) : rng(seed), jitter(0, 1.5f) {}
+
+    float chance() { return std::uniform_real_distribution<float>(0, 1)(rng); }
+
+    uint16_t ping(const Sequence& s, uint32_t ms) {
+        float cm = s.truth(ms);
+        float draw = chance();
+        if (draw < s.ringDown) return rng() % MIN_DISTANCE;
+        draw -= s.ringDown;
+        if (draw < s.ghosts) return 20 + rng() % 70;
+        draw -= s.ghosts;
+        if (cm <= 0 || draw < s.missed) return TIMEOUT;
+        float measured = cm + jitter(rng);
+        return measured < 0 ? 0 : (uint16_t)(measured + 0.5f);
+    }
+};
+
+// Within reach of the first motor
+static bool inReach(float cm) {
+    return cm > 0 && cm <= 100;
+}
+
+struct SequenceRun {
+    uint32_t samples;
+    uint32_t falseAlarms;                   // More motors than the truth calls for
+    uint32_t missed;                        // Fewer motors than the truth calls for
+    uint32_t reactions;
+    uint32_t reactionMs;                    // Summed, obstacle appearing to first motor
+};
+
+// Unfiltered: one ping per sample, sent as it came, as before the filter.
+// Filtered: PING_BURST pings per sample through the filter.
+static SequenceRun replay(const Sequence& s, bool filtered, uint32_t seed) {
+    Echoes echoes(seed);
+    RangeFilter filter;
+    SequenceRun run;
+    memset(&run, 0, sizeof(run));
+    bool waiting = false, wasPresent = false;
+    uint32_t appearedMs = 0;
+
+    for (uint32_t ms = 0; ms < s.durationMs; ms += SAMPLE_MS) {
+        uint16_t reported;
+        uint32_t sentMs = ms;
+        if (filtered) {
+            for (int p = 0; p < PING_BURST; p++) ping(filter, echoes.ping(s, ms + p * PING_MS));
+            reported = filter.getDistance();
+            sentMs = ms + (PING_BURST - 1) * PING_MS;
+        } else {
+            uint16_t raw = echoes.ping(s, ms);
+            reported = raw == TIMEOUT ? MAX_DISTANCE : raw;
+        }
+        if (reported == DISTANCE_NO_SENSOR) reported = MAX_DISTANCE;
+
+        float truth = s.truth(sentMs);
+        float lowest = truth > 0 ? truth - TOLERANCE : MAX_DISTANCE;
+        float highest = truth > 0 ? truth + TOLERANCE : MAX_DISTANCE;
+        run.samples++;
+        if (motors(reported) > motors(lowest < 0 ? 0 : (uint16_t)lowest)) run.falseAlarms++;
+        if (motors(reported) < motors((uint16_t)highest)) run.missed++;
+
+        bool present = inReach(s.truth(ms));
+        if (present && !wasPresent) {
+            waiting = true;
+            appearedMs = ms;
+            while (appearedMs > 0 && inReach(s.truth(appearedMs - 1))) appearedMs--;
+        }
+        if (waiting && motors(reported) > 0) {
+            run.reactions++;
+            run.reactionMs += sentMs - appearedMs;
+            waiting = false;
+        }
+        if (!present) waiting = false;
+        wasPresent = present;
+    }
+    return run;
+}
+
+// False alarms and missed alerts with and without the filter, over the
+// same echo sequences
+static int testSequences() {
+    for (const Sequence& s : SEQUENCES) {
+        for (int filtered = 0; filtered < 2; filtered++) {
+            SequenceRun total;
+            memset(&total, 0, sizeof(total));
+            for (uint32_t seed = 1; seed <= 20; seed++) {
+                SequenceRun run = replay(s, filtered, seed);
+                total.samples += run.samples;
+                total.falseAlarms += run.falseAlarms;
+                total.missed += run.missed;
+                total.reactions += run.reactions;
+                total.reactionMs += run.reactionMs;
+            }
+            CHECK(total.samples > 0);
+            std::printf("SEQUENCE %s %s false alarms %.2f%% missed %.2f%% reaction %.0f ms\n",
+                        s.name, filtered ? "filtered" : "raw",
+                        100.0 * total.falseAlarms / total.samples, 100.0 * total.missed / total.samples,
+                        total.reactions ? (double)total.reactionMs / total.reactions : 0.0);
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    struct { const char* name; int (*run)(); } cases[] = {
+        { "passthrough", testPassthrough },
+        { "outliers", testOutliers },
+        { "step", testStep },
+        { "against_reference", testAgainstReference },
+        { "sequences", testSequences },
+    };
+
+    int failures = 0;
+    for (auto& c : cases) {
+        if (argc > 1 && std::strcmp(argv[1], c.name) != 0) continue;
+        int result = c.run();
+        std::printf("%s %s\n", result == 0 ? "PASS" : "FAIL", c.name);
+        failures += result;
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,162 @@
+// Host harness for RateLimiter. Run with a case name; exits non-zero on
+// failure and prints the reason.
+
+#include "rate_limiter.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <random>
+#include <vector>
+
+#define CHECK(cond) do { if (!(cond)) { \
+    std::printf("FAIL %s:%d %s\n", __FILE__, __LINE__, #cond); return 1; } } while (0)
+
+// Counts heap allocations so the cases can assert there are none
+static size_t allocations = 0;
+void* operator new(size_t size) {
+    allocations++;
+    void* p = std::malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+static uint32_t clientIp(uint32_t n) {
+    return 0x0004A8C0UL + (n << 24);   // 192.168.4.n in network order
+}
+
+static int testBucket() {
+    RateLimiter limiter;
+    const uint32_t ip = clientIp(2);
+    uint32_t now = 1000;
+
+    // A full burst, then refused until one token has refilled
+    for (int i = 0; i < RATE_LIMIT_BURST; i++) CHECK(limiter.allow(ip, now));
+    uint32_t retry = 0;
+    CHECK(!limiter.allow(ip, now, &retry));
+    CHECK(retry == API_RATE_LIMIT_MS);
+
+    now += API_RATE_LIMIT_MS - 1;
+    CHECK(!limiter.allow(ip, now, &retry));
+    CHECK(retry == 1);
+    now += 1;
+    CHECK(limiter.allow(ip, now));
+    CHECK(!limiter.allow(ip, now));
+
+    // Sustained rate is one request per API_RATE_LIMIT_MS
+    uint32_t allowed = 0;
+    for (uint32_t t = 10; t <= 100 * API_RATE_LIMIT_MS; t += 10) {
+        allowed += limiter.allow(ip, now + t);
+    }
+    CHECK(allowed == 100);
+
+    // A long pause refills only up to the burst
+    now += 1000000;
+    allowed = 0;
+    for (int i = 0; i < RATE_LIMIT_BURST * 2; i++) allowed += limiter.allow(ip, now);
+    CHECK(allowed == RATE_LIMIT_BURST);
+
+    // No address, nothing to key on
+    CHECK(limiter.allow(0, now));
+    CHECK(limiter.getActiveClients(now) == 1);
+    return 0;
+}
+
+static int testIndependentClients() {
+    RateLimiter limiter;
+    uint32_t now = 0;
+    for (int i = 0; i < RATE_LIMIT_BURST * 5; i++) limiter.allow(clientIp(10), now);
+    CHECK(!limiter.allow(clientIp(10), now));
+
+    for (uint32_t n = 11; n < 20; n++) {
+        for (int i = 0; i < RATE_LIMIT_BURST; i++) CHECK(limiter.allow(clientIp(n), now));
+    }
+    CHECK(limiter.getActiveClients(now) == 10);
+    RateLimitStats stats = limiter.getStats();
+    CHECK(stats.throttled == RATE_LIMIT_BURST * 4 + 1);
+    CHECK(stats.evictions == 0);
+    return 0;
+}
+
+// Hundreds of clients against a fixed table: memory stays bounded, there
+// are no allocations, and clients that keep polling are never pushed out
+// by the churn, so none of them exceeds its rate
+static int testManyClients() {
+    RateLimiter limiter;
+    CHECK(sizeof(RateLimiter) <= RateLimiter::getTableBytes() + sizeof(RateLimitStats));
+    CHECK(RateLimiter::getTableBytes() == RATE_LIMIT_SLOTS * 12);
+
+    std::mt19937 rng(7);
+    const int steadyClients = 4;
+    const int transientClients = 600;
+    std::vector<uint32_t> steadyAllowed(steadyClients, 0);
+
+    size_t before = allocations;
+    uint32_t now = 5000;
+    const uint32_t duration = 120000;
+    for (uint32_t t = 0; t < duration; t += 5) {
+        for (int c = 0; c < steadyClients; c++) {
+            steadyAllowed[c] += limiter.allow(0x0A000000UL + c, now + t);
+        }
+        if (rng() % 4 == 0) {
+            uint32_t ip = 0xC0A80000UL + 100 + rng() % transientClients;
+            limiter.allow(ip, now + t);
+        }
+        CHECK(limiter.getActiveClients(now + t) <= RATE_LIMIT_SLOTS);
+    }
+    CHECK(allocations == before);
+
+    const uint32_t ceiling = RATE_LIMIT_BURST + duration / API_RATE_LIMIT_MS;
+    for (int c = 0; c < steadyClients; c++) {
+        CHECK(steadyAllowed[c] <= ceiling);
+        CHECK(steadyAllowed[c] >= ceiling - 1);
+    }
+
+    RateLimitStats stats = limiter.getStats();
+    std::printf("allowed %u throttled %u evictions %u reused %u table %zu bytes\n",
+                stats.allowed, stats.throttled, stats.evictions, stats.reused,
+                RateLimiter::getTableBytes());
+    CHECK(stats.evictions > 0);
+    return 0;
+}
+
+// Clients idle past RATE_LIMIT_IDLE_MS give their slot to new ones
+// without counting as evictions
+static int testAging() {
+    RateLimiter limiter;
+    const uint32_t clients = RATE_LIMIT_SLOTS / 2;
+    uint32_t now = 0;
+    for (uint32_t n = 1; n <= clients; n++) limiter.allow(clientIp(n), now);
+    CHECK(limiter.getActiveClients(now) == clients);
+    CHECK(limiter.getStats().evictions == 0);
+
+    now += RATE_LIMIT_IDLE_MS;
+    CHECK(limiter.getActiveClients(now) == 0);
+    for (uint32_t n = 101; n <= 100 + clients; n++) limiter.allow(clientIp(n), now);
+    RateLimitStats stats = limiter.getStats();
+    CHECK(stats.evictions == 0);
+    CHECK(stats.reused > 0);
+    CHECK(limiter.getActiveClients(now) == clients);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    struct { const char* name; int (*run)(); } cases[] = {
+        { "bucket", testBucket },
+        { "independent_clients", testIndependentClients },
+        { "many_clients", testManyClients },
+        { "aging", testAging },
+    };
+
+    int failures = 0;
+    for (auto& c : cases) {
+        if (argc > 1 && std::strcmp(argv[1], c.name) != 0) continue;
+        int result = c.run();
+        std::printf("%s %s\n", result == 0 ? "PASS" : "FAIL", c.name);
+        failures += result;
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,221 @@
+// Host harness for ResponseCache. Run with a case name; exits non-zero on
+// failure and prints the reason.
+
+#include "response_cache.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#define CHECK(cond) do { if (!(cond)) { \
+    std::printf("FAIL %s:%d %s\n", __FILE__, __LINE__, #cond); return 1; } } while (0)
+
+static uint32_t hostMicros() {
+    using namespace std::chrono;
+    return (uint32_t)duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+// What the writers report; changing one without a bump must not show
+static uint32_t battery = 80;
+static uint32_t clients = 1;
+static uint32_t threshold = 30;
+static std::atomic<int> writes(0);
+static int writeDelayMs = 0;
+
+static void writeStatus(JsonStream& json) {
+    writes++;
+    if (writeDelayMs) std::this_thread::sleep_for(std::chrono::milliseconds(writeDelayMs));
+    json.beginObject();
+    json.stringField("status", "operational");
+    json.unsignedField("batteryLevel", battery);
+    json.unsignedField("wifiClients", clients);
+    json.end();
+}
+
+static void writeConfig(JsonStream& json) {
+    writes++;
+    json.beginObject();
+    json.scaledField("lowThreshold", threshold, 2);
+    json.end();
+}
+
+static void writeLarge(JsonStream& json) {
+    writes++;
+    json.beginArray();
+    for (uint32_t i = 0; i < RESPONSE_CACHE_BODY_BYTES; i++) json.unsignedValue(i);
+    json.end();
+}
+
+enum { STATUS, CONFIG, LARGE };
+
+static const CacheDef defs[] = {
+    { "/status", writeStatus, DATA_BIT(DATA_BATTERY) | DATA_BIT(DATA_CLIENTS) },
+    { "/config", writeConfig, DATA_BIT(DATA_CONFIG) },
+    { "/large", writeLarge, DATA_BIT(DATA_GPS) },
+};
+
+static std::string body(ResponseCache& cache, uint8_t id) {
+    uint16_t length;
+    const char* data = cache.acquire(id, &length);
+    if (!data) return "";
+    std::string copy(data, length);
+    cache.release(id);
+    return copy;
+}
+
+static void reset() {
+    battery = 80;
+    clients = 1;
+    threshold = 30;
+    writes = 0;
+    writeDelayMs = 0;
+}
+
+static int testHitMiss() {
+    reset();
+    DataVersions versions;
+    ResponseCache cache;
+    cache.begin(defs, versions, hostMicros);
+
+    CHECK(body(cache, STATUS) == "{\"status\":\"operational\",\"batteryLevel\":80,\"wifiClients\":1}");
+    CHECK(body(cache, STATUS) == body(cache, STATUS));
+    CHECK(writes == 1);
+    CHECK(cache.getStats(STATUS).hits == 2 && cache.getStats(STATUS).builds == 1);
+
+    // Sources the body does not list leave it alone
+    versions.bump(DATA_GPS);
+    versions.bump(DATA_CONFIG);
+    body(cache, STATUS);
+    CHECK(writes == 1);
+
+    battery = 79;
+    versions.bump(DATA_BATTERY);
+    CHECK(body(cache, STATUS) == "{\"status\":\"operational\",\"batteryLevel\":79,\"wifiClients\":1}");
+    CHECK(writes == 2);
+
+    clients = 2;
+    versions.bump(DATA_CLIENTS);
+    CHECK(body(cache, STATUS).find("\"wifiClients\":2") != std::string::npos);
+
+    // Entries are independent
+    CHECK(body(cache, CONFIG) == "{\"lowThreshold\":0.30}");
+    threshold = 40;
+    versions.bump(DATA_CONFIG);
+    CHECK(body(cache, CONFIG) == "{\"lowThreshold\":0.40}");
+    CHECK(cache.getStats(STATUS).builds == 3 && cache.getStats(CONFIG).builds == 2);
+
+    cache.invalidate(CONFIG);
+    body(cache, CONFIG);
+    CHECK(cache.getStats(CONFIG).builds == 3);
+    return 0;
+}
+
+// A request that arrives while the body is being built waits for it
+static int testCoalesce() {
+    reset();
+    DataVersions versions;
+    ResponseCache cache;
+    cache.begin(defs, versions, hostMicros);
+    writeDelayMs = 50;
+
+    std::string first, second;
+    std::thread a([&] { first = body(cache, STATUS); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    std::thread b([&] { second = body(cache, STATUS); });
+    a.join();
+    b.join();
+
+    CHECK(writes == 1);
+    CHECK(!first.empty() && first == second);
+    CHECK(cache.getStats(STATUS).builds == 1);
+    CHECK(cache.getStats(STATUS).coalesced == 1);
+    CHECK(cache.getStats(STATUS).lastBuildUs >= 50000);
+    return 0;
+}
+
+// Too large to cache: nothing returned, nothing left locked
+static int testOverflow() {
+    reset();
+    DataVersions versions;
+    ResponseCache cache;
+    cache.begin(defs, versions, hostMicros);
+
+    uint16_t length;
+    CHECK(cache.acquire(LARGE, &length) == NULL);
+    CHECK(cache.acquire(LARGE, &length) == NULL);
+    CHECK(cache.getStats(LARGE).overflows == 2 && cache.getStats(LARGE).hits == 0);
+    CHECK(cache.acquire(99, &length) == NULL);
+    return 0;
+}
+
+// Four dashboards polling /status and /config every 2 s for an hour while
+// the battery moves a percent every few minutes and a client comes and
+// goes; every request is timed against rebuilding the body each time
+static int testPolling() {
+    reset();
+    DataVersions versions;
+    ResponseCache cache;
+    cache.begin(defs, versions, hostMicros);
+
+    const uint32_t seconds = 3600;
+    const int dashboards = 4;
+    uint32_t requests = 0;
+    volatile size_t sink = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t t = 0; t < seconds; t += 2) {
+        if (t % 240 == 0) { battery--; versions.bump(DATA_BATTERY); }
+        if (t % 900 == 0) { clients ^= 3; versions.bump(DATA_CLIENTS); }
+        for (int d = 0; d < dashboards; d++) {
+            sink = sink + body(cache, STATUS).size() + body(cache, CONFIG).size();
+            requests += 2;
+        }
+    }
+    double cachedUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    for (uint32_t n = 0; n < requests / 2; n++) {
+        std::string out;
+        JsonStream status([](const char* d, size_t l, void* c) { static_cast<std::string*>(c)->append(d, l); }, &out);
+        writeStatus(status);
+        status.finish();
+        JsonStream config([](const char* d, size_t l, void* c) { static_cast<std::string*>(c)->append(d, l); }, &out);
+        writeConfig(config);
+        config.finish();
+        sink = sink + out.size();
+    }
+    double uncachedUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+    const CacheStats& s = cache.getStats(STATUS);
+    const CacheStats& c = cache.getStats(CONFIG);
+    uint32_t builds = s.builds + c.builds;
+    uint32_t hits = s.hits + c.hits;
+    CHECK(builds + hits == requests);
+    CHECK(builds <= 30);
+
+    std::printf("%u requests, %u builds, hit rate %.1f%%\n", requests, builds, 100.0 * hits / requests);
+    std::printf("cached: %.0f us total, rebuilding every request: %.0f us total\n", cachedUs, uncachedUs);
+    std::printf("build time saved (cache estimate): %u us\n", s.savedUs + c.savedUs);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    struct { const char* name; int (*run)(); } cases[] = {
+        { "hit_miss", testHitMiss },
+        { "coalesce", testCoalesce },
+        { "overflow", testOverflow },
+        { "polling", testPolling },
+    };
+
+    int failures = 0;
+    for (auto& c : cases) {
+        if (argc > 1 && std::strcmp(argv[1], c.name) != 0) continue;
+        int result = c.run();
+        std::printf("%s %s\n", result == 0 ? "PASS" : "FAIL", c.name);
+        failures += result;
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,208 @@
+// Host harness for the compile-time route table. Run with a case name;
+// exits non-zero on failure and prints the reason.
+
+#include "route_table.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#define CHECK(cond) do { if (!(cond)) { \
+    std::printf("FAIL %s:%d %s\n", __FILE__, __LINE__, #cond); return 1; } } while (0)
+
+static uint32_t virtualUs = 0;
+static uint32_t virtualClock() { return virtualUs; }
+
+static int lastHandler = -1;
+template <int N> static void handler() { lastHandler = N; }
+
+// A full table: the device routes plus the ones planned around them
+constexpr RouteDef routes[] = {
+    { ROUTE_GET, "/gps", handler<0>, ROUTE_FLAG_NO_RATE_LIMIT },
+    { ROUTE_GET, "/track", handler<1>, 0 },
+    { ROUTE_GET, "/metrics", handler<2>, 0 },
+    { ROUTE_GET, "/status", handler<3>, 0 },
+    { ROUTE_GET, "/sensors", handler<4>, 0 },
+    { ROUTE_GET, "/config", handler<5>, 0 },
+    { ROUTE_POST, "/config", handler<6>, 0 },
+    { ROUTE_GET, "/delta", handler<7>, 0 },
+    { ROUTE_GET, "/dashboard", handler<8>, 0 },
+    { ROUTE_GET, "/clients", handler<9>, 0 },
+    { ROUTE_GET, "/events", handler<10>, 0 },
+    { ROUTE_POST, "/ota", handler<11>, 0 },
+    { ROUTE_GET, "/ota/status", handler<12>, 0 },
+    { ROUTE_POST, "/reset", handler<13>, 0 },
+    { ROUTE_OPTIONS, "/config", handler<14>, 0 },
+    { ROUTE_GET, "/info", handler<15>, 0 },
+};
+const size_t routeCount = sizeof(routes) / sizeof(routes[0]);
+constexpr RouteIndex routeIndex = buildRouteIndex(routes);
+static_assert(routeIndex.seed != ROUTE_NO_SEED, "No perfect hash for the test table");
+
+static int testAllRoutesFound() {
+    Router router;
+    router.begin(routes, routeIndex, virtualClock);
+    CHECK(router.getRouteCount() == routeCount);
+
+    int occupied = 0;
+    for (int slot = 0; slot < ROUTE_TABLE_SLOTS; slot++) occupied += routeIndex.slots[slot] >= 0;
+    CHECK(occupied == (int)routeCount);
+
+    for (size_t i = 0; i < routeCount; i++) {
+        CHECK(router.find(routes[i].method, routes[i].path) == (int)i);
+        lastHandler = -1;
+        CHECK(router.dispatch(routes[i].method, routes[i].path));
+        CHECK(lastHandler == (int)i);
+        CHECK(router.getRoute(i).flags == (i == 0 ? ROUTE_FLAG_NO_RATE_LIMIT : 0));
+    }
+    CHECK(router.getMisses() == 0);
+    return 0;
+}
+
+static int testUnknownRejected() {
+    Router router;
+    router.begin(routes, routeIndex, virtualClock);
+
+    const char* paths[] = {
+        "", "/", "/gp", "/gpss", "/GPS", "gps", "/gps/", "/track?x=1", "/metric",
+        "/config/", "/ota/status/", "/status ", "/unknown", "/dashboard2"
+    };
+    for (const char* path : paths) {
+        for (int m = 0; m < ROUTE_METHOD_COUNT; m++) {
+            CHECK(router.find((RouteMethod)m, path) == -1);
+        }
+    }
+
+    // Right path, wrong method
+    CHECK(router.find(ROUTE_POST, "/gps") == -1);
+    CHECK(router.find(ROUTE_DELETE, "/config") == -1);
+    lastHandler = -1;
+    CHECK(!router.dispatch(ROUTE_PUT, "/metrics"));
+    CHECK(lastHandler == -1);
+    CHECK(router.getMisses() == 1);
+
+    // Nothing routes before begin()
+    Router empty;
+    CHECK(empty.find(ROUTE_GET, "/gps") == -1);
+    return 0;
+}
+
+static uint32_t handlerCostUs = 0;
+static void costlyHandler() { virtualUs += handlerCostUs; }
+
+constexpr RouteDef timedRoutes[] = {
+    { ROUTE_GET, "/slow", costlyHandler, 0 },
+};
+constexpr RouteIndex timedIndex = buildRouteIndex(timedRoutes);
+static_assert(timedIndex.seed != ROUTE_NO_SEED, "No perfect hash for the timed table");
+
+static int testStats() {
+    Router router;
+    router.begin(timedRoutes, timedIndex, virtualClock);
+
+    const uint32_t costs[] = { 0, 127, 128, 255, 1000, 8191, 8192, 500000 };
+    const uint8_t buckets[] = { 0, 0, 1, 1, 3, 6, 7, 7 };
+    uint32_t expected[ROUTE_LATENCY_BUCKETS] = { 0 };
+    uint32_t total = 0;
+    for (size_t i = 0; i < sizeof(costs) / sizeof(costs[0]); i++) {
+        handlerCostUs = costs[i];
+        CHECK(router.dispatch(ROUTE_GET, "/slow"));
+        expected[buckets[i]]++;
+        total += costs[i];
+    }
+
+    const RouteStats& stats = router.getStats(0);
+    CHECK(stats.count == 8);
+    CHECK(stats.totalUs == total);
+    CHECK(stats.maxUs == 500000);
+    for (int b = 0; b < ROUTE_LATENCY_BUCKETS; b++) CHECK(stats.histogram[b] == expected[b]);
+    CHECK(Router::getBucketLimitUs(0) == 128);
+    CHECK(Router::getBucketLimitUs(ROUTE_LATENCY_BUCKETS - 1) == UINT32_MAX);
+    return 0;
+}
+
+// The previous WiFiManager approach: String path and method per endpoint,
+// compared in turn for every request
+struct LinearEndpoint {
+    std::string path;
+    std::string method;
+    void (*handler)();
+};
+
+static int linearFind(const std::vector<LinearEndpoint>& endpoints,
+                      const std::string& method, const std::string& path) {
+    for (size_t i = 0; i < endpoints.size(); i++) {
+        if (endpoints[i].path == path && endpoints[i].method == method) return (int)i;
+    }
+    return -1;
+}
+
+static int testBenchmark() {
+    using namespace std::chrono;
+    Router router;
+    router.begin(routes, routeIndex, virtualClock);
+
+    std::vector<LinearEndpoint> endpoints;
+    for (const RouteDef& r : routes) {
+        endpoints.push_back({ r.path, Router::getMethodName(r.method), r.handler });
+    }
+
+    // Every route plus a few misses, as the server would see them
+    std::vector<std::pair<RouteMethod, std::string> > requests;
+    for (const RouteDef& r : routes) requests.push_back({ r.method, r.path });
+    requests.push_back({ ROUTE_GET, "/favicon.ico" });
+    requests.push_back({ ROUTE_GET, "/generate_204" });
+    requests.push_back({ ROUTE_POST, "/gps" });
+
+    for (auto& request : requests) {
+        std::string method = Router::getMethodName(request.first);
+        CHECK(router.find(request.first, request.second.c_str()) ==
+              linearFind(endpoints, method, request.second));
+    }
+
+    const int rounds = 200000;
+    volatile int sink = 0;
+
+    auto start = steady_clock::now();
+    for (int n = 0; n < rounds; n++) {
+        for (auto& request : requests) {
+            // The server hands over the method as a String too
+            std::string method = Router::getMethodName(request.first);
+            sink = sink + linearFind(endpoints, method, request.second);
+        }
+    }
+    double linearNs = duration<double, std::nano>(steady_clock::now() - start).count();
+
+    start = steady_clock::now();
+    for (int n = 0; n < rounds; n++) {
+        for (auto& request : requests) {
+            sink = sink + router.find(request.first, request.second.c_str());
+        }
+    }
+    double hashNs = duration<double, std::nano>(steady_clock::now() - start).count();
+
+    double lookups = (double)rounds * requests.size();
+    std::printf("%zu routes: linear %.1f ns/lookup, perfect hash %.1f ns/lookup (%.1fx)\n",
+                routeCount, linearNs / lookups, hashNs / lookups, linearNs / hashNs);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    struct { const char* name; int (*run)(); } cases[] = {
+        { "all_routes_found", testAllRoutesFound },
+        { "unknown_rejected", testUnknownRejected },
+        { "stats", testStats },
+        { "benchmark", testBenchmark },
+    };
+
+    int failures = 0;
+    for (auto& c : cases) {
+        if (argc > 1 && std::strcmp(argv[1], c.name) != 0) continue;
+        int result = c.run();
+        std::printf("%s %s\n", result == 0 ? "PASS" : "FAIL", c.name);
+        failures += result;
+    }
+    return failures == 0 ? 0 : 1;
+}
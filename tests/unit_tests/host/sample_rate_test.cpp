@@ -0,0 +1,273 @@
+// Host harness for SampleRate. Run with a case name; exits non-zero on
+// failure and prints the reason.
+
+#include "sample_rate.h"
+#include "echo_capture.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#define CHECK(cond) do { if (!(cond)) { \
+    std::printf("FAIL %s:%d %s\n", __FILE__, __LINE__, #cond); return 1; } } while (0)
+
+static int testProximity() {
+    CHECK(SampleRate::targetIntervalMs(15, 0, true) == SAMPLE_INTERVAL_MIN);
+    CHECK(SampleRate::targetIntervalMs(SAMPLE_NEAR_DISTANCE, 0, true) == SAMPLE_INTERVAL_MIN);
+    CHECK(SampleRate::targetIntervalMs(SAMPLE_FAR_DISTANCE, 0, true) == SAMPLE_INTERVAL_MAX);
+    CHECK(SampleRate::targetIntervalMs(MAX_DISTANCE, 0, false) == SAMPLE_INTERVAL_MAX);
+
+    uint16_t previous = 0;
+    for (uint16_t cm = 0; cm <= MAX_DISTANCE; cm += 5) {
+        uint16_t interval = SampleRate::targetIntervalMs(cm, 0, true);
+        CHECK(interval >= previous);
+        CHECK(interval >= SAMPLE_INTERVAL_MIN && interval <= SAMPLE_INTERVAL_MAX);
+        previous = interval;
+    }
+
+    // Receding obstacles sample by distance alone
+    CHECK(SampleRate::targetIntervalMs(SAMPLE_FAR_DISTANCE, -200, true) == SAMPLE_INTERVAL_MAX);
+    return 0;
+}
+
+// A far obstacle closing fast is sampled as if it were near
+static int testClosing() {
+    CHECK(SampleRate::targetIntervalMs(350, 100, true) == SAMPLE_STEP * 1000 / 100);
+    CHECK(SampleRate::targetIntervalMs(350, 400, true) == SAMPLE_INTERVAL_MIN);
+
+    SampleRate rate;
+    uint32_t t = 0;
+    // Let it back off on a static wall first
+    for (int i = 0; i < 20; i++) {
+        t += rate.getIntervalMs();
+        rate.update(t, 350, true);
+    }
+    CHECK(rate.getIntervalMs() == SAMPLE_INTERVAL_MAX);
+
+    // Walking towards it at 140 cm/s
+    float distance = 350;
+    for (int i = 0; i < 6; i++) {
+        t += rate.getIntervalMs();
+        distance -= 0.14f * rate.getIntervalMs();
+        rate.update(t, (uint16_t)distance, true);
+    }
+    CHECK(rate.getClosingSpeed() > 80 && rate.getClosingSpeed() < 160);
+    CHECK(rate.getIntervalMs() <= SAMPLE_STEP * 1000 / 80);
+    CHECK(distance > SAMPLE_FAR_DISTANCE - 100);
+    return 0;
+}
+
+// Backing off doubles the interval per sample; speeding up is immediate
+static int testBackoff() {
+    SampleRate rate;
+    CHECK(rate.getIntervalMs() == SAMPLE_INTERVAL_MIN);
+    CHECK(rate.update(25, 30, true) == SAMPLE_INTERVAL_MIN);
+
+    uint16_t expected = SAMPLE_INTERVAL_MIN;
+    uint32_t t = 25;
+    while (expected < SAMPLE_INTERVAL_MAX) {
+        expected = expected * 2 < SAMPLE_INTERVAL_MAX ? expected * 2 : SAMPLE_INTERVAL_MAX;
+        t += rate.getIntervalMs();
+        CHECK(rate.update(t, MAX_DISTANCE, false) == expected);
+    }
+    CHECK(rate.getRateHz() == (1000 + SAMPLE_INTERVAL_MAX / 2) / SAMPLE_INTERVAL_MAX);
+
+    t += rate.getIntervalMs();
+    CHECK(rate.update(t, 20, true) == SAMPLE_INTERVAL_MIN);
+    CHECK(rate.getRateHz() == 40);
+    return 0;
+}
+
+// A new obstacle stepping into view is not read as a closing speed
+static int testJump() {
+    SampleRate rate;
+    rate.update(0, 380, true);
+    rate.update(25, 120, true);
+    CHECK(rate.getClosingSpeed() == 0);
+
+    // Losing the target forgets the last distance
+    rate.update(50, MAX_DISTANCE, false);
+    rate.update(300, 350, true);
+    CHECK(rate.getClosingSpeed() == 0);
+    return 0;
+}
+
+// Centimetre jitter on a static far wall still backs off
+static int testJitter() {
+    SampleRate rate;
+    uint32_t t = 0;
+    for (int i = 0; i < 40; i++) {
+        t += rate.getIntervalMs();
+        rate.update(t, (uint16_t)(320 + (i % 2)), true);
+    }
+    CHECK(rate.getIntervalMs() == SAMPLE_INTERVAL_MAX);
+    return 0;
+}
+
+// ================= Simulation =================
+
+// HC-SR04 timing as in echo_capture_test.cpp
+#define BURST_US 460
+#define NO_ECHO_HOLD_US 38000
+#define LOOP_US 50
+
+// Energy above the idle draw, at 3.3 V: the sensor ranging from trigger
+// to the end of its echo, and the radio sending one ESP-NOW packet
+#define SUPPLY_V 3.3
+#define SENSOR_MA 15.0
+#define RADIO_MA 170.0
+#define RADIO_TX_US 1000.0
+
+typedef float (*Scene)(uint32_t us);       // True distance, 0 for none
+
+struct Packet {
+    uint32_t us;
+    uint16_t cm;
+};
+
+struct Run {
+    std::vector<Packet> packets;
+    double sensorUs;
+};
+
+// fixedMs 0 samples adaptively
+static Run simulate(Scene scene, uint32_t durationUs, uint32_t fixedMs) {
+    EchoCapture echo;
+    SampleRate rate;
+    Run run;
+    run.sensorUs = 0;
+    uint32_t riseAt = 0, fallAt = 0, lastTriggerMs = 0;
+    bool rising = false, falling = false;
+
+    for (uint32_t t = 0; t < durationUs; t += LOOP_US) {
+        if (rising && t >= riseAt) { echo.onEdge(true, riseAt); rising = false; }
+        if (falling && !rising && t >= fallAt) { echo.onEdge(false, fallAt); falling = false; }
+
+        uint32_t now = t / 1000;
+        uint32_t interval = fixedMs ? fixedMs : rate.getIntervalMs();
+        if (now - lastTriggerMs >= interval && !rising && !falling && echo.ready(t)) {
+            float cm = scene(t);
+            echo.arm(t);
+            riseAt = t + BURST_US;
+            fallAt = riseAt + (cm > 0 && cm <= MAX_DISTANCE ?
+                               (uint32_t)(2 * cm / SPEED_OF_SOUND) : NO_ECHO_HOLD_US);
+            rising = falling = true;
+            run.sensorUs += fallAt - t;
+            lastTriggerMs = now;
+        }
+
+        uint32_t pulse;
+        switch (echo.poll(t, &pulse)) {
+            case ECHO_OK: {
+                uint16_t cm = EchoCapture::toDistanceCm(pulse);
+                rate.update(now, cm, true);
+                run.packets.push_back({ t, cm });
+                break;
+            }
+            case ECHO_NO_TARGET:
+                rate.update(now, MAX_DISTANCE, false);
+                run.packets.push_back({ t, MAX_DISTANCE });
+                break;
+            default:
+                break;
+        }
+    }
+    return run;
+}
+
+static double powerMw(const Run& run, uint32_t durationUs) {
+    double mj = SUPPLY_V * (SENSOR_MA * run.sensorUs + RADIO_MA * RADIO_TX_US * run.packets.size()) / 1e6;
+    return mj * 1e6 / durationUs;
+}
+
+// First packet at or under cm after atUs; its delay
+static double reactionMs(const Run& run, uint32_t atUs, uint16_t cm) {
+    for (const Packet& p : run.packets) {
+        if (p.us >= atUs && p.cm <= cm) return (p.us - atUs) / 1000.0;
+    }
+    return -1;
+}
+
+static float emptyScene(uint32_t) { return 0; }
+
+// Walking at 140 cm/s towards a wall 450 cm away; within 100 cm 2.5 s
+// after setting off
+static uint32_t approachUs;
+static float approachScene(uint32_t us) {
+    if (us < approachUs) return 450;
+    float cm = 450 - 0.14f * ((us - approachUs) / 1000.0f);
+    return cm > 20 ? cm : 20;
+}
+#define APPROACH_TO_100_US 2500000
+
+// Someone steps in 80 cm ahead of an empty scene
+static uint32_t stepInUs;
+static float stepInScene(uint32_t us) { return us >= stepInUs ? 80 : 0; }
+
+// Mean and worst delay until a packet reports the obstacle, over 50
+// phases of the obstacle against the sampling period
+#define PHASES 50
+
+static int reaction(Scene scene, uint32_t* at, uint32_t fromUs, uint32_t afterUs, uint16_t cm,
+                    uint32_t fixedMs, double* mean, double* worst) {
+    double sum = 0;
+    *worst = 0;
+    for (int k = 0; k < PHASES; k++) {
+        *at = fromUs + k * 5013;
+        Run run = simulate(scene, *at + afterUs + 1000000, fixedMs);
+        double ms = reactionMs(run, *at + afterUs, cm);
+        CHECK(ms >= 0);
+        sum += ms;
+        if (ms > *worst) *worst = ms;
+    }
+    *mean = sum / PHASES;
+    return 0;
+}
+
+static int testRegimes() {
+    const uint32_t emptyUs = 60000000, walkUs = 3000000;
+    static const struct { const char* name; uint32_t fixedMs; } modes[] = {
+        { "fixed", SAMPLE_RATE },
+        { "fastest", SAMPLE_INTERVAL_MIN },
+        { "adaptive", 0 },
+    };
+
+    for (auto& m : modes) {
+        double mean, worst;
+
+        Run empty = simulate(emptyScene, emptyUs, m.fixedMs);
+        std::printf("REGIME empty %s %.1f Hz %.2f mW\n", m.name,
+                    empty.packets.size() * 1e6 / emptyUs, powerMw(empty, emptyUs));
+
+        approachUs = 0;
+        Run walk = simulate(approachScene, walkUs, m.fixedMs);
+        CHECK(reaction(approachScene, &approachUs, 1000000, APPROACH_TO_100_US, 100,
+                       m.fixedMs, &mean, &worst) == 0);
+        std::printf("REGIME approach %s %.1f Hz %.2f mW reaction %.1f ms (max %.1f)\n", m.name,
+                    walk.packets.size() * 1e6 / walkUs, powerMw(walk, walkUs), mean, worst);
+
+        CHECK(reaction(stepInScene, &stepInUs, 10000000, 0, 80, m.fixedMs, &mean, &worst) == 0);
+        std::printf("REGIME step_in %s reaction %.1f ms (max %.1f)\n", m.name, mean, worst);
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    struct { const char* name; int (*run)(); } cases[] = {
+        { "proximity", testProximity },
+        { "closing", testClosing },
+        { "backoff", testBackoff },
+        { "jump", testJump },
+        { "jitter", testJitter },
+        { "regimes", testRegimes },
+    };
+
+    int failures = 0;
+    for (auto& c : cases) {
+        if (argc > 1 && std::strcmp(argv[1], c.name) != 0) continue;
+        int result = c.run();
+        std::printf("%s %s\n", result == 0 ? "PASS" : "FAIL", c.name);
+        failures += result;
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,253 @@
+// Host harness for SendGate. Run with a case name; exits non-zero on
+// failure and prints the reason.
+
+#include "send_gate.h"
+#include "sample_rate.h"
+#include <haptic_level.h>
+
+#include <cstdio>
+#include <cstring>
+
+#define CHECK(cond) do { if (!(cond)) { \
+    std::printf("FAIL %s:%d %s\n", __FILE__, __LINE__, #cond); return 1; } } while (0)
+
+static SensorScan makeScan(uint16_t d0, uint16_t d1 = DISTANCE_NO_SENSOR, uint8_t count = 1) {
+    SensorScan scan;
+    memset(&scan, 0, sizeof(scan));
+    scan.count = count;
+    scan.distance[0] = d0;
+    scan.distance[1] = d1;
+    scan.nearest = d0;
+    scan.inRange = d0 < MAX_DISTANCE;
+    return scan;
+}
+
+// ================= Cases =================
+
+static int testLevels() {
+    CHECK(hapticLevel(MAX_DISTANCE) == 0);
+    CHECK(hapticLevel(101) == 0);
+    CHECK(hapticLevel(100) == 1);
+    CHECK(hapticLevel(61) == 2);
+    CHECK(hapticLevel(20) == HAPTIC_LEVELS);
+    CHECK(hapticLevel(0) == HAPTIC_LEVELS);
+    return 0;
+}
+
+// Crossing a band is sent at once, however small the step
+static int testLevelCross() {
+    SendGate gate;
+    gate.setDelta(50);
+    gate.setHeartbeat(10000);
+    CHECK(gate.shouldSend(0, makeScan(102)));
+    CHECK(!gate.shouldSend(25, makeScan(101)));
+    CHECK(gate.shouldSend(50, makeScan(100)));
+    CHECK(!gate.shouldSend(75, makeScan(99)));
+    CHECK(gate.shouldSend(100, makeScan(101)));
+    GateStats stats = gate.getStats();
+    CHECK(stats.sent == 3 && stats.skipped == 2 && stats.levelChanges == 2 && stats.heartbeats == 0);
+    return 0;
+}
+
+// Within a band, changes are measured from what was last sent
+static int testDelta() {
+    SendGate gate;
+    gate.setDelta(10);
+    gate.setHeartbeat(10000);
+    CHECK(gate.shouldSend(0, makeScan(250)));
+    CHECK(!gate.shouldSend(25, makeScan(255)));
+    CHECK(!gate.shouldSend(50, makeScan(259)));
+    // A slow drift still adds up
+    CHECK(gate.shouldSend(75, makeScan(260)));
+    CHECK(!gate.shouldSend(100, makeScan(251)));
+    CHECK(gate.shouldSend(125, makeScan(250)));
+    return 0;
+}
+
+// A static scene is still sent every heartbeat
+static int testHeartbeat() {
+    SendGate gate;
+    gate.setDelta(10);
+    gate.setHeartbeat(1000);
+    CHECK(gate.shouldSend(0, makeScan(150)));
+    uint32_t sent = 1;
+    for (uint32_t t = 200; t <= 5000; t += 200) {
+        if (gate.shouldSend(t, makeScan(150))) {
+            CHECK(t % 1000 == 0);
+            sent++;
+        }
+    }
+    CHECK(sent == 6);
+    CHECK(gate.getStats().heartbeats == 5);
+    // The clock wrapping does not stall it
+    SendGate wrap;
+    wrap.setHeartbeat(1000);
+    wrap.setDelta(10);
+    CHECK(wrap.shouldSend(0xFFFFFF00UL, makeScan(150)));
+    CHECK(!wrap.shouldSend(0xFFFFFFF0UL, makeScan(150)));
+    CHECK(wrap.shouldSend(0x300, makeScan(150)));
+    return 0;
+}
+
+// A sensor dropping out, coming back, or the count changing is sent
+// A send ESP-NOW reports undelivered is retried on the next scan, even
+// one the receiver would otherwise already know
+static int testFailed() {
+    SendGate gate;
+    gate.setDelta(50);
+    gate.setHeartbeat(1000);
+    CHECK(gate.shouldSend(0, makeScan(150)));
+    CHECK(gate.shouldSend(50, makeScan(90)));
+    gate.noteFailed();
+    CHECK(gate.shouldSend(100, makeScan(90)));
+    CHECK(!gate.shouldSend(150, makeScan(90)));
+    // The retry restarts the heartbeat
+    CHECK(!gate.shouldSend(1050, makeScan(90)));
+    CHECK(gate.shouldSend(1100, makeScan(90)));
+    GateStats stats = gate.getStats();
+    CHECK(stats.sent == 4 && stats.failed == 1 && stats.skipped == 2 && stats.heartbeats == 1);
+    return 0;
+}
+
+static int testSensors() {
+    SendGate gate;
+    gate.setDelta(10);
+    gate.setHeartbeat(10000);
+    CHECK(gate.shouldSend(0, makeScan(200, 300, 2)));
+    CHECK(!gate.shouldSend(25, makeScan(200, 300, 2)));
+    CHECK(gate.shouldSend(50, makeScan(200, DISTANCE_NO_SENSOR, 2)));
+    CHECK(!gate.shouldSend(75, makeScan(200, DISTANCE_NO_SENSOR, 2)));
+    CHECK(gate.shouldSend(100, makeScan(200, 300, 2)));
+    CHECK(gate.shouldSend(125, makeScan(200, 300, 3)));
+    CHECK(gate.shouldSend(150, makeScan(200)));
+    return 0;
+}
+
+// A delta of 0 sends every scan
+static int testDisabled() {
+    SendGate gate;
+    gate.setDelta(0);
+    gate.setHeartbeat(0);
+    for (uint32_t t = 0; t < 1000; t += 25) CHECK(gate.shouldSend(t, makeScan(150)));
+    CHECK(gate.getStats().skipped == 0);
+    return 0;
+}
+
+// ================= Walking traces =================
+
+// Transmit current and airtime of one ESP-NOW packet with its ACK
+#define TX_CURRENT_MA 170
+#define TX_TIME_US 1000
+#define SUPPLY_MV 3300
+#define TRACE_MS 60000
+
+static uint32_t seed = 12345;
+
+// Filtered readings still wander by a centimetre or two
+static int jitter() {
+    seed = seed * 1103515245u + 12345u;
+    return (int)((seed >> 16) % 5) - 2;
+}
+
+// Obstacle distance at t, or MAX_DISTANCE when nothing is in range
+static float traceDistance(const char* name, uint32_t t) {
+    if (std::strcmp(name, "clear") == 0) return MAX_DISTANCE;
+    // Waiting at a counter, mid-band
+    if (std::strcmp(name, "standing") == 0) return 70;
+    if (std::strcmp(name, "crossing") == 0) {
+        // Someone steps across the corridor 150 cm ahead every 5 s
+        return t % 5000 < 800 ? 150 : MAX_DISTANCE;
+    }
+    // Walk up to a wall at 120 cm/s, stand 3 s, turn away for 4 s
+    uint32_t phase = t % 10000;
+    if (phase < 2500) return 350 - 0.12f * phase;
+    if (phase < 5500) return 50;
+    return MAX_DISTANCE;
+}
+
+typedef struct {
+    uint32_t scans;
+    uint32_t sent;
+    uint32_t heartbeats;
+    uint32_t maxGapMs;
+    uint32_t motorWrites;
+    uint32_t lateLevels;            // Scans whose level the receiver had not been sent
+} TraceResult;
+
+static TraceResult runTrace(const char* name, bool onChange) {
+    TraceResult result;
+    memset(&result, 0, sizeof(result));
+    SampleRate rate;
+    SendGate gate;
+    gate.setDelta(onChange ? SEND_DELTA : 0);
+    gate.setHeartbeat(onChange ? HEARTBEAT_INTERVAL : 0);
+    seed = 12345;
+
+    uint32_t lastSentMs = 0;
+    uint8_t receiverLevel = 0;
+    for (uint32_t t = 0; t < TRACE_MS; t += rate.getIntervalMs()) {
+        float d = traceDistance(name, t);
+        bool inRange = d < MAX_DISTANCE;
+        uint16_t cm = inRange ? (uint16_t)(d + jitter()) : MAX_DISTANCE;
+        rate.update(t, cm, inRange);
+        result.scans++;
+
+        if (gate.shouldSend(t, makeScan(cm))) {
+            if (result.sent > 0 && t - lastSentMs > result.maxGapMs) result.maxGapMs = t - lastSentMs;
+            lastSentMs = t;
+            result.sent++;
+            // The receiver used to write every motor pin per packet
+            if (!onChange) result.motorWrites += HAPTIC_LEVELS;
+            else if (hapticLevel(cm) != receiverLevel) result.motorWrites += HAPTIC_LEVELS;
+            receiverLevel = hapticLevel(cm);
+        }
+        if (receiverLevel != hapticLevel(cm)) result.lateLevels++;
+    }
+    result.heartbeats = gate.getStats().heartbeats;
+    return result;
+}
+
+static int testTraces() {
+    const char* traces[] = { "clear", "wall", "crossing", "standing" };
+    for (const char* name : traces) {
+        TraceResult every = runTrace(name, false);
+        TraceResult change = runTrace(name, true);
+        CHECK(every.sent == every.scans);
+        CHECK(change.sent <= every.sent);
+        CHECK(change.lateLevels == 0);
+        CHECK(change.maxGapMs <= HEARTBEAT_INTERVAL + SAMPLE_INTERVAL_MAX);
+
+        const TraceResult* runs[] = { &every, &change };
+        for (const TraceResult* run : runs) {
+            double perMin = run->sent * 60000.0 / TRACE_MS;
+            double mJ = perMin * TX_CURRENT_MA * SUPPLY_MV * TX_TIME_US / 1e9;
+            std::printf("TRACE %s %s %.0f packets/min %.1f mJ/min heartbeats %u max gap %u ms "
+                        "motor writes %u\n",
+                        name, run == &every ? "every" : "change", perMin, mJ,
+                        (unsigned)run->heartbeats, (unsigned)run->maxGapMs, (unsigned)run->motorWrites);
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    struct { const char* name; int (*run)(); } cases[] = {
+        { "levels", testLevels },
+        { "level_cross", testLevelCross },
+        { "delta", testDelta },
+        { "heartbeat", testHeartbeat },
+        { "failed", testFailed },
+        { "sensors", testSensors },
+        { "disabled", testDisabled },
+        { "traces", testTraces },
+    };
+
+    int failures = 0;
+    for (auto& c : cases) {
+        if (argc > 1 && std::strcmp(argv[1], c.name) != 0) continue;
+        int result = c.run();
+        std::printf("%s %s\n", result == 0 ? "PASS" : "FAIL", c.name);
+        failures += result;
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,372 @@
+// Host harness for SensorArray. Run with a case name; exits non-zero on
+// failure and prints the reason.
+
+#include "sensor_array.h"
+
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <vector>
+
+#define CHECK(cond) do { if (!(cond)) { \
+    std::printf("FAIL %s:%d %s\n", __FILE__, __LINE__, #cond); return 1; } } while (0)
+
+// ================= Acoustics =================
+
+// HC-SR04 timing as in echo_capture_test.cpp
+#define BURST_US 460
+#define NO_ECHO_HOLD_US 38000
+#define LOOP_US 50
+
+// What each sensor hears: the echo of its own burst from the nearest
+// obstacle ahead of it, bursts of neighbouring sensors reflected into
+// it, and the late echo of every burst off a far wall.
+struct Scene {
+    float own[SENSOR_MAX];                  // cm, 0 for none
+    float cross[SENSOR_MAX][SENSOR_MAX];    // Half the path from one sensor's burst to another, 0 for none
+    float reverb;                           // Half the late echo's path, 0 for none
+};
+
+static uint32_t roundTripUs(float cm) {
+    return (uint32_t)(2 * cm / SPEED_OF_SOUND);
+}
+
+struct Burst {
+    uint32_t us;
+    uint8_t sensor;
+};
+
+// Sensors driven by the array and the echoes they hear
+struct Acoustics {
+    const Scene* scene;
+    EchoCapture sensors[SENSOR_MAX];
+    uint8_t count;
+    std::vector<Burst> bursts;
+    bool rising[SENSOR_MAX];
+    bool high[SENSOR_MAX];
+    uint32_t riseAt[SENSOR_MAX];
+    std::vector<uint8_t> fired;             // Sensor per trigger, in order
+    std::vector<uint32_t> firedUs;
+
+    Acoustics(const Scene* scene, uint8_t count) : scene(scene), count(count) {
+        memset(rising, 0, sizeof(rising));
+        memset(high, 0, sizeof(high));
+        memset(riseAt, 0, sizeof(riseAt));
+    }
+
+    bool fire(uint8_t s, uint32_t nowUs) {
+        if (rising[s] || high[s] || !sensors[s].ready(nowUs)) return false;
+        sensors[s].arm(nowUs);
+        rising[s] = true;
+        riseAt[s] = nowUs + BURST_US;
+        bursts.push_back({ nowUs + BURST_US, s });
+        fired.push_back(s);
+        firedUs.push_back(nowUs);
+        return true;
+    }
+
+    // First sound reaching sensor s after its line rose
+    uint32_t fallAt(uint8_t s) const {
+        uint32_t first = riseAt[s] + NO_ECHO_HOLD_US;
+        for (const Burst& b : bursts) {
+            float paths[2] = { b.sensor == s ? scene->own[s] : scene->cross[b.sensor][s], scene->reverb };
+            for (float cm : paths) {
+                if (cm <= 0) continue;
+                uint32_t at = b.us + roundTripUs(cm);
+                if ((int32_t)(at - riseAt[s]) > 0 && (int32_t)(at - first) < 0) first = at;
+            }
+        }
+        return first;
+    }
+
+    void step(uint32_t t) {
+        for (uint8_t s = 0; s < count; s++) {
+            if (rising[s] && t >= riseAt[s]) {
+                sensors[s].onEdge(true, riseAt[s]);
+                rising[s] = false;
+                high[s] = true;
+            }
+            if (high[s]) {
+                uint32_t fall = fallAt(s);
+                if (t >= fall) {
+                    sensors[s].onEdge(false, fall);
+                    high[s] = false;
+                }
+            }
+        }
+        while (!bursts.empty() && (int32_t)(t - bursts.front().us) > 2 * NO_ECHO_HOLD_US) {
+            bursts.erase(bursts.begin());
+        }
+    }
+};
+
+static bool fireSensor(uint8_t sensor, uint32_t nowUs, void* context) {
+    return static_cast<Acoustics*>(context)->fire(sensor, nowUs);
+}
+
+// Centre, left, right and low sensors: nothing in range to the right,
+// the ground ahead of the low one. Left and right face apart and never
+// hear each other.
+static const Scene CORRIDOR = {
+    { 150, 80, 0, 60 },
+    {
+        { 0, 110, 180, 70 },
+        { 110, 0, 0, 90 },
+        { 180, 0, 0, 0 },
+        { 70, 90, 0, 0 },
+    },
+    520,
+};
+
+// The same sensors with nothing but their own echoes
+static const Scene QUIET = {
+    { 150, 80, 0, 60 },
+    { { 0 } },
+    0,
+};
+
+static uint16_t expected(const Scene& scene, uint8_t s) {
+    if (scene.own[s] <= 0 || scene.own[s] > MAX_DISTANCE) return MAX_DISTANCE;
+    return EchoCapture::toDistanceCm(roundTripUs(scene.own[s]));
+}
+
+// Scans back to back for durationUs, one raw ping per sensor unless a
+// burst and filter window are given; 0 keeps the array's own
+struct ScanRun {
+    uint32_t scans;
+    uint32_t readings;
+    uint32_t wrong;                         // Off by more than 2 cm
+    uint32_t maxScanUs;
+    uint64_t totalScanUs;
+};
+
+static ScanRun scanFor(const Scene& scene, uint8_t count, const uint8_t* slots, uint32_t staggerUs,
+                       uint32_t durationUs, Acoustics** keep = NULL, uint8_t burst = 1,
+                       uint8_t window = 1) {
+    Acoustics* acoustics = new Acoustics(&scene, count);
+    SensorArray array(acoustics->sensors, count, fireSensor, acoustics);
+    if (slots) array.setSlots(slots);
+    array.setStagger(staggerUs);
+    if (burst) array.setBurst(burst);
+    if (window) array.setFilterWindow(window);
+
+    ScanRun run;
+    memset(&run, 0, sizeof(run));
+    for (uint32_t t = 0; t < durationUs; t += LOOP_US) {
+        acoustics->step(t);
+        array.start(t);
+        SensorScan scan;
+        if (!array.poll(t, &scan)) continue;
+        run.scans++;
+        run.totalScanUs += scan.scanUs;
+        if (scan.scanUs > run.maxScanUs) run.maxScanUs = scan.scanUs;
+        for (uint8_t s = 0; s < count; s++) {
+            run.readings++;
+            if (std::abs((int)scan.distance[s] - (int)expected(scene, s)) > 2) run.wrong++;
+        }
+    }
+    if (keep) *keep = acoustics;
+    else delete acoustics;
+    return run;
+}
+
+// ================= Cases =================
+
+static const uint8_t ROUND_ROBIN[SENSOR_MAX] = { 0, 1, 2, 3 };
+static const uint8_t INTERLEAVED[SENSOR_MAX] = { 0, 1, 1, 2 };    // Left and right together
+static const uint8_t TOGETHER[SENSOR_MAX] = { 0, 0, 0, 0 };
+
+// One sensor at a time, SENSOR_STAGGER apart or after the last result,
+// every distance in one scan
+static int testRoundRobin() {
+    Acoustics* acoustics;
+    ScanRun run = scanFor(QUIET, 4, ROUND_ROBIN, SENSOR_STAGGER, 1000000, &acoustics);
+    CHECK(run.scans > 5 && run.wrong == 0);
+    CHECK(acoustics->fired.size() >= 4);
+    for (size_t i = 0; i < acoustics->fired.size(); i++) CHECK(acoustics->fired[i] == i % 4);
+
+    for (size_t i = 1; i < acoustics->fired.size(); i++) {
+        uint8_t previous = acoustics->fired[i - 1];
+        uint32_t result = acoustics->firedUs[i - 1] + BURST_US +
+                          (QUIET.own[previous] > 0 ? roundTripUs(QUIET.own[previous]) : TIMEOUT_DURATION);
+        uint32_t due = acoustics->firedUs[i - 1] + SENSOR_STAGGER;
+        if ((int32_t)(result - due) > 0) due = result;
+        CHECK(acoustics->firedUs[i] >= due);
+        CHECK(acoustics->firedUs[i] - due <= 2 * LOOP_US);
+    }
+    delete acoustics;
+    return 0;
+}
+
+static int testInterleaved() {
+    Acoustics* acoustics;
+    ScanRun run = scanFor(QUIET, 4, INTERLEAVED, SENSOR_STAGGER, 1000000, &acoustics);
+    CHECK(run.scans > 5 && run.wrong == 0);
+    // Left and right fire on the same pass
+    CHECK(acoustics->fired[1] == 1 && acoustics->fired[2] == 2);
+    CHECK(acoustics->firedUs[1] == acoustics->firedUs[2]);
+    CHECK(acoustics->fired[3] == 3);
+    delete acoustics;
+
+    ScanRun robin = scanFor(QUIET, 4, ROUND_ROBIN, SENSOR_STAGGER, 1000000);
+    CHECK(run.scans > robin.scans);
+    return 0;
+}
+
+// A missing sensor does not hold up the others
+static int testMissing() {
+    Scene scene = QUIET;
+    Acoustics acoustics(&scene, 2);
+    SensorArray array(acoustics.sensors, 2, fireSensor, &acoustics);
+    array.setSlots(ROUND_ROBIN);
+    array.setBurst(1);
+
+    SensorScan scan;
+    bool done = false;
+    CHECK(array.start(0));
+    CHECK(!array.start(0));
+    for (uint32_t t = 0; t < 200000 && !done; t += LOOP_US) {
+        // Sensor 0 never raises its line
+        if (acoustics.rising[0]) acoustics.rising[0] = false;
+        acoustics.step(t);
+        done = array.poll(t, &scan);
+    }
+    CHECK(done);
+    CHECK(scan.count == 2);
+    CHECK(scan.distance[0] == DISTANCE_NO_SENSOR);
+    CHECK(scan.distance[1] == expected(scene, 1));
+    CHECK(scan.inRange && scan.nearest == scan.distance[1]);
+    return 0;
+}
+
+// A sensor still holding its line after a miss defers its slot
+static int testDeferred() {
+    Scene scene = QUIET;
+    Acoustics acoustics(&scene, 1);
+    SensorArray array(acoustics.sensors, 1, fireSensor, &acoustics);
+    array.setStagger(0);
+    array.setBurst(1);
+
+    SensorScan scan;
+    uint32_t t = 0, scans = 0, first = 0, second = 0;
+    scene.own[0] = 0;                       // Nothing in range: the line holds for 38 ms
+    for (; t < 200000 && scans < 2; t += LOOP_US) {
+        acoustics.step(t);
+        array.start(t);
+        if (array.poll(t, &scan)) {
+            scans++;
+            CHECK(!scan.inRange && scan.nearest == MAX_DISTANCE);
+        }
+        if (acoustics.fired.size() == 1 && !first) first = acoustics.firedUs[0];
+        if (acoustics.fired.size() == 2 && !second) second = acoustics.firedUs[1];
+    }
+    CHECK(scans == 2);
+    CHECK(second - first >= BURST_US + NO_ECHO_HOLD_US);
+    CHECK(array.getStats().deferred == 1);
+    return 0;
+}
+
+// Each scan pings every sensor PING_BURST times, pass after pass, and
+// reports the filtered distance
+static int testBurst() {
+    Acoustics* acoustics;
+    ScanRun run = scanFor(QUIET, 2, ROUND_ROBIN, SENSOR_STAGGER, 1000000, &acoustics, PING_BURST,
+                          FILTER_WINDOW);
+    CHECK(run.scans > 2 && run.wrong == 0);
+    CHECK(acoustics->fired.size() >= 2 * PING_BURST * run.scans);
+    for (size_t i = 0; i < acoustics->fired.size(); i++) CHECK(acoustics->fired[i] == i % 2);
+    delete acoustics;
+
+    // By default an array pings each sensor once per scan and its filters
+    // span scans; only a lone sensor bursts
+    run = scanFor(QUIET, 2, ROUND_ROBIN, SENSOR_STAGGER, 1000000, &acoustics, 0, 0);
+    CHECK(run.scans > 2 && run.wrong == 0);
+    CHECK(acoustics->fired.size() <= 2 * (run.scans + 1));
+    delete acoustics;
+    run = scanFor(QUIET, 1, NULL, SENSOR_STAGGER, 1000000, &acoustics, 0, 0);
+    CHECK(run.scans > 2 && run.wrong == 0);
+    CHECK(acoustics->fired.size() >= (FILTER_ENABLED ? PING_BURST : 1) * run.scans);
+    delete acoustics;
+
+    // The ring-down of a sensor with something right in front of it is
+    // never reported, and a missing sensor reads no sensor
+    Scene scene = QUIET;
+    scene.own[0] = 1;
+    Acoustics near(&scene, 2);
+    SensorArray array(near.sensors, 2, fireSensor, &near);
+    array.setSlots(ROUND_ROBIN);
+    array.setBurst(PING_BURST);
+    SensorScan scan;
+    bool done = false;
+    array.start(0);
+    for (uint32_t t = 0; t < 1000000 && !done; t += LOOP_US) {
+        if (near.rising[1]) near.rising[1] = false;
+        near.step(t);
+        done = array.poll(t, &scan);
+    }
+    CHECK(done);
+    CHECK(near.fired.size() == 2 * PING_BURST);
+    CHECK(scan.distance[0] == DISTANCE_NO_SENSOR && scan.confidence[0] == 0);
+    CHECK(scan.distance[1] == DISTANCE_NO_SENSOR && scan.confidence[1] == 0);
+    CHECK(array.getFilter(0).getStats().rejected == PING_BURST);
+    return 0;
+}
+
+// Scan period and wrong readings by schedule and stagger, in a corridor
+// whose late echoes reach every sensor
+static int testCrosstalk() {
+    static const struct { const char* name; const uint8_t* slots; } schedules[] = {
+        { "together", TOGETHER },
+        { "interleaved", INTERLEAVED },
+        { "round_robin", ROUND_ROBIN },
+    };
+    static const uint32_t staggers[] = { 0, 10000, 20000, 30000, 40000 };
+
+    for (auto& s : schedules) {
+        for (uint32_t stagger : staggers) {
+            if (s.slots == TOGETHER && stagger) continue;
+            ScanRun run = scanFor(CORRIDOR, 4, s.slots, stagger, 10000000);
+            CHECK(run.scans > 0);
+            std::printf("SCHEDULE %s stagger %u us scan %.1f ms (max %.1f) %.1f Hz wrong %.1f%%\n",
+                        s.name, (unsigned)stagger, run.totalScanUs / 1000.0 / run.scans,
+                        run.maxScanUs / 1000.0, run.scans / 10.0, 100.0 * run.wrong / run.readings);
+        }
+    }
+
+    // The shipped configuration: the array's own burst and filter window
+    for (auto& s : schedules) {
+        if (s.slots == TOGETHER) continue;
+        ScanRun run = scanFor(CORRIDOR, 4, s.slots, SENSOR_STAGGER, 10000000, NULL, 0, 0);
+        CHECK(run.scans > 0);
+        std::printf("SCHEDULE %s_filtered stagger %u us scan %.1f ms (max %.1f) %.1f Hz wrong %.1f%%\n",
+                    s.name, (unsigned)SENSOR_STAGGER, run.totalScanUs / 1000.0 / run.scans,
+                    run.maxScanUs / 1000.0, run.scans / 10.0, 100.0 * run.wrong / run.readings);
+    }
+
+    // One sensor, as before the array
+    ScanRun single = scanFor(CORRIDOR, 1, NULL, SENSOR_STAGGER, 10000000);
+    std::printf("SCHEDULE single stagger %u us scan %.1f ms (max %.1f) %.1f Hz wrong %.1f%%\n",
+                (unsigned)SENSOR_STAGGER, single.totalScanUs / 1000.0 / single.scans,
+                single.maxScanUs / 1000.0, single.scans / 10.0, 100.0 * single.wrong / single.readings);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    struct { const char* name; int (*run)(); } cases[] = {
+        { "round_robin", testRoundRobin },
+        { "interleaved", testInterleaved },
+        { "missing", testMissing },
+        { "deferred", testDeferred },
+        { "burst", testBurst },
+        { "crosstalk", testCrosstalk },
+    };
+
+    int failures = 0;
+    for (auto& c : cases) {
+        if (argc > 1 && std::strcmp(argv[1], c.name) != 0) continue;
+        int result = c.run();
+        std::printf("%s %s\n", result == 0 ? "PASS" : "FAIL", c.name);
+        failures += result;
+    }
+    return failures == 0 ? 0 : 1;
+}
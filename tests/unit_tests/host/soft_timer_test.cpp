@@ -0,0 +1,305 @@
+// Host harness for TimerService, driven by a virtual clock. Run with a
+// case name; exits non-zero on failure and prints the reason.
+
+#include "soft_timer.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#define CHECK(cond) do { if (!(cond)) { \
+    std::printf("FAIL %s:%d %s\n", __FILE__, __LINE__, #cond); return 1; } } while (0)
+
+static uint32_t virtualNow = 0;
+static uint32_t virtualClock() { return virtualNow; }
+
+// Records when a timer fired
+struct Probe {
+    SoftTimer timer;
+    uint32_t due;
+    uint32_t firedAt;
+    uint32_t fires;
+    bool early;
+
+    Probe() : timer(onFire, this), due(0), firedAt(0), fires(0), early(false) {}
+
+    static void onFire(void* context) {
+        Probe* p = static_cast<Probe*>(context);
+        if ((int32_t)(virtualNow - p->due) < 0) p->early = true;
+        p->firedAt = virtualNow;
+        p->fires++;
+    }
+};
+
+static int testOneShotExact() {
+    const uint32_t delays[] = {
+        0, 1, 2, 63, 64, 65, 127, 128, 4095, 4096, 4097, 65535,
+        262143, 262144, 262145, 600000
+    };
+    const size_t count = sizeof(delays) / sizeof(delays[0]);
+
+    for (uint32_t base : { 0u, 37u, 4095u, 0xFFFFF000u }) {
+        virtualNow = base;
+        TimerService service;
+        service.begin(virtualClock);
+
+        std::vector<Probe> probes(count);
+        for (size_t i = 0; i < count; i++) {
+            probes[i].due = base + delays[i];
+            service.start(probes[i].timer, delays[i]);
+        }
+        CHECK(service.getStats().active == count);
+
+        // One millisecond at a time, so every timer must fire on its tick
+        // (a zero delay fires on the next tick)
+        for (uint32_t t = 1; t <= 600001; t++) {
+            virtualNow = base + t;
+            service.advance();
+        }
+        for (size_t i = 0; i < count; i++) {
+            uint32_t expected = base + (delays[i] ? delays[i] : 1);
+            if (probes[i].fires != 1 || probes[i].firedAt != expected) {
+                std::printf("base %u delay %u fired %u times at %u, expected %u\n",
+                            base, delays[i], probes[i].fires, probes[i].firedAt, expected);
+                return 1;
+            }
+        }
+        CHECK(service.getStats().active == 0);
+    }
+    return 0;
+}
+
+// Random starts, stops and clock jumps against a brute-force model: each
+// timer fires exactly once, at the first advance at or after its expiry.
+static int testRandomAgainstModel() {
+    std::mt19937 rng(1234);
+    virtualNow = 0x7FFFF000;
+    TimerService service;
+    service.begin(virtualClock);
+
+    const int timers = 2000;
+    std::vector<Probe> probes(timers);
+    std::vector<bool> armed(timers, false);
+
+    for (int step = 0; step < 20000; step++) {
+        int i = rng() % timers;
+        switch (rng() % 4) {
+            case 0:
+            case 1: {
+                uint32_t delay = rng() % 3 == 0 ? rng() % 700000 : rng() % 5000;
+                probes[i].due = virtualNow + (delay ? delay : 1);
+                probes[i].fires = 0;
+                service.start(probes[i].timer, delay);
+                armed[i] = true;
+                break;
+            }
+            case 2:
+                service.stop(probes[i].timer);
+                armed[i] = false;
+                break;
+            default: {
+                virtualNow += rng() % 3 == 0 ? rng() % 20000 : rng() % 50;
+                service.advance();
+                for (int k = 0; k < timers; k++) {
+                    if (!armed[k]) continue;
+                    if ((int32_t)(virtualNow - probes[k].due) >= 0) {
+                        CHECK(probes[k].fires == 1);
+                        CHECK(!probes[k].early);
+                        armed[k] = false;
+                    } else {
+                        CHECK(probes[k].fires == 0);
+                        CHECK(probes[k].timer.isActive());
+                    }
+                }
+                break;
+            }
+        }
+    }
+
+    uint32_t active = 0;
+    for (int k = 0; k < timers; k++) active += armed[k];
+    CHECK(service.getStats().active == active);
+    return 0;
+}
+
+static int testPeriodic() {
+    virtualNow = 1000;
+    TimerService service;
+    service.begin(virtualClock);
+
+    Probe probe;
+    probe.due = 1010;
+    service.start(probe.timer, 10, 10);
+    for (uint32_t t = 1001; t <= 2000; t++) {
+        virtualNow = t;
+        service.advance();
+        if (probe.fires) probe.due = 1010 + probe.fires * 10;
+    }
+    CHECK(probe.fires == 100);
+    CHECK(!probe.early);
+    CHECK(probe.timer.isActive());
+
+    // A late advance keeps the phase when less than a period behind...
+    virtualNow = 2015;
+    service.advance();
+    CHECK(probe.fires == 101);
+    CHECK(probe.timer.getExpiry() == 2020);
+
+    // ...and skips ahead when it fell further behind
+    virtualNow = 2100;
+    service.advance();
+    CHECK(probe.timer.getExpiry() == 2110);
+
+    service.stop(probe.timer);
+    uint32_t fires = probe.fires;
+    virtualNow = 3000;
+    service.advance();
+    CHECK(probe.fires == fires);
+    return 0;
+}
+
+// Callbacks may stop and restart timers, including ones in the same slot
+static TimerService* reentrantService;
+static SoftTimer* victim;
+static int victimFires = 0;
+static int restarts = 0;
+
+static void onVictim(void*) { victimFires++; }
+static void onStopper(void*) { reentrantService->stop(*victim); }
+static void onRestarter(void* context) {
+    if (++restarts < 5) reentrantService->start(*static_cast<SoftTimer*>(context), 3);
+}
+
+static int testReentrant() {
+    virtualNow = 0;
+    TimerService service;
+    service.begin(virtualClock);
+    reentrantService = &service;
+
+    SoftTimer stopper(onStopper);
+    SoftTimer target(onVictim);
+    victim = &target;
+    service.start(target, 20);
+    service.start(stopper, 20);     // Same slot, fires first (LIFO)
+
+    SoftTimer restarter(onRestarter, &restarter);
+    service.start(restarter, 3);
+
+    for (uint32_t t = 1; t <= 100; t++) {
+        virtualNow = t;
+        service.advance();
+    }
+    CHECK(victimFires == 0);
+    CHECK(restarts == 5);
+    CHECK(service.getStats().active == 0);
+    return 0;
+}
+
+static int testMsUntilNext() {
+    std::mt19937 rng(99);
+    virtualNow = 5000;
+    TimerService service;
+    service.begin(virtualClock);
+    CHECK(service.msUntilNext() == UINT32_MAX);
+
+    std::vector<Probe> probes(200);
+    for (int round = 0; round < 500; round++) {
+        int i = rng() % probes.size();
+        uint32_t delay = rng() % 2 ? rng() % 64 : rng() % 400000;
+        probes[i].due = virtualNow + (delay ? delay : 1);
+        service.start(probes[i].timer, delay);
+
+        // Never later than the true next expiry. Each early wake is a
+        // cascade (one more for a timer parked beyond the horizon).
+        Probe* next = NULL;
+        uint32_t active = 0;
+        for (Probe& p : probes) {
+            if (!p.timer.isActive()) continue;
+            active++;
+            if (!next || (int32_t)(p.due - next->due) < 0) next = &p;
+        }
+        uint32_t fires = next->fires;
+        int sleeps = 0;
+        while (next->fires == fires) {
+            uint32_t until = service.msUntilNext();
+            CHECK(until <= next->due - virtualNow);
+            virtualNow += until;
+            service.advance();
+            CHECK(++sleeps <= (int)(active * (TIMER_WHEEL_LEVELS + 1)));
+        }
+        for (Probe& p : probes) CHECK(!p.early);
+    }
+    return 0;
+}
+
+static int testMsUntilNextExact() {
+    // With only level 0 occupied the answer is exact
+    virtualNow = 100;
+    TimerService service;
+    service.begin(virtualClock);
+
+    Probe a, b;
+    service.start(a.timer, 40);
+    service.start(b.timer, 7);
+    CHECK(service.msUntilNext() == 7);
+    virtualNow = 103;
+    CHECK(service.msUntilNext() == 4);
+    virtualNow = 107;
+    service.advance();
+    CHECK(b.fires == 1);
+    CHECK(service.msUntilNext() == 33);
+    return 0;
+}
+
+static uint32_t wakes = 0;
+static void onWake() { wakes++; }
+
+static int testEvents() {
+    virtualNow = 0;
+    TimerService service;
+    service.begin(virtualClock);
+    service.setWakeHandler(onWake);
+
+    SoftTimer imu(0x01);
+    SoftTimer web(0x04);
+    service.start(imu, 10, 10);
+    service.start(web, 25);
+
+    service.postEvent(0x80);
+    CHECK(wakes == 1);
+    CHECK(service.takeEvents() == 0x80);
+    CHECK(service.takeEvents() == 0);
+
+    virtualNow = 10;
+    service.advance();
+    CHECK(service.takeEvents() == 0x01);
+    virtualNow = 30;
+    service.advance();
+    CHECK(service.takeEvents() == 0x05);
+    CHECK(wakes == 5);
+    CHECK(service.getStats().fired == 4);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    struct { const char* name; int (*run)(); } cases[] = {
+        { "one_shot_exact", testOneShotExact },
+        { "random_against_model", testRandomAgainstModel },
+        { "periodic", testPeriodic },
+        { "reentrant", testReentrant },
+        { "ms_until_next", testMsUntilNext },
+        { "ms_until_next_exact", testMsUntilNextExact },
+        { "events", testEvents },
+    };
+
+    int failures = 0;
+    for (auto& c : cases) {
+        if (argc > 1 && std::strcmp(argv[1], c.name) != 0) continue;
+        int result = c.run();
+        std::printf("%s %s\n", result == 0 ? "PASS" : "FAIL", c.name);
+        failures += result;
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,269 @@
+// Host harness for the state broadcast packet. Run with a case name;
+// exits non-zero on failure and prints the reason. "packet" prints a
+// sample packet in hex for the Python listener to decode.
+
+#include "state_broadcast.h"
+#include "json_stream.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+#define CHECK(cond) do { if (!(cond)) { \
+    std::printf("FAIL %s:%d %s\n", __FILE__, __LINE__, #cond); return 1; } } while (0)
+
+static StateSnapshot sample() {
+    StateSnapshot s;
+    s.flags = STATE_FLAG_GPS_FIX | STATE_FLAG_ALERT;
+    s.sequence = 0;
+    s.uptimeMs = 123456;
+    s.latitudeE6 = 12840600;
+    s.longitudeE6 = -80153400;
+    s.lastFallS = 98;
+    s.version = 0xDEADBEEFUL;
+    s.falls = 3;
+    s.batteryLevel = 76;
+    s.wifiClients = 2;
+    return s;
+}
+
+static int testLayout() {
+    StateSnapshot s = sample();
+    s.sequence = 0x01020304UL;
+    uint8_t p[STATE_PACKET_SIZE];
+    CHECK(encodeStatePacket(s, p) == STATE_PACKET_SIZE);
+    CHECK(p[0] == 'D' && p[1] == 'S' && p[2] == STATE_PACKET_VERSION);
+    CHECK(p[3] == (STATE_FLAG_GPS_FIX | STATE_FLAG_ALERT));
+    CHECK(p[4] == 0x04 && p[7] == 0x01);
+    CHECK(p[8] == 0x40 && p[9] == 0xE2 && p[10] == 0x01);     // 123456
+    CHECK(p[24] == 0xEF && p[27] == 0xDE);
+    CHECK(p[28] == 3 && p[29] == 0 && p[30] == 76 && p[31] == 2);
+    return 0;
+}
+
+static int testRoundTrip() {
+    StateSnapshot s = sample();
+    s.lastFallS = STATE_NO_FALL;
+    uint8_t p[STATE_PACKET_SIZE + 4];
+    encodeStatePacket(s, p);
+
+    StateSnapshot d;
+    CHECK(decodeStatePacket(p, STATE_PACKET_SIZE, d));
+    CHECK(d.flags == s.flags && d.uptimeMs == s.uptimeMs);
+    CHECK(d.latitudeE6 == s.latitudeE6 && d.longitudeE6 == s.longitudeE6);
+    CHECK(d.lastFallS == STATE_NO_FALL && d.version == s.version);
+    CHECK(d.falls == 3 && d.batteryLevel == 76 && d.wifiClients == 2);
+
+    // A longer packet from a later version still decodes
+    p[2] = STATE_PACKET_VERSION + 1;
+    CHECK(decodeStatePacket(p, sizeof(p), d));
+
+    CHECK(!decodeStatePacket(p, STATE_PACKET_SIZE - 1, d));
+    p[0] = 'X';
+    CHECK(!decodeStatePacket(p, STATE_PACKET_SIZE, d));
+    return 0;
+}
+
+static int testUrgent() {
+    StateBroadcaster broadcaster;
+    StateSnapshot s = sample();
+
+    broadcaster.prepare(s, false);
+    CHECK(s.sequence == 1 && !(s.flags & STATE_FLAG_URGENT));
+    CHECK(!broadcaster.takeRepeat());
+
+    s = sample();
+    broadcaster.prepare(s, true);
+    CHECK(s.sequence == 2 && (s.flags & STATE_FLAG_URGENT));
+    StateSnapshot d;
+    CHECK(decodeStatePacket(broadcaster.getPacket(), STATE_PACKET_SIZE, d));
+    CHECK(d.sequence == 2 && (d.flags & STATE_FLAG_URGENT));
+    for (int i = 0; i < STATE_URGENT_REPEATS; i++) CHECK(broadcaster.takeRepeat());
+    CHECK(!broadcaster.takeRepeat());
+
+    // An interval packet waits for pending copies; a newer urgent one
+    // replaces them
+    s = sample();
+    broadcaster.prepare(s, true);
+    CHECK(broadcaster.takeRepeat());
+    s = sample();
+    CHECK(broadcaster.prepare(s, false) == NULL);
+    CHECK(broadcaster.getSequence() == 3);
+    s = sample();
+    broadcaster.prepare(s, true);
+    CHECK(s.sequence == 4);
+    for (int i = 0; i < STATE_URGENT_REPEATS; i++) CHECK(broadcaster.takeRepeat());
+    CHECK(!broadcaster.takeRepeat());
+    s = sample();
+    CHECK(broadcaster.prepare(s, false) != NULL && s.sequence == 5);
+
+    broadcaster.noteSent(true, 120);
+    broadcaster.noteSent(false, 0);
+    BroadcastStats stats = broadcaster.getStats();
+    CHECK(stats.sent == 1 && stats.failed == 1 && stats.urgent == 3 && stats.deferred == 1);
+    CHECK(stats.repeats == 2 * STATE_URGENT_REPEATS + 1 && stats.bytes == STATE_PACKET_SIZE);
+    return 0;
+}
+
+// The interval timer and the repeat timer run independently, as on the
+// controller. Wherever the fall lands in the interval, every copy goes
+// out and sequence numbers on the air never go backwards.
+static int testInterleave() {
+    const uint32_t windowMs = STATE_URGENT_REPEATS * STATE_URGENT_REPEAT_MS;
+    uint32_t cutShort = 0;
+    for (uint32_t fallMs = 0; fallMs < STATE_BROADCAST_INTERVAL_MS; fallMs += 10) {
+        StateBroadcaster broadcaster;
+        uint32_t lastOnAir = 0;
+        uint32_t copies = 0;
+        uint32_t intervalSent = 0;
+        bool repeating = false;
+        uint32_t nextRepeatMs = 0;
+
+        for (uint32_t t = 0; t <= 3 * STATE_BROADCAST_INTERVAL_MS; t++) {
+            StateSnapshot s = sample();
+            const uint8_t* sent = NULL;
+            if (t == STATE_BROADCAST_INTERVAL_MS + fallMs) {
+                sent = broadcaster.prepare(s, true);
+                repeating = true;
+                nextRepeatMs = t + STATE_URGENT_REPEAT_MS;
+            }
+            if (t % STATE_BROADCAST_INTERVAL_MS == 0 && !sent) {
+                sent = broadcaster.prepare(s, false);
+                if (sent) intervalSent++;
+            }
+            if (repeating && t == nextRepeatMs) {
+                // The controller stops the repeat timer once no copy is left
+                if (broadcaster.takeRepeat()) {
+                    sent = broadcaster.getPacket();
+                    copies++;
+                    nextRepeatMs += STATE_URGENT_REPEAT_MS;
+                } else {
+                    repeating = false;
+                }
+            }
+            if (sent) {
+                StateSnapshot d;
+                CHECK(decodeStatePacket(sent, STATE_PACKET_SIZE, d));
+                CHECK(d.sequence >= lastOnAir);
+                lastOnAir = d.sequence;
+            }
+        }
+        CHECK(copies == STATE_URGENT_REPEATS);
+        // Only an interval tick inside the repeat window (or at the fall
+        // itself, whose packet it would duplicate) is skipped
+        uint32_t ticks = 4;
+        bool tickInWindow = fallMs == 0 || fallMs + windowMs >= STATE_BROADCAST_INTERVAL_MS;
+        CHECK(intervalSent == ticks - (tickInWindow ? 1 : 0));
+        if (tickInWindow) cutShort++;
+    }
+    std::printf("%u of %u fall phases had an interval tick during the repeats\n",
+                (unsigned)cutShort, (unsigned)(STATE_BROADCAST_INTERVAL_MS / 10));
+    return 0;
+}
+
+static int printPacket() {
+    StateBroadcaster broadcaster;
+    StateSnapshot s = sample();
+    const uint8_t* p = broadcaster.prepare(s, true);
+    for (int i = 0; i < STATE_PACKET_SIZE; i++) std::printf("%02x", p[i]);
+    std::printf("\n");
+    return 0;
+}
+
+// ================= Benchmark =================
+
+static size_t bodyBytes = 0;
+static void countBytes(const char*, size_t length, void*) { bodyBytes += length; }
+
+// The /dashboard body, as each polling caregiver gets it
+static void writeDashboard(JsonStream& json, const StateSnapshot& s) {
+    json.beginObject();
+    json.unsignedField("v", s.version);
+    json.beginObject("gps");
+    json.key("latitude");
+    json.scaledValue(s.latitudeE6, 6);
+    json.key("longitude");
+    json.scaledValue(s.longitudeE6, 6);
+    json.stringField("fallTime", "00:01:38");
+    json.end();
+    json.beginObject("status");
+    json.stringField("status", "critical");
+    json.beginObject("sensors");
+    json.stringField("mpu6050", "active");
+    json.stringField("gps", "active");
+    json.stringField("wifi", "active");
+    json.stringField("fallDetection", "alert");
+    json.end();
+    json.unsignedField("batteryLevel", s.batteryLevel);
+    json.unsignedField("wifiClients", s.wifiClients);
+    json.end();
+    json.beginObject("sensors");
+    json.stringField("motion", "Active");
+    json.stringField("fallState", "alert");
+    json.unsignedField("falls", s.falls);
+    json.stringField("lastFallTime", "00:01:38");
+    json.end();
+    json.end();
+}
+
+// Request line and headers from a browser plus response headers and chunk
+// framing; TCP/IP headers, handshakes and ACKs come on top
+#define HTTP_OVERHEAD_BYTES 400
+// UDP, IP and 802.11 headers of one broadcast frame
+#define UDP_OVERHEAD_BYTES 60
+
+static int testBenchmark() {
+    const int rounds = 100000;
+    StateSnapshot s = sample();
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+        JsonStream json(countBytes, NULL);
+        s.falls = i & 0xFF;
+        writeDashboard(json, s);
+        json.finish();
+    }
+    double jsonUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / rounds;
+    size_t body = bodyBytes / rounds;
+
+    StateBroadcaster broadcaster;
+    volatile uint8_t sink = 0;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++) {
+        StateSnapshot t = s;
+        t.falls = i & 0xFF;
+        sink ^= broadcaster.prepare(t, false)[4];
+    }
+    double packetUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / rounds;
+
+    std::printf("per update: dashboard body %zu B in %.3f us, packet %d B in %.3f us\n",
+                body, jsonUs, STATE_PACKET_SIZE, packetUs);
+    std::printf("listeners  http bytes/s  http us/s  broadcast bytes/s  broadcast us/s\n");
+    for (int n = 1; n <= WIFI_MAX_CLIENTS; n++) {
+        std::printf("%9d  %12zu  %9.2f  %17d  %14.3f\n", n, n * (body + HTTP_OVERHEAD_BYTES), n * jsonUs,
+                    STATE_PACKET_SIZE + UDP_OVERHEAD_BYTES, packetUs);
+    }
+    CHECK(packetUs < jsonUs);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    struct { const char* name; int (*run)(); } cases[] = {
+        { "layout", testLayout },
+        { "round_trip", testRoundTrip },
+        { "urgent", testUrgent },
+        { "interleave", testInterleave },
+        { "packet", printPacket },
+        { "benchmark", testBenchmark },
+    };
+
+    int failures = 0;
+    for (auto& c : cases) {
+        if (argc > 1 && std::strcmp(argv[1], c.name) != 0) continue;
+        if (argc == 1 && std::strcmp(c.name, "packet") == 0) continue;
+        int result = c.run();
+        std::printf("%s %s\n", result == 0 ? "PASS" : "FAIL", c.name);
+        failures += result;
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,559 @@
+// Host harness for the telemetry uplink: MQTT session framing against
+// scripted broker bytes, batch encoding, and a one-hour comparison of
+// batched and per-sample publishing. Run with a case name; exits non-zero
+// on failure and prints the reason. "batch" prints an encoded batch in
+// hex for the Python decoder; "broker <host> <port>" publishes one to a
+// real broker.
+
+#include "telemetry_export.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#define CHECK(cond) do { if (!(cond)) { \
+    std::printf("FAIL %s:%d %s\n", __FILE__, __LINE__, #cond); return 1; } } while (0)
+
+// Everything the session sends, packet by packet
+struct Wire {
+    std::vector<uint8_t> bytes;
+    uint32_t packets;
+    bool fail;
+    Wire() : packets(0), fail(false) {}
+};
+
+static bool wireSend(const uint8_t* data, size_t length, void* context) {
+    Wire& w = *static_cast<Wire*>(context);
+    if (w.fail) return false;
+    w.bytes.insert(w.bytes.end(), data, data + length);
+    w.packets++;
+    return true;
+}
+
+static const uint8_t CONNACK_OK[] = { 0x20, 0x02, 0x00, 0x00 };
+static const uint8_t PINGRESP[] = { 0xD0, 0x00 };
+
+static void feedPuback(MqttSession& mqtt, uint16_t id, uint32_t nowMs) {
+    const uint8_t ack[] = { 0x40, 0x02, (uint8_t)(id >> 8), (uint8_t)id };
+    mqtt.receive(ack, sizeof(ack), nowMs);
+}
+
+static void connected(MqttSession& mqtt, Wire& wire, uint16_t keepAliveS = 60) {
+    mqtt.begin(wireSend, &wire);
+    mqtt.connect("drishti-0a0b0c", keepAliveS, 0);
+    mqtt.receive(CONNACK_OK, sizeof(CONNACK_OK), 10);
+    wire.bytes.clear();
+}
+
+static int testConnect() {
+    Wire wire;
+    MqttSession mqtt;
+    mqtt.begin(wireSend, &wire);
+    CHECK(mqtt.getState() == MQTT_DISCONNECTED);
+    CHECK(mqtt.publish("t", (const uint8_t*)"x", 1, 0) == 0);
+
+    CHECK(mqtt.connect("dev1", 60, 0));
+    static const uint8_t expected[] = {
+        0x10, 16, 0x00, 0x04, 'M', 'Q', 'T', 'T', 0x04, 0x02, 0x00, 60, 0x00, 0x04, 'd', 'e', 'v', '1'
+    };
+    CHECK(wire.bytes.size() == sizeof(expected));
+    CHECK(std::memcmp(wire.bytes.data(), expected, sizeof(expected)) == 0);
+    CHECK(mqtt.getState() == MQTT_CONNECTING && !mqtt.isReady());
+
+    mqtt.receive(CONNACK_OK, sizeof(CONNACK_OK), 5);
+    CHECK(mqtt.getState() == MQTT_CONNECTED && mqtt.isReady());
+    CHECK(mqtt.getStats().connects == 1);
+
+    // Refused: bad credentials, unavailable server...
+    const uint8_t refused[] = { 0x20, 0x02, 0x00, 0x05 };
+    mqtt.connect("dev1", 60, 100);
+    mqtt.receive(refused, sizeof(refused), 105);
+    CHECK(mqtt.getState() == MQTT_DISCONNECTED && mqtt.getStats().refused == 1);
+
+    // No CONNACK at all
+    mqtt.connect("dev1", 60, 1000);
+    CHECK(mqtt.poll(1000 + MQTT_CONNECT_TIMEOUT_MS));
+    CHECK(!mqtt.poll(1001 + MQTT_CONNECT_TIMEOUT_MS));
+    CHECK(mqtt.getState() == MQTT_DISCONNECTED && mqtt.getStats().timeouts == 1);
+
+    wire.fail = true;
+    CHECK(!mqtt.connect("dev1", 60, 2000));
+    CHECK(mqtt.getState() == MQTT_DISCONNECTED);
+    return 0;
+}
+
+static int testPublish() {
+    Wire wire;
+    MqttSession mqtt;
+    connected(mqtt, wire);
+
+    const uint8_t payload[] = { 1, 2, 3 };
+    uint16_t id = mqtt.publish("a/b", payload, sizeof(payload), 100);
+    CHECK(id == 1);
+    static const uint8_t expected[] = { 0x32, 10, 0x00, 0x03, 'a', '/', 'b', 0x00, 0x01, 1, 2, 3 };
+    CHECK(wire.bytes.size() == sizeof(expected));
+    CHECK(std::memcmp(wire.bytes.data(), expected, sizeof(expected)) == 0);
+    CHECK(MqttSession::publishSize(3, 3) == sizeof(expected));
+
+    // One in flight: backpressure until the broker acknowledges
+    CHECK(!mqtt.isReady());
+    CHECK(mqtt.publish("a/b", payload, sizeof(payload), 110) == 0);
+
+    // A PUBACK for another id changes nothing
+    feedPuback(mqtt, 7, 150);
+    CHECK(mqtt.takeAcked() == 0 && !mqtt.isReady());
+
+    // Split across reads, with a PINGRESP in front
+    uint8_t stream[] = { 0xD0, 0x00, 0x40, 0x02, 0x00, 0x01 };
+    for (size_t i = 0; i < sizeof(stream); i++) mqtt.receive(stream + i, 1, 200);
+    CHECK(mqtt.takeAcked() == 1);
+    CHECK(mqtt.takeAcked() == 0);
+    CHECK(mqtt.isReady());
+    CHECK(mqtt.getStats().acks == 1 && mqtt.getStats().lastAckMs == 100);
+
+    // Remaining length past 127 takes two bytes
+    std::vector<uint8_t> big(300, 0xAB);
+    wire.bytes.clear();
+    CHECK(mqtt.publish("a/b", big.data(), big.size(), 300) == 2);
+    CHECK(wire.bytes.size() == MqttSession::publishSize(3, 300));
+    CHECK(wire.bytes[1] == (((2 + 3 + 2 + 300) & 0x7F) | 0x80) && wire.bytes[2] == 2);
+
+    // Unknown packets (a SUBACK, a PUBLISH) are skipped whole
+    const uint8_t other[] = { 0x90, 0x03, 0x00, 0x01, 0x00, 0x30, 0x03, 0x00, 0x01, 'x', 0x40, 0x02, 0x00, 0x02 };
+    mqtt.receive(other, sizeof(other), 350);
+    CHECK(mqtt.takeAcked() == 2);
+
+    CHECK(mqtt.publish(std::string(MQTT_TOPIC_MAX + 1, 't').c_str(), payload, 1, 400) == 0);
+    return 0;
+}
+
+static int testKeepalive() {
+    Wire wire;
+    MqttSession mqtt;
+    connected(mqtt, wire, 10);
+
+    CHECK(mqtt.poll(9000) && wire.bytes.empty());
+    CHECK(mqtt.poll(10000));
+    CHECK(wire.bytes.size() == 2 && wire.bytes[0] == 0xC0);
+    CHECK(mqtt.getStats().pings == 1);
+    mqtt.receive(PINGRESP, sizeof(PINGRESP), 10100);
+
+    // Publishing counts as activity
+    wire.bytes.clear();
+    uint16_t id = mqtt.publish("t", (const uint8_t*)"x", 1, 15000);
+    feedPuback(mqtt, id, 15050);
+    CHECK(mqtt.poll(24000) && mqtt.getStats().pings == 1);
+    CHECK(mqtt.poll(25000) && mqtt.getStats().pings == 2);
+
+    // No PINGRESP: the connection is dead
+    CHECK(mqtt.poll(25000 + MQTT_ACK_TIMEOUT_MS));
+    CHECK(!mqtt.poll(25001 + MQTT_ACK_TIMEOUT_MS));
+    CHECK(mqtt.getStats().timeouts == 1 && mqtt.getState() == MQTT_DISCONNECTED);
+
+    // No PUBACK either
+    connected(mqtt, wire, 10);
+    mqtt.publish("t", (const uint8_t*)"x", 1, 20000);
+    CHECK(!mqtt.poll(20001 + MQTT_ACK_TIMEOUT_MS));
+    CHECK(mqtt.getStats().timeouts == 2);
+
+    // A reconnect starts clean
+    connected(mqtt, wire, 10);
+    CHECK(mqtt.isReady());
+    return 0;
+}
+
+// ================= Batches =================
+
+static TelemetryRecord summaryRecord(uint16_t boot, uint32_t uptimeS, uint8_t battery, uint8_t flags,
+                                     uint16_t activeS, uint16_t falls) {
+    TelemetrySummary s;
+    std::memset(&s, 0, sizeof(s));
+    s.boot = boot;
+    s.uptimeS = uptimeS;
+    s.batteryLevel = battery;
+    s.flags = flags;
+    s.activeS = activeS;
+    s.falls = falls;
+    TelemetryRecord r;
+    r.type = TELEMETRY_SUMMARY;
+    r.length = sizeof(s);
+    std::memcpy(r.data, &s, sizeof(s));
+    return r;
+}
+
+static TelemetryRecord pointRecord(uint8_t type, uint16_t boot, uint32_t uptimeS, int32_t lat, int32_t lon) {
+    TelemetryPoint p;
+    std::memset(&p, 0, sizeof(p));
+    p.boot = boot;
+    p.uptimeS = uptimeS;
+    p.latitudeE6 = lat;
+    p.longitudeE6 = lon;
+    TelemetryRecord r;
+    r.type = type;
+    r.length = sizeof(p);
+    std::memcpy(r.data, &p, sizeof(p));
+    return r;
+}
+
+// A walk with a fall, a summary and a reboot, as the decoder test expects
+static void buildSample(TelemetryBatch& batch) {
+    batch.reset();
+    batch.add(pointRecord(TELEMETRY_TRACK, 7, 100000, 12840600, 80153400));
+    batch.add(pointRecord(TELEMETRY_TRACK, 7, 100010, 12840650, 80153380));
+    batch.add(pointRecord(TELEMETRY_FALL, 7, 100013, 12840652, 80153371));
+    batch.add(summaryRecord(7, 100060, 76, TELEMETRY_FLAG_GPS_FIX | TELEMETRY_FLAG_ALERT, 41, 3));
+    batch.add(pointRecord(TELEMETRY_TRACK, 8, 5, -33868800, 151209300));
+}
+
+static int testBatch() {
+    TelemetryBatch batch;
+    CHECK(batch.getLength() == 1 && batch.getData()[0] == TELEMETRY_BATCH_VERSION);
+    buildSample(batch);
+    CHECK(batch.getCount() == 5);
+
+    const uint8_t* d = batch.getData();
+    // First record: absolute track point, varint boot and uptime
+    CHECK(d[1] == (TELEMETRY_TRACK | TELEMETRY_TAG_ABSOLUTE) && d[2] == 7);
+    CHECK(d[3] == (0xA0 | 0x80) && d[4] == (0x8D | 0x80) && d[5] == 0x06);    // 100000
+    // Second: 10 s later, +50/-20 micro-degrees in three bytes
+    size_t second = 1 + 1 + 1 + 3 + 4 + 4;
+    CHECK(d[second] == TELEMETRY_TRACK && d[second + 1] == 10);
+    CHECK(d[second + 2] == 100 && d[second + 3] == 39);
+
+    // Records other than the first cost a few bytes instead of 16 raw
+    CHECK(batch.getLength() < 5 * 8);
+
+    // Unknown types and stale layouts are skipped, not encoded
+    TelemetryRecord odd = pointRecord(9, 7, 1, 0, 0);
+    size_t length = batch.getLength();
+    CHECK(batch.add(odd) && batch.getLength() == length && batch.getCount() == 5);
+    odd = pointRecord(TELEMETRY_TRACK, 7, 1, 0, 0);
+    odd.length = 10;
+    CHECK(batch.add(odd) && batch.getLength() == length);
+
+    // Filling up: add() refuses a record that does not fit, whole
+    batch.reset();
+    uint32_t added = 0;
+    for (;;) {
+        int32_t jitter = (int32_t)(added * 7919 % 100000);
+        if (!batch.add(pointRecord(TELEMETRY_TRACK, 1, 10 * added, jitter, -jitter))) break;
+        added++;
+    }
+    CHECK(added > 0 && batch.getLength() <= TELEMETRY_BATCH_BYTES);
+    CHECK(batch.getLength() > TELEMETRY_BATCH_BYTES - 16);
+    CHECK(batch.getCount() == added);
+    return 0;
+}
+
+static void printHex(const uint8_t* data, size_t length) {
+    for (size_t i = 0; i < length; i++) std::printf("%02x", data[i]);
+    std::printf("\n");
+}
+
+// ================= Benchmark =================
+
+// Per segment: IPv4 and TCP headers, no options. Each MQTT packet is
+// counted as one segment; pure ACKs are left out for both strategies.
+#define TCPIP_OVERHEAD 40
+#define PUBACK_SIZE 4
+#define PING_SIZE 2
+
+struct Traffic {
+    uint32_t publishes;
+    uint32_t records;
+    uint32_t pings;
+    uint64_t bytes;                 // Both directions, with TCP/IP
+    uint64_t payloadBytes;
+    double encodeUs;
+};
+
+// Simulated TCP/MQTT link: every PUBLISH is acknowledged and every ping
+// answered at once
+struct Link {
+    Wire wire;
+    MqttSession mqtt;
+    Traffic traffic;
+    uint32_t lastPings;
+
+    Link() : lastPings(0) {
+        std::memset(&traffic, 0, sizeof(traffic));
+        connected(mqtt, wire, MQTT_KEEPALIVE_S);
+    }
+
+    void publish(const char* topic, const uint8_t* payload, size_t length, uint32_t records, uint32_t nowMs) {
+        uint16_t id = mqtt.publish(topic, payload, length, nowMs);
+        feedPuback(mqtt, id, nowMs);
+        mqtt.takeAcked();
+        traffic.publishes++;
+        traffic.records += records;
+        traffic.payloadBytes += length;
+        traffic.bytes += MqttSession::publishSize(std::strlen(topic), length) + PUBACK_SIZE + 2 * TCPIP_OVERHEAD;
+    }
+
+    void tick(uint32_t nowMs) {
+        mqtt.poll(nowMs);
+        if (mqtt.getStats().pings != lastPings) {
+            lastPings = mqtt.getStats().pings;
+            mqtt.receive(PINGRESP, sizeof(PINGRESP), nowMs);
+            traffic.pings++;
+            traffic.bytes += 2 * (PING_SIZE + TCPIP_OVERHEAD);
+        }
+    }
+};
+
+struct Sample {
+    uint32_t atS;
+    TelemetryRecord record;
+};
+
+// One hour of a walk: a track point every TELEMETRY_TRACK_INTERVAL_S, a
+// summary every TELEMETRY_SUMMARY_MS, two falls
+static std::vector<Sample> hourOfSamples() {
+    std::vector<Sample> samples;
+    int32_t lat = 12840600, lon = 80153400;
+    uint32_t falls = 0;
+    for (uint32_t t = 1; t <= 3600; t++) {
+        if (t % TELEMETRY_TRACK_INTERVAL_S == 0) {
+            lat += (int32_t)(t * 2654435761UL % 61) - 20;     // ~1 m/s, wandering
+            lon += (int32_t)(t * 40503UL % 61) - 30;
+            Sample s = { t, pointRecord(TELEMETRY_TRACK, 3, t, lat, lon) };
+            samples.push_back(s);
+        }
+        if (t == 1234 || t == 2718) {
+            falls++;
+            Sample s = { t, pointRecord(TELEMETRY_FALL, 3, t, lat, lon) };
+            samples.push_back(s);
+        }
+        if (t % (TELEMETRY_SUMMARY_MS / 1000) == 0) {
+            Sample s = { t, summaryRecord(3, t, (uint8_t)(90 - t / 400), TELEMETRY_FLAG_GPS_FIX,
+                                          (uint16_t)(40 + t % 17), (uint16_t)falls) };
+            samples.push_back(s);
+        }
+    }
+    return samples;
+}
+
+// What a per-sample uplink publishes: one JSON document per record
+static size_t sampleJson(const TelemetryRecord& r, char* out, size_t size) {
+    if (r.type == TELEMETRY_SUMMARY) {
+        TelemetrySummary s;
+        std::memcpy(&s, r.data, sizeof(s));
+        return std::snprintf(out, size, "{\"type\":\"summary\",\"boot\":%u,\"uptime\":%u,\"batteryLevel\":%u,"
+                             "\"flags\":%u,\"activeS\":%u,\"falls\":%u}",
+                             s.boot, s.uptimeS, s.batteryLevel, s.flags, s.activeS, s.falls);
+    }
+    TelemetryPoint p;
+    std::memcpy(&p, r.data, sizeof(p));
+    return std::snprintf(out, size, "{\"type\":\"%s\",\"boot\":%u,\"uptime\":%u,\"latitude\":\"%.6f\",\"longitude\":\"%.6f\"}",
+                         r.type == TELEMETRY_FALL ? "fall" : "track", p.boot, p.uptimeS,
+                         p.latitudeE6 / 1e6, p.longitudeE6 / 1e6);
+}
+
+static const char* TOPIC = MQTT_TOPIC_PREFIX "/0a0b0c0d0e0f/telemetry";
+
+static Traffic runPerSample(const std::vector<Sample>& samples) {
+    Link link;
+    size_t next = 0;
+    char json[192];
+    for (uint32_t t = 1; t <= 3600; t++) {
+        while (next < samples.size() && samples[next].atS == t) {
+            size_t n = sampleJson(samples[next].record, json, sizeof(json));
+            link.publish(TOPIC, (const uint8_t*)json, n, 1, t * 1000);
+            next++;
+        }
+        link.tick(t * 1000);
+    }
+    return link.traffic;
+}
+
+static bool ramRead(uint32_t address, void* out, size_t length, void* context) {
+    std::memcpy(out, static_cast<uint8_t*>(context) + address, length);
+    return true;
+}
+
+static bool ramWrite(uint32_t address, const void* data, size_t length, void* context) {
+    uint8_t* p = static_cast<uint8_t*>(context) + address;
+    for (size_t i = 0; i < length; i++) p[i] &= static_cast<const uint8_t*>(data)[i];
+    return true;
+}
+
+static bool ramErase(uint16_t sector, void* context) {
+    std::memset(static_cast<uint8_t*>(context) + (size_t)sector * TELEMETRY_SECTOR_SIZE, 0xFF, TELEMETRY_SECTOR_SIZE);
+    return true;
+}
+
+// The exporter's policy: queue every record in flash, publish when a
+// batch fills, a fall is waiting or the oldest record has waited
+// TELEMETRY_FLUSH_MS; mark sent on PUBACK
+static Traffic runBatched(const std::vector<Sample>& samples, uint32_t& maxPending) {
+    static uint8_t flashBytes[8 * TELEMETRY_SECTOR_SIZE];
+    std::memset(flashBytes, 0xFF, sizeof(flashBytes));
+    FlashStorage flash = { ramRead, ramWrite, ramErase, flashBytes, 8 };
+    TelemetryQueue queue;
+    queue.begin(flash);
+
+    Link link;
+    TelemetryBatch batch;
+    static TelemetryRecord records[TELEMETRY_BATCH_RECORDS];
+    size_t next = 0;
+    bool urgent = false;
+    uint32_t pendingSinceS = 0;
+    double encodeUs = 0;
+    maxPending = 0;
+
+    for (uint32_t t = 1; t <= 3600; t++) {
+        while (next < samples.size() && samples[next].atS == t) {
+            const TelemetryRecord& r = samples[next].record;
+            if (queue.getPending() == 0) pendingSinceS = t;
+            queue.push(r.type, r.data, r.length);
+            if (r.type == TELEMETRY_FALL) urgent = true;
+            next++;
+        }
+        if (queue.getPending() > maxPending) maxPending = queue.getPending();
+
+        bool due = queue.getPending() >= TELEMETRY_BATCH_RECORDS || urgent ||
+                   (t - pendingSinceS) * 1000 >= TELEMETRY_FLUSH_MS;
+        while (queue.getPending() > 0 && (due || t == 3600)) {
+            auto start = std::chrono::steady_clock::now();
+            QueueCursor end;
+            uint8_t n = queue.peek(records, TELEMETRY_BATCH_RECORDS, (size_t)-1, end);
+            batch.reset();
+            uint8_t taken = 0;
+            while (taken < n && batch.add(records[taken])) taken++;
+            if (taken < n) queue.peek(records, taken, (size_t)-1, end);
+            encodeUs += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+            link.publish(TOPIC, batch.getData(), batch.getLength(), taken, t * 1000);
+            queue.markSent(end);
+            pendingSinceS = t;
+            urgent = false;
+            due = queue.getPending() >= TELEMETRY_BATCH_RECORDS;
+        }
+        link.tick(t * 1000);
+    }
+    link.traffic.encodeUs = link.traffic.publishes ? encodeUs / link.traffic.publishes : 0;
+    return link.traffic;
+}
+
+static int runBenchmark() {
+    std::vector<Sample> samples = hourOfSamples();
+    uint32_t maxPending;
+    Traffic single = runPerSample(samples);
+    Traffic batched = runBatched(samples, maxPending);
+    CHECK(single.records == samples.size() && batched.records == samples.size());
+
+    std::printf("one hour: %u records (track every %u s, summary every %u s, 2 falls)\n",
+                (unsigned)samples.size(), (unsigned)TELEMETRY_TRACK_INTERVAL_S,
+                (unsigned)(TELEMETRY_SUMMARY_MS / 1000));
+    std::printf("%-12s %9s %12s %7s %13s %12s\n", "strategy", "publishes", "records/pub", "pings",
+                "payload B/h", "wire B/h");
+    const struct { const char* name; const Traffic* t; } rows[] = {
+        { "per-sample", &single }, { "batched", &batched },
+    };
+    for (auto& r : rows) {
+        std::printf("%-12s %9u %12.1f %7u %13llu %12llu\n", r.name, r.t->publishes,
+                    (double)r.t->records / r.t->publishes, r.t->pings,
+                    (unsigned long long)r.t->payloadBytes, (unsigned long long)r.t->bytes);
+    }
+    std::printf("batched: %.1fx fewer publishes, %.1fx fewer bytes; at most %u records queued; "
+                "%.2f us to read and encode a batch\n",
+                (double)single.publishes / batched.publishes, (double)single.bytes / batched.bytes,
+                maxPending, batched.encodeUs);
+    std::printf("(wire bytes: MQTT packets, PUBACKs and pings with %u bytes of TCP/IP each)\n",
+                (unsigned)TCPIP_OVERHEAD);
+
+    CHECK(batched.publishes * 5 <= single.publishes);
+    CHECK(batched.bytes * 3 <= single.bytes);
+    return 0;
+}
+
+// ================= Broker =================
+
+static bool socketSend(const uint8_t* data, size_t length, void* context) {
+    int fd = *static_cast<int*>(context);
+    while (length > 0) {
+        ssize_t n = send(fd, data, length, 0);
+        if (n <= 0) return false;
+        data += n;
+        length -= n;
+    }
+    return true;
+}
+
+static uint32_t wallMs() {
+    using namespace std::chrono;
+    return (uint32_t)duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+// Connects, publishes the sample batch with QoS 1 and waits for PUBACK
+static int runBroker(const char* host, const char* port, const char* topic) {
+    addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* addr = NULL;
+    CHECK(getaddrinfo(host, port, &hints, &addr) == 0);
+    int fd = socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol);
+    CHECK(fd >= 0);
+    CHECK(connect(fd, addr->ai_addr, addr->ai_addrlen) == 0);
+    freeaddrinfo(addr);
+    timeval timeout = { 0, 100000 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    MqttSession mqtt;
+    mqtt.begin(socketSend, &fd);
+    CHECK(mqtt.connect("drishti-host-test", MQTT_KEEPALIVE_S, wallMs()));
+
+    TelemetryBatch batch;
+    buildSample(batch);
+    uint16_t id = 0;
+    bool acked = false;
+    uint32_t start = wallMs();
+    while (!acked && wallMs() - start < 5000) {
+        uint8_t buffer[64];
+        ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+        if (n > 0) mqtt.receive(buffer, n, wallMs());
+        CHECK(mqtt.poll(wallMs()));
+        if (!id && mqtt.isReady()) id = mqtt.publish(topic, batch.getData(), batch.getLength(), wallMs());
+        if (id && mqtt.takeAcked() == id) acked = true;
+    }
+    close(fd);
+    CHECK(acked);
+    std::printf("acked %u in %u ms\n", id, mqtt.getStats().lastAckMs);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1 && std::strcmp(argv[1], "batch") == 0) {
+        TelemetryBatch batch;
+        buildSample(batch);
+        printHex(batch.getData(), batch.getLength());
+        return 0;
+    }
+    if (argc > 3 && std::strcmp(argv[1], "broker") == 0) {
+        return runBroker(argv[2], argv[3], argc > 4 ? argv[4] : TOPIC);
+    }
+
+    struct { const char* name; int (*run)(); } cases[] = {
+        { "connect", testConnect },
+        { "publish", testPublish },
+        { "keepalive", testKeepalive },
+        { "batch_encode", testBatch },
+        { "benchmark", runBenchmark },
+    };
+
+    int failures = 0;
+    for (auto& c : cases) {
+        if (argc > 1 && std::strcmp(argv[1], c.name) != 0) continue;
+        int result = c.run();
+        std::printf("%s %s\n", result == 0 ? "PASS" : "FAIL", c.name);
+        failures += result;
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,266 @@
+// Host harness for TelemetryQueue on RAM that behaves like NOR flash.
+// Run with a case name; exits non-zero on failure and prints the reason.
+
+#include "telemetry_queue.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#define CHECK(cond) do { if (!(cond)) { \
+    std::printf("FAIL %s:%d %s\n", __FILE__, __LINE__, #cond); return 1; } } while (0)
+
+// Erase sets bytes to 0xFF, writes only clear bits; a write can be cut
+// short after a byte budget to emulate a reset mid-write
+struct RamFlash {
+    std::vector<uint8_t> bytes;
+    long writeBudget;
+    uint32_t erases;
+
+    explicit RamFlash(uint16_t sectors)
+        : bytes((size_t)sectors * TELEMETRY_SECTOR_SIZE, 0xFF), writeBudget(-1), erases(0) {}
+};
+
+static bool ramRead(uint32_t address, void* out, size_t length, void* context) {
+    RamFlash& f = *static_cast<RamFlash*>(context);
+    if (address + length > f.bytes.size()) return false;
+    std::memcpy(out, &f.bytes[address], length);
+    return true;
+}
+
+static bool ramWrite(uint32_t address, const void* data, size_t length, void* context) {
+    RamFlash& f = *static_cast<RamFlash*>(context);
+    if (address + length > f.bytes.size()) return false;
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < length; i++) {
+        if (f.writeBudget == 0) return false;
+        if (f.writeBudget > 0) f.writeBudget--;
+        f.bytes[address + i] &= p[i];
+    }
+    return true;
+}
+
+static bool ramErase(uint16_t sector, void* context) {
+    RamFlash& f = *static_cast<RamFlash*>(context);
+    std::memset(&f.bytes[(size_t)sector * TELEMETRY_SECTOR_SIZE], 0xFF, TELEMETRY_SECTOR_SIZE);
+    f.erases++;
+    return true;
+}
+
+static FlashStorage storageFor(RamFlash& flash) {
+    FlashStorage s = { ramRead, ramWrite, ramErase, &flash,
+                       (uint16_t)(flash.bytes.size() / TELEMETRY_SECTOR_SIZE) };
+    return s;
+}
+
+static void fill(uint8_t* data, uint8_t length, uint32_t n) {
+    for (uint8_t i = 0; i < length; i++) data[i] = (uint8_t)(n * 7 + i);
+}
+
+static bool pushNumbered(TelemetryQueue& q, uint32_t n, uint8_t length = 16) {
+    uint8_t data[TELEMETRY_RECORD_MAX];
+    fill(data, length, n);
+    std::memcpy(data, &n, sizeof(n));
+    return q.push((uint8_t)(1 + n % 3), data, length);
+}
+
+static uint32_t numberOf(const TelemetryRecord& r) {
+    uint32_t n;
+    std::memcpy(&n, r.data, sizeof(n));
+    return n;
+}
+
+static int testPushPeek() {
+    RamFlash flash(4);
+    TelemetryQueue q;
+    CHECK(q.begin(storageFor(flash)));
+    CHECK(q.isMounted() && q.getPending() == 0);
+
+    for (uint32_t n = 0; n < 10; n++) CHECK(pushNumbered(q, n));
+    CHECK(!q.push(1, "x", 0));
+    CHECK(!q.push(1, "x", TELEMETRY_RECORD_MAX + 1));
+    CHECK(q.getPending() == 10);
+
+    TelemetryRecord out[8];
+    QueueCursor next;
+    CHECK(q.peek(out, 4, 1000, next) == 4);
+    for (uint32_t n = 0; n < 4; n++) {
+        CHECK(numberOf(out[n]) == n && out[n].type == 1 + n % 3 && out[n].length == 16);
+        uint8_t expected[16];
+        fill(expected, 16, n);
+        CHECK(std::memcmp(out[n].data + 4, expected + 4, 12) == 0);
+    }
+
+    // Peeking again without markSent returns the same records
+    CHECK(q.peek(out, 8, 1000, next) == 8 && numberOf(out[0]) == 0);
+
+    // Payload budget: at least one record, then whole records only
+    CHECK(q.peek(out, 8, 40, next) == 2);
+    CHECK(q.peek(out, 8, 1, next) == 1);
+
+    q.peek(out, 4, 1000, next);
+    q.markSent(next);
+    CHECK(q.getPending() == 6);
+    CHECK(q.peek(out, 8, 1000, next) == 6 && numberOf(out[0]) == 4);
+    q.markSent(next);
+    CHECK(q.getPending() == 0);
+    CHECK(q.peek(out, 8, 1000, next) == 0);
+
+    const QueueStats& s = q.getStats();
+    CHECK(s.queued == 10 && s.sent == 10 && s.dropped == 0 && s.corrupt == 0);
+    return 0;
+}
+
+// Records span sectors and survive a reboot in order, sent ones excluded
+static int testReboot() {
+    RamFlash flash(4);
+    uint32_t perSector = (TELEMETRY_SECTOR_SIZE - 8) / (4 + 16);
+    uint32_t total = perSector * 2 + 5;
+    {
+        TelemetryQueue q;
+        CHECK(q.begin(storageFor(flash)));
+        for (uint32_t n = 0; n < total; n++) CHECK(pushNumbered(q, n));
+        TelemetryRecord out[TELEMETRY_BATCH_RECORDS];
+        QueueCursor next;
+        CHECK(q.peek(out, 50, 100000, next) == 50);
+        q.markSent(next);
+    }
+
+    TelemetryQueue q;
+    CHECK(q.begin(storageFor(flash)));
+    CHECK(q.getPending() == total - 50);
+    TelemetryRecord out[TELEMETRY_BATCH_RECORDS];
+    QueueCursor next;
+    uint32_t expected = 50;
+    while (q.getPending() > 0) {
+        uint8_t n = q.peek(out, TELEMETRY_BATCH_RECORDS, 100000, next);
+        CHECK(n > 0);
+        for (uint8_t i = 0; i < n; i++) CHECK(numberOf(out[i]) == expected++);
+        q.markSent(next);
+    }
+    CHECK(expected == total);
+
+    // New records continue after the old ones
+    CHECK(pushNumbered(q, 1000));
+    CHECK(q.peek(out, 8, 1000, next) == 1 && numberOf(out[0]) == 1000);
+    return 0;
+}
+
+// A reset mid-write leaves a torn record: it is skipped, and nothing is
+// appended after it in that sector
+static int testTornWrite() {
+    RamFlash flash(4);
+    {
+        TelemetryQueue q;
+        CHECK(q.begin(storageFor(flash)));
+        for (uint32_t n = 0; n < 3; n++) CHECK(pushNumbered(q, n));
+        flash.writeBudget = 9;      // Header and part of the payload
+        CHECK(!pushNumbered(q, 3));
+        flash.writeBudget = -1;
+    }
+
+    TelemetryQueue q;
+    CHECK(q.begin(storageFor(flash)));
+    CHECK(q.getStats().corrupt == 1);
+    CHECK(q.getPending() == 3);
+    CHECK(pushNumbered(q, 4));
+
+    TelemetryRecord out[8];
+    QueueCursor next;
+    CHECK(q.peek(out, 8, 1000, next) == 4);
+    CHECK(numberOf(out[2]) == 2 && numberOf(out[3]) == 4);
+    q.markSent(next);
+    CHECK(q.getPending() == 0);
+
+    // A flipped payload bit fails the check the same way
+    flash.bytes[8 + 4 + 5] ^= 0x01;
+    TelemetryQueue again;
+    CHECK(again.begin(storageFor(flash)));
+    CHECK(again.getStats().corrupt == 1);
+    return 0;
+}
+
+// With the ring full, the oldest sector is dropped, sent or not
+static int testFullRing() {
+    RamFlash flash(3);
+    TelemetryQueue q;
+    CHECK(q.begin(storageFor(flash)));
+
+    uint32_t perSector = (TELEMETRY_SECTOR_SIZE - 8) / (4 + 16);
+    uint32_t total = perSector * 5;
+    for (uint32_t n = 0; n < total; n++) CHECK(pushNumbered(q, n));
+
+    const QueueStats& s = q.getStats();
+    CHECK(s.dropped > 0);
+    CHECK(q.getPending() + s.dropped == total);
+    CHECK(q.getPending() <= perSector * 3);
+
+    // What is left is the newest, still in order
+    TelemetryRecord out[TELEMETRY_BATCH_RECORDS];
+    QueueCursor next;
+    uint32_t expected = s.dropped;
+    while (q.getPending() > 0) {
+        uint8_t n = q.peek(out, TELEMETRY_BATCH_RECORDS, 100000, next);
+        CHECK(n > 0);
+        for (uint8_t i = 0; i < n; i++) CHECK(numberOf(out[i]) == expected++);
+        q.markSent(next);
+    }
+    CHECK(expected == total);
+
+    // Remounting the wrapped ring finds the same head
+    TelemetryQueue again;
+    CHECK(again.begin(storageFor(flash)));
+    CHECK(again.getPending() == 0);
+    CHECK(pushNumbered(again, 99999));
+    CHECK(again.peek(out, 8, 1000, next) == 1 && numberOf(out[0]) == 99999);
+    return 0;
+}
+
+// Marking sent clears one byte in place, no erase
+static int testSentInPlace() {
+    RamFlash flash(2);
+    TelemetryQueue q;
+    CHECK(q.begin(storageFor(flash)));
+    uint32_t erases = flash.erases;
+    for (uint32_t n = 0; n < 20; n++) CHECK(pushNumbered(q, n, 6));
+
+    TelemetryRecord out[8];
+    QueueCursor next;
+    q.peek(out, 8, 1000, next);
+    q.markSent(next);
+    CHECK(flash.erases == erases);
+    CHECK(flash.bytes[8 + 3] == 0x00);
+    CHECK(flash.bytes[8 + 8 * 10 + 3] == 0xFF);
+
+    // An erased or foreign partition is formatted
+    RamFlash blank(2);
+    std::memset(&blank.bytes[0], 0x5A, 64);
+    TelemetryQueue fresh;
+    CHECK(fresh.begin(storageFor(blank)));
+    CHECK(fresh.getPending() == 0 && fresh.getCapacityBytes() == 2 * TELEMETRY_SECTOR_SIZE);
+
+    RamFlash tiny(1);
+    TelemetryQueue none;
+    CHECK(!none.begin(storageFor(tiny)));
+    CHECK(!none.push(1, "x", 1));
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    struct { const char* name; int (*run)(); } cases[] = {
+        { "push_peek", testPushPeek },
+        { "reboot", testReboot },
+        { "torn_write", testTornWrite },
+        { "full_ring", testFullRing },
+        { "sent_in_place", testSentInPlace },
+    };
+
+    int failures = 0;
+    for (auto& c : cases) {
+        if (argc > 1 && std::strcmp(argv[1], c.name) != 0) continue;
+        int result = c.run();
+        std::printf("%s %s\n", result == 0 ? "PASS" : "FAIL", c.name);
+        failures += result;
+    }
+    return failures == 0 ? 0 : 1;
+}
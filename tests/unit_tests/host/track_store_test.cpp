@@ -0,0 +1,329 @@
+// Host harness for TrackStore and TrackSimplifier. Run with a case name;
+// exits non-zero on failure and prints the reason.
+
+#include "track_store.h"
+
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#define CHECK(cond) do { if (!(cond)) { \
+    std::printf("FAIL %s:%d %s\n", __FILE__, __LINE__, #cond); return 1; } } while (0)
+
+// Metres per 1e-6 degree of latitude, as in track_store.cpp
+#define METERS_PER_E6 0.11132
+
+static void collect(const TrackPoint& point, void* context) {
+    static_cast<std::vector<TrackPoint>*>(context)->push_back(point);
+}
+
+static bool samePoint(const TrackPoint& a, const TrackPoint& b) {
+    return a.timestamp == b.timestamp && a.latitudeE6 == b.latitudeE6 && a.longitudeE6 == b.longitudeE6;
+}
+
+static TrackPoint makePoint(uint32_t t, int32_t latE6, int32_t lonE6) {
+    TrackPoint p = { t, latE6, lonE6 };
+    return p;
+}
+
+// Distance in metres from p to the segment a-b, on a local flat plane
+static double segmentMeters(const TrackPoint& p, const TrackPoint& a, const TrackPoint& b) {
+    double lonScale = METERS_PER_E6 * std::cos(a.latitudeE6 * 1e-6 * M_PI / 180.0);
+    double bx = (b.longitudeE6 - a.longitudeE6) * lonScale, by = (b.latitudeE6 - a.latitudeE6) * METERS_PER_E6;
+    double px = (p.longitudeE6 - a.longitudeE6) * lonScale, py = (p.latitudeE6 - a.latitudeE6) * METERS_PER_E6;
+    double lengthSq = bx * bx + by * by;
+    double t = lengthSq > 0 ? (px * bx + py * by) / lengthSq : 0;
+    t = t < 0 ? 0 : (t > 1 ? 1 : t);
+    return std::hypot(px - t * bx, py - t * by);
+}
+
+static uint32_t seed = 12345;
+
+// -range..range
+static int32_t noise(int32_t range) {
+    seed = seed * 1103515245u + 12345u;
+    return (int32_t)((seed >> 8) % (uint32_t)(2 * range + 1)) - range;
+}
+
+// A random walk with a sharp turn every few steps, so the simplifier keeps
+// nearly every point
+static std::vector<TrackPoint> makeZigzag(uint32_t start, uint32_t count) {
+    std::vector<TrackPoint> fixes;
+    int32_t lat = 12840600, lon = 80153400;
+    seed = 12345;
+    for (uint32_t i = 0; i < count; i++) {
+        lat += (i % 4 < 2 ? 600 : -600) + noise(100);
+        lon += 900 + noise(100);
+        fixes.push_back(makePoint(start + i * 5, lat, lon));
+    }
+    return fixes;
+}
+
+static void appendAll(TrackStore& store, const std::vector<TrackPoint>& fixes) {
+    for (const TrackPoint& p : fixes) store.append(p.timestamp, p.latitudeE6 * 1e-6, p.longitudeE6 * 1e-6);
+}
+
+// ================= Cases =================
+
+static int testVarint() {
+    const int32_t values[] = { 0, 1, -1, 63, -64, 64, -65, 8191, -8192, 8192, 1 << 19,
+                               1 << 20, -(1 << 27), 1 << 27, INT32_MAX, INT32_MIN };
+    const uint8_t sizes[] = { 1, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 4, 4, 5, 5, 5 };
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        uint8_t buffer[8];
+        std::memset(buffer, 0xEE, sizeof(buffer));
+        uint8_t n = TrackStore::writeVarint(buffer, values[i]);
+        CHECK(n == sizes[i]);
+        CHECK(buffer[n] == 0xEE);
+        int32_t back = 0;
+        CHECK(TrackStore::readVarint(buffer, back) == n);
+        CHECK(back == values[i]);
+    }
+
+    // Back to back, as in a block
+    uint8_t block[64];
+    uint8_t used = 0;
+    for (int32_t v = -40000; v <= 40000; v += 9999) used += TrackStore::writeVarint(block + used, v);
+    uint8_t pos = 0;
+    for (int32_t v = -40000; v <= 40000; v += 9999) {
+        int32_t back;
+        pos += TrackStore::readVarint(block + pos, back);
+        CHECK(back == v);
+    }
+    CHECK(pos == used);
+    return 0;
+}
+
+// Points stored in blocks come back exactly as the simplifier emitted them,
+// whatever the size of the deltas
+static int testRoundTrip() {
+    static TrackStore store;
+    store.clear();
+    TrackSimplifier reference;
+    std::vector<TrackPoint> expected;
+
+    // Small steps, 1 km jumps, a long time gap and a jump across the globe
+    int32_t lat = 12840600, lon = 80153400;
+    uint32_t t = 100;
+    for (uint32_t i = 0; i < 600; i++) {
+        if (i % 100 == 50) lat += 9000 * (i % 200 == 50 ? 1 : -1);
+        else if (i == 300) { lat = -33868800; lon = -151209300; }
+        else { lat += (i % 2 ? 400 : -300); lon += 700; }
+        t += i == 400 ? 100000 : 3;
+        TrackPoint p = makePoint(t, lat, lon);
+        reference.add(p, collect, &expected);
+        store.append(t, lat * 1e-6, lon * 1e-6);
+    }
+
+    std::vector<TrackPoint> stored;
+    uint32_t count = store.query(0, UINT32_MAX, 0, collect, &stored);
+    TrackPoint tail;
+    CHECK(reference.peekPending(tail));
+    CHECK(count == stored.size() && count == expected.size() + 1);
+    CHECK(store.getPointCount() == expected.size());
+    for (size_t i = 0; i < expected.size(); i++) CHECK(samePoint(stored[i], expected[i]));
+    CHECK(samePoint(stored.back(), tail));
+
+    // A range picks out the same points
+    std::vector<TrackPoint> range;
+    uint32_t from = expected[20].timestamp, to = expected[40].timestamp;
+    CHECK(store.query(from, to, 0, collect, &range) == 21);
+    CHECK(samePoint(range.front(), expected[20]) && samePoint(range.back(), expected[40]));
+    range.clear();
+    CHECK(store.query(to + 1, to, 0, collect, &range) == 0 && range.empty());
+    return 0;
+}
+
+static int testSimplifier() {
+    // A straight walk keeps its ends
+    TrackSimplifier line;
+    std::vector<TrackPoint> out;
+    for (uint32_t i = 0; i < 200; i++) line.add(makePoint(i, 12840600 + i * 10, 80153400), collect, &out);
+    line.flush(collect, &out);
+    CHECK(out.size() == 2);
+    CHECK(out[0].timestamp == 0 && out[1].timestamp == 199);
+
+    // A right angle keeps the corner
+    TrackSimplifier corner;
+    out.clear();
+    for (uint32_t i = 0; i <= 100; i++) corner.add(makePoint(i, 12840600 + i * 10, 80153400), collect, &out);
+    for (uint32_t i = 1; i <= 100; i++) corner.add(makePoint(100 + i, 12841600, 80153400 + i * 10), collect, &out);
+    corner.flush(collect, &out);
+    // Kept as the last fix that still fitted, a few metres past the corner
+    CHECK(out.size() == 3);
+    CHECK(out[1].timestamp >= 100 && out[1].timestamp <= 105);
+
+    // Standing still: jitter inside the dead band (about 1 m each way) is
+    // dropped, but a point is kept every TRACK_MAX_GAP_S
+    TrackSimplifier still;
+    out.clear();
+    for (uint32_t t = 0; t < 3 * TRACK_MAX_GAP_S; t++) {
+        still.add(makePoint(t, 12840600 + noise(10), 80153400 + noise(10)), collect, &out);
+    }
+    CHECK(out.size() == 3);
+    CHECK(out[1].timestamp == TRACK_MAX_GAP_S && out[2].timestamp == 2 * TRACK_MAX_GAP_S);
+
+    // A curve: every fix stays within the tolerance of the kept track
+    TrackSimplifier curve;
+    std::vector<TrackPoint> fixes;
+    out.clear();
+    for (uint32_t i = 0; i < 400; i++) {
+        double angle = i * 0.05;
+        TrackPoint p = makePoint(i, 12840600 + (int32_t)(std::sin(angle) * 900), 80153400 + (int32_t)(std::cos(angle) * 900));
+        fixes.push_back(p);
+        curve.add(p, collect, &out);
+    }
+    curve.flush(collect, &out);
+    CHECK(out.size() > 2 && out.size() < fixes.size() / 4);
+    size_t segment = 0;
+    double worst = 0;
+    for (const TrackPoint& p : fixes) {
+        while (segment + 2 < out.size() && p.timestamp > out[segment + 1].timestamp) segment++;
+        double d = segmentMeters(p, out[segment], out[segment + 1]);
+        if (d > worst) worst = d;
+    }
+    std::printf("curve %u fixes -> %u points, worst %.2f m\n", (unsigned)fixes.size(), (unsigned)out.size(), worst);
+    CHECK(worst <= TRACK_TOLERANCE_M + 0.1);
+    return 0;
+}
+
+// The point budget, including its edges
+static int testBudget() {
+    static TrackStore store;
+    store.clear();
+    std::vector<TrackPoint> out;
+
+    // Empty
+    for (uint16_t max = 0; max <= 2; max++) CHECK(store.query(0, UINT32_MAX, max, collect, &out) == 0);
+    CHECK(out.empty());
+
+    // One fix
+    store.append(10, 12.8406, 80.1534);
+    CHECK(store.query(0, UINT32_MAX, 1, collect, &out) == 1 && out.size() == 1);
+
+    appendAll(store, makeZigzag(20, 2000));
+    std::vector<TrackPoint> all;
+    uint32_t available = store.query(0, UINT32_MAX, 0, collect, &all);
+    CHECK(available == all.size() && available > 1000);
+
+    // A budget at or above what is stored changes nothing
+    out.clear();
+    CHECK(store.query(0, UINT32_MAX, available, collect, &out) == available);
+    CHECK(out.size() == available);
+
+    // 1: the latest point
+    out.clear();
+    CHECK(store.query(0, UINT32_MAX, 1, collect, &out) == 1);
+    CHECK(out.size() == 1 && samePoint(out[0], all.back()));
+    out.clear();
+    uint32_t middle = all[available / 2].timestamp;
+    CHECK(store.query(0, middle, 1, collect, &out) == 1 && samePoint(out[0], all[available / 2]));
+
+    // 2: the ends
+    out.clear();
+    CHECK(store.query(0, UINT32_MAX, 2, collect, &out) == 2 && out.size() == 2);
+    CHECK(samePoint(out[0], all.front()) && samePoint(out[1], all.back()));
+
+    // Anything else stays within budget, in time order, starting at the
+    // first point
+    const uint16_t budgets[] = { 3, 10, 50, 200, (uint16_t)(available - 1) };
+    for (uint16_t max : budgets) {
+        out.clear();
+        uint32_t sent = store.query(0, UINT32_MAX, max, collect, &out);
+        CHECK(sent == out.size() && sent <= max && sent >= 2);
+        CHECK(samePoint(out.front(), all.front()));
+        for (size_t i = 1; i < out.size(); i++) CHECK(out[i].timestamp > out[i - 1].timestamp);
+    }
+    return 0;
+}
+
+// When the ring is full the oldest block goes, and what is left still
+// decodes
+static int testEvict() {
+    static TrackStore store;
+    store.clear();
+    std::vector<TrackPoint> fixes = makeZigzag(0, 20000);
+    appendAll(store, fixes);
+    TrackStats stats = store.getStats();
+    CHECK(stats.blocksEvicted > 0);
+    CHECK(stats.bytesUsed <= TRACK_BLOCK_COUNT * (sizeof(TrackPoint) + TRACK_BLOCK_BYTES));
+
+    std::vector<TrackPoint> kept;
+    uint32_t count = store.query(0, UINT32_MAX, 0, collect, &kept);
+    CHECK(count == store.getPointCount() + 1);
+    CHECK(kept.front().timestamp > 0);
+    for (size_t i = 1; i < kept.size(); i++) CHECK(kept[i].timestamp > kept[i - 1].timestamp);
+
+    // What is left is the newest of what the simplifier kept, then the
+    // pending tail
+    TrackSimplifier reference;
+    std::vector<TrackPoint> expected;
+    for (const TrackPoint& p : fixes) reference.add(p, collect, &expected);
+    CHECK(expected.size() > count);
+    size_t skip = expected.size() - (count - 1);
+    for (size_t i = 0; i + 1 < kept.size(); i++) CHECK(samePoint(kept[i], expected[skip + i]));
+
+    // Before the oldest block there is nothing
+    std::vector<TrackPoint> gone;
+    CHECK(store.query(0, kept.front().timestamp - 1, 0, collect, &gone) == 0);
+    std::printf("evicted %u blocks (%u bytes), kept %u points\n", (unsigned)stats.blocksEvicted,
+                (unsigned)stats.bytesEvicted, (unsigned)count);
+    return 0;
+}
+
+// A day at 1 Hz: home, a walk, work, a walk back, home. The fixes wander
+// by a couple of metres, as a phone or module GPS does.
+static int testDay() {
+    static TrackStore store;
+    store.clear();
+    seed = 777;
+    const int32_t homeLat = 12840600, homeLon = 80153400;
+    int32_t lat = homeLat, lon = homeLon;
+    int32_t stepLat = 0, stepLon = 0;
+    for (uint32_t t = 0; t < 86400; t++) {
+        uint32_t hour = t / 3600;
+        bool walking = hour == 8 || hour == 17;
+        if (walking) {
+            // 1.2 m/s, turning at each block corner
+            if (t % 120 == 0) {
+                bool north = (t / 120) % 2 == 0;
+                int32_t sign = hour == 8 ? 1 : -1;
+                stepLat = north ? sign * 11 : 0;
+                stepLon = north ? 0 : sign * 11;
+            }
+            lat += stepLat;
+            lon += stepLon;
+        }
+        store.append(t, (lat + noise(18)) * 1e-6, (lon + noise(18)) * 1e-6);
+    }
+
+    TrackStats stats = store.getStats();
+    CHECK(stats.fixesAppended == 86400 && stats.blocksEvicted == 0);
+    std::printf("DAY %u fixes -> %u points, %u bytes of %u (%.1fx), store %u bytes of RAM\n",
+                (unsigned)stats.fixesAppended, (unsigned)stats.pointsStored, (unsigned)stats.bytesUsed,
+                (unsigned)(TRACK_BLOCK_COUNT * (sizeof(TrackPoint) + TRACK_BLOCK_BYTES)),
+                store.getCompressionRatio(), (unsigned)sizeof(TrackStore));
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    struct { const char* name; int (*run)(); } cases[] = {
+        { "varint", testVarint },
+        { "round_trip", testRoundTrip },
+        { "simplifier", testSimplifier },
+        { "budget", testBudget },
+        { "evict", testEvict },
+        { "day", testDay },
+    };
+
+    int failures = 0;
+    for (auto& c : cases) {
+        if (argc > 1 && std::strcmp(argv[1], c.name) != 0) continue;
+        int result = c.run();
+        std::printf("%s %s\n", result == 0 ? "PASS" : "FAIL", c.name);
+        failures += result;
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,65 @@
+#!/usr/bin/env python3
+"""
+Host Harness Support
+
+Firmware modules without Arduino dependencies are tested on the host. A
+test class names its C++ harness in host/ and the sources it needs; the
+harness is built once per class and run one case at a time. A harness
+takes a case name, prints what it measured, and exits non-zero on
+failure.
+"""
+
+import os
+import shutil
+import subprocess
+import tempfile
+import unittest
+
+REPO_ROOT = os.path.abspath(os.path.join(os.path.dirname(__file__), '..', '..'))
+HOST_DIR = os.path.join(os.path.dirname(__file__), 'host')
+CONTROLLER_DIR = os.path.join(REPO_ROOT, 'src', 'esp32-main-controller')
+TRANSMITTER_DIR = os.path.join(REPO_ROOT, 'src', 'esp8266-nodes', 'transmitter')
+RECEIVER_DIR = os.path.join(REPO_ROOT, 'src', 'esp8266-nodes', 'receiver')
+PACKET_DIR = os.path.join(REPO_ROOT, 'src', 'esp8266-nodes', 'libraries', 'espnow_packet', 'src')
+
+
+class HostHarnessTest(unittest.TestCase):
+    """Builds host/<HARNESS>_test.cpp with SOURCES and runs its cases"""
+
+    HARNESS = None
+    INCLUDE_DIRS = ()
+    SOURCES = ()
+    # C++11, as the ESP32 2.x and ESP8266 2.7 cores build sketches
+    STD = 'c++11'
+    FLAGS = ()
+    LIBS = ()
+    TIMEOUT = 60
+
+    @classmethod
+    def setUpClass(cls):
+        if cls.HARNESS is None:
+            raise unittest.SkipTest("no harness")
+        if shutil.which('g++') is None:
+            raise unittest.SkipTest("g++ is required for host tests")
+        cls.build_dir = tempfile.mkdtemp()
+        cls.binary = os.path.join(cls.build_dir, cls.HARNESS + '_test')
+        command = ['g++', '-std=' + cls.STD, '-O2', '-Wall', '-Wextra'] + list(cls.FLAGS)
+        for directory in cls.INCLUDE_DIRS:
+            command += ['-I', directory]
+        command += [os.path.join(HOST_DIR, cls.HARNESS + '_test.cpp')] + list(cls.SOURCES)
+        command += list(cls.LIBS) + ['-o', cls.binary]
+        try:
+            subprocess.run(command, check=True)
+        except subprocess.CalledProcessError:
+            shutil.rmtree(cls.build_dir, ignore_errors=True)
+            raise
+
+    @classmethod
+    def tearDownClass(cls):
+        shutil.rmtree(cls.build_dir, ignore_errors=True)
+
+    def run_case(self, *args):
+        result = subprocess.run([self.binary] + list(args), capture_output=True, text=True,
+                                timeout=self.TIMEOUT)
+        self.assertEqual(result.returncode, 0, result.stdout + result.stderr)
+        return result.stdout
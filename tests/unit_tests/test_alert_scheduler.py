@@ -0,0 +1,56 @@
+#!/usr/bin/env python3
+"""
+Unit Tests for the Buzzer Alert Scheduler
+
+Checks that the buzzer plays the most urgent alert first, that a fall
+preempts a tone already playing and the tone resumes after it, that
+delayed alerts fire on time, and that alerts posted from several tasks
+at once are neither lost nor duplicated.
+"""
+
+import os
+import unittest
+
+from host_harness import CONTROLLER_DIR, HostHarnessTest
+
+
+class TestAlertScheduler(HostHarnessTest):
+    """Test the priority alert scheduler on the host"""
+
+    HARNESS = 'alert_scheduler'
+    INCLUDE_DIRS = (CONTROLLER_DIR,)
+    SOURCES = (os.path.join(CONTROLLER_DIR, 'alert_scheduler.cpp'),)
+    STD = 'c++17'
+    FLAGS = ('-pthread',)
+
+    def test_priority_order(self):
+        """Higher priorities first, FIFO within a priority"""
+        self.run_case('priority_order')
+
+    def test_preempt_resume(self):
+        """A preempted alert resumes ahead of later alerts of its priority"""
+        self.run_case('preempt_resume')
+
+    def test_timer_wheel(self):
+        """Delayed alerts fire within one wheel tick, beyond one revolution too"""
+        self.run_case('timer_wheel')
+
+    def test_clock_wrap(self):
+        """Delayed alerts across the millis() wrap fire on time"""
+        self.run_case('clock_wrap')
+
+    def test_clear(self):
+        """Clear requests drop waiting and delayed alerts in post order"""
+        self.run_case('clear')
+
+    def test_ring_full(self):
+        """A full post ring rejects instead of blocking"""
+        self.run_case('ring_full')
+
+    def test_concurrent_producers(self):
+        """No loss, ordering and bounded latency with concurrent producers"""
+        self.run_case('concurrent_producers')
+
+
+if __name__ == '__main__':
+    unittest.main(verbosity=2)
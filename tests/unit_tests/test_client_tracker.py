@@ -0,0 +1,47 @@
+#!/usr/bin/env python3
+"""
+Unit Tests for the AP Client Tracker
+
+Checks that stations joining and leaving the access point are recorded
+with their callbacks fired once, that a reassociating station keeps its
+entry, that a full table turns newcomers away, and that DHCP addresses
+and the binary record layout match what /clients reports.
+"""
+
+import os
+import unittest
+
+from host_harness import CONTROLLER_DIR, HostHarnessTest
+
+
+class TestClientTracker(HostHarnessTest):
+    """Test the station table on the host"""
+
+    HARNESS = 'client_tracker'
+    INCLUDE_DIRS = (CONTROLLER_DIR,)
+    SOURCES = (os.path.join(CONTROLLER_DIR, 'client_tracker.cpp'),)
+    STD = 'c++17'
+
+    def test_join_leave(self):
+        """Joins and leaves update the count and fire the callbacks"""
+        self.run_case('join_leave')
+
+    def test_rejoin(self):
+        """A reassociating station keeps a single record"""
+        self.run_case('rejoin')
+
+    def test_full(self):
+        """Joins beyond the AP limit are counted and dropped"""
+        self.run_case('full')
+
+    def test_ip_assigned(self):
+        """DHCP addresses reach the right station, with or without a MAC"""
+        self.run_case('ip_assigned')
+
+    def test_record(self):
+        """Records stay small and MACs format as text"""
+        self.run_case('record')
+
+
+if __name__ == '__main__':
+    unittest.main(verbosity=2)
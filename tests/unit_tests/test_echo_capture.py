@@ -0,0 +1,61 @@
+#!/usr/bin/env python3
+"""
+Unit Tests for the Transmitter Echo Capture
+
+Checks that an HC-SR04 pulse is timed from its edges alone, that a
+missing, stuck or noisy sensor is reported rather than read as an
+obstacle, and that micros() wrapping mid-pulse still gives the right
+distance. Also reports the sample rate a simulated sensor sustains.
+"""
+
+import os
+import re
+import unittest
+
+from host_harness import TRANSMITTER_DIR, HostHarnessTest
+
+
+class TestEchoCapture(HostHarnessTest):
+    """Test the echo capture state machine on the host"""
+
+    HARNESS = 'echo_capture'
+    INCLUDE_DIRS = (TRANSMITTER_DIR,)
+    SOURCES = (os.path.join(TRANSMITTER_DIR, 'echo_capture.cpp'),)
+
+    def test_echo(self):
+        """Both edges are timed by the interrupt, whenever the loop polls"""
+        self.run_case('echo')
+
+    def test_no_target(self):
+        """Nothing in range ends at the round trip of MAX_DISTANCE"""
+        self.run_case('no_target')
+
+    def test_no_sensor(self):
+        """An echo that never starts is reported as a missing sensor"""
+        self.run_case('no_sensor')
+
+    def test_stuck(self):
+        """A line held high does not wedge the state machine"""
+        self.run_case('stuck')
+
+    def test_spurious(self):
+        """Edges outside a measurement are counted and ignored"""
+        self.run_case('spurious')
+
+    def test_wrap(self):
+        """Timing survives micros() wrapping"""
+        self.run_case('wrap')
+
+    def test_rate(self):
+        """Back-to-back sampling stays above 25 Hz at any distance"""
+        output = self.run_case('rate')
+        rates = {m.group(1): float(m.group(2))
+                 for m in re.finditer(r'RATE (\S+) ([\d.]+) Hz', output)}
+        print('\n' + output.strip())
+        self.assertEqual(len(rates), 5)
+        self.assertGreater(min(rates.values()), 25)
+        self.assertGreater(rates['100cm'], 50)
+
+
+if __name__ == '__main__':
+    unittest.main(verbosity=2)
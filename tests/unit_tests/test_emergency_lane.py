@@ -0,0 +1,103 @@
+#!/usr/bin/env python3
+"""
+Unit Tests for the Emergency Notification Lane
+
+Checks that a fall reaches every configured sink, that failed sinks are
+retried with exponential backoff and each event is delivered once by
+its ID, that the webhook and UDP messages have the documented format,
+and that a UDP sink only counts as delivered once acknowledged. The
+stand-in receiver in tools/emergency_receiver then drops replies and
+acknowledgements over real sockets to force the retries.
+"""
+
+import importlib.util
+import os
+import unittest
+
+from host_harness import REPO_ROOT, CONTROLLER_DIR, HostHarnessTest
+
+TOOL = os.path.join(REPO_ROOT, 'tools', 'emergency_receiver', 'emergency_receiver.py')
+
+spec = importlib.util.spec_from_file_location('emergency_receiver', TOOL)
+emergency_receiver = importlib.util.module_from_spec(spec)
+spec.loader.exec_module(emergency_receiver)
+
+
+class TestEmergencyLane(HostHarnessTest):
+    """Test the emergency lane on the host"""
+
+    HARNESS = 'emergency_lane'
+    INCLUDE_DIRS = (CONTROLLER_DIR,)
+    SOURCES = (os.path.join(CONTROLLER_DIR, 'emergency_lane.cpp'),)
+
+    def test_deliver(self):
+        """Every sink gets the fall on the first pass; latency from the fall"""
+        self.run_case('deliver')
+
+    def test_backoff(self):
+        """A failing sink is retried at doubling intervals, then given up"""
+        self.run_case('backoff')
+
+    def test_dedup(self):
+        """Raising an event still in delivery does nothing; retries keep the ID"""
+        self.run_case('dedup')
+
+    def test_evict(self):
+        """With every slot retrying, a new fall replaces the oldest"""
+        self.run_case('evict')
+
+    def test_confirm(self):
+        """A broadcast counts only once acknowledged, and is resent until it is"""
+        self.run_case('confirm')
+
+    def test_formats(self):
+        """UDP packet and acknowledgement, JSON body, webhook request and HTTP status parsing"""
+        self.run_case('formats')
+
+    def test_stand_in_sinks(self):
+        """A 503, a lost reply and a lost acknowledgement are retried; the receiver keeps one copy"""
+        receiver = emergency_receiver.EmergencyReceiver(0, 0, address='127.0.0.1', fail=1, drop=1,
+                                                        lose_acks=1)
+        try:
+            out = self.run_case('deliver', '127.0.0.1', str(receiver.http_port), str(receiver.udp_port))
+            print(out)
+            events = [receiver.receive(timeout=2), receiver.receive(timeout=2)]
+            self.assertIsNone(receiver.receive(timeout=0.2))
+            by_source = {e.source: e for e in events}
+            self.assertEqual(set(by_source), {'udp', 'webhook'})
+            self.assertEqual(by_source['udp'].id, by_source['webhook'].id)
+            self.assertEqual(by_source['udp'].attempt, 1)
+            self.assertEqual(by_source['webhook'].attempt, 2)
+            self.assertTrue(by_source['webhook'].gps_fix)
+            self.assertAlmostEqual(by_source['webhook'].latitude, 12.8406)
+            self.assertAlmostEqual(by_source['udp'].longitude, -80.1534)
+            # 503, then recorded with the reply lost, then a duplicate; the
+            # packet sent again is the other duplicate
+            self.assertEqual(receiver.posts, 3)
+            self.assertEqual(receiver.dedup.duplicates, 2)
+            self.assertIn('webhook  delivered 1 retries 2 failed 0', out)
+            # The packet again once the first acknowledgement was lost
+            self.assertEqual(receiver.acks, 1)
+            self.assertIn('udp      delivered 1 retries 1 failed 0 unconfirmed 1', out)
+        finally:
+            receiver.close()
+
+
+class TestEmergencyReceiver(unittest.TestCase):
+    """Test the stand-in receiver's decoding"""
+
+    def test_rejects_state_packets(self):
+        """State snapshots on the shared port are not falls"""
+        with self.assertRaises(ValueError):
+            emergency_receiver.decode_packet(b'DS\x01' + b'\x00' * 29)
+        with self.assertRaises(ValueError):
+            emergency_receiver.decode_packet(b'DE\x01')
+
+    def test_ack(self):
+        """The acknowledgement echoes the event ID and attempt"""
+        event = emergency_receiver.FallEvent(0xA1B2C3D4, 0, 0.0, 0.0, False, 1, 3, 'udp', 0.0)
+        self.assertEqual(emergency_receiver.encode_ack(event), b'DA\x01\x03\xd4\xc3\xb2\xa1')
+
+
+if __name__ == '__main__':
+    unittest.main()
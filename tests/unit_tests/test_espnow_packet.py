@@ -0,0 +1,55 @@
+#!/usr/bin/env python3
+"""
+Unit Tests for the Shared ESP-NOW Packet Format
+
+Checks the wire layout and CRC shared by both ESP8266 nodes: every
+payload survives a round trip, packets at unaligned addresses decode,
+corrupt, truncated and malformed packets are rejected, and sequence
+numbers wrap. Also reports encode and decode time per packet.
+"""
+
+import os
+import re
+import unittest
+
+from host_harness import PACKET_DIR, HostHarnessTest
+
+
+class TestEspNowPacket(HostHarnessTest):
+    """Test the ESP-NOW packet format on the host"""
+
+    HARNESS = 'espnow_packet'
+    INCLUDE_DIRS = (PACKET_DIR,)
+    SOURCES = (os.path.join(PACKET_DIR, 'espnow_packet.cpp'),)
+
+    def test_layout(self):
+        """Fields sit where the documented layout puts them"""
+        self.run_case('layout')
+
+    def test_round_trip(self):
+        """Every field of every payload survives encoding and parsing"""
+        self.run_case('round_trip')
+
+    def test_unaligned(self):
+        """Packets parse in place at any address"""
+        self.run_case('unaligned')
+
+    def test_rejects(self):
+        """Bit errors, truncation, other versions and bad payloads are refused"""
+        self.run_case('rejects')
+
+    def test_sequence(self):
+        """Sequence order holds across the wrap"""
+        self.run_case('sequence')
+
+    def test_benchmark(self):
+        """Encode and decode cost per packet"""
+        output = self.run_case('benchmark')
+        print('\n' + output.strip())
+        match = re.search(r'BENCH packet (\d+) bytes .* encode ([\d.]+) ns decode ([\d.]+) ns', output)
+        self.assertIsNotNone(match)
+        self.assertLessEqual(int(match.group(1)), 250)
+
+
+if __name__ == '__main__':
+    unittest.main(verbosity=2)
@@ -0,0 +1,43 @@
+#!/usr/bin/env python3
+"""
+Unit Tests for the Field Versions and /delta Responses
+
+Checks that /delta returns only the fields changed since the client's
+version, that a version from another boot gets a full snapshot, and that
+counter wrap is handled. Also reports the bytes four dashboards fetch in
+an hour with and without /delta.
+"""
+
+import os
+import unittest
+
+from host_harness import CONTROLLER_DIR, HostHarnessTest
+
+
+class TestFieldVersions(HostHarnessTest):
+    """Test the delta encoder on the host"""
+
+    HARNESS = 'field_versions'
+    INCLUDE_DIRS = (CONTROLLER_DIR,)
+    SOURCES = (os.path.join(CONTROLLER_DIR, 'field_versions.cpp'),
+               os.path.join(CONTROLLER_DIR, 'json_stream.cpp'))
+
+    def test_delta(self):
+        """Only fields changed since the given version are sent"""
+        self.run_case('delta')
+
+    def test_snapshot(self):
+        """Unknown versions get a full snapshot"""
+        self.run_case('snapshot')
+
+    def test_wrap(self):
+        """Version order survives the 32-bit wrap"""
+        self.run_case('wrap')
+
+    def test_bandwidth(self):
+        """Bytes per hour for four dashboards, before and after /delta"""
+        print(self.run_case('bandwidth'))
+
+
+if __name__ == '__main__':
+    unittest.main(verbosity=2)
@@ -0,0 +1,50 @@
+#!/usr/bin/env python3
+"""
+Unit Tests for the Streaming JSON Writer
+
+Checks that streamed responses are valid JSON whatever the nesting,
+escaping and number formatting, that compile-time field schemas write
+the same output, and that nothing is lost across chunk boundaries. Also
+compares peak heap and serialize time with String concatenation.
+"""
+
+import os
+import unittest
+
+from host_harness import CONTROLLER_DIR, HostHarnessTest
+
+
+class TestJsonStream(HostHarnessTest):
+    """Test the JSON writer on the host"""
+
+    HARNESS = 'json_stream'
+    INCLUDE_DIRS = (CONTROLLER_DIR,)
+    SOURCES = (os.path.join(CONTROLLER_DIR, 'json_stream.cpp'),)
+
+    def test_structure(self):
+        """Containers nest and members are comma separated"""
+        self.run_case('structure')
+
+    def test_escaping(self):
+        """Quotes, backslashes and control characters are escaped"""
+        self.run_case('escaping')
+
+    def test_numbers(self):
+        """Integers, scaled integers and floats format without printf"""
+        self.run_case('numbers')
+
+    def test_schema(self):
+        """Schema fields read every member type at its offset"""
+        self.run_case('schema')
+
+    def test_chunks(self):
+        """Output spans chunks intact and writing never allocates"""
+        self.run_case('chunks')
+
+    def test_benchmark(self):
+        """Streaming matches, and is measured against, String concatenation"""
+        print(self.run_case('benchmark'))
+
+
+if __name__ == '__main__':
+    unittest.main(verbosity=2)
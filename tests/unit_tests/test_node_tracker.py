@@ -0,0 +1,55 @@
+#!/usr/bin/env python3
+"""
+Unit Tests for the Receiver Node Tracker
+
+Checks that lost packets are counted from sequence gaps, that stale and
+repeated packets are dropped, that a transmitter rebooting mid-run is
+resynced, that sequence numbers and timestamps wrap, and that several
+interleaved transmitters share the table until it evicts the oldest.
+"""
+
+import os
+import unittest
+
+from host_harness import RECEIVER_DIR, PACKET_DIR, HostHarnessTest
+
+
+class TestNodeTracker(HostHarnessTest):
+    """Test the node tracker on the host"""
+
+    HARNESS = 'node_tracker'
+    INCLUDE_DIRS = (RECEIVER_DIR, PACKET_DIR)
+    SOURCES = (os.path.join(RECEIVER_DIR, 'node_tracker.cpp'),
+               os.path.join(PACKET_DIR, 'espnow_packet.cpp'))
+
+    def test_in_order(self):
+        """Packets in order are accepted and gaps counted as lost"""
+        self.run_case('in_order')
+
+    def test_stale(self):
+        """Repeated and late packets are dropped"""
+        self.run_case('stale')
+
+    def test_reboot(self):
+        """A transmitter starting again from 0 is resynced at once"""
+        self.run_case('reboot')
+
+    def test_reboot_by_time(self):
+        """A reboot with the sequence close behind is caught by its timestamp"""
+        self.run_case('reboot_by_time')
+
+    def test_wrap(self):
+        """The sequence and micros() roll over without a restart"""
+        self.run_case('wrap')
+
+    def test_two_nodes(self):
+        """Interleaved transmitters keep their own sequences"""
+        self.run_case('two_nodes')
+
+    def test_eviction(self):
+        """A full table makes room by dropping the node heard longest ago"""
+        self.run_case('eviction')
+
+
+if __name__ == '__main__':
+    unittest.main(verbosity=2)
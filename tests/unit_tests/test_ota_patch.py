@@ -0,0 +1,198 @@
+#!/usr/bin/env python3
+"""
+Unit Tests for OTA Delta Patches
+
+Checks that patches from tools/ota_patch rebuild the new image with the
+reference applier, and that the controller's streaming applier does the
+same when the upload is split at every boundary. Also checks that bad
+headers, CRCs and operations are rejected, that upload signatures match
+RFC 4231, Python's hmac and the host tool, and reports apply throughput.
+The signature's mbedtls calls run on OpenSSL here (host/mbedtls_md.cpp).
+"""
+
+import hashlib
+import hmac
+import importlib.util
+import os
+import random
+import string
+import unittest
+
+from host_harness import REPO_ROOT, CONTROLLER_DIR, HOST_DIR, HostHarnessTest
+
+TOOL = os.path.join(REPO_ROOT, 'tools', 'ota_patch', 'ota_patch.py')
+
+spec = importlib.util.spec_from_file_location('ota_patch', TOOL)
+ota_patch = importlib.util.module_from_spec(spec)
+spec.loader.exec_module(ota_patch)
+
+IMAGE_BASE = 0x400D0000
+WORD_SPACING = 64       # One absolute address per 64 bytes of code
+
+
+def make_image(seed, size):
+    """Incompressible code with absolute addresses into itself"""
+    rng = random.Random(seed)
+    out = bytearray()
+    while len(out) < size:
+        out += rng.randbytes(WORD_SPACING - 4)
+        out += (IMAGE_BASE + rng.randrange(size)).to_bytes(4, 'little')
+    return bytes(out[:size])
+
+
+def insert_code(old, at, code):
+    """New image with code inserted and every address past it relocated"""
+    new = bytearray(old[:at] + code + old[at:])
+    for i in range(WORD_SPACING - 4, len(old) - 3, WORD_SPACING):
+        target = int.from_bytes(old[i:i + 4], 'little') - IMAGE_BASE
+        if target >= at:
+            target += len(code)
+        j = i if i < at else i + len(code)
+        new[j:j + 4] = (IMAGE_BASE + target).to_bytes(4, 'little')
+    return bytes(new)
+
+
+class TestPatchGenerator(unittest.TestCase):
+    """Test the host patch generator against its reference applier"""
+
+    def setUp(self):
+        self.old = make_image(1, 128 * 1024)
+        self.code = random.Random(2).randbytes(300)
+
+    def round_trip(self, old, new):
+        patch = ota_patch.make_patch(old, new)
+        self.assertEqual(ota_patch.apply_patch(old, patch), new)
+        return patch
+
+    def test_round_trip(self):
+        """Edits of every kind rebuild the new image exactly"""
+        old = self.old
+        cases = [
+            old,
+            old[:5000] + self.code + old[5000:],
+            old[:5000] + old[9000:],
+            old + self.code,
+            self.code + old,
+            old[::-1],
+            b'',
+        ]
+        for new in cases:
+            self.round_trip(old, new)
+        self.round_trip(b'', self.code)
+
+    def test_inserted_code(self):
+        """Code inserted without relocation costs about its own size"""
+        new = self.old[:60000] + self.code + self.old[60000:]
+        patch = self.round_trip(self.old, new)
+        self.assertLess(len(patch), len(self.code) + 200)
+
+    def test_relocated_code(self):
+        """Shifted addresses keep the patch a small fraction of the image"""
+        new = insert_code(self.old, 60000, self.code)
+        patch = self.round_trip(self.old, new)
+        self.assertLess(len(patch), len(new) * 0.06)
+
+    def test_header(self):
+        """Header layout matches ota_patch.h"""
+        new = self.old[:100] + b'x' + self.old[100:]
+        patch = ota_patch.make_patch(self.old, new)
+        self.assertEqual(patch[:4], b'DGP1')
+        self.assertEqual(patch[4], 1)
+        source_size, source_crc, target_size, _ = ota_patch.parse_header(patch)
+        self.assertEqual(source_size, len(self.old))
+        self.assertEqual(target_size, len(new))
+
+    def test_wrong_source(self):
+        """A patch is refused against any image but its own source"""
+        patch = ota_patch.make_patch(self.old, self.old + b'tail')
+        other = bytearray(self.old)
+        other[1000] ^= 0xFF
+        with self.assertRaises(ota_patch.PatchError):
+            ota_patch.apply_patch(bytes(other), patch)
+        with self.assertRaises(ota_patch.PatchError):
+            ota_patch.apply_patch(self.old, b'\xe9' + patch[1:])
+
+
+class TestPatchApplier(HostHarnessTest):
+    """Test the device patch applier on the host"""
+
+    HARNESS = 'ota_patch'
+    # HOST_DIR holds an OpenSSL-backed mbedtls/md.h for the signature
+    INCLUDE_DIRS = (CONTROLLER_DIR, HOST_DIR)
+    SOURCES = (os.path.join(CONTROLLER_DIR, 'ota_patch.cpp'),
+               os.path.join(HOST_DIR, 'mbedtls_md.cpp'))
+    # zlib stands in for the ROM inflater
+    LIBS = ('-lz', '-lcrypto')
+    TIMEOUT = 120
+
+    def apply_on_device(self, old, new):
+        paths = [os.path.join(self.build_dir, name) for name in ('old.bin', 'patch.bin', 'out.bin')]
+        patch = ota_patch.make_patch(old, new)
+        for path, data in zip(paths, (old, patch)):
+            with open(path, 'wb') as f:
+                f.write(data)
+        output = self.run_case('apply', *paths)
+        with open(paths[2], 'rb') as f:
+            self.assertEqual(f.read(), new)
+        return output
+
+    def test_crc(self):
+        """CRC-32 matches zlib's"""
+        self.run_case('crc')
+
+    def test_header(self):
+        """Header fields parse and other files are rejected"""
+        self.run_case('header')
+
+    def test_ops(self):
+        """The operation stream applies the same in pieces of any size"""
+        self.run_case('ops')
+
+    def test_errors(self):
+        """Out-of-range copies, bad ops, truncation and bad CRCs are caught"""
+        self.run_case('errors')
+
+    def test_signature(self):
+        """HMAC-SHA256 matches RFC 4231 in pieces of any size; bad signatures fail"""
+        self.run_case('signature')
+
+    def test_tool_signature(self):
+        """Signatures from the host tool verify on the device side"""
+        path = os.path.join(self.build_dir, 'signed.bin')
+        data = make_image(7, 100 * 1024)
+        with open(path, 'wb') as f:
+            f.write(data)
+        for secret in ('s3cret', 'x' * 100):
+            self.run_case('sign', secret, ota_patch.sign(data, secret), path)
+
+    def test_hmac_vectors(self):
+        """Signatures match Python's hmac for keys and uploads around the block size"""
+        rng = random.Random(5)
+        path = os.path.join(self.build_dir, 'vector.bin')
+        for key_length in (1, 32, 63, 64, 65, 200):
+            secret = ''.join(rng.choice(string.ascii_letters + string.digits) for _ in range(key_length))
+            for size in (1, 55, 56, 64, 65, 4097):
+                data = rng.randbytes(size)
+                with open(path, 'wb') as f:
+                    f.write(data)
+                expected = hmac.new(secret.encode(), data, hashlib.sha256).hexdigest()
+                self.run_case('sign', secret, expected, path)
+
+    def test_generated_patches(self):
+        """Patches from the host tool apply byte for byte on the device side"""
+        old = make_image(3, 64 * 1024)
+        code = random.Random(4).randbytes(200)
+        for new in (old, insert_code(old, 20000, code), old[:30000] + old[31000:], code * 40):
+            self.apply_on_device(old, new)
+
+    def test_benchmark(self):
+        """Apply throughput for a 1 MB image with relocated code"""
+        old = make_image(5, 1024 * 1024)
+        new = insert_code(old, 400000, random.Random(6).randbytes(300))
+        patch = ota_patch.make_patch(old, new)
+        print('\npatch %d bytes for %d byte image (%.1f%%)' % (len(patch), len(new), 100.0 * len(patch) / len(new)))
+        print(self.apply_on_device(old, new))
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,61 @@
+#!/usr/bin/env python3
+"""
+Unit Tests for the Receiver Packet Ring
+
+Checks that the receiver's packet ring keeps order, drops rather than
+overwrites when full, survives index wrap, and loses nothing between a
+producer and consumer on separate threads. Also compares callback time
+and dropped frames with the callback doing all the work inline, on a
+model of the receiver's scheduler and UART.
+"""
+
+import os
+import re
+import unittest
+
+from host_harness import RECEIVER_DIR, PACKET_DIR, HostHarnessTest
+
+
+class TestPacketRing(HostHarnessTest):
+    """Test the packet ring on the host"""
+
+    HARNESS = 'packet_ring'
+    INCLUDE_DIRS = (RECEIVER_DIR, PACKET_DIR)
+    SOURCES = (os.path.join(RECEIVER_DIR, 'packet_ring.cpp'),
+               os.path.join(PACKET_DIR, 'espnow_packet.cpp'))
+    FLAGS = ('-pthread',)
+
+    def test_order(self):
+        """Packets come out whole and in order"""
+        self.run_case('order')
+
+    def test_full(self):
+        """A full ring drops and counts the newest packet"""
+        self.run_case('full')
+
+    def test_wrap(self):
+        """The indices wrap without losing a packet"""
+        self.run_case('wrap')
+
+    def test_threads(self):
+        """A producer and a consumer thread pass every packet intact"""
+        self.run_case('threads')
+
+    def test_timeline(self):
+        """The callback stays short and no frame is dropped under load"""
+        output = self.run_case('timeline')
+        print('\n' + output.strip())
+        runs = {(m.group(1), m.group(2)): (float(m.group(3)), float(m.group(4)), int(m.group(5)))
+                for m in re.finditer(r'TIMELINE (\w+) (\w+) callback ([\d.]+) us mean ([\d.]+) us max, '
+                                     r'dropped (\d+) of \d+', output)}
+
+        for name in ('one_node', 'bursts', 'four_nodes'):
+            inline, ring = runs[(name, 'inline')], runs[(name, 'ring')]
+            self.assertLess(ring[1], inline[1] / 5, name)
+            self.assertEqual(ring[2], 0, name)
+        # The inline callback loses frames once the UART backs up
+        self.assertGreater(runs[('four_nodes', 'inline')][2], 0)
+
+
+if __name__ == '__main__':
+    unittest.main(verbosity=2)
@@ -0,0 +1,59 @@
+#!/usr/bin/env python3
+"""
+Unit Tests for the Transmitter Range Filter
+
+Checks that the Hampel filter passes clean readings through, replaces
+outliers with the window median, follows a real change in distance, and
+agrees with a filter that sorts its window for every ping. Also replays
+echo sequences with missed echoes, ghosts and ring-down, and compares
+false alarms and missed alerts with one raw ping per sample.
+"""
+
+import os
+import re
+import unittest
+
+from host_harness import TRANSMITTER_DIR, HostHarnessTest
+
+
+class TestRangeFilter(HostHarnessTest):
+    """Test the range filter on the host"""
+
+    HARNESS = 'range_filter'
+    INCLUDE_DIRS = (TRANSMITTER_DIR,)
+    SOURCES = (os.path.join(TRANSMITTER_DIR, 'range_filter.cpp'),)
+
+    def test_passthrough(self):
+        """A window of one reports each valid ping as it is"""
+        self.run_case('passthrough')
+
+    def test_outliers(self):
+        """Ghosts, missed echoes and ring-down are replaced by the median"""
+        self.run_case('outliers')
+
+    def test_step(self):
+        """A real change is followed once it holds most of the window"""
+        self.run_case('step')
+
+    def test_against_reference(self):
+        """Matches a filter that sorts its window for every ping"""
+        self.run_case('against_reference')
+
+    def test_sequences(self):
+        """Far fewer false alarms than raw pings, no more missed alerts"""
+        output = self.run_case('sequences')
+        print('\n' + output.strip())
+        runs = {(m.group(1), m.group(2)): (float(m.group(3)), float(m.group(4)), float(m.group(5)))
+                for m in re.finditer(r'SEQUENCE (\w+) (\w+) false alarms ([\d.]+)% missed ([\d.]+)% '
+                                     r'reaction ([\d.]+) ms', output)}
+
+        for name in ('clear', 'wall', 'crossing', 'clutter'):
+            raw, filtered = runs[(name, 'raw')], runs[(name, 'filtered')]
+            self.assertLess(filtered[0], raw[0] / 4, name)
+            self.assertLessEqual(filtered[1], raw[1], name)
+        # One burst later than a raw ping, no more
+        self.assertLess(runs[('crossing', 'filtered')][2], runs[('crossing', 'raw')][2] + 50)
+
+
+if __name__ == '__main__':
+    unittest.main(verbosity=2)
@@ -0,0 +1,43 @@
+#!/usr/bin/env python3
+"""
+Unit Tests for the API Rate Limiter
+
+Checks that each client gets its burst and then the refill rate, that
+one client's requests never spend another's tokens, that hundreds of
+clients fit the fixed table without touching the heap, and that idle
+clients age out.
+"""
+
+import os
+import unittest
+
+from host_harness import CONTROLLER_DIR, HostHarnessTest
+
+
+class TestRateLimiter(HostHarnessTest):
+    """Test the token-bucket rate limiter on the host"""
+
+    HARNESS = 'rate_limiter'
+    INCLUDE_DIRS = (CONTROLLER_DIR,)
+    SOURCES = (os.path.join(CONTROLLER_DIR, 'rate_limiter.cpp'),)
+    STD = 'c++17'
+
+    def test_bucket(self):
+        """Burst, refill and sustained rate of one client"""
+        self.run_case('bucket')
+
+    def test_independent_clients(self):
+        """A throttled client does not affect the others"""
+        self.run_case('independent_clients')
+
+    def test_many_clients(self):
+        """Hundreds of clients stay within the fixed table with no allocation"""
+        self.run_case('many_clients')
+
+    def test_aging(self):
+        """Idle clients give up their slots without evictions"""
+        self.run_case('aging')
+
+
+if __name__ == '__main__':
+    unittest.main(verbosity=2)
@@ -0,0 +1,44 @@
+#!/usr/bin/env python3
+"""
+Unit Tests for the Response Cache
+
+Checks that a cached response is served until something it depends on
+changes, that a request arriving mid-build waits for that build rather
+than starting another, and that oversized bodies bypass the cache. Also
+reports the hit rate and CPU saved over an hour of polling clients.
+"""
+
+import os
+import unittest
+
+from host_harness import CONTROLLER_DIR, HostHarnessTest
+
+
+class TestResponseCache(HostHarnessTest):
+    """Test the response cache on the host"""
+
+    HARNESS = 'response_cache'
+    INCLUDE_DIRS = (CONTROLLER_DIR,)
+    SOURCES = (os.path.join(CONTROLLER_DIR, 'response_cache.cpp'),
+               os.path.join(CONTROLLER_DIR, 'json_stream.cpp'))
+    FLAGS = ('-pthread',)
+
+    def test_hit_miss(self):
+        """Bodies are rebuilt only when a listed source changes"""
+        self.run_case('hit_miss')
+
+    def test_coalesce(self):
+        """A request during a build shares that build"""
+        self.run_case('coalesce')
+
+    def test_overflow(self):
+        """Bodies too large to cache are reported and not kept"""
+        self.run_case('overflow')
+
+    def test_polling(self):
+        """Hit rate and CPU saved under multi-client polling"""
+        print(self.run_case('polling'))
+
+
+if __name__ == '__main__':
+    unittest.main(verbosity=2)
@@ -0,0 +1,42 @@
+#!/usr/bin/env python3
+"""
+Unit Tests for the API Route Table
+
+Checks that every API route reaches its handler through the perfect
+hash, that unknown paths and methods are rejected, and that latency
+histograms are kept per route. Also compares dispatch time with the old
+linear String lookup.
+"""
+
+import os
+import unittest
+
+from host_harness import CONTROLLER_DIR, HostHarnessTest
+
+
+class TestRouteTable(HostHarnessTest):
+    """Test the perfect-hash router on the host"""
+
+    HARNESS = 'route_table'
+    INCLUDE_DIRS = (CONTROLLER_DIR,)
+    SOURCES = (os.path.join(CONTROLLER_DIR, 'route_table.cpp'),)
+
+    def test_all_routes_found(self):
+        """Every route has its own slot and dispatches to its handler"""
+        self.run_case('all_routes_found')
+
+    def test_unknown_rejected(self):
+        """Near-miss paths and wrong methods are not routed"""
+        self.run_case('unknown_rejected')
+
+    def test_stats(self):
+        """Access counts and latency histogram buckets"""
+        self.run_case('stats')
+
+    def test_benchmark(self):
+        """Perfect-hash dispatch agrees with, and is timed against, linear lookup"""
+        print(self.run_case('benchmark'))
+
+
+if __name__ == '__main__':
+    unittest.main(verbosity=2)
@@ -0,0 +1,63 @@
+#!/usr/bin/env python3
+"""
+Unit Tests for the Transmitter Sampling Rate Controller
+
+Checks that sampling speeds up near obstacles and for fast approaches,
+backs off gradually once the path clears, and reacts at once to an
+obstacle stepping into view. Also compares reaction latency and sensor
+and radio energy with fixed-rate sampling on a simulated HC-SR04.
+"""
+
+import os
+import re
+import unittest
+
+from host_harness import TRANSMITTER_DIR, HostHarnessTest
+
+
+class TestSampleRate(HostHarnessTest):
+    """Test the sampling rate controller on the host"""
+
+    HARNESS = 'sample_rate'
+    INCLUDE_DIRS = (TRANSMITTER_DIR,)
+    SOURCES = (os.path.join(TRANSMITTER_DIR, 'sample_rate.cpp'),
+               os.path.join(TRANSMITTER_DIR, 'echo_capture.cpp'))
+
+    def test_proximity(self):
+        """Nearer obstacles are sampled faster"""
+        self.run_case('proximity')
+
+    def test_closing(self):
+        """An approaching obstacle is sampled often enough to track it"""
+        self.run_case('closing')
+
+    def test_backoff(self):
+        """The interval doubles back to the slowest and drops at once"""
+        self.run_case('backoff')
+
+    def test_jump(self):
+        """A new obstacle in view is not read as closing speed"""
+        self.run_case('jump')
+
+    def test_jitter(self):
+        """Centimetre jitter on a static scene still backs off"""
+        self.run_case('jitter')
+
+    def test_regimes(self):
+        """Faster reaction when approaching, no slower or costlier when empty"""
+        output = self.run_case('regimes')
+        print('\n' + output.strip())
+        power = {(m.group(1), m.group(2)): float(m.group(3))
+                 for m in re.finditer(r'REGIME (\w+) (\w+) [\d.]+ Hz ([\d.]+) mW', output)}
+        reaction = {(m.group(1), m.group(2)): (float(m.group(3)), float(m.group(4)))
+                    for m in re.finditer(r'REGIME (\w+) (\w+) .*reaction ([\d.]+) ms \(max ([\d.]+)\)',
+                                         output)}
+
+        self.assertLess(reaction[('approach', 'adaptive')][0], reaction[('approach', 'fixed')][0] / 3)
+        self.assertLessEqual(reaction[('step_in', 'adaptive')][1], reaction[('step_in', 'fixed')][1] + 5)
+        self.assertLess(power[('empty', 'adaptive')], power[('empty', 'fixed')] * 1.05)
+        self.assertLess(power[('approach', 'adaptive')], power[('approach', 'fastest')])
+
+
+if __name__ == '__main__':
+    unittest.main(verbosity=2)
@@ -0,0 +1,77 @@
+#!/usr/bin/env python3
+"""
+Unit Tests for the Transmitter Send Gate
+
+Checks that a scan is sent when a reading crosses a haptic band, moves
+SEND_DELTA, or a sensor drops out or returns; that a quiet scene is
+still sent every heartbeat; that an undelivered send is retried on the
+next scan; and that a delta of 0 sends everything. Also compares packets
+and transmit energy on walking traces with sending every scan.
+"""
+
+import os
+import re
+import unittest
+
+from host_harness import TRANSMITTER_DIR, PACKET_DIR, HostHarnessTest
+
+
+HEARTBEAT_INTERVAL = 1000
+SAMPLE_INTERVAL_MAX = 200
+
+
+class TestSendGate(HostHarnessTest):
+    """Test the send gate on the host"""
+
+    HARNESS = 'send_gate'
+    INCLUDE_DIRS = (TRANSMITTER_DIR, PACKET_DIR)
+    SOURCES = (os.path.join(TRANSMITTER_DIR, 'send_gate.cpp'),
+               os.path.join(TRANSMITTER_DIR, 'sample_rate.cpp'))
+
+    def test_levels(self):
+        """One motor more per 20 cm band inside 100 cm"""
+        self.run_case('levels')
+
+    def test_level_cross(self):
+        """Crossing a haptic band is sent at once, however small the step"""
+        self.run_case('level_cross')
+
+    def test_delta(self):
+        """Within a band, a change of SEND_DELTA from the last packet is sent"""
+        self.run_case('delta')
+
+    def test_heartbeat(self):
+        """A static scene is still sent every heartbeat"""
+        self.run_case('heartbeat')
+
+    def test_failed(self):
+        """An undelivered send is retried on the next scan"""
+        self.run_case('failed')
+
+    def test_sensors(self):
+        """A sensor dropping out or coming back is sent"""
+        self.run_case('sensors')
+
+    def test_disabled(self):
+        """A delta of 0 sends every scan"""
+        self.run_case('disabled')
+
+    def test_traces(self):
+        """Far fewer packets on walking traces, with no band change held back"""
+        output = self.run_case('traces')
+        print('\n' + output.strip())
+        runs = {(m.group(1), m.group(2)): (float(m.group(3)), float(m.group(4)), int(m.group(5)))
+                for m in re.finditer(r'TRACE (\w+) (\w+) ([\d.]+) packets/min ([\d.]+) mJ/min '
+                                     r'heartbeats \d+ max gap (\d+) ms', output)}
+
+        for name in ('clear', 'wall', 'crossing', 'standing'):
+            every, change = runs[(name, 'every')], runs[(name, 'change')]
+            self.assertLess(change[0], every[0] / 3, name)
+            self.assertLess(change[1], every[1] / 3, name)
+            self.assertLessEqual(change[2], HEARTBEAT_INTERVAL + SAMPLE_INTERVAL_MAX, name)
+        # A quiet scene is held to the heartbeat
+        self.assertLessEqual(runs[('clear', 'change')][0], 60000 / HEARTBEAT_INTERVAL + 1)
+
+
+if __name__ == '__main__':
+    unittest.main(verbosity=2)
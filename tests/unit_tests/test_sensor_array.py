@@ -0,0 +1,71 @@
+#!/usr/bin/env python3
+"""
+Unit Tests for the Transmitter Sensor Array
+
+Checks that sensors fire by slot a stagger apart, that sensors sharing a
+slot fire together, that a missing sensor or one still holding its echo
+line does not stall the scan, and that only a lone sensor bursts. Also
+sweeps schedules and staggers in a corridor with late echoes, raw and
+with the configured filter, and reports scan rate and wrong readings.
+"""
+
+import os
+import re
+import unittest
+
+from host_harness import TRANSMITTER_DIR, HostHarnessTest
+
+
+def config_value(name):
+    with open(os.path.join(TRANSMITTER_DIR, 'config.h')) as f:
+        return int(re.search(r'#define %s (\d+)' % name, f.read()).group(1))
+
+
+class TestSensorArray(HostHarnessTest):
+    """Test the sensor array scheduling on the host"""
+
+    HARNESS = 'sensor_array'
+    INCLUDE_DIRS = (TRANSMITTER_DIR,)
+    SOURCES = (os.path.join(TRANSMITTER_DIR, 'sensor_array.cpp'),
+               os.path.join(TRANSMITTER_DIR, 'range_filter.cpp'),
+               os.path.join(TRANSMITTER_DIR, 'echo_capture.cpp'))
+
+    def test_round_robin(self):
+        """Sensors fire one at a time, a stagger apart"""
+        self.run_case('round_robin')
+
+    def test_interleaved(self):
+        """Sensors sharing a slot fire together and shorten the scan"""
+        self.run_case('interleaved')
+
+    def test_missing(self):
+        """A missing sensor does not hold up the scan"""
+        self.run_case('missing')
+
+    def test_deferred(self):
+        """A sensor still holding its line defers its slot"""
+        self.run_case('deferred')
+
+    def test_burst(self):
+        """A scan pings each sensor PING_BURST times and reports the filtered distance"""
+        self.run_case('burst')
+
+    def test_crosstalk(self):
+        """The default stagger and filter reject crosstalk and still scan at 5 Hz or more"""
+        output = self.run_case('crosstalk')
+        print('\n' + output.strip())
+        runs = {(m.group(1), int(m.group(2))): (float(m.group(3)), float(m.group(4)))
+                for m in re.finditer(r'SCHEDULE (\w+) stagger (\d+) us .* ([\d.]+) Hz wrong ([\d.]+)%',
+                                     output)}
+        stagger = config_value('SENSOR_STAGGER')
+
+        for schedule in ('round_robin', 'interleaved', 'round_robin_filtered', 'interleaved_filtered'):
+            hz, wrong = runs[(schedule, stagger)]
+            self.assertEqual(wrong, 0, schedule)
+            self.assertGreaterEqual(hz, 5, schedule)
+        self.assertGreater(runs[('together', 0)][1], 0)
+        self.assertGreater(runs[('round_robin', 0)][1], 0)
+
+
+if __name__ == '__main__':
+    unittest.main(verbosity=2)
@@ -0,0 +1,56 @@
+#!/usr/bin/env python3
+"""
+Unit Tests for the Soft Timer Service
+
+Checks that timers expire on the exact tick at every wheel level and
+agree with a brute-force model over random schedules, that periodic
+timers stay on period, that callbacks may add and cancel timers, that
+the next deadline the main loop sleeps until is correct, and that
+posted events wake it.
+"""
+
+import os
+import unittest
+
+from host_harness import CONTROLLER_DIR, HostHarnessTest
+
+
+class TestSoftTimer(HostHarnessTest):
+    """Test the hierarchical timer wheel on the host"""
+
+    HARNESS = 'soft_timer'
+    INCLUDE_DIRS = (CONTROLLER_DIR,)
+    SOURCES = (os.path.join(CONTROLLER_DIR, 'soft_timer.cpp'),)
+    STD = 'c++17'
+
+    def test_one_shot_exact(self):
+        """One-shot timers fire on their exact tick at every wheel level"""
+        self.run_case('one_shot_exact')
+
+    def test_random_against_model(self):
+        """Random starts, stops and clock jumps match a brute-force model"""
+        self.run_case('random_against_model')
+
+    def test_periodic(self):
+        """Periodic timers keep their phase and can be stopped"""
+        self.run_case('periodic')
+
+    def test_reentrant(self):
+        """Callbacks can stop and restart timers in the slot being expired"""
+        self.run_case('reentrant')
+
+    def test_ms_until_next(self):
+        """The reported wait never oversleeps a deadline"""
+        self.run_case('ms_until_next')
+
+    def test_ms_until_next_exact(self):
+        """The reported wait is exact for near deadlines"""
+        self.run_case('ms_until_next_exact')
+
+    def test_events(self):
+        """Event timers and posted events reach the main loop"""
+        self.run_case('events')
+
+
+if __name__ == '__main__':
+    unittest.main(verbosity=2)
@@ -0,0 +1,118 @@
+#!/usr/bin/env python3
+"""
+Unit Tests for the UDP State Broadcast
+
+Checks the state packet's byte layout and round trip, and that urgent
+changes are repeated. Also compares the cost of one broadcast with HTTP
+polling by up to WIFI_MAX_CLIENTS listeners, and checks that the Python
+listener in tools/state_listener decodes packets sent over loopback.
+"""
+
+import importlib.util
+import os
+import socket
+import unittest
+
+from host_harness import REPO_ROOT, CONTROLLER_DIR, HostHarnessTest
+
+TOOL = os.path.join(REPO_ROOT, 'tools', 'state_listener', 'state_listener.py')
+
+spec = importlib.util.spec_from_file_location('state_listener', TOOL)
+state_listener = importlib.util.module_from_spec(spec)
+spec.loader.exec_module(state_listener)
+
+
+def snapshot(sequence, uptime_ms):
+    return state_listener.StateSnapshot(0, sequence, uptime_ms, 0.0, 0.0, None, 0, 0, 0, 0)
+
+
+class TestStateListener(unittest.TestCase):
+    """Test the listener's sequence tracking"""
+
+    def test_repeats_and_loss(self):
+        """Urgent copies are dropped and sequence gaps counted as lost"""
+        tracker = state_listener.StateTracker()
+        self.assertTrue(tracker.accept(snapshot(1, 1000)))
+        self.assertTrue(tracker.accept(snapshot(2, 2000)))
+        self.assertFalse(tracker.accept(snapshot(2, 2000)))
+        self.assertTrue(tracker.accept(snapshot(5, 5000)))
+        self.assertEqual((tracker.received, tracker.duplicates, tracker.lost), (3, 1, 2))
+
+    def test_restart(self):
+        """A reboot restarts the sequence without counting losses"""
+        tracker = state_listener.StateTracker()
+        tracker.accept(snapshot(900, 900000))
+        self.assertTrue(tracker.accept(snapshot(1, 800)))
+        self.assertEqual((tracker.restarts, tracker.lost), (1, 0))
+
+    def test_rejects_other_packets(self):
+        """Short packets and other traffic on the port are ignored"""
+        with self.assertRaises(ValueError):
+            state_listener.decode(b'DS\x01')
+        with self.assertRaises(ValueError):
+            state_listener.decode(b'\x00' * 32)
+
+
+class TestStateBroadcast(HostHarnessTest):
+    """Test the state packet encoder on the host"""
+
+    HARNESS = 'state_broadcast'
+    INCLUDE_DIRS = (CONTROLLER_DIR,)
+    SOURCES = (os.path.join(CONTROLLER_DIR, 'state_broadcast.cpp'),
+               os.path.join(CONTROLLER_DIR, 'json_stream.cpp'))
+
+    def device_packet(self):
+        return bytes.fromhex(self.run_case('packet').split()[0])
+
+    def test_layout(self):
+        """Fields sit at the documented offsets, little endian"""
+        self.run_case('layout')
+
+    def test_round_trip(self):
+        """Packets decode to what was encoded; other data is rejected"""
+        self.run_case('round_trip')
+
+    def test_urgent(self):
+        """Urgent packets are flagged and repeated under one sequence number"""
+        self.run_case('urgent')
+
+    def test_interleave(self):
+        """Interval packets never cancel or overtake a fall's repeats"""
+        self.run_case('interleave')
+
+    def test_listener_decodes(self):
+        """The Python client reads the device's packet"""
+        s = state_listener.decode(self.device_packet())
+        self.assertEqual(s.sequence, 1)
+        self.assertTrue(s.urgent and s.alert and s.gps_fix)
+        self.assertFalse(s.battery_low or s.still)
+        self.assertAlmostEqual(s.latitude, 12.8406)
+        self.assertAlmostEqual(s.longitude, -80.1534)
+        self.assertEqual((s.uptime_ms, s.last_fall_s, s.version), (123456, 98, 0xDEADBEEF))
+        self.assertEqual((s.falls, s.battery_level, s.wifi_clients), (3, 76, 2))
+
+    def test_listener_receives(self):
+        """The listener receives over UDP and drops the urgent repeats"""
+        packet = self.device_packet()
+        listener = state_listener.StateListener(port=0, address='127.0.0.1')
+        port = listener.sock.getsockname()[1]
+        sender = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        try:
+            for _ in range(4):
+                sender.sendto(packet, ('127.0.0.1', port))
+            s = listener.receive(timeout=2)
+            self.assertIsNotNone(s)
+            self.assertEqual(s.sequence, 1)
+            self.assertIsNone(listener.receive(timeout=0.2))
+            self.assertEqual(listener.tracker.duplicates, 3)
+        finally:
+            sender.close()
+            listener.close()
+
+    def test_benchmark(self):
+        """Broadcast cost stays flat as listeners are added"""
+        print(self.run_case('benchmark'))
+
+
+if __name__ == '__main__':
+    unittest.main()
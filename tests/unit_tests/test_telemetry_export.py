@@ -0,0 +1,124 @@
+#!/usr/bin/env python3
+"""
+Unit Tests for the MQTT Telemetry Uplink
+
+Checks MQTT packet framing against scripted broker bytes, keepalive and
+its timeouts, and that a telemetry batch decodes in tools/telemetry to
+the records that went in. Also compares an hour of batched telemetry
+with publishing every sample. With mosquitto installed, a batch is
+published to a local broker and read back.
+"""
+
+import importlib.util
+import os
+import shutil
+import socket
+import subprocess
+import time
+import unittest
+
+from host_harness import REPO_ROOT, CONTROLLER_DIR, HostHarnessTest
+
+TOOL = os.path.join(REPO_ROOT, 'tools', 'telemetry', 'telemetry_decode.py')
+
+spec = importlib.util.spec_from_file_location('telemetry_decode', TOOL)
+telemetry_decode = importlib.util.module_from_spec(spec)
+spec.loader.exec_module(telemetry_decode)
+
+
+class TestTelemetryDecode(unittest.TestCase):
+    """Test the decoder on hand-built batches"""
+
+    def test_rejects_bad_batches(self):
+        """Unknown versions, types and truncated records are errors"""
+        with self.assertRaises(ValueError):
+            telemetry_decode.decode(b'\x02')
+        with self.assertRaises(ValueError):
+            telemetry_decode.decode(b'\x01\x89\x01\x01')
+        with self.assertRaises(ValueError):
+            telemetry_decode.decode(b'\x01\x83\x01')
+        with self.assertRaises(ValueError):
+            telemetry_decode.decode(b'\x01\x03\x0a\x00\x00')
+
+    def test_empty(self):
+        """A batch may carry no records"""
+        self.assertEqual(telemetry_decode.decode(b'\x01'), [])
+
+
+class TestTelemetryExport(HostHarnessTest):
+    """Test the MQTT session and batch encoder on the host"""
+
+    HARNESS = 'telemetry_export'
+    INCLUDE_DIRS = (CONTROLLER_DIR,)
+    SOURCES = (os.path.join(CONTROLLER_DIR, 'telemetry_export.cpp'),
+               os.path.join(CONTROLLER_DIR, 'telemetry_queue.cpp'),
+               os.path.join(CONTROLLER_DIR, 'mqtt_session.cpp'))
+
+    def check_sample(self, records):
+        self.assertEqual([r.type for r in records], ['track', 'track', 'fall', 'summary', 'track'])
+        self.assertEqual([(r.boot, r.uptime_s) for r in records],
+                         [(7, 100000), (7, 100010), (7, 100013), (7, 100060), (8, 5)])
+        self.assertAlmostEqual(records[0].latitude, 12.8406)
+        self.assertAlmostEqual(records[1].longitude, 80.15338)
+        self.assertAlmostEqual(records[2].latitude, 12.840652)
+        self.assertAlmostEqual(records[4].latitude, -33.8688)
+        self.assertAlmostEqual(records[4].longitude, 151.2093)
+        s = records[3]
+        self.assertEqual((s.battery_level, s.active_s, s.falls), (76, 41, 3))
+        self.assertEqual(s.flags, telemetry_decode.FLAG_GPS_FIX | telemetry_decode.FLAG_ALERT)
+
+    def test_connect(self):
+        """CONNECT bytes, CONNACK accepted or refused, CONNACK timeout"""
+        self.run_case('connect')
+
+    def test_publish(self):
+        """QoS 1 framing, one message in flight, PUBACK split across reads"""
+        self.run_case('publish')
+
+    def test_keepalive(self):
+        """Pings after an idle keepalive; a missing answer drops the session"""
+        self.run_case('keepalive')
+
+    def test_batch_encode(self):
+        """Delta-coded records, skipped layouts, batches capped in size"""
+        self.run_case('batch_encode')
+
+    def test_decoder_reads_batch(self):
+        """The Python decoder reads the device's batch"""
+        batch = bytes.fromhex(self.run_case('batch').split()[0])
+        self.check_sample(telemetry_decode.decode(batch))
+
+    def test_benchmark(self):
+        """An hour of telemetry in far fewer publishes and bytes than per sample"""
+        print(self.run_case('benchmark'))
+
+    @unittest.skipIf(shutil.which('mosquitto') is None or shutil.which('mosquitto_sub') is None,
+                     "mosquitto is required for the broker test")
+    def test_local_broker(self):
+        """A batch published with QoS 1 to mosquitto is acknowledged and decodes"""
+        with socket.socket() as s:
+            s.bind(('127.0.0.1', 0))
+            port = s.getsockname()[1]
+        broker = subprocess.Popen(['mosquitto', '-p', str(port)],
+                                  stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+        subscriber = None
+        try:
+            time.sleep(0.5)
+            topic = 'drishti/test/telemetry'
+            subscriber = subprocess.Popen(
+                ['mosquitto_sub', '-h', '127.0.0.1', '-p', str(port), '-t', topic, '-C', '1',
+                 '-F', '%x', '-W', '10'],
+                stdout=subprocess.PIPE, text=True)
+            time.sleep(0.5)
+            print(self.run_case('broker', '127.0.0.1', str(port), topic))
+            out, _ = subscriber.communicate(timeout=10)
+            self.check_sample(telemetry_decode.decode(bytes.fromhex(out.strip())))
+        finally:
+            if subscriber and subscriber.poll() is None:
+                subscriber.kill()
+            broker.terminate()
+            broker.wait(timeout=5)
+
+
+if __name__ == '__main__':
+    unittest.main()
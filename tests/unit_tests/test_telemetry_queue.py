@@ -0,0 +1,45 @@
+#!/usr/bin/env python3
+"""
+Unit Tests for the Telemetry Flash Queue
+
+Checks that the flash queue hands records back in order, recovers them
+after a reboot or a write torn by power loss, and drops the oldest once
+the ring is full, on NOR flash emulated in RAM.
+"""
+
+import os
+import unittest
+
+from host_harness import CONTROLLER_DIR, HostHarnessTest
+
+
+class TestTelemetryQueue(HostHarnessTest):
+    """Test the flash queue on the host"""
+
+    HARNESS = 'telemetry_queue'
+    INCLUDE_DIRS = (CONTROLLER_DIR,)
+    SOURCES = (os.path.join(CONTROLLER_DIR, 'telemetry_queue.cpp'),)
+
+    def test_push_peek(self):
+        """Records come back in order until marked sent"""
+        self.run_case('push_peek')
+
+    def test_reboot(self):
+        """Unsent records survive a remount, sent ones do not return"""
+        self.run_case('reboot')
+
+    def test_torn_write(self):
+        """A record cut short by a reset is skipped at mount"""
+        self.run_case('torn_write')
+
+    def test_full_ring(self):
+        """A full ring drops the oldest sector and keeps the newest in order"""
+        self.run_case('full_ring')
+
+    def test_sent_in_place(self):
+        """Marking sent clears a byte without erasing; bad partitions are formatted"""
+        self.run_case('sent_in_place')
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,53 @@
+#!/usr/bin/env python3
+"""
+Unit Tests for the GPS Breadcrumb Track
+
+Checks that coordinates survive the zigzag varint round trip, that
+stored blocks decode to exactly the points the simplifier kept, that the
+simplifier keeps corners and drops jitter inside its dead band, that
+/track stays within its point budget, and that the oldest block is
+evicted first. Also reports the bytes a day of 1 Hz fixes takes.
+"""
+
+import os
+import unittest
+
+from host_harness import CONTROLLER_DIR, HostHarnessTest
+
+
+class TestTrackStore(HostHarnessTest):
+    """Test the track store on the host"""
+
+    HARNESS = 'track_store'
+    INCLUDE_DIRS = (CONTROLLER_DIR,)
+    SOURCES = (os.path.join(CONTROLLER_DIR, 'track_store.cpp'),)
+
+    def test_varint(self):
+        """Zigzag varints round trip at every length"""
+        self.run_case('varint')
+
+    def test_round_trip(self):
+        """Stored points decode to what the simplifier emitted"""
+        self.run_case('round_trip')
+
+    def test_simplifier(self):
+        """Lines keep their ends, corners stay, jitter is dropped, curves stay within tolerance"""
+        self.run_case('simplifier')
+
+    def test_budget(self):
+        """A query never returns more than max points; 1 is the latest, 2 the ends"""
+        self.run_case('budget')
+
+    def test_evict(self):
+        """A full ring drops its oldest block and still decodes"""
+        self.run_case('evict')
+
+    def test_day(self):
+        """A day at 1 Hz fits without eviction"""
+        out = self.run_case('day')
+        print(out)
+        self.assertIn('86400 fixes', out)
+
+
+if __name__ == '__main__':
+    unittest.main()
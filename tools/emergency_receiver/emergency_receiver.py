@@ -0,0 +1,236 @@
+#!/usr/bin/env python3
+"""
+DrishtiGuide Emergency Receiver
+
+Local stand-in for the sinks of the ESP32 controller's emergency lane: a
+webhook that accepts the fall POSTs, and a listener for the emergency
+packets broadcast over UDP (emergency_lane.h). Both drop retries of an
+event they already have, by event ID. Every packet, a retry too, is
+acknowledged to its source: the controller counts the broadcast as
+delivered only then, and sends it again until one arrives.
+
+Usage on a machine joined to BlindStick_AP (set EMERGENCY_WEBHOOK_HOST to
+its address):
+    python3 emergency_receiver.py                 # webhook on 8080, UDP on 4210
+    python3 emergency_receiver.py --fail 2        # answer 503 twice, to watch the retries
+"""
+
+import argparse
+import json
+import queue
+import socket
+import struct
+import sys
+import threading
+import time
+from dataclasses import dataclass, asdict
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+DEFAULT_HTTP_PORT = 8080
+DEFAULT_UDP_PORT = 4210         # Shared with the state broadcast
+MAGIC = 0x4544                  # "DE"
+ACK_MAGIC = 0x4144              # "DA"
+VERSION = 1
+PACKET = struct.Struct('<HBBIIiiHBB')
+ACK = struct.Struct('<HBBI')
+
+FLAG_GPS_FIX = 0x01
+
+
+@dataclass
+class FallEvent:
+    id: int
+    uptime_ms: int
+    latitude: float
+    longitude: float
+    gps_fix: bool
+    falls: int
+    attempt: int
+    source: str
+    received: float             # time.time()
+
+
+def decode_packet(data):
+    """FallEvent from an emergency packet; ValueError if it is not one"""
+    if len(data) < PACKET.size:
+        raise ValueError('packet too short')
+    magic, version, flags, event_id, uptime_ms, lat, lon, falls, attempt, _ = PACKET.unpack_from(data)
+    if magic != MAGIC or version < VERSION:
+        raise ValueError('not an emergency packet')
+    return FallEvent(event_id, uptime_ms, lat / 1e6, lon / 1e6, bool(flags & FLAG_GPS_FIX),
+                     falls, attempt, 'udp', time.time())
+
+
+def encode_ack(event):
+    """Acknowledgement of an emergency packet"""
+    return ACK.pack(ACK_MAGIC, VERSION, event.attempt, event.id)
+
+
+def decode_json(body):
+    """FallEvent from a webhook or SSE body"""
+    d = json.loads(body)
+    if d.get('event') != 'fall':
+        raise ValueError('not a fall event')
+    return FallEvent(int(d['id']), int(d['uptimeMs']), float(d['latitude']), float(d['longitude']),
+                     bool(d['gpsFix']), int(d['falls']), int(d['attempt']), 'webhook', time.time())
+
+
+class Deduplicator:
+    """Remembers event IDs per source; counts what it has seen again"""
+
+    def __init__(self):
+        self.seen = set()
+        self.unique = 0
+        self.duplicates = 0
+        self.lock = threading.Lock()
+
+    def accept(self, event):
+        key = (event.source, event.id)
+        with self.lock:
+            if key in self.seen:
+                self.duplicates += 1
+                return False
+            self.seen.add(key)
+            self.unique += 1
+            return True
+
+
+class EmergencyReceiver:
+    """Webhook and UDP listener feeding one queue of new events.
+
+    fail answers that many POSTs with 503; drop reads and records that
+    many and closes without answering, as if the reply were lost;
+    lose_acks records that many packets without acknowledging them.
+    """
+
+    def __init__(self, http_port=DEFAULT_HTTP_PORT, udp_port=DEFAULT_UDP_PORT, address='',
+                 fail=0, drop=0, lose_acks=0):
+        self.events = queue.Queue()
+        self.dedup = Deduplicator()
+        self.posts = 0
+        self.acks = 0
+        self.fail = fail
+        self.drop = drop
+        self.lose_acks = lose_acks
+        receiver = self
+
+        class Handler(BaseHTTPRequestHandler):
+            def do_POST(self):
+                length = int(self.headers.get('Content-Length', 0))
+                body = self.rfile.read(length)
+                receiver.posts += 1
+                if receiver.fail > 0:
+                    receiver.fail -= 1
+                    self.send_response(503)
+                    self.send_header('Content-Length', '0')
+                    self.end_headers()
+                    return
+                try:
+                    event = decode_json(body)
+                except (ValueError, KeyError):
+                    self.send_response(400)
+                    self.send_header('Content-Length', '0')
+                    self.end_headers()
+                    return
+                # The same ID again is a retry: acknowledged, not recorded
+                if receiver.dedup.accept(event):
+                    receiver.events.put(event)
+                if receiver.drop > 0:
+                    receiver.drop -= 1
+                    self.close_connection = True
+                    return
+                self.send_response(200)
+                self.send_header('Content-Length', '0')
+                self.end_headers()
+
+            def log_message(self, *args):
+                pass
+
+        self.http = None
+        if http_port is not None:
+            self.http = ThreadingHTTPServer((address or '0.0.0.0', http_port), Handler)
+            threading.Thread(target=self.http.serve_forever, daemon=True).start()
+
+        self.udp = None
+        if udp_port is not None:
+            self.udp = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+            self.udp.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+            self.udp.bind((address, udp_port))
+            threading.Thread(target=self._listen_udp, daemon=True).start()
+
+    @property
+    def http_port(self):
+        return self.http.server_address[1]
+
+    @property
+    def udp_port(self):
+        return self.udp.getsockname()[1]
+
+    def _listen_udp(self):
+        while True:
+            try:
+                data, source = self.udp.recvfrom(256)
+            except OSError:
+                return
+            try:
+                event = decode_packet(data)
+            except ValueError:
+                continue        # State snapshots share the port
+            if self.dedup.accept(event):
+                self.events.put(event)
+            if self.lose_acks > 0:
+                self.lose_acks -= 1
+                continue
+            try:
+                self.udp.sendto(encode_ack(event), source)
+                self.acks += 1
+            except OSError:
+                pass
+
+    def receive(self, timeout=None):
+        """Next new event, or None on timeout"""
+        try:
+            return self.events.get(timeout=timeout)
+        except queue.Empty:
+            return None
+
+    def close(self):
+        if self.http:
+            self.http.shutdown()
+            self.http.server_close()
+        if self.udp:
+            self.udp.close()
+
+
+def format_line(e):
+    return '%s FALL #%d id %d via %s (attempt %d): %.6f, %.6f%s' % (
+        time.strftime('%H:%M:%S', time.localtime(e.received)), e.falls, e.id, e.source, e.attempt,
+        e.latitude, e.longitude, '' if e.gps_fix else ' (last known, no fix)')
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Stand-in sinks for DrishtiGuide fall notifications')
+    parser.add_argument('--http-port', type=int, default=DEFAULT_HTTP_PORT, help='Webhook port')
+    parser.add_argument('--udp-port', type=int, default=DEFAULT_UDP_PORT, help='Broadcast port')
+    parser.add_argument('--fail', type=int, default=0, help='Answer the first N POSTs with 503')
+    parser.add_argument('--json', action='store_true', help='One JSON object per event')
+    args = parser.parse_args()
+
+    receiver = EmergencyReceiver(args.http_port, args.udp_port, fail=args.fail)
+    print('Webhook on port %d, UDP on port %d' % (receiver.http_port, receiver.udp_port), file=sys.stderr)
+    try:
+        while True:
+            event = receiver.receive()
+            print(json.dumps(asdict(event)) if args.json else format_line(event))
+            sys.stdout.flush()
+    except KeyboardInterrupt:
+        pass
+    finally:
+        print('%d events, %d retries dropped' % (receiver.dedup.unique, receiver.dedup.duplicates),
+              file=sys.stderr)
+        receiver.close()
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
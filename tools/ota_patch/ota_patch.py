@@ -0,0 +1,292 @@
+#!/usr/bin/env python3
+"""
+DrishtiGuide OTA Patch Tool
+
+Builds compressed delta patches between two ESP32 controller images,
+applies them for verification, and uploads a patch or a full image to
+the controller's /update endpoint. The format matches ota_patch.h:
+
+    header  '<4sBBHIIII'  magic, version, flags, reserved,
+                          source size, source CRC-32, target size, target CRC-32
+    zlib    operations    0x01 COPY length, zigzag source delta
+                          0x02 INSERT length, bytes
+                          0x00 END
+
+Uploads are signed with HMAC-SHA256 of the whole file under the
+controller's OTA_SECRET, sent as hex in the X-OTA-Signature header.
+"""
+
+import argparse
+import hashlib
+import hmac
+import os
+import struct
+import sys
+import time
+import urllib.request
+import uuid
+import zlib
+
+MAGIC = b'DGP1'
+VERSION = 1
+HEADER = struct.Struct('<4sBBHIIII')
+
+OP_END = 0x00
+OP_COPY = 0x01
+OP_INSERT = 0x02
+
+BLOCK = 32              # Bytes hashed per index entry
+STRIDE = 16             # Index every STRIDE-th source offset
+MIN_INDEX_MATCH = 32    # Shortest copy found through the index
+MIN_CONTINUE_MATCH = 8  # Shortest copy continuing the previous offset
+
+
+class PatchError(Exception):
+    pass
+
+
+def _varint(value, out):
+    while value >= 0x80:
+        out.append((value & 0x7F) | 0x80)
+        value >>= 7
+    out.append(value)
+
+
+def _zigzag(value):
+    return (value << 1) if value >= 0 else ((-value) << 1) - 1
+
+
+def _match_length(old, q, new, p):
+    """Length of the common run of old[q:] and new[p:]"""
+    limit = min(len(old) - q, len(new) - p)
+    n = 0
+    step = 256
+    while n < limit:
+        take = min(step, limit - n)
+        if old[q + n:q + n + take] == new[p + n:p + n + take]:
+            n += take
+            continue
+        if take <= 8:
+            while n < limit and old[q + n] == new[p + n]:
+                n += 1
+            return n
+        step = take // 4
+    return n
+
+
+def _index(old):
+    table = {}
+    for q in range(0, len(old) - BLOCK + 1, STRIDE):
+        table.setdefault(old[q:q + BLOCK], q)
+    return table
+
+
+def make_ops(old, new):
+    """Operation stream turning old into new, uncompressed"""
+    old = bytes(old)
+    new = bytes(new)
+    table = _index(old)
+    ops = bytearray()
+    cursor = 0          # Source cursor, as the applier tracks it
+    shift = 0           # Source minus target offset of the last copy
+    literal_start = 0
+    p = 0
+
+    def flush_literal(end):
+        if end > literal_start:
+            ops.append(OP_INSERT)
+            _varint(end - literal_start, ops)
+            ops.extend(new[literal_start:end])
+
+    while p < len(new):
+        q = None
+        length = 0
+
+        # Code that only moved keeps its offset from the last copy
+        guess = p + shift
+        if 0 <= guess < len(old):
+            n = _match_length(old, guess, new, p)
+            if n >= MIN_CONTINUE_MATCH:
+                q, length = guess, n
+
+        if q is None and p + BLOCK <= len(new):
+            hit = table.get(new[p:p + BLOCK])
+            if hit is not None:
+                n = _match_length(old, hit, new, p)
+                if n >= MIN_INDEX_MATCH:
+                    q, length = hit, n
+
+        if q is None:
+            p += 1
+            continue
+
+        # Take back literal bytes that also match
+        while p > literal_start and q > 0 and old[q - 1] == new[p - 1]:
+            p -= 1
+            q -= 1
+            length += 1
+
+        flush_literal(p)
+        ops.append(OP_COPY)
+        _varint(length, ops)
+        _varint(_zigzag(q - cursor), ops)
+        cursor = q + length
+        shift = q - p
+        p += length
+        literal_start = p
+
+    flush_literal(len(new))
+    ops.append(OP_END)
+    return bytes(ops)
+
+
+def make_patch(old, new, level=9):
+    header = HEADER.pack(MAGIC, VERSION, 0, 0,
+                         len(old), zlib.crc32(old) & 0xFFFFFFFF,
+                         len(new), zlib.crc32(new) & 0xFFFFFFFF)
+    return header + zlib.compress(make_ops(old, new), level)
+
+
+def parse_header(patch):
+    if len(patch) < HEADER.size:
+        raise PatchError('patch shorter than its header')
+    magic, version, _, _, source_size, source_crc, target_size, target_crc = \
+        HEADER.unpack_from(patch)
+    if magic != MAGIC or version != VERSION:
+        raise PatchError('not a patch')
+    return source_size, source_crc, target_size, target_crc
+
+
+def _read_varint(ops, i):
+    value = 0
+    shift = 0
+    while True:
+        if i >= len(ops):
+            raise PatchError('operation stream truncated')
+        byte = ops[i]
+        i += 1
+        value |= (byte & 0x7F) << shift
+        shift += 7
+        if not byte & 0x80:
+            return value, i
+
+
+def apply_patch(old, patch):
+    """Reference applier; the device runs the same steps incrementally"""
+    source_size, source_crc, target_size, target_crc = parse_header(patch)
+    if len(old) != source_size or zlib.crc32(old) & 0xFFFFFFFF != source_crc:
+        raise PatchError('patch was made for a different image')
+
+    ops = zlib.decompress(patch[HEADER.size:])
+    out = bytearray()
+    cursor = 0
+    i = 0
+    while True:
+        if i >= len(ops):
+            raise PatchError('operation stream truncated')
+        op = ops[i]
+        i += 1
+        if op == OP_END:
+            break
+        if op == OP_COPY:
+            length, i = _read_varint(ops, i)
+            zz, i = _read_varint(ops, i)
+            start = cursor + ((zz >> 1) ^ -(zz & 1))
+            if start < 0 or start + length > len(old):
+                raise PatchError('copy outside source')
+            out += old[start:start + length]
+            cursor = start + length
+        elif op == OP_INSERT:
+            length, i = _read_varint(ops, i)
+            out += ops[i:i + length]
+            i += length
+        else:
+            raise PatchError('bad operation 0x%02x' % op)
+
+    if i != len(ops):
+        raise PatchError('data after END')
+    if len(out) != target_size or zlib.crc32(out) & 0xFFFFFFFF != target_crc:
+        raise PatchError('target mismatch')
+    return bytes(out)
+
+
+def sign(data, secret):
+    """Signature of a patch or image as the controller checks it"""
+    return hmac.new(secret.encode(), data, hashlib.sha256).hexdigest()
+
+
+def upload(host, data, filename, secret, timeout=120):
+    """POST a signed patch or image to /update as multipart form data"""
+    boundary = uuid.uuid4().hex
+    body = (('--%s\r\nContent-Disposition: form-data; name="firmware"; filename="%s"\r\n'
+             'Content-Type: application/octet-stream\r\n\r\n') % (boundary, filename)).encode()
+    body += data + ('\r\n--%s--\r\n' % boundary).encode()
+
+    request = urllib.request.Request('http://%s/update' % host, data=body, method='POST')
+    request.add_header('Content-Type', 'multipart/form-data; boundary=%s' % boundary)
+    request.add_header('X-OTA-Signature', sign(data, secret))
+    with urllib.request.urlopen(request, timeout=timeout) as response:
+        return response.status, response.read().decode(errors='replace')
+
+
+def _read(path):
+    with open(path, 'rb') as f:
+        return f.read()
+
+
+def _write(path, data):
+    with open(path, 'wb') as f:
+        f.write(data)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='DrishtiGuide OTA Patch Tool')
+    commands = parser.add_subparsers(dest='command', required=True)
+
+    make = commands.add_parser('make', help='Build a patch from the running image to a new one')
+    make.add_argument('old', help='Image currently on the controller')
+    make.add_argument('new', help='Image to install')
+    make.add_argument('-o', '--output', required=True, help='Patch file to write')
+
+    apply = commands.add_parser('apply', help='Apply a patch on the host to verify it')
+    apply.add_argument('old')
+    apply.add_argument('patch')
+    apply.add_argument('-o', '--output', required=True)
+
+    send = commands.add_parser('upload', help='Upload a patch or full image')
+    send.add_argument('file')
+    send.add_argument('--host', default='192.168.4.1', help='Controller address')
+    send.add_argument('--secret', default=os.environ.get('OTA_SECRET'),
+                      help='OTA_SECRET of the controller (default: $OTA_SECRET)')
+
+    args = parser.parse_args()
+
+    try:
+        if args.command == 'make':
+            old = _read(args.old)
+            new = _read(args.new)
+            start = time.time()
+            patch = make_patch(old, new)
+            _write(args.output, patch)
+            print('Patch: %d bytes for a %d byte image (%.1f%%) in %.1f s' %
+                  (len(patch), len(new), 100.0 * len(patch) / max(len(new), 1), time.time() - start))
+        elif args.command == 'apply':
+            _write(args.output, apply_patch(_read(args.old), _read(args.patch)))
+            print('Applied: %s' % args.output)
+        elif args.command == 'upload':
+            if not args.secret:
+                print('Error: --secret or $OTA_SECRET is required', file=sys.stderr)
+                return 1
+            data = _read(args.file)
+            start = time.time()
+            status, text = upload(args.host, data, args.file.split('/')[-1], args.secret)
+            print('HTTP %d in %.1f s: %s' % (status, time.time() - start, text))
+            return 0 if status == 200 else 1
+    except (PatchError, OSError, zlib.error) as e:
+        print('Error: %s' % e, file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
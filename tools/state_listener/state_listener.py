@@ -0,0 +1,181 @@
+#!/usr/bin/env python3
+"""
+DrishtiGuide State Listener
+
+Client library and command-line listener for the state snapshots the
+ESP32 controller broadcasts over UDP on its access point subnet. The
+packet layout matches state_broadcast.h: 32 bytes, little endian.
+
+Usage on a laptop or phone joined to BlindStick_AP:
+    python3 state_listener.py            # one line per state update
+    python3 state_listener.py --json     # one JSON object per line
+"""
+
+import argparse
+import json
+import socket
+import struct
+import sys
+import time
+from dataclasses import dataclass, asdict
+
+DEFAULT_PORT = 4210
+MAGIC = 0x5344          # "DS"
+VERSION = 1
+PACKET = struct.Struct('<HBBIIiiIIHBB')
+
+FLAG_GPS_FIX = 0x01
+FLAG_ALERT = 0x02
+FLAG_BATTERY_LOW = 0x04
+FLAG_STILL = 0x08
+FLAG_URGENT = 0x10
+
+NO_FALL = 0xFFFFFFFF
+
+
+@dataclass
+class StateSnapshot:
+    flags: int
+    sequence: int
+    uptime_ms: int
+    latitude: float
+    longitude: float
+    last_fall_s: object     # None if no fall since boot
+    version: int
+    falls: int
+    battery_level: int
+    wifi_clients: int
+
+    @property
+    def gps_fix(self):
+        return bool(self.flags & FLAG_GPS_FIX)
+
+    @property
+    def alert(self):
+        return bool(self.flags & FLAG_ALERT)
+
+    @property
+    def battery_low(self):
+        return bool(self.flags & FLAG_BATTERY_LOW)
+
+    @property
+    def still(self):
+        return bool(self.flags & FLAG_STILL)
+
+    @property
+    def urgent(self):
+        return bool(self.flags & FLAG_URGENT)
+
+
+def decode(data):
+    """StateSnapshot from a packet; ValueError if it is not one"""
+    if len(data) < PACKET.size:
+        raise ValueError('packet too short')
+    (magic, version, flags, sequence, uptime_ms, lat, lon,
+     last_fall, field_version, falls, battery, clients) = PACKET.unpack_from(data)
+    if magic != MAGIC or version < VERSION:
+        raise ValueError('not a state packet')
+    return StateSnapshot(flags, sequence, uptime_ms, lat / 1e6, lon / 1e6,
+                         None if last_fall == NO_FALL else last_fall,
+                         field_version, falls, battery, clients)
+
+
+class StateTracker:
+    """Drops repeated copies and counts packets lost between updates"""
+
+    def __init__(self):
+        self.last = None
+        self.received = 0
+        self.duplicates = 0
+        self.lost = 0
+        self.restarts = 0
+
+    def accept(self, snapshot):
+        """True if the snapshot is new, False for a repeat"""
+        last = self.last
+        if last is not None:
+            if snapshot.sequence == last.sequence and snapshot.uptime_ms >= last.uptime_ms:
+                self.duplicates += 1
+                return False
+            if snapshot.sequence < last.sequence or snapshot.uptime_ms < last.uptime_ms:
+                self.restarts += 1          # The controller rebooted
+            else:
+                self.lost += snapshot.sequence - last.sequence - 1
+        self.last = snapshot
+        self.received += 1
+        return True
+
+
+class StateListener:
+    """Receives and decodes broadcasts on the given UDP port"""
+
+    def __init__(self, port=DEFAULT_PORT, address=''):
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        self.sock.setsockopt(socket.SOL_SOCKET, socket.SO_BROADCAST, 1)
+        self.sock.bind((address, port))
+        self.tracker = StateTracker()
+
+    def receive(self, timeout=None):
+        """Next new snapshot, or None on timeout"""
+        self.sock.settimeout(timeout)
+        deadline = None if timeout is None else time.monotonic() + timeout
+        while True:
+            try:
+                data, _ = self.sock.recvfrom(256)
+            except socket.timeout:
+                return None
+            try:
+                snapshot = decode(data)
+            except ValueError:
+                continue
+            if self.tracker.accept(snapshot):
+                return snapshot
+            if deadline is not None:
+                remaining = deadline - time.monotonic()
+                if remaining <= 0:
+                    return None
+                self.sock.settimeout(remaining)
+
+    def close(self):
+        self.sock.close()
+
+
+def format_line(s):
+    state = 'ALERT' if s.alert else 'ok'
+    fall = '-' if s.last_fall_s is None else '%ds' % s.last_fall_s
+    return ('#%-6d %8.1fs %-5s %s gps=%s %.6f,%.6f falls=%d last=%s battery=%d%%%s clients=%d' %
+            (s.sequence, s.uptime_ms / 1000.0, state, 'still ' if s.still else 'moving',
+             'fix' if s.gps_fix else 'none', s.latitude, s.longitude, s.falls, fall,
+             s.battery_level, ' LOW' if s.battery_low else '', s.wifi_clients))
+
+
+def main():
+    parser = argparse.ArgumentParser(description='DrishtiGuide State Listener')
+    parser.add_argument('--port', type=int, default=DEFAULT_PORT, help='UDP port')
+    parser.add_argument('--json', action='store_true', help='Print JSON lines')
+    parser.add_argument('--count', type=int, default=0, help='Stop after this many updates')
+    args = parser.parse_args()
+
+    listener = StateListener(args.port)
+    updates = 0
+    try:
+        while args.count == 0 or updates < args.count:
+            s = listener.receive()
+            updates += 1
+            if args.json:
+                print(json.dumps(asdict(s)), flush=True)
+            else:
+                print(format_line(s), flush=True)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        t = listener.tracker
+        print('received %d, repeats %d, lost %d, restarts %d' %
+              (t.received, t.duplicates, t.lost, t.restarts), file=sys.stderr)
+        listener.close()
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
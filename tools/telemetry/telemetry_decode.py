@@ -0,0 +1,158 @@
+#!/usr/bin/env python3
+"""
+DrishtiGuide Telemetry Decoder
+
+Decodes the telemetry batches the ESP32 controller publishes to its MQTT
+broker (topic <prefix>/<device>/telemetry). The batch format matches
+telemetry_export.h: a version byte, then one tagged record per summary,
+fall or track point with varint times and delta-coded coordinates.
+
+Usage with mosquitto:
+    mosquitto_sub -t 'drishti/+/telemetry' -F %x | python3 telemetry_decode.py
+    mosquitto_sub -t 'drishti/+/telemetry' -F %x | python3 telemetry_decode.py --json
+"""
+
+import argparse
+import json
+import sys
+from dataclasses import dataclass, asdict
+
+BATCH_VERSION = 1
+TAG_ABSOLUTE = 0x80
+
+SUMMARY = 1
+FALL = 2
+TRACK = 3
+TYPE_NAMES = {SUMMARY: 'summary', FALL: 'fall', TRACK: 'track'}
+
+FLAG_GPS_FIX = 0x01
+FLAG_BATTERY_LOW = 0x02
+FLAG_ALERT = 0x04
+
+
+@dataclass
+class TelemetryRecord:
+    type: str
+    boot: int
+    uptime_s: int
+    latitude: object = None         # Falls and track points
+    longitude: object = None
+    battery_level: object = None    # Summaries
+    flags: object = None
+    active_s: object = None
+    falls: object = None
+
+
+class _Reader:
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0
+
+    def done(self):
+        return self.pos >= len(self.data)
+
+    def byte(self):
+        if self.done():
+            raise ValueError('batch truncated')
+        value = self.data[self.pos]
+        self.pos += 1
+        return value
+
+    def varint(self):
+        value = 0
+        shift = 0
+        while True:
+            b = self.byte()
+            value |= (b & 0x7F) << shift
+            if not b & 0x80:
+                return value
+            shift += 7
+            if shift > 35:
+                raise ValueError('varint too long')
+
+    def zigzag(self):
+        value = self.varint()
+        return (value >> 1) ^ -(value & 1)
+
+
+def decode(payload):
+    """Records of one batch, oldest first; ValueError if it is not one"""
+    reader = _Reader(bytes(payload))
+    if reader.byte() != BATCH_VERSION:
+        raise ValueError('unknown batch version')
+
+    records = []
+    boot = uptime = lat = lon = 0
+    while not reader.done():
+        tag = reader.byte()
+        kind = tag & ~TAG_ABSOLUTE
+        if kind not in TYPE_NAMES:
+            raise ValueError('unknown record type %d' % kind)
+        if tag & TAG_ABSOLUTE:
+            boot = reader.varint()
+            uptime = reader.varint()
+        elif not records:
+            raise ValueError('first record has no time')
+        else:
+            uptime += reader.varint()
+
+        record = TelemetryRecord(TYPE_NAMES[kind], boot, uptime)
+        if kind == SUMMARY:
+            record.battery_level = reader.byte()
+            record.flags = reader.byte()
+            record.active_s = reader.varint()
+            record.falls = reader.varint()
+        else:
+            lat += reader.zigzag()
+            lon += reader.zigzag()
+            record.latitude = lat / 1e6
+            record.longitude = lon / 1e6
+        records.append(record)
+    return records
+
+
+def format_record(r):
+    head = '%-7s boot %-4d %7ds' % (r.type, r.boot, r.uptime_s)
+    if r.type == 'summary':
+        flags = [name for bit, name in ((FLAG_GPS_FIX, 'gps'), (FLAG_BATTERY_LOW, 'battery-low'),
+                                        (FLAG_ALERT, 'alert')) if r.flags & bit]
+        return '%s  battery %3d%%  active %4ds  falls %d  %s' % (
+            head, r.battery_level, r.active_s, r.falls, ' '.join(flags))
+    return '%s  %.6f, %.6f' % (head, r.latitude, r.longitude)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Decode DrishtiGuide telemetry batches')
+    parser.add_argument('input', nargs='?', help='File of hex batches, one per line (default: stdin)')
+    parser.add_argument('--json', action='store_true', help='One JSON object per record')
+    args = parser.parse_args()
+
+    stream = open(args.input) if args.input else sys.stdin
+    status = 0
+    try:
+        for line in stream:
+            line = line.strip()
+            if not line:
+                continue
+            try:
+                records = decode(bytes.fromhex(line))
+            except ValueError as e:
+                print('Skipped batch: %s' % e, file=sys.stderr)
+                status = 1
+                continue
+            for r in records:
+                if args.json:
+                    print(json.dumps({k: v for k, v in asdict(r).items() if v is not None}))
+                else:
+                    print(format_record(r))
+            sys.stdout.flush()
+    except KeyboardInterrupt:
+        pass
+    finally:
+        if args.input:
+            stream.close()
+    return status
+
+
+if __name__ == '__main__':
+    sys.exit(main())